@@ -75,6 +75,18 @@ AboutDialog::AboutDialog(QWidget* parent, Qt::WFlags f)
     thanksLabel->setWordWrap(true);
     tabStack->addTab(thanksLabel, "Thanks");
 
+    performanceLabel = new QLabel;
+    performanceLabel->setPalette(QPalette(QColor(255, 255, 255)));
+    performanceLabel->setFrameShape(QLabel::StyledPanel);
+    performanceLabel->setFrameShadow(QLabel::Sunken);
+    performanceLabel->setLineWidth(2);
+    performanceLabel->setMargin(2);
+    performanceLabel->setAlignment(Qt::AlignLeft | Qt::AlignTop);
+    performanceLabel->setSizePolicy(QSizePolicy::Minimum,
+                                    QSizePolicy::Minimum);
+    performanceLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    tabStack->addTab(performanceLabel, "Performance");
+
     QHBoxLayout* buttonHlay = new QHBoxLayout;
     buttonHlay->setSpacing(SPACING);
     mainVlay->addLayout(buttonHlay);
@@ -98,3 +110,16 @@ AboutDialog::AboutDialog(QWidget* parent, Qt::WFlags f)
 AboutDialog::~AboutDialog()
 {
 }
+
+//---------------------------------------------------------------------------
+//  setPerformanceReport
+//
+//! Set the report shown on the Performance tab.
+//
+//! @param report the report, as returned by WordEngine::getPerformanceReport
+//---------------------------------------------------------------------------
+void
+AboutDialog::setPerformanceReport(const QString& report)
+{
+    performanceLabel->setText(report);
+}
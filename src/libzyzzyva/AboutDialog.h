@@ -26,6 +26,7 @@
 #define ZYZZYVA_ABOUT_DIALOG_H
 
 #include <QDialog>
+#include <QLabel>
 
 class AboutDialog : public QDialog
 {
@@ -33,6 +34,11 @@ class AboutDialog : public QDialog
     public:
     AboutDialog(QWidget* parent = 0, Qt::WFlags f = 0);
     ~AboutDialog();
+
+    void setPerformanceReport(const QString& report);
+
+    private:
+    QLabel* performanceLabel;
 };
 
 #endif // ZYZZYVA_ABOUT_DIALOG_H
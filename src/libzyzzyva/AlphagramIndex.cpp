@@ -0,0 +1,294 @@
+//---------------------------------------------------------------------------
+// AlphagramIndex.cpp
+//
+// A class for looking up the anagrams of a set of letters.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#include "AlphagramIndex.h"
+#include "LexiconBundle.h"
+#include <QHash>
+#include <QPair>
+#include <QTime>
+#include <QtAlgorithms>
+#include <cstring>
+
+//---------------------------------------------------------------------------
+//  AlphagramIndex
+//
+//! Constructor.
+//---------------------------------------------------------------------------
+AlphagramIndex::AlphagramIndex()
+    : groupData(0), bucketData(0), numGroups(0), numBuckets(0), numWords(0),
+      buildTime(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  clear
+//
+//! Remove all words from the index.
+//---------------------------------------------------------------------------
+void
+AlphagramIndex::clear()
+{
+    keyData.clear();
+    wordData.clear();
+    groups.clear();
+    buckets.clear();
+    groupData = 0;
+    bucketData = 0;
+    numGroups = 0;
+    numBuckets = 0;
+    numWords = 0;
+    buildTime = 0;
+}
+
+//---------------------------------------------------------------------------
+//  build
+//
+//! Build the index from a list of words.  Any words already in the index
+//! are removed.
+//
+//! @param words the words, in upper case
+//---------------------------------------------------------------------------
+void
+AlphagramIndex::build(const QList<QByteArray>& words)
+{
+    QTime timer;
+    timer.start();
+
+    clear();
+
+    // Sort words by alphagram, then by word, so that each group of anagrams
+    // is contiguous and in order
+    QVector<QPair<QByteArray, QByteArray> > entries;
+    entries.reserve(words.size());
+    int totalLength = 0;
+    foreach (const QByteArray& word, words) {
+        QByteArray key = word;
+        qSort(key.begin(), key.end());
+        entries.append(qMakePair(key, word));
+        totalLength += word.length();
+    }
+    qSort(entries.begin(), entries.end());
+
+    wordData.reserve(totalLength);
+    for (int i = 0; i < entries.size(); ++i) {
+        const QByteArray& key = entries.at(i).first;
+        if (!i || (key != entries.at(i - 1).first)) {
+            Group group;
+            group.keyOffset = keyData.size();
+            group.wordOffset = wordData.size();
+            group.length = key.length();
+            keyData.append(key);
+            groups.append(group);
+        }
+        wordData.append(entries.at(i).second);
+        ++groups.last().numWords;
+    }
+    numWords = entries.size();
+
+    // Keep the hash table at most half full
+    int tableSize = 1;
+    while (tableSize < 2 * groups.size())
+        tableSize <<= 1;
+    buckets.fill(0, tableSize);
+
+    uint mask = tableSize - 1;
+    for (int i = 0; i < groups.size(); ++i) {
+        const Group& group = groups.at(i);
+        QByteArray key = QByteArray::fromRawData(
+            keyData.constData() + group.keyOffset, group.length);
+        uint bucket = qHash(key) & mask;
+        while (buckets.at(bucket))
+            bucket = (bucket + 1) & mask;
+        buckets[bucket] = i + 1;
+    }
+
+    groupData = groups.constData();
+    bucketData = buckets.constData();
+    numGroups = groups.size();
+    numBuckets = buckets.size();
+    buildTime = timer.elapsed();
+}
+
+//---------------------------------------------------------------------------
+//  attachBundle
+//
+//! Use the index held by a lexicon bundle in place.  Any words already in
+//! the index are removed.  The hash table is only valid for the hash
+//! function it was built with, which is why a bundle is only opened by the
+//! Qt version that built it.  The bundle must stay open while the index is
+//! in use.
+//
+//! @param bundle the bundle
+//! @param numBundleWords the number of words in the lexicon
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+AlphagramIndex::attachBundle(const LexiconBundle& bundle, int
+                             numBundleWords)
+{
+    clear();
+
+    QByteArray groupSection =
+        bundle.getSection(LexiconBundle::AlphagramGroups);
+    QByteArray bucketSection =
+        bundle.getSection(LexiconBundle::AlphagramBuckets);
+    int bundleGroups = groupSection.size() / int(sizeof(Group));
+    int bundleBuckets = bucketSection.size() / int(sizeof(quint32));
+    if ((groupSection.size() % int(sizeof(Group))) ||
+        (bucketSection.size() % int(sizeof(quint32))) ||
+        (bundleBuckets <= bundleGroups) ||
+        (bundleBuckets & (bundleBuckets - 1)))
+    {
+        return false;
+    }
+
+    keyData = bundle.getSection(LexiconBundle::AlphagramKeys);
+    wordData = bundle.getSection(LexiconBundle::AlphagramWords);
+    groupData = (const Group*) groupSection.constData();
+    bucketData = (const quint32*) bucketSection.constData();
+    numGroups = bundleGroups;
+    numBuckets = bundleBuckets;
+    numWords = numBundleWords;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  writeBundle
+//
+//! Add the index to a lexicon bundle.  The sections are not copied, so the
+//! index must not be changed until the bundle is saved.
+//
+//! @param bundle the bundle
+//---------------------------------------------------------------------------
+void
+AlphagramIndex::writeBundle(LexiconBundle& bundle) const
+{
+    bundle.setSection(LexiconBundle::AlphagramKeys, keyData);
+    bundle.setSection(LexiconBundle::AlphagramWords, wordData);
+    bundle.setSection(LexiconBundle::AlphagramGroups,
+        QByteArray::fromRawData((const char*) groupData,
+                                numGroups * sizeof(Group)));
+    bundle.setSection(LexiconBundle::AlphagramBuckets,
+        QByteArray::fromRawData((const char*) bucketData,
+                                numBuckets * sizeof(quint32)));
+}
+
+//---------------------------------------------------------------------------
+//  getAnagrams
+//
+//! Get the words that are anagrams of a set of letters.
+//
+//! @param letters the letters
+//! @return a list of anagrams, in alphabetical order
+//---------------------------------------------------------------------------
+QStringList
+AlphagramIndex::getAnagrams(const QString& letters) const
+{
+    QStringList anagrams;
+    int index = findGroup(getKey(letters));
+    if (index < 0)
+        return anagrams;
+
+    const Group& group = groupData[index];
+    const char* word = wordData.constData() + group.wordOffset;
+    for (int i = 0; i < group.numWords; ++i, word += group.length)
+        anagrams.append(QString::fromLatin1(word, group.length));
+
+    return anagrams;
+}
+
+//---------------------------------------------------------------------------
+//  getNumAnagrams
+//
+//! Get the number of words that are anagrams of a set of letters.
+//
+//! @param letters the letters
+//! @return the number of anagrams
+//---------------------------------------------------------------------------
+int
+AlphagramIndex::getNumAnagrams(const QString& letters) const
+{
+    int index = findGroup(getKey(letters));
+    return (index < 0) ? 0 : groupData[index].numWords;
+}
+
+//---------------------------------------------------------------------------
+//  getMemoryUsage
+//
+//! Get the number of bytes allocated by the index.
+//
+//! @return the memory usage in bytes
+//---------------------------------------------------------------------------
+qint64
+AlphagramIndex::getMemoryUsage() const
+{
+    return qint64(keyData.capacity()) + wordData.capacity() +
+        qint64(groups.capacity()) * sizeof(Group) +
+        qint64(buckets.capacity()) * sizeof(quint32);
+}
+
+//---------------------------------------------------------------------------
+//  getKey
+//
+//! Get the key used to look up a set of letters.
+//
+//! @param letters the letters
+//! @return the key
+//---------------------------------------------------------------------------
+QByteArray
+AlphagramIndex::getKey(const QString& letters)
+{
+    QByteArray key = letters.toUpper().toLatin1();
+    qSort(key.begin(), key.end());
+    return key;
+}
+
+//---------------------------------------------------------------------------
+//  findGroup
+//
+//! Find the group of anagrams with a key.
+//
+//! @param key the key
+//! @return the index of the group, or -1 if not found
+//---------------------------------------------------------------------------
+int
+AlphagramIndex::findGroup(const QByteArray& key) const
+{
+    if (!numBuckets)
+        return -1;
+
+    uint mask = numBuckets - 1;
+    uint bucket = qHash(key) & mask;
+    while (quint32 entry = bucketData[bucket]) {
+        const Group& group = groupData[entry - 1];
+        if ((group.length == key.length()) &&
+            !memcmp(keyData.constData() + group.keyOffset, key.constData(),
+                    group.length))
+        {
+            return entry - 1;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+    return -1;
+}
@@ -0,0 +1,82 @@
+//---------------------------------------------------------------------------
+// AlphagramIndex.h
+//
+// A class for looking up the anagrams of a set of letters.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#ifndef ZYZZYVA_ALPHAGRAM_INDEX_H
+#define ZYZZYVA_ALPHAGRAM_INDEX_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class LexiconBundle;
+
+// Words are stored in flat arrays grouped by alphagram, with an open
+// addressing hash table mapping each alphagram to its group.
+class AlphagramIndex
+{
+    public:
+    AlphagramIndex();
+    ~AlphagramIndex() { }
+
+    void clear();
+    void build(const QList<QByteArray>& words);
+    bool attachBundle(const LexiconBundle& bundle, int numBundleWords);
+    void writeBundle(LexiconBundle& bundle) const;
+    QStringList getAnagrams(const QString& letters) const;
+    int getNumAnagrams(const QString& letters) const;
+    int getNumWords() const { return numWords; }
+    int getNumAlphagrams() const { return numGroups; }
+    qint64 getMemoryUsage() const;
+    int getBuildTime() const { return buildTime; }
+
+    private:
+    class Group {
+      public:
+        Group() : keyOffset(0), wordOffset(0), numWords(0), length(0) { }
+        quint32 keyOffset;
+        quint32 wordOffset;
+        quint16 numWords;
+        quint8 length;
+    };
+
+    static QByteArray getKey(const QString& letters);
+    int findGroup(const QByteArray& key) const;
+
+    QByteArray keyData;
+    QByteArray wordData;
+    QVector<Group> groups;
+    QVector<quint32> buckets;
+
+    // The groups and the hash table, in the vectors or in a lexicon bundle
+    const Group* groupData;
+    const quint32* bucketData;
+    int numGroups;
+    int numBuckets;
+    int numWords;
+    int buildTime;
+};
+
+#endif // ZYZZYVA_ALPHAGRAM_INDEX_H
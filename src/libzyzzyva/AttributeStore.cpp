@@ -0,0 +1,392 @@
+//---------------------------------------------------------------------------
+// AttributeStore.cpp
+//
+// A class for holding the numeric attributes of every word in a lexicon.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#include "AttributeStore.h"
+#include "LexiconBundle.h"
+#include "WordGraph.h"
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QTime>
+#include <QVariant>
+
+// The database column holding each attribute, in order
+const QString ATTRIBUTE_COLUMNS =
+    "length, num_vowels, num_unique_letters, point_value, num_anagrams, "
+    "playability_order, min_playability_order, max_playability_order, "
+    "probability_order0, min_probability_order0, max_probability_order0, "
+    "probability_order1, min_probability_order1, max_probability_order1, "
+    "probability_order2, min_probability_order2, max_probability_order2";
+
+//---------------------------------------------------------------------------
+//  AttributeStore
+//
+//! Constructor.
+//---------------------------------------------------------------------------
+AttributeStore::AttributeStore()
+    : numWords(0), loadTime(0)
+{
+    clear();
+}
+
+//---------------------------------------------------------------------------
+//  clear
+//
+//! Remove all words from the store.
+//---------------------------------------------------------------------------
+void
+AttributeStore::clear()
+{
+    for (int i = 0; i < NUM_BYTE_ATTRIBUTES; ++i) {
+        byteColumns[i] = QVector<quint8>();
+        byteData[i] = 0;
+    }
+    for (int i = 0; i < NUM_ORDER_ATTRIBUTES; ++i) {
+        orderColumns[i] = QVector<quint32>();
+        orderData[i] = 0;
+    }
+    numWords = 0;
+    loadTime = 0;
+}
+
+//---------------------------------------------------------------------------
+//  load
+//
+//! Load the attributes of every word from a lexicon database.  Any words
+//! already in the store are removed.  The database must hold exactly the
+//! words in the word graph, otherwise the store is left empty.
+//
+//! @param db the lexicon database
+//! @param graph the word graph, used to number the words
+//! @param errString returns the error string in case of error
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+AttributeStore::load(const QSqlDatabase& db, const WordGraph* graph,
+                     QString* errString)
+{
+    QTime timer;
+    timer.start();
+
+    clear();
+
+    int size = graph->getNumWords();
+    if (!size) {
+        if (errString)
+            *errString = "The word graph is empty.";
+        return false;
+    }
+
+    for (int i = 0; i < NUM_BYTE_ATTRIBUTES; ++i)
+        byteColumns[i].fill(0, size);
+    for (int i = 0; i < NUM_ORDER_ATTRIBUTES; ++i)
+        orderColumns[i].fill(0, size);
+
+    QSqlQuery query (db);
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT word, " + ATTRIBUTE_COLUMNS +
+                    " FROM words"))
+    {
+        if (errString)
+            *errString = query.lastError().text();
+        clear();
+        return false;
+    }
+
+    QVector<bool> loaded (size, false);
+    int numLoaded = 0;
+    while (query.next()) {
+        int id = graph->getWordId(query.value(0).toString());
+        if ((id < 0) || loaded.at(id))
+            continue;
+        loaded[id] = true;
+        ++numLoaded;
+
+        for (int i = 0; i < NUM_BYTE_ATTRIBUTES; ++i) {
+            byteColumns[i][id] =
+                quint8(qMin(query.value(i + 1).toUInt(), 0xFFu));
+        }
+        for (int i = 0; i < NUM_ORDER_ATTRIBUTES; ++i) {
+            orderColumns[i][id] =
+                query.value(NUM_BYTE_ATTRIBUTES + i + 1).toUInt();
+        }
+    }
+
+    if (numLoaded != size) {
+        if (errString) {
+            *errString = QString("The database holds %1 of the %2 words "
+                                 "in the lexicon.").arg(numLoaded).arg(size);
+        }
+        clear();
+        return false;
+    }
+
+    for (int i = 0; i < NUM_BYTE_ATTRIBUTES; ++i)
+        byteData[i] = byteColumns[i].constData();
+    for (int i = 0; i < NUM_ORDER_ATTRIBUTES; ++i)
+        orderData[i] = orderColumns[i].constData();
+
+    numWords = size;
+    loadTime = timer.elapsed();
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  attachBundle
+//
+//! Use the attributes held by a lexicon bundle in place.  Any words already
+//! in the store are removed.  The bundle must stay open while the store is
+//! in use.
+//
+//! @param bundle the bundle
+//! @param numBundleWords the number of words in the lexicon
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+AttributeStore::attachBundle(const LexiconBundle& bundle, int
+                             numBundleWords)
+{
+    QTime timer;
+    timer.start();
+
+    clear();
+    if (numBundleWords <= 0)
+        return false;
+
+    for (int i = 0; i < NumAttributes; ++i) {
+        QByteArray section =
+            bundle.getSection(LexiconBundle::AttributeColumns + i);
+        int valueSize = (i < NUM_BYTE_ATTRIBUTES) ? sizeof(quint8)
+                                                  : sizeof(quint32);
+        if (section.size() != numBundleWords * valueSize) {
+            clear();
+            return false;
+        }
+
+        if (i < NUM_BYTE_ATTRIBUTES)
+            byteData[i] = (const quint8*) section.constData();
+        else {
+            orderData[i - NUM_BYTE_ATTRIBUTES] =
+                (const quint32*) section.constData();
+        }
+    }
+
+    numWords = numBundleWords;
+    loadTime = timer.elapsed();
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  writeBundle
+//
+//! Add the attributes to a lexicon bundle, if they are loaded.  The
+//! sections are not copied, so the store must not be changed until the
+//! bundle is saved.
+//
+//! @param bundle the bundle
+//---------------------------------------------------------------------------
+void
+AttributeStore::writeBundle(LexiconBundle& bundle) const
+{
+    if (isEmpty())
+        return;
+
+    for (int i = 0; i < NUM_BYTE_ATTRIBUTES; ++i) {
+        bundle.setSection(LexiconBundle::AttributeColumns + i,
+            QByteArray::fromRawData((const char*) byteData[i],
+                                    numWords * sizeof(quint8)));
+    }
+    for (int i = 0; i < NUM_ORDER_ATTRIBUTES; ++i) {
+        bundle.setSection(
+            LexiconBundle::AttributeColumns + NUM_BYTE_ATTRIBUTES + i,
+            QByteArray::fromRawData((const char*) orderData[i],
+                                    numWords * sizeof(quint32)));
+    }
+}
+
+//---------------------------------------------------------------------------
+//  getValue
+//
+//! Get the value of an attribute of a word.
+//
+//! @param attribute the attribute
+//! @param id the number of the word, as returned by WordGraph::getWordId
+//! @return the value
+//---------------------------------------------------------------------------
+quint32
+AttributeStore::getValue(Attribute attribute, int id) const
+{
+    if ((id < 0) || (id >= numWords))
+        return 0;
+    if (attribute < NUM_BYTE_ATTRIBUTES)
+        return byteData[attribute][id];
+    return orderData[attribute - NUM_BYTE_ATTRIBUTES][id];
+}
+
+//---------------------------------------------------------------------------
+//  selectColumn
+//
+//! Find the entries of a column in a range of values.  The comparison and
+//! the store are done for every entry, with no branch on the value, so the
+//! loop runs at the speed of memory.
+//
+//! @param values the values of the column
+//! @param size the number of entries in the column
+//! @param minValue the minimum value
+//! @param maxValue the maximum value
+//! @param ids return the indexes of the entries, in increasing order
+//---------------------------------------------------------------------------
+template<typename T> void
+AttributeStore::selectColumn(const T* values, int size, quint32 minValue,
+                             quint32 maxValue, QVector<int>& ids)
+{
+    ids.clear();
+    if (minValue > maxValue)
+        return;
+
+    ids.resize(size);
+    int* out = ids.data();
+    quint32 range = maxValue - minValue;
+    int count = 0;
+    for (int i = 0; i < size; ++i) {
+        out[count] = i;
+        count += (quint32(values[i]) - minValue <= range);
+    }
+    ids.resize(count);
+}
+
+//---------------------------------------------------------------------------
+//  filterColumn
+//
+//! Remove the indexes of entries of a column not in a range of values.
+//
+//! @param values the values of the column
+//! @param minValue the minimum value
+//! @param maxValue the maximum value
+//! @param ids the indexes of the entries
+//---------------------------------------------------------------------------
+template<typename T> void
+AttributeStore::filterColumn(const T* values, quint32 minValue,
+                             quint32 maxValue, QVector<int>& ids)
+{
+    if (minValue > maxValue) {
+        ids.clear();
+        return;
+    }
+
+    int size = ids.size();
+    int* data = ids.data();
+    quint32 range = maxValue - minValue;
+    int count = 0;
+    for (int i = 0; i < size; ++i) {
+        int id = data[i];
+        data[count] = id;
+        count += (quint32(values[id]) - minValue <= range);
+    }
+    ids.resize(count);
+}
+
+//---------------------------------------------------------------------------
+//  select
+//
+//! Find the words with an attribute in a range of values.
+//
+//! @param attribute the attribute
+//! @param minValue the minimum value
+//! @param maxValue the maximum value
+//! @return the numbers of the words, in increasing order
+//---------------------------------------------------------------------------
+QVector<int>
+AttributeStore::select(Attribute attribute, quint32 minValue, quint32
+                       maxValue) const
+{
+    QVector<int> ids;
+    if (attribute < NUM_BYTE_ATTRIBUTES) {
+        selectColumn(byteData[attribute], numWords, minValue, maxValue, ids);
+    }
+    else {
+        selectColumn(orderData[attribute - NUM_BYTE_ATTRIBUTES], numWords,
+                     minValue, maxValue, ids);
+    }
+    return ids;
+}
+
+//---------------------------------------------------------------------------
+//  filter
+//
+//! Remove the words without an attribute in a range of values from a list
+//! of words.  The words remaining are left in the same order.
+//
+//! @param attribute the attribute
+//! @param minValue the minimum value
+//! @param maxValue the maximum value
+//! @param ids the numbers of the words
+//---------------------------------------------------------------------------
+void
+AttributeStore::filter(Attribute attribute, quint32 minValue, quint32
+                       maxValue, QVector<int>& ids) const
+{
+    if (attribute < NUM_BYTE_ATTRIBUTES) {
+        filterColumn(byteData[attribute], minValue, maxValue, ids);
+    }
+    else {
+        filterColumn(orderData[attribute - NUM_BYTE_ATTRIBUTES], minValue,
+                     maxValue, ids);
+    }
+}
+
+//---------------------------------------------------------------------------
+//  getMemoryUsage
+//
+//! Get the number of bytes allocated by the store.
+//
+//! @return the memory usage in bytes
+//---------------------------------------------------------------------------
+qint64
+AttributeStore::getMemoryUsage() const
+{
+    qint64 bytes = 0;
+    for (int i = 0; i < NUM_BYTE_ATTRIBUTES; ++i)
+        bytes += byteColumns[i].capacity() * sizeof(quint8);
+    for (int i = 0; i < NUM_ORDER_ATTRIBUTES; ++i)
+        bytes += orderColumns[i].capacity() * sizeof(quint32);
+    return bytes;
+}
+
+//---------------------------------------------------------------------------
+//  getProbabilityOrder
+//
+//! Get the probability order attribute for a number of blanks.
+//
+//! @param numBlanks the number of blanks
+//! @return the attribute
+//---------------------------------------------------------------------------
+AttributeStore::Attribute
+AttributeStore::getProbabilityOrder(int numBlanks)
+{
+    switch (numBlanks) {
+        case 1:  return ProbabilityOrder1;
+        case 2:  return ProbabilityOrder2;
+        default: return ProbabilityOrder0;
+    }
+}
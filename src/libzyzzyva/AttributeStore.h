@@ -0,0 +1,103 @@
+//---------------------------------------------------------------------------
+// AttributeStore.h
+//
+// A class for holding the numeric attributes of every word in a lexicon.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#ifndef ZYZZYVA_ATTRIBUTE_STORE_H
+#define ZYZZYVA_ATTRIBUTE_STORE_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+
+class LexiconBundle;
+class WordGraph;
+
+// Each attribute is held in its own array, indexed by the number the word
+// graph assigns to each word, so a range condition on an attribute is a
+// single pass over one array.
+class AttributeStore
+{
+    public:
+    // Attributes small enough to be held in a byte come first
+    enum Attribute {
+        Length = 0,
+        NumVowels,
+        NumUniqueLetters,
+        PointValue,
+        NumAnagrams,
+        PlayabilityOrder,
+        MinPlayabilityOrder,
+        MaxPlayabilityOrder,
+        ProbabilityOrder0,
+        MinProbabilityOrder0,
+        MaxProbabilityOrder0,
+        ProbabilityOrder1,
+        MinProbabilityOrder1,
+        MaxProbabilityOrder1,
+        ProbabilityOrder2,
+        MinProbabilityOrder2,
+        MaxProbabilityOrder2,
+        NumAttributes
+    };
+
+    public:
+    AttributeStore();
+    ~AttributeStore() { }
+
+    void clear();
+    bool load(const QSqlDatabase& db, const WordGraph* graph,
+              QString* errString = 0);
+    bool attachBundle(const LexiconBundle& bundle, int numBundleWords);
+    void writeBundle(LexiconBundle& bundle) const;
+    bool isEmpty() const { return !numWords; }
+    int getNumWords() const { return numWords; }
+    quint32 getValue(Attribute attribute, int id) const;
+    QVector<int> select(Attribute attribute, quint32 minValue, quint32
+                        maxValue) const;
+    void filter(Attribute attribute, quint32 minValue, quint32 maxValue,
+                QVector<int>& ids) const;
+    qint64 getMemoryUsage() const;
+    int getLoadTime() const { return loadTime; }
+
+    static Attribute getProbabilityOrder(int numBlanks);
+
+    private:
+    template<typename T> static void selectColumn(const T* values, int
+        size, quint32 minValue, quint32 maxValue, QVector<int>& ids);
+    template<typename T> static void filterColumn(const T* values,
+        quint32 minValue, quint32 maxValue, QVector<int>& ids);
+
+    static const int NUM_BYTE_ATTRIBUTES = PlayabilityOrder;
+    static const int NUM_ORDER_ATTRIBUTES = NumAttributes - PlayabilityOrder;
+
+    QVector<quint8> byteColumns[NUM_BYTE_ATTRIBUTES];
+    QVector<quint32> orderColumns[NUM_ORDER_ATTRIBUTES];
+
+    // The values of each attribute, in the vectors or in a lexicon bundle
+    const quint8* byteData[NUM_BYTE_ATTRIBUTES];
+    const quint32* orderData[NUM_ORDER_ATTRIBUTES];
+    int numWords;
+    int loadTime;
+};
+
+#endif // ZYZZYVA_ATTRIBUTE_STORE_H
@@ -28,6 +28,7 @@
 #include <QApplication>
 #include <QDir>
 #include <QFile>
+#include <cstdio>
 #include <unistd.h>
 
 const QString SET_UNKNOWN_STRING = "Unknown";
@@ -204,6 +205,31 @@ Auxil::copyDir(const QString& src, const QString& dest)
     return true;
 }
 
+//---------------------------------------------------------------------------
+//  replaceFile
+//
+//! Move a file over another file.  Where the platform allows it, the
+//! destination is replaced in a single step, so it is never missing or
+//! incomplete.  Otherwise the destination is removed first.
+//
+//! @param src the file to move
+//! @param dest the file to replace
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+Auxil::replaceFile(const QString& src, const QString& dest)
+{
+    if (::rename(QFile::encodeName(src).constData(),
+                 QFile::encodeName(dest).constData()) == 0)
+    {
+        return true;
+    }
+
+    if (QFile::exists(dest) && !QFile::remove(dest))
+        return false;
+    return QFile::rename(src, dest);
+}
+
 //---------------------------------------------------------------------------
 //  getPid
 //
@@ -474,6 +500,30 @@ Auxil::getDatabaseFilename(const QString& lexicon)
     return (dbPath + "/" + lexicon + ".db");
 }
 
+//---------------------------------------------------------------------------
+//  getBundleFilename
+//
+//! Return the lexicon bundle filename that should be used for a lexicon.
+//! Bundles are kept with the lexicon databases.
+//
+//! @param lexicon the lexicon name
+//! @return the bundle filename, or empty string if error
+//---------------------------------------------------------------------------
+QString
+Auxil::getBundleFilename(const QString& lexicon)
+{
+    if (lexicon != LEXICON_CUSTOM) {
+        QString lexiconPrefix = getLexiconPrefix(lexicon);
+        if (lexiconPrefix.isEmpty())
+            return QString();
+    }
+
+    QString dbPath = getUserDir() + "/lexicons";
+    QDir dir;
+    dir.mkpath(dbPath);
+    return (dbPath + "/" + lexicon + ".zlb");
+}
+
 //---------------------------------------------------------------------------
 //  dialogWordWrap
 //
@@ -36,6 +36,7 @@
 
 namespace Auxil {
     bool copyDir(const QString& src, const QString& dest);
+    bool replaceFile(const QString& src, const QString& dest);
     unsigned int getPid();
     QString getAboutString();
     QString getThanksString();
@@ -51,6 +52,7 @@ namespace Auxil {
     QString getUserConfigDir();
     QString getLexiconPrefix(const QString& lexicon);
     QString getDatabaseFilename(const QString& lexicon);
+    QString getBundleFilename(const QString& lexicon);
     QString dialogWordWrap(const QString& str);
     QString wordWrap(const QString& str, int wrapLength);
     bool isVowel(QChar c);
@@ -0,0 +1,265 @@
+//---------------------------------------------------------------------------
+// BitmapIndex.cpp
+//
+// A class for looking up the sets of words sharing an attribute.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#include "BitmapIndex.h"
+#include "AlphagramIndex.h"
+#include "Auxil.h"
+#include "WordGraph.h"
+#include <QMutexLocker>
+#include <QTime>
+#include <cstring>
+
+//---------------------------------------------------------------------------
+//  BitmapIndex
+//
+//! Constructor.
+//---------------------------------------------------------------------------
+BitmapIndex::BitmapIndex()
+    : graph(0), numWords(0), buildTime(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  clear
+//
+//! Remove all words from the index.
+//---------------------------------------------------------------------------
+void
+BitmapIndex::clear()
+{
+    QMutexLocker locker (&letterMutex);
+    graph = 0;
+    wordData.clear();
+    wordOffsets.clear();
+    for (int i = 0; i < NumValueTypes; ++i)
+        valueBitmaps[i].clear();
+    frontHooks = WordBitmap();
+    backHooks = WordBitmap();
+    letterBitmaps.clear();
+    numWords = 0;
+    buildTime = 0;
+}
+
+//---------------------------------------------------------------------------
+//  build
+//
+//! Build the index for the words in a word graph.  Any words already in the
+//! index are removed.
+//
+//! @param wordGraph the word graph, which numbers the words
+//! @param alphagrams the alphagram index for the same words
+//---------------------------------------------------------------------------
+void
+BitmapIndex::build(const WordGraph* wordGraph, const AlphagramIndex&
+                   alphagrams)
+{
+    QTime timer;
+    timer.start();
+
+    clear();
+
+    // Words are listed in the order the graph numbers them
+    QList<QByteArray> words = wordGraph->getWords();
+    graph = wordGraph;
+    numWords = words.size();
+    wordOffsets.reserve(numWords + 1);
+    frontHooks = WordBitmap(numWords);
+    backHooks = WordBitmap(numWords);
+
+    for (int id = 0; id < numWords; ++id) {
+        const QByteArray& word = words.at(id);
+        int length = word.length();
+        wordOffsets.append(wordData.size());
+        wordData.append(word);
+
+        int numVowels = 0;
+        int numUniqueLetters = 0;
+        bool seen[256];
+        memset(seen, 0, sizeof(seen));
+        for (int i = 0; i < length; ++i) {
+            uchar c = word.at(i);
+            if (Auxil::isVowel(QChar(c)))
+                ++numVowels;
+            if (!seen[c])
+                ++numUniqueLetters;
+            seen[c] = true;
+        }
+
+        QString wordStr = QString::fromLatin1(word.constData(), length);
+        addValue(Length, length, id);
+        addValue(NumVowels, numVowels, id);
+        addValue(NumUniqueLetters, numUniqueLetters, id);
+        addValue(NumAnagrams, alphagrams.getNumAnagrams(wordStr), id);
+
+        if ((length > 1) && graph->containsWord(wordStr.mid(1)))
+            frontHooks.setBit(id);
+        if ((length > 1) && graph->containsWord(wordStr.left(length - 1)))
+            backHooks.setBit(id);
+    }
+    wordOffsets.append(wordData.size());
+
+    buildTime = timer.elapsed();
+}
+
+//---------------------------------------------------------------------------
+//  getRange
+//
+//! Get the words with an attribute in a range of values.
+//
+//! @param type the attribute
+//! @param minValue the minimum value
+//! @param maxValue the maximum value
+//! @return the set of words
+//---------------------------------------------------------------------------
+WordBitmap
+BitmapIndex::getRange(ValueType type, int minValue, int maxValue) const
+{
+    const QVector<WordBitmap>& bitmaps = valueBitmaps[type];
+    WordBitmap bitmap (numWords);
+    int last = qMin(maxValue, bitmaps.size() - 1);
+    for (int value = qMax(minValue, 0); value <= last; ++value)
+        bitmap |= bitmaps.at(value);
+    return bitmap;
+}
+
+//---------------------------------------------------------------------------
+//  getLetters
+//
+//! Get the words containing a letter at least a number of times.
+//
+//! @param letter the letter, in upper case
+//! @param count the number of times
+//! @return the set of words
+//---------------------------------------------------------------------------
+WordBitmap
+BitmapIndex::getLetters(uchar letter, int count) const
+{
+    count = qBound(1, count, 255);
+    int key = (letter << 8) | count;
+
+    QMutexLocker locker (&letterMutex);
+    QHash<int, WordBitmap>::const_iterator it = letterBitmaps.find(key);
+    if (it != letterBitmaps.end())
+        return it.value();
+
+    WordBitmap bitmap (numWords);
+    const char* data = wordData.constData();
+    for (int id = 0; id < numWords; ++id) {
+        int found = 0;
+        for (quint32 i = wordOffsets.at(id); i < wordOffsets.at(id + 1); ++i)
+            found += (uchar(data[i]) == letter);
+        if (found >= count)
+            bitmap.setBit(id);
+    }
+
+    letterBitmaps.insert(key, bitmap);
+    return bitmap;
+}
+
+//---------------------------------------------------------------------------
+//  getWords
+//
+//! Get the set of words in a list.
+//
+//! @param words the words
+//! @return the set of words in the list that are in the index
+//---------------------------------------------------------------------------
+WordBitmap
+BitmapIndex::getWords(const QStringList& words) const
+{
+    WordBitmap bitmap (numWords);
+    if (!graph)
+        return bitmap;
+
+    foreach (const QString& word, words) {
+        int id = graph->getWordId(word.toUpper());
+        if ((id >= 0) && (id < numWords))
+            bitmap.setBit(id);
+    }
+    return bitmap;
+}
+
+//---------------------------------------------------------------------------
+//  getWords
+//
+//! Get the words in a set.
+//
+//! @param bitmap the set of words
+//! @return the words, in alphabetical order
+//---------------------------------------------------------------------------
+QStringList
+BitmapIndex::getWords(const WordBitmap& bitmap) const
+{
+    QStringList words;
+    const char* data = wordData.constData();
+    foreach (int id, bitmap.getIds()) {
+        if (id >= numWords)
+            break;
+        quint32 offset = wordOffsets.at(id);
+        words.append(QString::fromLatin1(data + offset,
+                                         wordOffsets.at(id + 1) - offset));
+    }
+    return words;
+}
+
+//---------------------------------------------------------------------------
+//  getMemoryUsage
+//
+//! Get the number of bytes allocated by the index.
+//
+//! @return the memory usage in bytes
+//---------------------------------------------------------------------------
+qint64
+BitmapIndex::getMemoryUsage() const
+{
+    QMutexLocker locker (&letterMutex);
+    qint64 bytes = qint64(wordData.capacity()) +
+        qint64(wordOffsets.capacity()) * sizeof(quint32) +
+        frontHooks.getMemoryUsage() + backHooks.getMemoryUsage();
+    for (int i = 0; i < NumValueTypes; ++i) {
+        foreach (const WordBitmap& bitmap, valueBitmaps[i])
+            bytes += bitmap.getMemoryUsage();
+    }
+    foreach (const WordBitmap& bitmap, letterBitmaps)
+        bytes += bitmap.getMemoryUsage();
+    return bytes;
+}
+
+//---------------------------------------------------------------------------
+//  addValue
+//
+//! Add a word to the bitmap for a value of an attribute.
+//
+//! @param type the attribute
+//! @param value the value
+//! @param id the number of the word
+//---------------------------------------------------------------------------
+void
+BitmapIndex::addValue(ValueType type, int value, int id)
+{
+    QVector<WordBitmap>& bitmaps = valueBitmaps[type];
+    while (bitmaps.size() <= value)
+        bitmaps.append(WordBitmap(numWords));
+    bitmaps[value].setBit(id);
+}
@@ -0,0 +1,87 @@
+//---------------------------------------------------------------------------
+// BitmapIndex.h
+//
+// A class for looking up the sets of words sharing an attribute.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#ifndef ZYZZYVA_BITMAP_INDEX_H
+#define ZYZZYVA_BITMAP_INDEX_H
+
+#include "WordBitmap.h"
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+class AlphagramIndex;
+class WordGraph;
+
+// A bitmap of the words with each value of each small numeric attribute,
+// and of the words in each hook set, so a search made of such conditions
+// can be answered with bitmap operations.  Bitmaps of the words containing
+// a letter a number of times are made when first needed.
+class BitmapIndex
+{
+    public:
+    enum ValueType {
+        Length = 0,
+        NumVowels,
+        NumUniqueLetters,
+        NumAnagrams,
+        NumValueTypes
+    };
+
+    public:
+    BitmapIndex();
+    ~BitmapIndex() { }
+
+    void clear();
+    void build(const WordGraph* graph, const AlphagramIndex& alphagrams);
+    bool isEmpty() const { return !numWords; }
+    int getNumWords() const { return numWords; }
+    WordBitmap getRange(ValueType type, int minValue, int maxValue) const;
+    WordBitmap getLetters(uchar letter, int count) const;
+    const WordBitmap& getFrontHooks() const { return frontHooks; }
+    const WordBitmap& getBackHooks() const { return backHooks; }
+    WordBitmap getWords(const QStringList& words) const;
+    QStringList getWords(const WordBitmap& bitmap) const;
+    qint64 getMemoryUsage() const;
+    int getBuildTime() const { return buildTime; }
+
+    private:
+    void addValue(ValueType type, int value, int id);
+
+    const WordGraph* graph;
+    QByteArray wordData;
+    QVector<quint32> wordOffsets;
+    QVector<WordBitmap> valueBitmaps[NumValueTypes];
+    WordBitmap frontHooks;
+    WordBitmap backHooks;
+    int numWords;
+    int buildTime;
+
+    mutable QHash<int, WordBitmap> letterBitmaps;
+    mutable QMutex letterMutex;
+};
+
+#endif // ZYZZYVA_BITMAP_INDEX_H
@@ -28,11 +28,16 @@
 #include "WordEngine.h"
 #include "Auxil.h"
 #include "Defs.h"
+#include <QThreadPool>
 #include <QtSql>
 
 const int MAX_DEFINITION_LINKS = 3;
 const int PROGRESS_STEP = 1000;
+const int ROW_CHUNK_SIZE = 256;
 const QString DB_CONNECTION_NAME = "CreateDatabaseThread";
+const QString BUILD_FILE_SUFFIX = ".build";
+const int BULK_LOAD_PAGE_SIZE = 4096;
+const int BULK_LOAD_CACHE_PAGES = 16384;
 
 using namespace Defs;
 
@@ -44,7 +49,10 @@ using namespace Defs;
 void
 CreateDatabaseThread::run()
 {
-    runPrivate();
+    if (incremental)
+        updatePrivate();
+    else
+        runPrivate();
 }
 
 //---------------------------------------------------------------------------
@@ -57,14 +65,21 @@ CreateDatabaseThread::runPrivate()
 {
     int numSteps = 0;
 
+    // The database is built in a separate file that replaces the database
+    // file only when it is complete, so an interrupted build never leaves a
+    // partial database behind.  Remove what is left of any earlier build.
+    QString buildFilename = dbFilename + BUILD_FILE_SUFFIX;
+    if (QFile::exists(buildFilename))
+        QFile::remove(buildFilename);
+
     {
         // Create empty database
         QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE",
                                                     DB_CONNECTION_NAME);
-        db.setDatabaseName(dbFilename);
+        db.setDatabaseName(buildFilename);
         if (!db.open()) {
             error = QString("Unable to open database file '%1':\n%2").arg(
-                dbFilename).arg(db.lastError().text());
+                buildFilename).arg(db.lastError().text());
             cancel();
         }
 
@@ -75,7 +90,7 @@ CreateDatabaseThread::runPrivate()
         // Total number of progress steps is number of words times the number
         // of lines that increment stepNum in all the code that is called
         // below.
-        int stepNumIncs = 8;
+        int stepNumIncs = 10;
         int numWords = wordEngine->getNumWords(lexiconName);
         int baseProgress = numWords * stepNumIncs / 99;
         numSteps = numWords * stepNumIncs + baseProgress + 1;
@@ -83,21 +98,426 @@ CreateDatabaseThread::runPrivate()
         int stepNum = baseProgress;
         emit progress(stepNum);
 
+        setBulkLoadMode(db);
         createTables(db);
-        createIndexes(db);
-        // insertWords increments stepNum 2 times
-        insertWords(db, stepNum);
+
+        // Every column of every row is computed before any row is written,
+        // so each row is inserted once and never updated
+        QVector<WordRow> rows;
+        computeWordRows(rows, stepNum);
         // updateProbabilityOrder increments stepNum 4 times for each word
         // because of 0, 1, 2 blanks and playability
-        updateProbabilityOrder(db, stepNum);
-        updateDefinitions(db, stepNum);
-        updateDefinitionLinks(db, stepNum);
+        if (!cancelled)
+            updateProbabilityOrder(rows, stepNum);
+        if (!cancelled)
+            updateDefinitions(rows, stepNum);
+        if (!cancelled)
+            updateDefinitionLinks(rows, stepNum);
+        if (!cancelled)
+            insertRows(db, rows, stepNum);
+
+        // Building the indexes once the table is full is much faster than
+        // updating them for each row inserted
+        if (!cancelled)
+            createIndexes(db, stepNum);
+        if (!cancelled)
+            finishDatabase(db, stepNum);
+        db.close();
     }
 
     cleanup();
+
+    if (cancelled || !error.isEmpty()) {
+        QFile::remove(buildFilename);
+    }
+    else if (!Auxil::replaceFile(buildFilename, dbFilename)) {
+        error = QString("Unable to replace database file '%1'.").arg(
+            dbFilename);
+        QFile::remove(buildFilename);
+    }
+
+    emit progress(numSteps);
+}
+
+//---------------------------------------------------------------------------
+//  updatePrivate
+//
+//! Update an existing database with the changes to the lexicon since the
+//! database was created.
+//---------------------------------------------------------------------------
+void
+CreateDatabaseThread::updatePrivate()
+{
+    int numSteps = 0;
+
+    // The changes are made to a copy of the database, which replaces the
+    // database file only when it is complete
+    QString buildFilename = dbFilename + BUILD_FILE_SUFFIX;
+    if (QFile::exists(buildFilename))
+        QFile::remove(buildFilename);
+
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE",
+                                                    DB_CONNECTION_NAME);
+        db.setDatabaseName(buildFilename);
+        if (!QFile::copy(dbFilename, buildFilename)) {
+            error = QString("Unable to copy database file '%1'.").arg(
+                dbFilename);
+            cancel();
+        }
+        else if (!db.open()) {
+            error = QString("Unable to open database file '%1':\n%2").arg(
+                buildFilename).arg(db.lastError().text());
+            cancel();
+        }
+
+        // Start at 1% progress
+        emit(steps(100));
+        emit(progress(1));
+
+        // Total number of progress steps is number of words times the number
+        // of lines that increment stepNum in all the code that is called
+        // below, at most.  Only the changed lengths are renumbered, so the
+        // update may finish early.
+        int stepNumIncs = 10;
+        int numWords = wordEngine->getNumWords(lexiconName);
+        int baseProgress = numWords * stepNumIncs / 99;
+        numSteps = numWords * stepNumIncs + baseProgress + 1;
+        emit steps(numSteps);
+        int stepNum = baseProgress;
+        emit progress(stepNum);
+
+        if (!cancelled) {
+            setBulkLoadMode(db);
+            updateWords(db, stepNum);
+        }
+        if (!cancelled)
+            createIndexes(db, stepNum);
+        if (!cancelled)
+            finishDatabase(db, stepNum);
+        db.close();
+    }
+
+    cleanup();
+
+    if (cancelled || !error.isEmpty()) {
+        QFile::remove(buildFilename);
+    }
+    else if (!Auxil::replaceFile(buildFilename, dbFilename)) {
+        error = QString("Unable to replace database file '%1'.").arg(
+            dbFilename);
+        QFile::remove(buildFilename);
+    }
+
     emit progress(numSteps);
 }
 
+//---------------------------------------------------------------------------
+//  updateWords
+//
+//! Update the words table with the words added to and removed from the
+//! lexicon.  Only the rows of words whose columns depend on the changed
+//! words are recomputed: the added words, the words they or the removed
+//! words hook or are hooks of, and their anagrams.  Words whose definitions
+//! have changed are updated as well.  Orders are renumbered only for the
+//! lengths of the changed words, and only the orders that differ are
+//! written.
+//
+//! @param db the database
+//! @param stepNum the current step number
+//---------------------------------------------------------------------------
+void
+CreateDatabaseThread::updateWords(QSqlDatabase& db, int& stepNum)
+{
+    // Read the words and definitions already in the database
+    QHash<QString, QString> oldDefinitions;
+    QSqlQuery selectQuery (db);
+    selectQuery.exec("SELECT word, definition FROM words");
+    while (selectQuery.next()) {
+        oldDefinitions.insert(selectQuery.value(0).toString(),
+                              selectQuery.value(1).toString());
+    }
+    stepNum += oldDefinitions.size();
+    emit progress(stepNum);
+
+    // Find the words now in the lexicon and their definitions
+    QVector<WordRow> lexiconRows;
+    for (int length = 1; length <= MAX_WORD_LEN; ++length) {
+        foreach (const QString& word, getWords(length)) {
+            WordRow row;
+            row.word = word;
+            row.length = length;
+            row.alphagram = Auxil::getAlphagram(word);
+            lexiconRows.append(row);
+        }
+    }
+    updateDefinitions(lexiconRows, stepNum);
+    if (cancelled)
+        return;
+    updateDefinitionLinks(lexiconRows, stepNum);
+    if (cancelled)
+        return;
+
+    QHash<QString, int> rowIndexes;
+    QMap<QString, int> numAnagramsMap;
+    for (int i = 0; i < lexiconRows.size(); ++i) {
+        const WordRow& row = lexiconRows.at(i);
+        rowIndexes.insert(row.word, i);
+        ++numAnagramsMap[row.alphagram];
+    }
+
+    QSet<QString> addedWords;
+    foreach (const WordRow& row, lexiconRows) {
+        if (!oldDefinitions.contains(row.word))
+            addedWords.insert(row.word);
+    }
+    QSet<QString> removedWords;
+    QHashIterator<QString, QString> it (oldDefinitions);
+    while (it.hasNext()) {
+        it.next();
+        if (!rowIndexes.contains(it.key()))
+            removedWords.insert(it.key());
+    }
+
+    // Find the words whose rows depend on the changed words
+    QSet<QString> changedWords = addedWords + removedWords;
+    QSet<QString> changedAlphagrams;
+    QSet<int> changedLengths;
+    QSet<QString> affectedWords = addedWords;
+    foreach (const QString& word, changedWords) {
+        changedAlphagrams.insert(Auxil::getAlphagram(word));
+        changedLengths.insert(word.length());
+
+        // The word is a front hook of one word and a back hook of another,
+        // and is itself hooked by other words
+        QStringList neighbours;
+        neighbours << word.mid(1) << word.left(word.length() - 1);
+        for (int i = 0; i < 26; ++i) {
+            QChar letter ('A' + i);
+            neighbours << (letter + word) << (word + letter);
+        }
+        foreach (const QString& neighbour, neighbours) {
+            if (rowIndexes.contains(neighbour))
+                affectedWords.insert(neighbour);
+        }
+    }
+    foreach (const WordRow& row, lexiconRows) {
+        if (changedAlphagrams.contains(row.alphagram) ||
+            (row.definition != oldDefinitions.value(row.word)))
+        {
+            affectedWords.insert(row.word);
+        }
+    }
+
+    // Recompute the affected rows
+    QStringList words = affectedWords.toList();
+    qSort(words);
+    QList<LexiconStyle> lexStyles = getLexiconStyles();
+    QMap<QString, qint64> playabilityMap;
+    importPlayability(getPlayabilityFilename(), playabilityMap);
+    QVector<WordRow> affectedRows (words.size());
+    computeRows(words, lexStyles, playabilityMap, affectedRows);
+    if (cancelled)
+        return;
+    for (int i = 0; i < affectedRows.size(); ++i) {
+        WordRow& row = affectedRows[i];
+        row.numAnagrams = numAnagramsMap.value(row.alphagram);
+        row.definition = lexiconRows.at(rowIndexes.value(row.word)).definition;
+    }
+
+    // Gather the rows of the changed lengths, with their current orders
+    QStringList orderColumns;
+    for (int column = 0; column < NumOrderColumns; ++column) {
+        QString orderCol = getOrderColumnName(column);
+        orderColumns << orderCol << ("min_" + orderCol) << ("max_" + orderCol);
+    }
+
+    QList<int> lengths = changedLengths.toList();
+    qSort(lengths);
+    selectQuery.prepare("SELECT word, playability, combinations0, "
+                        "combinations1, combinations2, alphagram, " +
+                        orderColumns.join(", ") + " FROM words "
+                        "WHERE length=?");
+    QVector<WordRow> orderRows;
+    foreach (int length, lengths) {
+        selectQuery.bindValue(0, length);
+        selectQuery.exec();
+        while (selectQuery.next()) {
+            WordRow row;
+            row.word = selectQuery.value(0).toString();
+            if (removedWords.contains(row.word))
+                continue;
+            row.length = length;
+            row.playability = selectQuery.value(1).toLongLong();
+            row.combinations0 = selectQuery.value(2).toDouble();
+            row.combinations1 = selectQuery.value(3).toDouble();
+            row.combinations2 = selectQuery.value(4).toDouble();
+            row.alphagram = selectQuery.value(5).toString();
+            int valueNum = 6;
+            for (int column = 0; column < NumOrderColumns; ++column) {
+                row.order[column] = selectQuery.value(valueNum++).toInt();
+                row.minOrder[column] = selectQuery.value(valueNum++).toInt();
+                row.maxOrder[column] = selectQuery.value(valueNum++).toInt();
+            }
+            orderRows.append(row);
+        }
+
+        foreach (const WordRow& row, affectedRows) {
+            if ((row.length == length) && addedWords.contains(row.word))
+                orderRows.append(row);
+        }
+    }
+
+    QVector<WordRow> oldOrderRows = orderRows;
+    updateProbabilityOrder(orderRows, stepNum);
+    if (cancelled)
+        return;
+
+    // The order indexes are unique, so they are dropped while orders are
+    // shifted and recreated afterward
+    QSqlQuery query (db);
+    query.exec("DROP INDEX IF EXISTS play_index");
+    query.exec("DROP INDEX IF EXISTS play_min_max_index");
+    query.exec("DROP INDEX IF EXISTS prob0_index");
+    query.exec("DROP INDEX IF EXISTS prob0_min_max_index");
+    query.exec("DROP INDEX IF EXISTS prob1_index");
+    query.exec("DROP INDEX IF EXISTS prob1_min_max_index");
+    query.exec("DROP INDEX IF EXISTS prob2_index");
+    query.exec("DROP INDEX IF EXISTS prob2_min_max_index");
+
+    QSqlQuery transactionQuery ("BEGIN TRANSACTION", db);
+
+    query.prepare("DELETE FROM words WHERE word=?");
+    foreach (const QString& word, removedWords) {
+        query.bindValue(0, word);
+        query.exec();
+    }
+
+    query.prepare("UPDATE words SET num_anagrams=?, front_hooks=?, "
+                  "back_hooks=?, is_front_hook=?, is_back_hook=?, "
+                  "lexicon_symbols=?, definition=? WHERE word=?");
+    foreach (const WordRow& row, affectedRows) {
+        if (addedWords.contains(row.word))
+            continue;
+        int bindNum = 0;
+        query.bindValue(bindNum++, row.numAnagrams);
+        query.bindValue(bindNum++, row.frontHooks);
+        query.bindValue(bindNum++, row.backHooks);
+        query.bindValue(bindNum++, row.isFrontHook);
+        query.bindValue(bindNum++, row.isBackHook);
+        query.bindValue(bindNum++, row.symbols);
+        query.bindValue(bindNum++, row.definition);
+        query.bindValue(bindNum++, row.word);
+        query.exec();
+    }
+
+    query.prepare("UPDATE words SET " + orderColumns.join("=?, ") +
+                  "=? WHERE word=?");
+    QVector<WordRow> addedRows;
+    for (int i = 0; i < orderRows.size(); ++i) {
+        const WordRow& row = orderRows.at(i);
+        if (addedWords.contains(row.word)) {
+            addedRows.append(row);
+            continue;
+        }
+
+        const WordRow& oldRow = oldOrderRows.at(i);
+        bool orderChanged = false;
+        for (int column = 0; column < NumOrderColumns; ++column) {
+            if ((row.order[column] != oldRow.order[column]) ||
+                (row.minOrder[column] != oldRow.minOrder[column]) ||
+                (row.maxOrder[column] != oldRow.maxOrder[column]))
+            {
+                orderChanged = true;
+                break;
+            }
+        }
+        if (!orderChanged)
+            continue;
+
+        int bindNum = 0;
+        for (int column = 0; column < NumOrderColumns; ++column) {
+            query.bindValue(bindNum++, row.order[column]);
+            query.bindValue(bindNum++, row.minOrder[column]);
+            query.bindValue(bindNum++, row.maxOrder[column]);
+        }
+        query.bindValue(bindNum++, row.word);
+        query.exec();
+
+        if ((stepNum % PROGRESS_STEP) == 0) {
+            if (cancelled) {
+                transactionQuery.exec("END TRANSACTION");
+                return;
+            }
+            emit progress(stepNum);
+        }
+        ++stepNum;
+    }
+
+    query.prepare("UPDATE lexicon_file SET file=?");
+    query.bindValue(0, wordEngine->getLexiconFile(lexiconName));
+    query.exec();
+
+    transactionQuery.exec("END TRANSACTION");
+
+    insertRows(db, addedRows, stepNum);
+}
+
+//---------------------------------------------------------------------------
+//  setBulkLoadMode
+//
+//! Tune a new database for being filled in one pass.  The database file is
+//! discarded if the build does not finish, so nothing is journaled or
+//! synced to disk until the database is finished.  Must be called before
+//! any table is created, so the page size can still be changed.
+//
+//! @param db the database
+//---------------------------------------------------------------------------
+void
+CreateDatabaseThread::setBulkLoadMode(QSqlDatabase& db)
+{
+    QSqlQuery query (db);
+    query.exec(QString("PRAGMA page_size = %1").arg(BULK_LOAD_PAGE_SIZE));
+    query.exec(QString("PRAGMA cache_size = %1").arg(
+        BULK_LOAD_CACHE_PAGES));
+    query.exec("PRAGMA journal_mode = OFF");
+    query.exec("PRAGMA synchronous = OFF");
+    query.exec("PRAGMA locking_mode = EXCLUSIVE");
+    query.exec("PRAGMA temp_store = MEMORY");
+}
+
+//---------------------------------------------------------------------------
+//  finishDatabase
+//
+//! Gather statistics for the query planner, then restore the default
+//! journal and sync settings and compact the database, which also writes
+//! it safely to disk.
+//
+//! @param db the database
+//! @param stepNum the current step number
+//---------------------------------------------------------------------------
+void
+CreateDatabaseThread::finishDatabase(QSqlDatabase& db, int& stepNum)
+{
+    // Finishing the database counts as one step for each word
+    int numWords = wordEngine->getNumWords(lexiconName);
+
+    QSqlQuery query (db);
+    query.exec("ANALYZE");
+    emit progress(stepNum + numWords / 2);
+    if (cancelled)
+        return;
+
+    query.exec("PRAGMA journal_mode = DELETE");
+    query.exec("PRAGMA synchronous = FULL");
+    if (!query.exec("VACUUM")) {
+        error = QString("Unable to write database file '%1':\n%2").arg(
+            dbFilename).arg(query.lastError().text());
+    }
+    stepNum += numWords;
+    emit progress(stepNum);
+}
+
 //---------------------------------------------------------------------------
 //  createTables
 //
@@ -150,87 +570,99 @@ CreateDatabaseThread::createTables(QSqlDatabase& db)
 //! @param stepNum the current step number
 //---------------------------------------------------------------------------
 void
-CreateDatabaseThread::createIndexes(QSqlDatabase& db)
+CreateDatabaseThread::createIndexes(QSqlDatabase& db, int& stepNum)
 {
-    QSqlQuery query (db);
-
-    // Indexes on words table
-    query.exec("CREATE UNIQUE INDEX word_index on words (word)");
-    if (cancelled)
-        return;
+    QStringList statements;
+
+    // Indexes on words table.  Only missing indexes are created, so the
+    // indexes dropped while a database is updated can be recreated.
+    statements << "CREATE UNIQUE INDEX IF NOT EXISTS word_index on words "
+           "(word)"
+        << "CREATE INDEX IF NOT EXISTS word_length_index on words "
+           "(length)"
+        << "CREATE UNIQUE INDEX IF NOT EXISTS play_index on words "
+           "(length, playability_order)"
+        << "CREATE INDEX IF NOT EXISTS play_min_max_index on words "
+           "(length, min_playability_order, max_playability_order)"
+        << "CREATE UNIQUE INDEX IF NOT EXISTS prob0_index on words "
+           "(length, probability_order0)"
+        << "CREATE INDEX IF NOT EXISTS prob0_min_max_index on words "
+           "(length, min_probability_order0, max_probability_order0)"
+        << "CREATE UNIQUE INDEX IF NOT EXISTS prob1_index on words "
+           "(length, probability_order1)"
+        << "CREATE INDEX IF NOT EXISTS prob1_min_max_index on words "
+           "(length, min_probability_order1, max_probability_order1)"
+        << "CREATE UNIQUE INDEX IF NOT EXISTS prob2_index on words "
+           "(length, probability_order2)"
+        << "CREATE INDEX IF NOT EXISTS prob2_min_max_index on words "
+           "(length, min_probability_order2, max_probability_order2)"
+        << "CREATE INDEX IF NOT EXISTS definition_index on words "
+           "(definition)";
+
+    // Creating all the indexes counts as one step for each word
+    int numWords = wordEngine->getNumWords(lexiconName);
+    int endStepNum = stepNum + numWords;
 
-    query.exec("CREATE INDEX word_length_index on words (length)");
-    if (cancelled)
-        return;
-
-    query.exec("CREATE UNIQUE INDEX play_index on words "
-               "(length, playability_order)");
-    if (cancelled)
-        return;
-
-    query.exec("CREATE INDEX play_min_max_index on words "
-               "(length, min_playability_order, max_playability_order)");
-    if (cancelled)
-        return;
-
-    query.exec("CREATE UNIQUE INDEX prob0_index on words "
-               "(length, probability_order0)");
-    if (cancelled)
-        return;
-
-    query.exec("CREATE INDEX prob0_min_max_index on words "
-               "(length, min_probability_order0, max_probability_order0)");
-    if (cancelled)
-        return;
-
-    query.exec("CREATE UNIQUE INDEX prob1_index on words "
-               "(length, probability_order1)");
-    if (cancelled)
-        return;
-
-    query.exec("CREATE INDEX prob1_min_max_index on words "
-               "(length, min_probability_order1, max_probability_order1)");
-    if (cancelled)
-        return;
-
-    query.exec("CREATE UNIQUE INDEX prob2_index on words "
-               "(length, probability_order2)");
-    if (cancelled)
-        return;
-
-    query.exec("CREATE INDEX prob2_min_max_index on words "
-               "(length, min_probability_order2, max_probability_order2)");
-    if (cancelled)
-        return;
-
-    query.exec("CREATE INDEX definition_index on words "
-               "(definition)");
-    if (cancelled)
-        return;
+    QSqlQuery query (db);
+    for (int i = 0; i < statements.size(); ++i) {
+        if (cancelled)
+            return;
+        query.exec(statements.at(i));
+        emit progress(stepNum + numWords * (i + 1) / statements.size());
+    }
+    stepNum = endStepNum;
 }
 
 //---------------------------------------------------------------------------
-//  insertWords
+//  computeWordRows
 //
-//! Insert words into the database.
+//! Compute the rows of the words table for every word in the lexicon,
+//! except for their orders and definitions.  The rows are grouped by
+//! length.
 //
-//! @param db the database
+//! @param rows the list to receive the rows
 //! @param stepNum the current step number
 //---------------------------------------------------------------------------
 void
-CreateDatabaseThread::insertWords(QSqlDatabase& db, int& stepNum)
+CreateDatabaseThread::computeWordRows(QVector<WordRow>& rows, int& stepNum)
 {
-    LetterBag letterBag;
-    QStringList letters;
-    letters << "A" << "B" << "C" << "D" << "E" << "F" << "G" << "H" <<
-        "I" << "J" << "K" << "L" << "M" << "N" << "O" << "P" << "Q" <<
-        "R" << "S" << "T" << "U" << "V" << "W" << "X" << "Y" << "Z";
+    QList<LexiconStyle> lexStyles = getLexiconStyles();
+    QMap<QString, qint64> playabilityMap;
+    importPlayability(getPlayabilityFilename(), playabilityMap);
 
-    SearchCondition searchCondition;
-    searchCondition.type = SearchCondition::Length;
-    SearchSpec searchSpec;
-    searchSpec.conditions.append(searchCondition);
+    for (int length = 1; length <= MAX_WORD_LEN; ++length) {
+        QStringList words = getWords(length);
+        QVector<WordRow> lengthRows (words.size());
+        computeRows(words, lexStyles, playabilityMap, lengthRows);
+        if (cancelled)
+            return;
+
+        // Anagrams have the same length, so they can be counted here
+        QMap<QString, int> numAnagramsMap;
+        foreach (const WordRow& row, lengthRows)
+            ++numAnagramsMap[row.alphagram];
+        for (int i = 0; i < lengthRows.size(); ++i) {
+            WordRow& row = lengthRows[i];
+            row.numAnagrams = numAnagramsMap.value(row.alphagram);
+        }
+
+        rows += lengthRows;
+        stepNum += lengthRows.size();
+        emit progress(stepNum);
+    }
+}
 
+//---------------------------------------------------------------------------
+//  getLexiconStyles
+//
+//! Get the styles of the lexicons to be compared with this one, for those
+//! compared lexicons that are loaded.
+//
+//! @return the lexicon styles
+//---------------------------------------------------------------------------
+QList<LexiconStyle>
+CreateDatabaseThread::getLexiconStyles() const
+{
     QList<LexiconStyle> lexStyles = MainSettings::getWordListLexiconStyles();
     QMutableListIterator<LexiconStyle> it (lexStyles);
     while (it.hasNext()) {
@@ -241,277 +673,352 @@ CreateDatabaseThread::insertWords(QSqlDatabase& db, int& stepNum)
             it.remove();
         }
     }
+    return lexStyles;
+}
 
-    QMap<QString, qint64> playabilityMap;
-    QString playabilityFile = Auxil::getWordsDir() +
-        Auxil::getLexiconPrefix(lexiconName) + "-Playability.txt";
-    importPlayability(playabilityFile, playabilityMap);
+//---------------------------------------------------------------------------
+//  getPlayabilityFilename
+//
+//! Get the name of the file of playability values for the lexicon.
+//
+//! @return the filename
+//---------------------------------------------------------------------------
+QString
+CreateDatabaseThread::getPlayabilityFilename() const
+{
+    return Auxil::getWordsDir() + Auxil::getLexiconPrefix(lexiconName) +
+        "-Playability.txt";
+}
 
-    QSqlQuery transactionQuery ("BEGIN TRANSACTION", db);
-    QSqlQuery query (db);
+//---------------------------------------------------------------------------
+//  getWords
+//
+//! Get the words of a length in the lexicon.
+//
+//! @param length the length
+//! @return the words, in alphabetical order
+//---------------------------------------------------------------------------
+QStringList
+CreateDatabaseThread::getWords(int length) const
+{
+    SearchCondition searchCondition;
+    searchCondition.type = SearchCondition::Length;
+    searchCondition.minValue = length;
+    searchCondition.maxValue = length;
+    SearchSpec searchSpec;
+    searchSpec.conditions.append(searchCondition);
 
-    QMap<QString, qint64> numAnagramsMap;
+    // Do a word graph search because we're still building the database!
+    return wordEngine->wordGraphSearch(lexiconName, searchSpec);
+}
 
-    for (int length = 1; length <= MAX_WORD_LEN; ++length) {
-        searchSpec.conditions[0].minValue = length;
-        searchSpec.conditions[0].maxValue = length;
-
-        // Do a word graph search because we're still building the database!
-        QStringList words = wordEngine->wordGraphSearch(lexiconName,
-                                                        searchSpec);
-
-        query.prepare("INSERT INTO words (word, length, playability, "
-                      "combinations0, combinations1, combinations2, "
-                      "alphagram, num_unique_letters, num_vowels, "
-                      "point_value, front_hooks, back_hooks, "
-                      "is_front_hook, is_back_hook, lexicon_symbols) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
-
-        // Insert words with length, combinations, hooks
-        foreach (const QString& word, words) {
-            qint64 playability = playabilityMap.value(word);
-            double combinations0 = letterBag.getNumCombinations(word, 0);
-            double combinations1 = letterBag.getNumCombinations(word, 1);
-            double combinations2 = letterBag.getNumCombinations(word, 2);
-            int numUniqueLetters = Auxil::getNumUniqueLetters(word);
-            int numVowels = Auxil::getNumVowels(word);
-
-            int pointValue = 0;
-            for (int i = 0; i < word.length(); ++i) {
-                pointValue += letterBag.getLetterValue(word.at(i));
-            }
+//---------------------------------------------------------------------------
+//  computeRows
+//
+//! Compute the rows of the words table for a list of words, dividing the
+//! words into chunks that are computed by the threads of the global thread
+//! pool.  The calling thread computes chunks as well, and only waits for
+//! pool threads that were actually started.
+//
+//! @param words the words
+//! @param lexStyles the styles of lexicons to be compared with this one
+//! @param playabilityMap the playability value of each word
+//! @param rows the rows to be computed, one for each word
+//---------------------------------------------------------------------------
+void
+CreateDatabaseThread::computeRows(const QStringList& words, const
+                                  QList<LexiconStyle>& lexStyles, const
+                                  QMap<QString, qint64>& playabilityMap,
+                                  QVector<WordRow>& rows) const
+{
+    RowJob job (this, words, lexStyles, playabilityMap, rows);
+
+    QThreadPool* pool = QThreadPool::globalInstance();
+    int numChunks = (words.size() + ROW_CHUNK_SIZE - 1) / ROW_CHUNK_SIZE;
+    int numThreads = qMin(pool->maxThreadCount(), numChunks);
+    int numStarted = 0;
+    for (int i = 1; i < numThreads; ++i) {
+        RowWorker* worker = new RowWorker(&job);
+        if (!pool->tryStart(worker)) {
+            delete worker;
+            break;
+        }
+        ++numStarted;
+    }
 
-            QString alphagram = Auxil::getAlphagram(word);
-            if (numAnagramsMap.contains(alphagram))
-                ++numAnagramsMap[alphagram];
-            else
-                numAnagramsMap[alphagram] = 1;
-
-            int isFrontHook = wordEngine->isAcceptable(
-                lexiconName, word.right(word.length() - 1)) ? 1 : 0;
-            int isBackHook = wordEngine->isAcceptable(
-                lexiconName, word.left(word.length() - 1)) ? 1 : 0;
-
-            QString front, back;
-            foreach (const QString& letter, letters) {
-                if (wordEngine->isAcceptable(lexiconName, letter + word))
-                    front += letter;
-                if (wordEngine->isAcceptable(lexiconName, word + letter))
-                    back += letter;
-            }
+    job.run();
+    job.finished.acquire(numStarted);
+}
 
-            // Populate words and hooks with symbols
-            QString symbolStr;
-            if (!lexStyles.isEmpty()) {
-                QListIterator<LexiconStyle> it (lexStyles);
-                while (it.hasNext()) {
-                    const LexiconStyle& style = it.next();
-                    bool acceptable =
-                        wordEngine->isAcceptable(style.compareLexicon, word);
-                    if (!(acceptable ^ style.inCompareLexicon))
-                        symbolStr += style.symbol;
-                }
+//---------------------------------------------------------------------------
+//  computeRow
+//
+//! Compute the row of the words table for a word: its playability,
+//! combinations, alphagram, letter counts, point value, hooks and lexicon
+//! symbols.  Called on any thread.
+//
+//! @param word the word
+//! @param lexStyles the styles of lexicons to be compared with this one
+//! @param playabilityMap the playability value of each word
+//! @param letterBag the letter bag used to compute combinations and point
+//! values
+//! @param row the row to be computed
+//---------------------------------------------------------------------------
+void
+CreateDatabaseThread::computeRow(const QString& word, const
+                                 QList<LexiconStyle>& lexStyles, const
+                                 QMap<QString, qint64>& playabilityMap, const
+                                 LetterBag& letterBag, WordRow& row) const
+{
+    row.word = word;
+    row.length = word.length();
+    row.playability = playabilityMap.value(word);
+    row.combinations0 = letterBag.getNumCombinations(word, 0);
+    row.combinations1 = letterBag.getNumCombinations(word, 1);
+    row.combinations2 = letterBag.getNumCombinations(word, 2);
+    row.alphagram = Auxil::getAlphagram(word);
+    row.numUniqueLetters = Auxil::getNumUniqueLetters(word);
+    row.numVowels = Auxil::getNumVowels(word);
+
+    row.pointValue = 0;
+    for (int i = 0; i < word.length(); ++i) {
+        row.pointValue += letterBag.getLetterValue(word.at(i));
+    }
 
-                // Populate front hooks with symbols
-                for (int i = 0; i < front.length(); ++i) {
-                    QChar c = front[i];
-                    QString hookWord = c.toUpper() + word;
-
-                    it.toFront();
-                    while (it.hasNext()) {
-                        const LexiconStyle& style = it.next();
-                        bool acceptable = wordEngine->isAcceptable(
-                            style.compareLexicon, hookWord);
-
-                        if (!(acceptable ^ style.inCompareLexicon)) {
-                            front.insert(i + 1, style.symbol);
-                            i += style.symbol.length();
-                        }
-                    }
-                }
+    row.isFrontHook = wordEngine->isAcceptable(
+        lexiconName, word.right(word.length() - 1)) ? 1 : 0;
+    row.isBackHook = wordEngine->isAcceptable(
+        lexiconName, word.left(word.length() - 1)) ? 1 : 0;
+
+    // Find all hooks with one walk of each word graph
+    quint32 frontHooks = wordEngine->getFrontHooks(lexiconName, word);
+    quint32 backHooks = wordEngine->getBackHooks(lexiconName, word);
+
+    // Populate words and hooks with symbols
+    QString symbolStr;
+    QString front, back;
+    if (lexStyles.isEmpty()) {
+        front = WordGraph::getLetters(frontHooks);
+        back = WordGraph::getLetters(backHooks);
+    }
 
-                // Populate back hooks with symbols
-                for (int i = 0; i < back.length(); ++i) {
-                    QChar c = back[i];
-                    QString hookWord = word + c.toUpper();
-
-                    it.toFront();
-                    while (it.hasNext()) {
-                        const LexiconStyle& style = it.next();
-                        bool acceptable = wordEngine->isAcceptable(
-                            style.compareLexicon, hookWord);
-
-                        if (!(acceptable ^ style.inCompareLexicon)) {
-                            back.insert(i + 1, style.symbol);
-                            i += style.symbol.length();
-                        }
-                    }
-                }
-            }
+    else {
+        QList<quint32> compareFrontHooks;
+        QList<quint32> compareBackHooks;
+        QListIterator<LexiconStyle> it (lexStyles);
+        while (it.hasNext()) {
+            const LexiconStyle& style = it.next();
+            bool acceptable =
+                wordEngine->isAcceptable(style.compareLexicon, word);
+            if (!(acceptable ^ style.inCompareLexicon))
+                symbolStr += style.symbol;
+
+            compareFrontHooks.append(wordEngine->getFrontHooks(
+                style.compareLexicon, word));
+            compareBackHooks.append(wordEngine->getBackHooks(
+                style.compareLexicon, word));
+        }
 
-            int bindNum = 0;
-            query.bindValue(bindNum++, word);
-            query.bindValue(bindNum++, length);
-            query.bindValue(bindNum++, playability);
-            query.bindValue(bindNum++, combinations0);
-            query.bindValue(bindNum++, combinations1);
-            query.bindValue(bindNum++, combinations2);
-            query.bindValue(bindNum++, alphagram);
-            query.bindValue(bindNum++, numUniqueLetters);
-            query.bindValue(bindNum++, numVowels);
-            query.bindValue(bindNum++, pointValue);
-            query.bindValue(bindNum++, front.toLower());
-            query.bindValue(bindNum++, back.toLower());
-            query.bindValue(bindNum++, isFrontHook);
-            query.bindValue(bindNum++, isBackHook);
-            query.bindValue(bindNum++, symbolStr);
-            query.exec();
+        for (int i = 0; i < 26; ++i) {
+            quint32 bit = quint32(1) << i;
+            QChar letter ('a' + i);
 
-            if ((stepNum % PROGRESS_STEP) == 0) {
-                if (cancelled) {
-                    transactionQuery.exec("END TRANSACTION");
-                    return;
+            // Populate front hooks with symbols
+            if (frontHooks & bit) {
+                front += letter;
+                for (int j = 0; j < lexStyles.size(); ++j) {
+                    const LexiconStyle& style = lexStyles.at(j);
+                    bool acceptable = (compareFrontHooks.at(j) & bit);
+                    if (!(acceptable ^ style.inCompareLexicon))
+                        front += style.symbol;
                 }
-                emit progress(stepNum);
             }
-            ++stepNum;
-        }
-
-        // Update number of anagrams
-        query.prepare("UPDATE words SET num_anagrams=? WHERE word=?");
-        foreach (const QString& word, words) {
-            QString alphagram = Auxil::getAlphagram(word);
-            query.bindValue(0, numAnagramsMap[alphagram]);
-            query.bindValue(1, word);
-            query.exec();
 
-            if ((stepNum % PROGRESS_STEP) == 0) {
-                if (cancelled) {
-                    transactionQuery.exec("END TRANSACTION");
-                    return;
+            // Populate back hooks with symbols
+            if (backHooks & bit) {
+                back += letter;
+                for (int j = 0; j < lexStyles.size(); ++j) {
+                    const LexiconStyle& style = lexStyles.at(j);
+                    bool acceptable = (compareBackHooks.at(j) & bit);
+                    if (!(acceptable ^ style.inCompareLexicon))
+                        back += style.symbol;
                 }
-                emit progress(stepNum);
             }
-            ++stepNum;
         }
     }
 
-    transactionQuery.exec("END TRANSACTION");
+    row.frontHooks = front.toLower();
+    row.backHooks = back.toLower();
+    row.symbols = symbolStr;
 }
 
 //---------------------------------------------------------------------------
-//  updateProbabilityOrder
+//  insertRows
 //
-//! Update probability and playability order of words in the database.
+//! Insert rows into the words table.
 //
 //! @param db the database
+//! @param rows the rows
 //! @param stepNum the current step number
 //---------------------------------------------------------------------------
 void
-CreateDatabaseThread::updateProbabilityOrder(QSqlDatabase& db, int& stepNum)
+CreateDatabaseThread::insertRows(QSqlDatabase& db, const QVector<WordRow>&
+                                 rows, int& stepNum)
 {
     QSqlQuery transactionQuery ("BEGIN TRANSACTION", db);
 
-    for (int numBlanks = -1; numBlanks <= 2; ++numBlanks) {
-        QString valueCol = (numBlanks < 0 ? "playability"
-            : QString("combinations%1").arg(numBlanks));
-        QString orderCol = (numBlanks < 0 ? "playability_order"
-            : QString("probability_order%1").arg(numBlanks));
-        QString minOrderCol = "min_" + orderCol;
-        QString maxOrderCol = "max_" + orderCol;
-
-        QSqlQuery updateQuery (db);
-        updateQuery.prepare(QString("UPDATE words SET %1=?, %2=?, %3=? "
-            "WHERE word=?").arg(orderCol).arg(minOrderCol).arg(maxOrderCol));
+    QSqlQuery query (db);
+    query.prepare("INSERT INTO words (word, length, playability, "
+                  "combinations0, combinations1, combinations2, "
+                  "playability_order, min_playability_order, "
+                  "max_playability_order, probability_order0, "
+                  "min_probability_order0, max_probability_order0, "
+                  "probability_order1, min_probability_order1, "
+                  "max_probability_order1, probability_order2, "
+                  "min_probability_order2, max_probability_order2, "
+                  "alphagram, num_anagrams, num_unique_letters, num_vowels, "
+                  "point_value, front_hooks, back_hooks, "
+                  "is_front_hook, is_back_hook, lexicon_symbols, "
+                  "definition) "
+                  "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, "
+                  "?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+
+    foreach (const WordRow& row, rows) {
+        int bindNum = 0;
+        query.bindValue(bindNum++, row.word);
+        query.bindValue(bindNum++, row.length);
+        query.bindValue(bindNum++, row.playability);
+        query.bindValue(bindNum++, row.combinations0);
+        query.bindValue(bindNum++, row.combinations1);
+        query.bindValue(bindNum++, row.combinations2);
+        for (int i = 0; i < NumOrderColumns; ++i) {
+            query.bindValue(bindNum++, row.order[i]);
+            query.bindValue(bindNum++, row.minOrder[i]);
+            query.bindValue(bindNum++, row.maxOrder[i]);
+        }
+        query.bindValue(bindNum++, row.alphagram);
+        query.bindValue(bindNum++, row.numAnagrams);
+        query.bindValue(bindNum++, row.numUniqueLetters);
+        query.bindValue(bindNum++, row.numVowels);
+        query.bindValue(bindNum++, row.pointValue);
+        query.bindValue(bindNum++, row.frontHooks);
+        query.bindValue(bindNum++, row.backHooks);
+        query.bindValue(bindNum++, row.isFrontHook);
+        query.bindValue(bindNum++, row.isBackHook);
+        query.bindValue(bindNum++, row.symbols);
+        query.bindValue(bindNum++, row.definition);
+        query.exec();
 
-        for (int length = 1; length <= MAX_WORD_LEN; ++length) {
-            QSqlQuery selectQuery (db);
-            selectQuery.prepare(QString("SELECT word, %1 FROM words "
-                "WHERE length=? ORDER BY %1 DESC").arg(valueCol));
+        if ((stepNum % PROGRESS_STEP) == 0) {
+            if (cancelled) {
+                transactionQuery.exec("END TRANSACTION");
+                return;
+            }
+            emit progress(stepNum);
+        }
+        ++stepNum;
+    }
 
-            selectQuery.bindValue(0, length);
-            selectQuery.exec();
+    transactionQuery.exec("END TRANSACTION");
+}
 
-            QMap<QString, QString> equalWordMap;
-            int order = 1;
+//---------------------------------------------------------------------------
+//  updateProbabilityOrder
+//
+//! Update probability and playability order of words.  Words of equal
+//! value share a range of orders, from their minimum to their maximum
+//! order, and are ordered by alphagram within the range.
+//
+//! @param rows the rows of the words, grouped by length
+//! @param stepNum the current step number
+//---------------------------------------------------------------------------
+void
+CreateDatabaseThread::updateProbabilityOrder(QVector<WordRow>& rows, int&
+                                             stepNum)
+{
+    int numRows = rows.size();
+    int begin = 0;
+    while (begin < numRows) {
+        int length = rows.at(begin).length;
+        int end = begin + 1;
+        while ((end < numRows) && (rows.at(end).length == length))
+            ++end;
+
+        QVector<int> indexes;
+        for (int i = begin; i < end; ++i)
+            indexes.append(i);
+        int numIndexes = indexes.size();
+
+        for (int column = 0; column < NumOrderColumns; ++column) {
+            qSort(indexes.begin(), indexes.end(),
+                  OrderLessThan(rows.constData(), column));
+
+            // Start a new range where the value changes
             int minOrder = 1;
             double prevValue = 0;
-
-            while (selectQuery.next()) {
-                QString word = selectQuery.value(0).toString();
-                double value = selectQuery.value(1).toDouble();
-
-                // Update probability ranges
-                if ((value != prevValue) && !equalWordMap.empty()) {
-                    int maxOrder = minOrder + equalWordMap.size() - 1;
-                    QMapIterator<QString, QString> jt (equalWordMap);
-                    while (jt.hasNext()) {
-                        jt.next();
-                        QString equalWord = jt.value();
-                        updateQuery.bindValue(0, order);
-                        updateQuery.bindValue(1, minOrder);
-                        updateQuery.bindValue(2, maxOrder);
-                        updateQuery.bindValue(3, equalWord);
-                        updateQuery.exec();
-
-                        if ((stepNum % PROGRESS_STEP) == 0) {
-                            if (cancelled) {
-                                transactionQuery.exec("END TRANSACTION");
-                                return;
-                            }
-                            emit progress(stepNum);
-                        }
-
-                        ++order;
-                        ++stepNum;
-                    }
-                    minOrder = order;
-                    equalWordMap.clear();
-                }
-
-                // Sort words by alphagram
-                QString radix = Auxil::getAlphagram(word) + word;
-                equalWordMap.insert(radix, word);
-
+            for (int i = 0; i < numIndexes; ++i) {
+                WordRow& row = rows[indexes.at(i)];
+                double value = row.getOrderValue(column);
+                if ((i > 0) && (value != prevValue))
+                    minOrder = i + 1;
+                row.order[column] = i + 1;
+                row.minOrder[column] = minOrder;
                 prevValue = value;
             }
 
-            int maxOrder = minOrder + equalWordMap.size() - 1;
-            QMapIterator<QString, QString> jt (equalWordMap);
-            while (jt.hasNext()) {
-                jt.next();
-                QString equalWord = jt.value();
-                updateQuery.bindValue(0, order);
-                updateQuery.bindValue(1, minOrder);
-                updateQuery.bindValue(2, maxOrder);
-                updateQuery.bindValue(3, equalWord);
-                updateQuery.exec();
-                ++order;
-                ++stepNum;
+            // End each range where the next one starts
+            int maxOrder = numIndexes;
+            for (int i = numIndexes - 1; i >= 0; --i) {
+                WordRow& row = rows[indexes.at(i)];
+                if ((i < numIndexes - 1) && (row.minOrder[column] !=
+                    rows.at(indexes.at(i + 1)).minOrder[column]))
+                {
+                    maxOrder = i + 1;
+                }
+                row.maxOrder[column] = maxOrder;
             }
+
+            stepNum += numIndexes;
+            if (cancelled)
+                return;
+            emit progress(stepNum);
         }
+
+        begin = end;
     }
+}
 
-    transactionQuery.exec("END TRANSACTION");
+//---------------------------------------------------------------------------
+//  getOrderColumnName
+//
+//! Get the name of an order column of the words table.
+//
+//! @param column the order column
+//! @return the column name
+//---------------------------------------------------------------------------
+QString
+CreateDatabaseThread::getOrderColumnName(int column) const
+{
+    return (column == PlayabilityOrder) ? QString("playability_order")
+        : QString("probability_order%1").arg(column - ProbabilityOrder0);
 }
 
 //---------------------------------------------------------------------------
 //  updateDefinitions
 //
-//! Update definitions of words in the database.
+//! Update definitions of words from the definition file.
 //
-//! @param db the database
+//! @param rows the rows of the words
 //! @param stepNum the current step number
 //---------------------------------------------------------------------------
 void
-CreateDatabaseThread::updateDefinitions(QSqlDatabase& db, int& stepNum)
+CreateDatabaseThread::updateDefinitions(QVector<WordRow>& rows, int&
+                                        stepNum)
 {
-    QSqlQuery transactionQuery ("BEGIN TRANSACTION", db);
+    QHash<QString, int> rowIndexes;
+    for (int i = 0; i < rows.size(); ++i)
+        rowIndexes.insert(rows.at(i).word, i);
 
-    QSqlQuery query (db);
-    query.prepare("UPDATE words SET definition=? WHERE word=?");
-
-    QMap<QString, QString> definitionMap;
     QFile definitionFile (definitionFilename);
     if (definitionFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
         bool readNewline = true;
@@ -530,8 +1037,7 @@ CreateDatabaseThread::updateDefinitions(QSqlDatabase& db, int& stepNum)
             if (!line.length() || (line.at(0) == '#')) {
                 if ((stepNum % PROGRESS_STEP) == 0) {
                     if (cancelled) {
-                        transactionQuery.exec("END TRANSACTION");
-                        delete buffer;
+                        delete[] buffer;
                         return;
                     }
                     emit progress(stepNum);
@@ -542,24 +1048,21 @@ CreateDatabaseThread::updateDefinitions(QSqlDatabase& db, int& stepNum)
             QString word = line.section(' ', 0, 0).toUpper();
             QString definition = line.section(' ', 1);
 
-            query.bindValue(0, definition);
-            query.bindValue(1, word);
-            query.exec();
+            int index = rowIndexes.value(word, -1);
+            if (index >= 0)
+                rows[index].definition = definition;
 
             if ((stepNum % PROGRESS_STEP) == 0) {
                 if (cancelled) {
-                    transactionQuery.exec("END TRANSACTION");
-                    delete buffer;
+                    delete[] buffer;
                     return;
                 }
                 emit progress(stepNum);
             }
             ++stepNum;
         }
-        delete buffer;
+        delete[] buffer;
     }
-
-    transactionQuery.exec("END TRANSACTION");
 }
 
 //---------------------------------------------------------------------------
@@ -588,30 +1091,27 @@ CreateDatabaseThread::cleanup()
 //---------------------------------------------------------------------------
 //  updateDefinitionLinks
 //
-//! Update links within definitions of words in the database.
+//! Update links within definitions of words.
 //
-//! @param db the database
+//! @param rows the rows of the words
 //! @param stepNum the current step number
 //---------------------------------------------------------------------------
 void
-CreateDatabaseThread::updateDefinitionLinks(QSqlDatabase& db, int& stepNum)
+CreateDatabaseThread::updateDefinitionLinks(QVector<WordRow>& rows, int&
+                                            stepNum)
 {
-    getDefinitions(db, stepNum);
+    getDefinitions(rows, stepNum);
 
     if (cancelled)
         return;
 
-    QSqlQuery updateQuery (db);
-    updateQuery.prepare("UPDATE words SET definition=? WHERE word=?");
-
-    QSqlQuery transactionQuery ("BEGIN TRANSACTION", db);
-
     QSet<QString> alreadyReplaced;
-    QMapIterator<QString, QString> it (definitions);
-    while (it.hasNext()) {
-        it.next();
-        QString word = it.key();
-        QString definition = it.value();
+    for (int i = 0; i < rows.size(); ++i) {
+        WordRow& row = rows[i];
+        if (!definitions.contains(row.word))
+            continue;
+        QString word = row.word;
+        QString definition = definitions.value(word);
 
         QStringList defs = definition.split(WordEngine::DEF_ORIG_SEP);
         QString newDefinition;
@@ -626,47 +1126,36 @@ CreateDatabaseThread::updateDefinitionLinks(QSqlDatabase& db, int& stepNum)
                 &alreadyReplaced);
         }
 
-        if (definition != newDefinition) {
-            updateQuery.bindValue(0, newDefinition);
-            updateQuery.bindValue(1, word);
-            updateQuery.exec();
-        }
+        row.definition = newDefinition;
 
         ++stepNum;
 
         if ((stepNum % PROGRESS_STEP) == 0) {
-            if (cancelled) {
-                transactionQuery.exec("END TRANSACTION");
+            if (cancelled)
                 return;
-            }
             emit progress(stepNum);
         }
     }
-
-    transactionQuery.exec("END TRANSACTION");
 }
 
 //---------------------------------------------------------------------------
 //  getDefinitions
 //
-//! Get word definitions from the database and put them in the definitions
-//! map.  Discard any definitions that consist of only part of speech.
+//! Get word definitions from the rows and put them in the definitions map.
+//! Discard any definitions that consist of only part of speech.
 //
-//! @param db the database
+//! @param rows the rows of the words
 //! @param stepNum the current step number
 //---------------------------------------------------------------------------
 void
-CreateDatabaseThread::getDefinitions(QSqlDatabase& db, int& stepNum)
+CreateDatabaseThread::getDefinitions(const QVector<WordRow>& rows, int&
+                                     stepNum)
 {
-    QSqlQuery selectQuery (db);
-    selectQuery.prepare("SELECT word, definition FROM words");
-    selectQuery.exec();
-
     QRegExp defRegex (QString("^[^[]|\\s+/\\s+[^[]"));
 
-    while (selectQuery.next()) {
-        QString word = selectQuery.value(0).toString();
-        QString definition = selectQuery.value(1).toString();
+    foreach (const WordRow& row, rows) {
+        const QString& word = row.word;
+        const QString& definition = row.definition;
 
         if (defRegex.indexIn(definition, 0) < 0) {
             ++stepNum;
@@ -855,3 +1344,81 @@ CreateDatabaseThread::importPlayability(const QString& filename,
 
     return imported;
 }
+
+//---------------------------------------------------------------------------
+//  run
+//
+//! Compute chunks of rows until every chunk has been taken.  Stop early if
+//! the creation of the database is cancelled.
+//---------------------------------------------------------------------------
+void
+CreateDatabaseThread::RowJob::run()
+{
+    int numWords = words.size();
+    for (;;) {
+        int begin = nextChunk.fetchAndAddRelaxed(1) * ROW_CHUNK_SIZE;
+        if ((begin >= numWords) || thread->cancelled)
+            break;
+        int end = qMin(begin + ROW_CHUNK_SIZE, numWords);
+        for (int i = begin; i < end; ++i) {
+            thread->computeRow(words.at(i), lexStyles, playabilityMap,
+                               letterBag, rows[i]);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+//  run
+//
+//! Take part in computing rows, then signal that this thread is done.
+//---------------------------------------------------------------------------
+void
+CreateDatabaseThread::RowWorker::run()
+{
+    job->run();
+    job->finished.release();
+}
+
+//---------------------------------------------------------------------------
+//  getOrderValue
+//
+//! Get the value by which words are ordered in an order column.
+//
+//! @param column the order column
+//! @return the value
+//---------------------------------------------------------------------------
+double
+CreateDatabaseThread::WordRow::getOrderValue(int column) const
+{
+    switch (column) {
+        case PlayabilityOrder: return playability;
+        case ProbabilityOrder0: return combinations0;
+        case ProbabilityOrder1: return combinations1;
+        case ProbabilityOrder2: return combinations2;
+        default: return 0;
+    }
+}
+
+//---------------------------------------------------------------------------
+//  operator()
+//
+//! Compare two rows by their value in the order column, then by alphagram,
+//! then by word.
+//
+//! @param a the index of the first row
+//! @param b the index of the second row
+//! @return true if the first row comes before the second, false otherwise
+//---------------------------------------------------------------------------
+bool
+CreateDatabaseThread::OrderLessThan::operator()(int a, int b) const
+{
+    const WordRow& rowA = rows[a];
+    const WordRow& rowB = rows[b];
+    double valueA = rowA.getOrderValue(column);
+    double valueB = rowB.getOrderValue(column);
+    if (valueA != valueB)
+        return valueA > valueB;
+    if (rowA.alphagram != rowB.alphagram)
+        return rowA.alphagram < rowB.alphagram;
+    return rowA.word < rowB.word;
+}
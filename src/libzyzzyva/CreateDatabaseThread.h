@@ -25,10 +25,18 @@
 #ifndef ZYZZYVA_CREATE_DATABASE_THREAD_H
 #define ZYZZYVA_CREATE_DATABASE_THREAD_H
 
+#include "LetterBag.h"
+#include "LexiconStyle.h"
+#include <QAtomicInt>
+#include <QList>
 #include <QMap>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QString>
+#include <QStringList>
 #include <QSqlDatabase>
 #include <QThread>
+#include <QVector>
 
 class WordEngine;
 
@@ -39,9 +47,11 @@ class CreateDatabaseThread : public QThread
     CreateDatabaseThread(WordEngine* e, const QString& lex, const QString& db,
                          const QString& def, QObject* parent = 0)
         : QThread(parent), wordEngine(e), lexiconName(lex),
-          dbFilename(db), definitionFilename(def), cancelled(false) { }
+          dbFilename(db), definitionFilename(def), incremental(false),
+          cancelled(false) { }
     ~CreateDatabaseThread() { }
 
+    void setIncremental(bool b) { incremental = b; }
     bool getCancelled() { return cancelled; }
     QString getError() { return error; }
 
@@ -57,18 +67,119 @@ class CreateDatabaseThread : public QThread
     protected:
     void run();
 
+    private:
+    // The columns of the words table that hold the orders of words by
+    // playability and by probability with 0, 1 and 2 blanks
+    enum OrderColumn {
+        PlayabilityOrder = 0,
+        ProbabilityOrder0,
+        ProbabilityOrder1,
+        ProbabilityOrder2,
+        NumOrderColumns
+    };
+
+    // A row of the words table
+    class WordRow {
+      public:
+        WordRow() : length(0), playability(0), combinations0(0),
+            combinations1(0), combinations2(0), numAnagrams(0),
+            numUniqueLetters(0), numVowels(0), pointValue(0),
+            isFrontHook(0), isBackHook(0) { }
+        double getOrderValue(int column) const;
+
+        QString word;
+        int length;
+        qint64 playability;
+        double combinations0;
+        double combinations1;
+        double combinations2;
+        QString alphagram;
+        int numAnagrams;
+        int numUniqueLetters;
+        int numVowels;
+        int pointValue;
+        QString frontHooks;
+        QString backHooks;
+        int isFrontHook;
+        int isBackHook;
+        QString symbols;
+        QString definition;
+        int order[NumOrderColumns];
+        int minOrder[NumOrderColumns];
+        int maxOrder[NumOrderColumns];
+    };
+
+    // Orders the indexes of rows by descending value in an order column.
+    // Rows of equal value are ordered by alphagram, then by word.
+    class OrderLessThan {
+      public:
+        OrderLessThan(const WordRow* r, int c) : rows(r), column(c) { }
+        bool operator()(int a, int b) const;
+      private:
+        const WordRow* rows;
+        int column;
+    };
+
+    // State shared by the threads computing rows.  Words are divided into
+    // chunks, and each thread takes the next uncomputed chunk until none are
+    // left.  Each row is written by exactly one thread.
+    class RowJob {
+      public:
+        RowJob(const CreateDatabaseThread* t, const QStringList& w,
+               const QList<LexiconStyle>& s, const QMap<QString, qint64>& p,
+               QVector<WordRow>& r)
+            : thread(t), words(w), lexStyles(s), playabilityMap(p),
+              rows(r.data()), nextChunk(0) { }
+        void run();
+
+        const CreateDatabaseThread* thread;
+        const QStringList& words;
+        const QList<LexiconStyle>& lexStyles;
+        const QMap<QString, qint64>& playabilityMap;
+        LetterBag letterBag;
+        WordRow* rows;
+        QAtomicInt nextChunk;
+        QSemaphore finished;
+    };
+
+    // Computes part of the rows of a row job on a pool thread
+    class RowWorker : public QRunnable {
+      public:
+        RowWorker(RowJob* j) : job(j) { }
+        void run();
+
+      private:
+        RowJob* job;
+    };
+
     private:
     void runPrivate();
+    void updatePrivate();
+    void updateWords(QSqlDatabase& db, int& stepNum);
+    void setBulkLoadMode(QSqlDatabase& db);
+    void finishDatabase(QSqlDatabase& db, int& stepNum);
     void createTables(QSqlDatabase& db);
-    void createIndexes(QSqlDatabase& db);
+    void createIndexes(QSqlDatabase& db, int& stepNum);
     void insertVersion(QSqlDatabase& db);
-    void insertWords(QSqlDatabase& db, int& stepNum);
+    void computeWordRows(QVector<WordRow>& rows, int& stepNum);
+    QList<LexiconStyle> getLexiconStyles() const;
+    QString getPlayabilityFilename() const;
+    QStringList getWords(int length) const;
+    void computeRows(const QStringList& words, const QList<LexiconStyle>&
+                     lexStyles, const QMap<QString, qint64>& playabilityMap,
+                     QVector<WordRow>& rows) const;
+    void computeRow(const QString& word, const QList<LexiconStyle>&
+                    lexStyles, const QMap<QString, qint64>& playabilityMap,
+                    const LetterBag& letterBag, WordRow& row) const;
+    void insertRows(QSqlDatabase& db, const QVector<WordRow>& rows,
+                    int& stepNum);
     void updatePlayabilityOrder(QSqlDatabase& db, int& stepNum);
-    void updateProbabilityOrder(QSqlDatabase& db, int& stepNum);
-    void updateDefinitions(QSqlDatabase& db, int& stepNum);
-    void updateDefinitionLinks(QSqlDatabase& db, int& stepNum);
+    void updateProbabilityOrder(QVector<WordRow>& rows, int& stepNum);
+    QString getOrderColumnName(int column) const;
+    void updateDefinitions(QVector<WordRow>& rows, int& stepNum);
+    void updateDefinitionLinks(QVector<WordRow>& rows, int& stepNum);
 
-    void getDefinitions(QSqlDatabase& db, int& stepNum);
+    void getDefinitions(const QVector<WordRow>& rows, int& stepNum);
     QString replaceDefinitionLinks(const QString& definition, int maxDepth,
         QSet<QString>* alreadyReplaced = 0, bool useFollow = false) const;
     QString getSubDefinition(const QString& word, const QString& pos) const;
@@ -79,6 +190,7 @@ class CreateDatabaseThread : public QThread
     QString lexiconName;
     QString dbFilename;
     QString definitionFilename;
+    bool incremental;
     bool cancelled;
     QString error;
     QMap<QString, QString> definitions;
@@ -24,6 +24,8 @@
 #include "DefinitionBox.h"
 #include "LexiconSelectWidget.h"
 #include "MainSettings.h"
+#include "MainWindow.h"
+#include "SearchService.h"
 #include "WordEngine.h"
 #include "WordLineEdit.h"
 #include "WordValidator.h"
@@ -40,6 +42,10 @@ using namespace Defs;
 const QString TITLE_PREFIX = "Definition";
 const QString NONE_STR = "(none)";
 
+// The anagram, front extension, back extension and double extension
+// searches run for all information about a word
+const int NUM_INFO_SEARCHES = 4;
+
 //---------------------------------------------------------------------------
 //  DefineForm
 //
@@ -49,7 +55,9 @@ const QString NONE_STR = "(none)";
 //! @param f widget flags
 //---------------------------------------------------------------------------
 DefineForm::DefineForm(WordEngine* e, QWidget* parent, Qt::WFlags f)
-    : ActionForm(DefineFormType, parent, f), engine(e)
+    : ActionForm(DefineFormType, parent, f), engine(e),
+      searchService(MainWindow::getInstance()->getSearchService()),
+      infoRequestId(0)
 {
     QVBoxLayout* mainVlay = new QVBoxLayout(this);
     mainVlay->setMargin(MARGIN);
@@ -109,6 +117,9 @@ DefineForm::DefineForm(WordEngine* e, QWidget* parent, Qt::WFlags f)
     infoButton->setEnabled(false);
     resultBox->hide();
 
+    connect(searchService, SIGNAL(searchFinished(int)),
+            SLOT(searchFinished(int)));
+
     lexiconActivated(lexiconWidget->getCurrentLexicon());
 }
 
@@ -228,7 +239,9 @@ DefineForm::displayAllInfo()
 //  displayInfo
 //
 //! Look up and display the acceptability and definition of the word currently
-//! in the word edit area.
+//! in the word edit area.  If all information is requested, the searches
+//! for anagrams and extensions are run in the background, and the
+//! information is displayed again when they are finished.
 //
 //! @param allInfo whether to display all information in addition to the
 //! definition
@@ -240,9 +253,86 @@ DefineForm::displayInfo(bool allInfo)
     if (word.isEmpty())
         return;
 
-    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-
     QString lexicon = lexiconWidget->getCurrentLexicon();
+    searchService->cancelAll(this);
+    infoRequestId = 0;
+    showInfo(lexicon, word, QList<QStringList>());
+    if (!allInfo)
+        return;
+
+    QList<SearchSpec> specs;
+    SearchSpec spec;
+    SearchCondition condition;
+
+    // Anagrams
+    condition.type = SearchCondition::AnagramMatch;
+    condition.stringValue = word;
+    spec.conditions.append(condition);
+    specs.append(spec);
+
+    // Front extensions
+    spec.conditions.clear();
+    condition.type = SearchCondition::PatternMatch;
+    condition.stringValue = "*?" + word;
+    spec.conditions.append(condition);
+    specs.append(spec);
+
+    // Back extensions
+    spec.conditions.clear();
+    condition.stringValue = word + "?*";
+    spec.conditions.append(condition);
+    specs.append(spec);
+
+    // Double extensions
+    spec.conditions.clear();
+    condition.stringValue = "*?" + word + "?*";
+    spec.conditions.append(condition);
+    specs.append(spec);
+
+    infoLexicon = lexicon;
+    infoWord = word;
+    infoRequestId = searchService->search(this, lexicon, specs, true,
+                                          SearchService::HighPriority);
+}
+
+//---------------------------------------------------------------------------
+//  searchFinished
+//
+//! Called when a search is finished.  If it is the search for information
+//! about the current word, display all information about the word.
+//
+//! @param requestId the search request ID
+//---------------------------------------------------------------------------
+void
+DefineForm::searchFinished(int requestId)
+{
+    if (!infoRequestId || (requestId != infoRequestId))
+        return;
+
+    infoRequestId = 0;
+    if (searchService->isCanceled(requestId))
+        return;
+
+    showInfo(infoLexicon, infoWord, searchService->getResults(requestId));
+}
+
+//---------------------------------------------------------------------------
+//  showInfo
+//
+//! Display the acceptability and definition of a word, and all other
+//! information about it if the searches for it have been run.
+//
+//! @param lexicon the name of the lexicon
+//! @param word the word
+//! @param searchResults the anagrams, front extensions, back extensions and
+//! double extensions of the word, or an empty list to display only the
+//! definition
+//---------------------------------------------------------------------------
+void
+DefineForm::showInfo(const QString& lexicon, const QString& word, const
+                     QList<QStringList>& searchResults)
+{
+    bool allInfo = (searchResults.size() == NUM_INFO_SEARCHES);
     bool showSymbols = MainSettings::getWordListUseLexiconStyles();
 
     bool acceptable = engine->isAcceptable(lexicon, word);
@@ -266,14 +356,8 @@ DefineForm::displayInfo(bool allInfo)
     }
 
     if (allInfo) {
-        SearchSpec spec;
-        SearchCondition condition;
-
         // Get anagrams
-        condition.type = SearchCondition::AnagramMatch;
-        condition.stringValue = word;
-        spec.conditions.append(condition);
-        QStringList anagrams = engine->search(lexicon, spec, true);
+        QStringList anagrams = searchResults[0];
         anagrams.removeAll(word);
         if (showSymbols) {
             QMutableListIterator<QString> it (anagrams);
@@ -303,11 +387,7 @@ DefineForm::displayInfo(bool allInfo)
         resultStr += "<br><b>Back Hooks:</b> " + bHookStr;
 
         // Get front extensions
-        spec.conditions.clear();
-        condition.type = SearchCondition::PatternMatch;
-        condition.stringValue = "*?" + word;
-        spec.conditions.append(condition);
-        QStringList fExts = engine->search(lexicon, spec, true);
+        QStringList fExts = searchResults[1];
         if (showSymbols) {
             QMutableListIterator<QString> it (fExts);
             while (it.hasNext()) {
@@ -322,11 +402,7 @@ DefineForm::displayInfo(bool allInfo)
         resultStr += "<br><b>Front Extensions:</b> " + fExtStr;
 
         // Get back extensions
-        spec.conditions.clear();
-        condition.type = SearchCondition::PatternMatch;
-        condition.stringValue = word + "?*";
-        spec.conditions.append(condition);
-        QStringList bExts = engine->search(lexicon, spec, true);
+        QStringList bExts = searchResults[2];
         if (showSymbols) {
             QMutableListIterator<QString> it (bExts);
             while (it.hasNext()) {
@@ -340,11 +416,7 @@ DefineForm::displayInfo(bool allInfo)
         resultStr += "<br><b>Back Extensions:</b> " + bExtStr;
 
         // Get double extensions
-        spec.conditions.clear();
-        condition.type = SearchCondition::PatternMatch;
-        condition.stringValue = "*?" + word + "?*";
-        spec.conditions.append(condition);
-        QStringList dExts = engine->search(lexicon, spec, true);
+        QStringList dExts = searchResults[3];
         if (showSymbols) {
             QMutableListIterator<QString> it (dExts);
             while (it.hasNext()) {
@@ -360,12 +432,11 @@ DefineForm::displayInfo(bool allInfo)
 
     resultBox->setText(resultStr);
 
+    QString title = word;
     if (showSymbols)
-        word += engine->getLexiconSymbols(lexicon, word);
+        title += engine->getLexiconSymbols(lexicon, word);
 
-    resultBox->setTitle(word);
+    resultBox->setTitle(title);
     resultBox->show();
     selectInputArea();
-
-    QApplication::restoreOverrideCursor();
 }
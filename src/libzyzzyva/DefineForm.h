@@ -27,9 +27,12 @@
 
 #include "ActionForm.h"
 #include "ZPushButton.h"
+#include <QList>
+#include <QStringList>
 
 class DefinitionBox;
 class LexiconSelectWidget;
+class SearchService;
 class WordEngine;
 class WordLineEdit;
 
@@ -52,12 +55,16 @@ class DefineForm : public ActionForm
     void wordChanged(const QString& word);
     void displayDefinition();
     void displayAllInfo();
+    void searchFinished(int requestId);
 
     private:
     void displayInfo(bool allInfo = false);
+    void showInfo(const QString& lexicon, const QString& word, const
+                  QList<QStringList>& searchResults);
 
     private:
     WordEngine*    engine;
+    SearchService* searchService;
     LexiconSelectWidget* lexiconWidget;
     WordLineEdit*  wordLine;
     ZPushButton*   defineButton;
@@ -65,6 +72,11 @@ class DefineForm : public ActionForm
     DefinitionBox* resultBox;
 
     QString detailsString;
+
+    // The word whose information is being searched for
+    int     infoRequestId;
+    QString infoLexicon;
+    QString infoWord;
 };
 
 #endif // ZYZZYVA_DEFINE_FORM_H
@@ -0,0 +1,324 @@
+//---------------------------------------------------------------------------
+// LexiconBundle.cpp
+//
+// A lexicon and the indexes built from it, held in a single mapped file.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#include "LexiconBundle.h"
+#include "Auxil.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <QVector>
+#include <cstring>
+
+// The first bytes of every bundle
+const char BUNDLE_MAGIC[] = "ZYZLEXB";
+
+// The version of the bundle layout.  Must be changed whenever the layout of
+// any section changes.
+const quint32 BUNDLE_VERSION = 2;
+
+// Sections are written in the byte order of the host that builds them, so
+// a bundle from a host of the other byte order reads this value differently
+const quint32 BYTE_ORDER_MARK = 0x01020304;
+
+// The alignment of the start of each section
+const qint64 SECTION_ALIGNMENT = 8;
+
+// Appended to the name of a bundle while it is being written
+const QString TEMP_FILE_SUFFIX = ".tmp";
+
+//---------------------------------------------------------------------------
+//  LexiconBundle
+//
+//! Constructor.
+//---------------------------------------------------------------------------
+LexiconBundle::LexiconBundle()
+    : file(0), mapping(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  ~LexiconBundle
+//
+//! Destructor.  Unmap the bundle if it was opened.  Nothing attached to the
+//! bundle may be used afterward.
+//---------------------------------------------------------------------------
+LexiconBundle::~LexiconBundle()
+{
+    clear();
+}
+
+//---------------------------------------------------------------------------
+//  getSourceStamp
+//
+//! Get a stamp identifying the current state of the files a bundle is built
+//! from.  The stamp changes whenever any of the files is changed, removed or
+//! created.
+//
+//! @param filenames the names of the files
+//! @return the stamp
+//---------------------------------------------------------------------------
+QByteArray
+LexiconBundle::getSourceStamp(const QStringList& filenames)
+{
+    QByteArray stamp;
+    foreach (const QString& filename, filenames) {
+        QFileInfo info (filename);
+        qint64 size = -1;
+        uint time = 0;
+        if (info.exists()) {
+            size = info.size();
+            time = info.lastModified().toTime_t();
+        }
+        stamp += QString("%1 %2 %3\n").arg(size).arg(time)
+            .arg(info.absoluteFilePath()).toUtf8();
+    }
+    return stamp;
+}
+
+//---------------------------------------------------------------------------
+//  clear
+//
+//! Remove all sections, and unmap the bundle if it was opened.
+//---------------------------------------------------------------------------
+void
+LexiconBundle::clear()
+{
+    sections.clear();
+    if (file) {
+        if (mapping)
+            file->unmap(mapping);
+        delete file;
+    }
+    file = 0;
+    mapping = 0;
+}
+
+//---------------------------------------------------------------------------
+//  open
+//
+//! Open a bundle and map it into memory.  Any sections already in the
+//! bundle are removed.
+//
+//! @param filename the name of the bundle file
+//! @param errString returns the error string in case of error
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+LexiconBundle::open(const QString& filename, QString* errString)
+{
+    clear();
+
+    file = new QFile(filename);
+    if (!file->open(QIODevice::ReadOnly)) {
+        if (errString) {
+            *errString = "Can't open file '" + filename + "': " +
+                file->errorString();
+        }
+        clear();
+        return false;
+    }
+
+    QString error;
+    do {
+        qint64 fileSize = file->size();
+        if (fileSize >= qint64(sizeof(Header)))
+            mapping = file->map(0, fileSize);
+        if (!mapping) {
+            error = "Can't map file '" + filename + "': " +
+                file->errorString();
+            break;
+        }
+
+        const Header* header = (const Header*) mapping;
+        if (memcmp(header->magic, BUNDLE_MAGIC, sizeof(header->magic))) {
+            error = "The file '" + filename + "' is not a lexicon bundle.";
+            break;
+        }
+
+        if ((header->version != BUNDLE_VERSION) ||
+            (header->byteOrder != BYTE_ORDER_MARK) ||
+            (header->qtVersion != QT_VERSION))
+        {
+            error = "The lexicon bundle '" + filename + "' was built by "
+                "another version of the program or on another platform.";
+            break;
+        }
+
+        qint64 tableEnd = sizeof(Header) +
+            qint64(header->numSections) * sizeof(SectionEntry);
+        if (tableEnd > fileSize) {
+            error = "The lexicon bundle '" + filename + "' is truncated or "
+                "corrupted.";
+            break;
+        }
+
+        const SectionEntry* entries =
+            (const SectionEntry*) (mapping + sizeof(Header));
+        for (quint32 i = 0; i < header->numSections; ++i) {
+            const SectionEntry& entry = entries[i];
+            if ((entry.offset < tableEnd) || (entry.size < 0) ||
+                (entry.offset % SECTION_ALIGNMENT) ||
+                (entry.size > fileSize - entry.offset))
+            {
+                error = "The lexicon bundle '" + filename + "' is "
+                    "truncated or corrupted.";
+                break;
+            }
+            sections.insert(entry.type, QByteArray::fromRawData(
+                (const char*) mapping + entry.offset, entry.size));
+        }
+    } while (false);
+
+    if (!error.isEmpty()) {
+        if (errString)
+            *errString = error;
+        clear();
+        return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  save
+//
+//! Write the sections of the bundle to a file.  The file is replaced only
+//! once the bundle is completely written, so a bundle that is open
+//! elsewhere is never seen half written.
+//
+//! @param filename the name of the bundle file
+//! @param errString returns the error string in case of error
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+LexiconBundle::save(const QString& filename, QString* errString) const
+{
+    QString tempFilename = filename + TEMP_FILE_SUFFIX;
+    QFile out (tempFilename);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (errString) {
+            *errString = "Can't open file '" + tempFilename + "': " +
+                out.errorString();
+        }
+        return false;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+    header.version = BUNDLE_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.qtVersion = QT_VERSION;
+    header.numSections = sections.size();
+
+    // Lay the sections out after the section table, each aligned so its
+    // array can be used in place once mapped
+    QVector<SectionEntry> entries;
+    qint64 tableEnd = sizeof(Header) +
+        qint64(sections.size()) * sizeof(SectionEntry);
+    qint64 offset = tableEnd;
+    QMapIterator<int, QByteArray> it (sections);
+    while (it.hasNext()) {
+        it.next();
+        offset = (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+        SectionEntry entry;
+        entry.type = it.key();
+        entry.reserved = 0;
+        entry.offset = offset;
+        entry.size = it.value().size();
+        entries.append(entry);
+        offset += entry.size;
+    }
+
+    bool ok = (out.write((const char*) &header, sizeof(header)) ==
+               qint64(sizeof(header)));
+    if (ok && !entries.isEmpty()) {
+        qint64 tableSize = tableEnd - sizeof(Header);
+        ok = (out.write((const char*) entries.constData(), tableSize) ==
+              tableSize);
+    }
+
+    qint64 position = tableEnd;
+    it.toFront();
+    for (int i = 0; ok && it.hasNext(); ++i) {
+        it.next();
+        const SectionEntry& entry = entries.at(i);
+        if (entry.offset > position) {
+            QByteArray padding (int(entry.offset - position), 0);
+            ok = (out.write(padding) == padding.size());
+        }
+        ok = ok && (out.write(it.value()) == entry.size);
+        position = entry.offset + entry.size;
+    }
+
+    out.close();
+    if (!ok || (out.error() != QFile::NoError)) {
+        if (errString) {
+            *errString = "Can't write file '" + tempFilename + "': " +
+                out.errorString();
+        }
+        QFile::remove(tempFilename);
+        return false;
+    }
+
+    if (!Auxil::replaceFile(tempFilename, filename)) {
+        if (errString)
+            *errString = "Can't replace file '" + filename + "'.";
+        QFile::remove(tempFilename);
+        return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  isCurrent
+//
+//! Determine whether the bundle was built from a set of files in their
+//! current state.
+//
+//! @param filenames the names of the files
+//! @return true if the bundle is current, false otherwise
+//---------------------------------------------------------------------------
+bool
+LexiconBundle::isCurrent(const QStringList& filenames) const
+{
+    return hasSection(SourceStamp) &&
+        (getSection(SourceStamp) == getSourceStamp(filenames));
+}
+
+//---------------------------------------------------------------------------
+//  setSection
+//
+//! Set the data of a section, replacing any data it already has.  The data
+//! is not copied if it was created with QByteArray::fromRawData, so it must
+//! be kept until the bundle is saved.
+//
+//! @param type the section type
+//! @param data the data
+//---------------------------------------------------------------------------
+void
+LexiconBundle::setSection(int type, const QByteArray& data)
+{
+    sections.insert(type, data);
+}
@@ -0,0 +1,105 @@
+//---------------------------------------------------------------------------
+// LexiconBundle.h
+//
+// A lexicon and the indexes built from it, held in a single mapped file.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#ifndef ZYZZYVA_LEXICON_BUNDLE_H
+#define ZYZZYVA_LEXICON_BUNDLE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+// A bundle is a set of sections, each holding one array exactly as it is
+// laid out in memory.  An opened bundle maps the whole file read-only, and
+// the structures attached to it use the mapping in place, so a lexicon is
+// loaded without reading or building anything, pages are only read as they
+// are touched, and lexicons loaded by several processes share the page
+// cache.  The bundle records the size and time of each file it was built
+// from, and is only used while they are unchanged.
+class LexiconBundle
+{
+    public:
+    // The sections of a bundle.  Each attribute of the attribute store has
+    // its own section, numbered up from AttributeColumns.
+    enum SectionType {
+        SourceStamp = 1,
+        LexiconFile,
+        ForwardDawg,
+        ReverseDawg,
+        ForwardSummaries,
+        ReverseSummaries,
+        FrontHooks,
+        BackHooks,
+        AlphagramKeys,
+        AlphagramWords,
+        AlphagramGroups,
+        AlphagramBuckets,
+        DefinitionOffsets,
+        DefinitionData,
+        AttributeColumns = 100
+    };
+
+    public:
+    LexiconBundle();
+    ~LexiconBundle();
+
+    static QByteArray getSourceStamp(const QStringList& filenames);
+
+    void clear();
+    bool open(const QString& filename, QString* errString = 0);
+    bool save(const QString& filename, QString* errString = 0) const;
+    bool isOpen() const { return mapping; }
+    bool isCurrent(const QStringList& filenames) const;
+    void setSection(int type, const QByteArray& data);
+    bool hasSection(int type) const { return sections.contains(type); }
+    QByteArray getSection(int type) const { return sections.value(type); }
+
+    private:
+    class Header {
+      public:
+        char magic[8];
+        quint32 version;
+        quint32 byteOrder;
+        quint32 qtVersion;
+        quint32 numSections;
+    };
+
+    class SectionEntry {
+      public:
+        quint32 type;
+        quint32 reserved;
+        qint64 offset;
+        qint64 size;
+    };
+
+    // The data of each section.  In an opened bundle the data points into
+    // the mapping.
+    QMap<int, QByteArray> sections;
+
+    QFile* file;
+    uchar* mapping;
+};
+
+#endif // ZYZZYVA_LEXICON_BUNDLE_H
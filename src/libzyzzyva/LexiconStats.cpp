@@ -0,0 +1,187 @@
+//---------------------------------------------------------------------------
+// LexiconStats.cpp
+//
+// Cardinality statistics of a lexicon, used to plan searches.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#include "LexiconStats.h"
+#include <QTime>
+
+//---------------------------------------------------------------------------
+//  LexiconStats
+//
+//! Constructor.
+//---------------------------------------------------------------------------
+LexiconStats::LexiconStats()
+    : numWords(0), buildTime(0)
+{
+    clear();
+}
+
+//---------------------------------------------------------------------------
+//  clear
+//
+//! Remove all statistics.
+//---------------------------------------------------------------------------
+void
+LexiconStats::clear()
+{
+    for (int i = 0; i < NUM_LENGTHS; ++i)
+        lengthCounts[i] = 0;
+    for (int i = 0; i < AttributeStore::NumAttributes; ++i) {
+        bucketWidths[i] = 1;
+        histograms[i] = QVector<quint32>();
+    }
+    numWords = 0;
+    buildTime = 0;
+}
+
+//---------------------------------------------------------------------------
+//  build
+//
+//! Gather statistics from the attributes of every word in a lexicon.  Any
+//! statistics already gathered are removed.
+//
+//! @param store the attribute store
+//---------------------------------------------------------------------------
+void
+LexiconStats::build(const AttributeStore& store)
+{
+    clear();
+    if (store.isEmpty())
+        return;
+
+    QTime timer;
+    timer.start();
+
+    int storeWords = store.getNumWords();
+    for (int i = 0; i < AttributeStore::NumAttributes; ++i) {
+        AttributeStore::Attribute attribute = AttributeStore::Attribute(i);
+
+        // Spread the values of the attribute evenly over the buckets
+        quint32 maxValue = 0;
+        for (int id = 0; id < storeWords; ++id)
+            maxValue = qMax(maxValue, store.getValue(attribute, id));
+        bucketWidths[i] = maxValue / NUM_BUCKETS + 1;
+        histograms[i].fill(0, NUM_LENGTHS * NUM_BUCKETS);
+    }
+
+    for (int id = 0; id < storeWords; ++id) {
+        int length = qMin(int(store.getValue(AttributeStore::Length, id)),
+                          NUM_LENGTHS - 1);
+        ++lengthCounts[length];
+        for (int i = 0; i < AttributeStore::NumAttributes; ++i) {
+            quint32 value = store.getValue(AttributeStore::Attribute(i), id);
+            ++histograms[i][length * NUM_BUCKETS + value / bucketWidths[i]];
+        }
+    }
+
+    numWords = storeWords;
+    buildTime = timer.elapsed();
+}
+
+//---------------------------------------------------------------------------
+//  getNumWords
+//
+//! Get the number of words with lengths in a range.
+//
+//! @param minLength the minimum length
+//! @param maxLength the maximum length
+//! @return the number of words
+//---------------------------------------------------------------------------
+int
+LexiconStats::getNumWords(int minLength, int maxLength) const
+{
+    int count = 0;
+    int last = qMin(maxLength, NUM_LENGTHS - 1);
+    for (int length = qMax(minLength, 0); length <= last; ++length)
+        count += lengthCounts[length];
+    return count;
+}
+
+//---------------------------------------------------------------------------
+//  estimate
+//
+//! Estimate the number of words with lengths in a range whose attributes
+//! all fall within ranges of values.
+//
+//! @param minLength the minimum length
+//! @param maxLength the maximum length
+//! @param attributes the attributes
+//! @param minValues the minimum value of each attribute
+//! @param maxValues the maximum value of each attribute
+//! @return the estimated number of words
+//---------------------------------------------------------------------------
+double
+LexiconStats::estimate(int minLength, int maxLength,
+                       const QList<AttributeStore::Attribute>& attributes,
+                       const QList<quint32>& minValues,
+                       const QList<quint32>& maxValues) const
+{
+    double total = 0;
+    int last = qMin(maxLength, NUM_LENGTHS - 1);
+    for (int length = qMax(minLength, 0); length <= last; ++length) {
+        double count = lengthCounts[length];
+        for (int i = 0; (i < attributes.size()) && (count > 0); ++i) {
+            count *= getFraction(attributes.at(i), length, minValues.at(i),
+                                 maxValues.at(i));
+        }
+        total += count;
+    }
+    return total;
+}
+
+//---------------------------------------------------------------------------
+//  getFraction
+//
+//! Estimate the fraction of the words of a length whose value of an
+//! attribute falls within a range, assuming the values are spread evenly
+//! within each bucket.
+//
+//! @param attribute the attribute
+//! @param length the word length
+//! @param minValue the minimum value
+//! @param maxValue the maximum value
+//! @return the estimated fraction
+//---------------------------------------------------------------------------
+double
+LexiconStats::getFraction(AttributeStore::Attribute attribute, int length,
+                          quint32 minValue, quint32 maxValue) const
+{
+    if (!lengthCounts[length] || (minValue > maxValue))
+        return 0;
+
+    quint32 width = bucketWidths[attribute];
+    quint32 first = minValue / width;
+    quint32 last = qMin(maxValue / width, quint32(NUM_BUCKETS - 1));
+    const quint32* buckets =
+        histograms[attribute].constData() + length * NUM_BUCKETS;
+
+    double count = 0;
+    for (quint32 bucket = first; bucket <= last; ++bucket) {
+        quint64 low = quint64(bucket) * width;
+        quint64 high = low + width - 1;
+        quint64 overlap = qMin(high, quint64(maxValue)) -
+            qMax(low, quint64(minValue)) + 1;
+        count += double(buckets[bucket]) * overlap / width;
+    }
+    return count / lengthCounts[length];
+}
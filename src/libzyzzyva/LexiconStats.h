@@ -0,0 +1,71 @@
+//---------------------------------------------------------------------------
+// LexiconStats.h
+//
+// Cardinality statistics of a lexicon, used to plan searches.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#ifndef ZYZZYVA_LEXICON_STATS_H
+#define ZYZZYVA_LEXICON_STATS_H
+
+#include "AttributeStore.h"
+#include "Defs.h"
+#include <QList>
+#include <QVector>
+
+// The number of words of each length, and a histogram of each attribute for
+// the words of each length, taken from an attribute store.  The order
+// attributes rank words among words of the same length, so keeping the
+// histograms apart by length lets conditions on length and order be
+// estimated together.  Other attributes are assumed to be independent.
+class LexiconStats
+{
+    public:
+    LexiconStats();
+    ~LexiconStats() { }
+
+    void clear();
+    void build(const AttributeStore& store);
+    bool isEmpty() const { return !numWords; }
+    int getNumWords() const { return numWords; }
+    int getNumWords(int minLength, int maxLength) const;
+    double estimate(int minLength, int maxLength,
+                    const QList<AttributeStore::Attribute>& attributes,
+                    const QList<quint32>& minValues,
+                    const QList<quint32>& maxValues) const;
+    int getBuildTime() const { return buildTime; }
+
+    private:
+    double getFraction(AttributeStore::Attribute attribute, int length,
+                       quint32 minValue, quint32 maxValue) const;
+
+    static const int NUM_LENGTHS = Defs::MAX_WORD_LEN + 1;
+    static const int NUM_BUCKETS = 64;
+
+    int numWords;
+    int lengthCounts[NUM_LENGTHS];
+    quint32 bucketWidths[AttributeStore::NumAttributes];
+
+    // Bucket counts for each attribute, indexed by length and bucket
+    QVector<quint32> histograms[AttributeStore::NumAttributes];
+    int buildTime;
+};
+
+#endif // ZYZZYVA_LEXICON_STATS_H
@@ -75,6 +75,7 @@ const QString SETTINGS_LEXICON_STYLES = "wordlist_lexicon_styles";
 const QString SETTINGS_USE_TILE_THEME = "use_tile_theme";
 const QString SETTINGS_TILE_THEME = "tile_theme";
 const QString SETTINGS_SEARCH_SELECT_INPUT = "search_select_input";
+const QString SETTINGS_SEARCH_WORD_CACHE_SIZE = "search_word_cache_size";
 const QString SETTINGS_QUIZ_LETTER_ORDER = "quiz_letter_order";
 const QString SETTINGS_QUIZ_BACKGROUND_COLOR = "quiz_background_color";
 const QString SETTINGS_QUIZ_USE_FLASHCARD_MODE = "quiz_use_flashcard_mode";
@@ -108,6 +109,7 @@ const QString DEFAULT_USER_DATA_DIR = Auxil::getHomeDir() + "/Zyzzyva";
 const bool    DEFAULT_USE_TILE_THEME = true;
 const QString DEFAULT_TILE_THEME = "tan-with-border";
 const bool    DEFAULT_SEARCH_SELECT_INPUT = true;
+const int     DEFAULT_SEARCH_WORD_CACHE_SIZE = 16;
 const QString DEFAULT_QUIZ_LETTER_ORDER = Defs::QUIZ_LETTERS_ALPHA;
 const QRgb    DEFAULT_QUIZ_BACKGROUND_COLOR = qRgb(0, 0, 127);
 const bool    DEFAULT_QUIZ_USE_FLASHCARD_MODE = false;
@@ -246,6 +248,9 @@ MainSettings::readSettings()
     instance->searchSelectInput
         = settings.value(SETTINGS_SEARCH_SELECT_INPUT,
                          DEFAULT_SEARCH_SELECT_INPUT).toBool();
+    instance->searchWordCacheSize
+        = settings.value(SETTINGS_SEARCH_WORD_CACHE_SIZE,
+                         DEFAULT_SEARCH_WORD_CACHE_SIZE).toInt();
 
     instance->quizLetterOrder
         = settings.value(SETTINGS_QUIZ_LETTER_ORDER,
@@ -388,6 +393,8 @@ MainSettings::writeSettings()
     settings.setValue(SETTINGS_TILE_THEME, instance->tileTheme);
     settings.setValue(SETTINGS_SEARCH_SELECT_INPUT,
                       instance->searchSelectInput);
+    settings.setValue(SETTINGS_SEARCH_WORD_CACHE_SIZE,
+                      instance->searchWordCacheSize);
     settings.setValue(SETTINGS_QUIZ_LETTER_ORDER,
                       instance->quizLetterOrder);
     settings.setValue(SETTINGS_QUIZ_BACKGROUND_COLOR,
@@ -501,6 +508,7 @@ MainSettings::restoreDefaults(const QString& group)
 
     if (group.isEmpty() || (group == SEARCH_PREFS_GROUP)) {
         instance->searchSelectInput = DEFAULT_SEARCH_SELECT_INPUT;
+        instance->searchWordCacheSize = DEFAULT_SEARCH_WORD_CACHE_SIZE;
     }
 
     if (group.isEmpty() || (group == QUIZ_PREFS_GROUP)) {
@@ -84,6 +84,10 @@ class MainSettings
     static bool getSearchSelectInput() { return instance->searchSelectInput; }
     static void setSearchSelectInput(bool b) {
         instance->searchSelectInput = b; }
+    static int getSearchWordCacheSize() {
+        return instance->searchWordCacheSize; }
+    static void setSearchWordCacheSize(int i) {
+        instance->searchWordCacheSize = i; }
     static QString getQuizLetterOrder() { return instance->quizLetterOrder; }
     static void setQuizLetterOrder(const QString& str) {
         instance->quizLetterOrder = str; }
@@ -263,6 +267,7 @@ class MainSettings
     bool useTileTheme;
     QString tileTheme;
     bool searchSelectInput;
+    int searchWordCacheSize;
     QString quizLetterOrder;
     QColor quizBackgroundColor;
     bool quizUseFlashcardMode;
@@ -39,6 +39,7 @@
 #include "QuizEngine.h"
 #include "QuizForm.h"
 #include "SearchForm.h"
+#include "SearchService.h"
 #include "SettingsDialog.h"
 #include "WordEngine.h"
 #include "WordEntryDialog.h"
@@ -54,6 +55,7 @@
 #include <QMenuBar>
 #include <QMessageBox>
 #include <QProgressDialog>
+#include <QRunnable>
 #include <QSignalMapper>
 #include <QStatusBar>
 #include <QSqlDatabase>
@@ -81,6 +83,20 @@ const int DETAILS_FONT_MIN_POINTS = 6;
 
 using namespace Defs;
 
+// Verifies the checksums of lexicons on a worker thread, and passes any
+// errors back to the main window
+class MainWindow::ChecksumVerifier : public QRunnable
+{
+    public:
+    ChecksumVerifier(MainWindow* w, const QStringList& l)
+        : window(w), lexicons(l) { }
+    void run() { window->verifyChecksums(lexicons); }
+
+    private:
+    MainWindow* window;
+    QStringList lexicons;
+};
+
 //---------------------------------------------------------------------------
 //  MainWindow
 //
@@ -91,9 +107,13 @@ using namespace Defs;
 //---------------------------------------------------------------------------
 MainWindow::MainWindow(QWidget* parent, QSplashScreen* splash, Qt::WFlags f)
     : QMainWindow(parent, f), splashScreen(splash),
-      wordEngine(new WordEngine()), settingsDialog(new SettingsDialog(this)),
-      aboutDialog(new AboutDialog(this))
+      wordEngine(new WordEngine()),
+      searchService(new SearchService(wordEngine, this)),
+      settingsDialog(new SettingsDialog(this)),
+      aboutDialog(new AboutDialog(this)), rescheduleRequestId(0)
 {
+    checksumPool.setMaxThreadCount(1);
+
     setSplashMessage("Creating interface...");
 
     // File Menu
@@ -296,6 +316,9 @@ MainWindow::MainWindow(QWidget* parent, QSplashScreen* splash, Qt::WFlags f)
     connect(tabStack, SIGNAL(currentChanged(int)),
              SLOT(currentTabChanged(int)));
 
+    connect(searchService, SIGNAL(searchFinished(int)),
+            SLOT(rescheduleSearchFinished(int)));
+
     closeButton = new QToolButton(tabStack);
     closeButton->setIcon(QIcon(":/close-tab-icon"));
     tabStack->setCornerWidget(closeButton);
@@ -491,6 +514,8 @@ MainWindow::processDatabaseErrors()
     errorActions.insert(DbDoesNotExist, "Database needs to be created");
     errorActions.insert(DbSymbolsOutOfDate,
                         "Lexicon symbols need to be updated");
+    errorActions.insert(DbLexiconChanged,
+                        "Database needs to be updated with lexicon changes");
 
     QString actionText;
     QMapIterator<QString, int> it (dbErrors);
@@ -509,7 +534,16 @@ MainWindow::processDatabaseErrors()
     if (code != QMessageBox::Yes)
         return;
 
-    rebuildDatabases(dbErrors.keys());
+    // Databases of changed lexicons are updated rather than rebuilt
+    QSet<QString> updateLexicons;
+    it.toFront();
+    while (it.hasNext()) {
+        it.next();
+        if (it.value() == DbLexiconChanged)
+            updateLexicons.insert(it.key());
+    }
+
+    rebuildDatabases(dbErrors.keys(), updateLexicons);
 }
 
 //---------------------------------------------------------------------------
@@ -776,6 +810,7 @@ MainWindow::editSettings()
             importLexicon(lexicon);
         }
         tryConnectToDatabases();
+        QTimer::singleShot(0, this, SLOT(displayLexiconError()));
     }
 
     // Add DB errors for database whose symbols need to be updated
@@ -895,42 +930,85 @@ MainWindow::rescheduleCardboxRequested()
 
     int code = dialog->exec();
     if (code == QDialog::Accepted) {
-        QString quizType = dialog->getQuizType();
-        QString lexicon = dialog->getLexicon();
-
-        QStringList words;
-        if (!dialog->getRescheduleAll()) {
-            SearchSpec searchSpec = dialog->getSearchSpec();
-            words = wordEngine->search(lexicon, searchSpec, true);
-            if (words.isEmpty())
-                return;
-        }
+        rescheduleQuizType = dialog->getQuizType();
+        rescheduleLexicon = dialog->getLexicon();
+        rescheduleType = dialog->getRescheduleType();
 
-        CardboxRescheduleType rescheduleType = dialog->getRescheduleType();
-
-        int rescheduleValue = 0;
+        rescheduleValue = 0;
         if (rescheduleType == CardboxRescheduleShiftDays)
             rescheduleValue = dialog->getNumDays();
         else if (rescheduleType == CardboxRescheduleShiftBacklog)
             rescheduleValue = dialog->getBacklogSize();
 
-        QApplication::setOverrideCursor(Qt::WaitCursor);
-        int numRescheduled = rescheduleCardbox(words, lexicon, quizType,
-            rescheduleType, rescheduleValue);
-        QApplication::restoreOverrideCursor();
-
-        QString questionStr = numRescheduled == 1 ? QString("question")
-                                                  : QString("questions");
-        QString caption = "Cardbox Questions Rescheduled";
-        QString message = QString::number(numRescheduled) + " " +
-            questionStr + " rescheduled.";
-        message = Auxil::dialogWordWrap(message);
-        QMessageBox::information(this, caption, message);
+        // Find the words to reschedule in the background, and reschedule
+        // them when the search is finished
+        if (dialog->getRescheduleAll()) {
+            rescheduleRequestId = 0;
+            rescheduleWords(QStringList());
+        }
+        else {
+            messageLabel->setText("Searching...");
+            rescheduleRequestId = searchService->search(
+                this, rescheduleLexicon, dialog->getSearchSpec(), true,
+                SearchService::HighPriority);
+        }
     }
 
     delete dialog;
 }
 
+//---------------------------------------------------------------------------
+//  rescheduleSearchFinished
+//
+//! Called when a search is finished.  If it is the search for words to
+//! reschedule, reschedule the words found.
+//
+//! @param requestId the search request ID
+//---------------------------------------------------------------------------
+void
+MainWindow::rescheduleSearchFinished(int requestId)
+{
+    if (!rescheduleRequestId || (requestId != rescheduleRequestId))
+        return;
+
+    rescheduleRequestId = 0;
+    currentTabChanged(tabStack->currentIndex());
+    if (searchService->isCanceled(requestId))
+        return;
+
+    QStringList words = searchService->getResults(requestId).value(0);
+    if (words.isEmpty())
+        return;
+
+    rescheduleWords(words);
+}
+
+//---------------------------------------------------------------------------
+//  rescheduleWords
+//
+//! Reschedule cardbox questions as requested by the user, and report the
+//! number of questions rescheduled.
+//
+//! @param words the words to reschedule, or an empty list to reschedule
+//! every question
+//---------------------------------------------------------------------------
+void
+MainWindow::rescheduleWords(const QStringList& words)
+{
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    int numRescheduled = rescheduleCardbox(words, rescheduleLexicon,
+        rescheduleQuizType, rescheduleType, rescheduleValue);
+    QApplication::restoreOverrideCursor();
+
+    QString questionStr = numRescheduled == 1 ? QString("question")
+                                              : QString("questions");
+    QString caption = "Cardbox Questions Rescheduled";
+    QString message = QString::number(numRescheduled) + " " +
+        questionStr + " rescheduled.";
+    message = Auxil::dialogWordWrap(message);
+    QMessageBox::information(this, caption, message);
+}
+
 //---------------------------------------------------------------------------
 //  displayAbout
 //
@@ -939,6 +1017,7 @@ MainWindow::rescheduleCardboxRequested()
 void
 MainWindow::displayAbout()
 {
+    aboutDialog->setPerformanceReport(wordEngine->getPerformanceReport());
     aboutDialog->exec();
 }
 
@@ -957,16 +1036,77 @@ MainWindow::displayHelp()
 //  displayLexiconError
 //
 //! Display any lexicon errors, and ask the user whether to proceed in the
-//! face of any errors.
+//! face of any errors.  Lexicon checksums are verified afterward on a worker
+//! thread, so the check stays off the startup path and does not block the
+//! interface.
 //---------------------------------------------------------------------------
 void
 MainWindow::displayLexiconError()
 {
-    if (lexiconError.isEmpty())
-        return;
+    if (!checksumLexicons.isEmpty()) {
+        checksumPool.start(new ChecksumVerifier(this, checksumLexicons));
+        checksumLexicons.clear();
+    }
+
+    if (!lexiconError.isEmpty())
+        warnLexiconError(lexiconError);
+}
 
+//---------------------------------------------------------------------------
+//  displayChecksumError
+//
+//! Display lexicon checksum errors found on a worker thread, and ask the
+//! user whether to proceed in the face of the errors.
+//
+//! @param error the checksum errors
+//---------------------------------------------------------------------------
+void
+MainWindow::displayChecksumError(const QString& error)
+{
+    warnLexiconError(error);
+}
+
+//---------------------------------------------------------------------------
+//  verifyChecksums
+//
+//! Verify the checksums of lexicons.  Called on a worker thread, so any
+//! errors are passed to the main thread to be displayed.
+//
+//! @param lexicons the lexicons to verify
+//---------------------------------------------------------------------------
+void
+MainWindow::verifyChecksums(const QStringList& lexicons)
+{
+    QString error;
+    foreach (const QString& lexicon, lexicons) {
+        QString checksumError;
+        if (!wordEngine->verifyChecksums(lexicon, &checksumError)) {
+            if (!error.isEmpty())
+                error += "\n";
+            error += lexicon + ": " + checksumError;
+        }
+    }
+
+    if (!error.isEmpty()) {
+        QMetaObject::invokeMethod(this, "displayChecksumError",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(QString, error));
+    }
+}
+
+//---------------------------------------------------------------------------
+//  warnLexiconError
+//
+//! Display lexicon errors, and ask the user whether to proceed in the face
+//! of the errors.  Quit if the user chooses not to proceed.
+//
+//! @param error the lexicon errors
+//---------------------------------------------------------------------------
+void
+MainWindow::warnLexiconError(const QString& error)
+{
     QString caption = "Lexicon Warning";
-    QString message = lexiconError + "\n\nProceed anyway?";
+    QString message = error + "\n\nProceed anyway?";
     message = Auxil::dialogWordWrap(message);
     int code = QMessageBox::warning(this, caption, message,
                                     QMessageBox::Yes | QMessageBox::No,
@@ -1038,6 +1178,7 @@ MainWindow::currentTabChanged(int)
     QString details;
     bool saveEnabled = false;
     bool saveCapable = false;
+    searchService->setActiveRequester(w);
     if (w) {
         ActionForm* form = static_cast<ActionForm*>(w);
         form->selectInputArea();
@@ -1184,7 +1325,7 @@ MainWindow::tryConnectToDatabase(const QString& lexicon)
             }
 
             // For custom lexicon, check to see if lexicon file has changed -
-            // if it has, the database is out of date
+            // if it has, the database needs to be updated with the changes
             if (lexicon == LEXICON_CUSTOM) {
                 QString qstr = "SELECT file FROM lexicon_file";
                 QSqlQuery query (qstr, db);
@@ -1193,7 +1334,7 @@ MainWindow::tryConnectToDatabase(const QString& lexicon)
                     lexiconFile = query.value(0).toString();
 
                 if (lexiconFile != wordEngine->getLexiconFile(lexicon)) {
-                    dbError = DbOutOfDate;
+                    dbError = DbLexiconChanged;
                     break;
                 }
             }
@@ -1229,6 +1370,7 @@ MainWindow::tryConnectToDatabase(const QString& lexicon)
 bool
 MainWindow::connectToDatabase(const QString& lexicon)
 {
+    searchService->stopAll();
     QString dbFilename = Auxil::getDatabaseFilename(lexicon);
     QString dbError;
     bool ok = wordEngine->connectToDatabase(lexicon, dbFilename, &dbError);
@@ -1239,6 +1381,8 @@ MainWindow::connectToDatabase(const QString& lexicon)
         QMessageBox::warning(this, caption, message);
         return false;
     }
+
+    writeBundle(lexicon);
     return true;
 }
 
@@ -1249,14 +1393,17 @@ MainWindow::connectToDatabase(const QString& lexicon)
 //! dialog.
 //
 //! @param lexicons the list of lexicons
+//! @param updateLexicons the lexicons whose databases only need to be
+//! updated with the changes to the lexicon
 //---------------------------------------------------------------------------
 void
-MainWindow::rebuildDatabases(const QStringList& lexicons)
+MainWindow::rebuildDatabases(const QStringList& lexicons, const
+                             QSet<QString>& updateLexicons)
 {
     QStringList successes;
     QStringList failures;
     foreach (const QString& lexicon, lexicons) {
-        bool ok = rebuildDatabase(lexicon);
+        bool ok = rebuildDatabase(lexicon, updateLexicons.contains(lexicon));
         // FIXME: do something if DB creation fails!
         if (!ok) {
             failures.append(lexicon);
@@ -1289,10 +1436,12 @@ MainWindow::rebuildDatabases(const QStringList& lexicons)
 //! Rebuild the database for a lexicon.  Also display a progress dialog.
 //
 //! @param lexicon the lexicon name
+//! @param incremental true if only the changes to the lexicon since the
+//! database was created should be applied to the database
 //! @return true if successful, false otherwise
 //---------------------------------------------------------------------------
 bool
-MainWindow::rebuildDatabase(const QString& lexicon)
+MainWindow::rebuildDatabase(const QString& lexicon, bool incremental)
 {
     QString dbFilename = Auxil::getDatabaseFilename(lexicon);
     QString definitionFilename;
@@ -1304,46 +1453,22 @@ MainWindow::rebuildDatabase(const QString& lexicon)
             Auxil::getLexiconPrefix(lexicon) + ".txt";
     }
 
-    QFileInfo fileInfo (dbFilename);
-    QString file = fileInfo.fileName();
-    QString path = fileInfo.path();
-    QString tmpDbFilename = path + "/orig-" + file;
-
+    // The thread replaces the database file only if the new database is
+    // complete, so the original is left as it was if creation fails
+    searchService->stopAll();
     wordEngine->disconnectFromDatabase(lexicon);
-    QFile dbFile (dbFilename);
-    QFile tmpDbFile (tmpDbFilename);
-
-    bool ok = (!tmpDbFile.exists() || tmpDbFile.remove());
-    if (!ok) {
-        QString caption = "Cannot remove database backup file";
-        QString message = "Cannot remove database backup file: " +
-            tmpDbFilename + ".\nPlease close Zyzzyva, remove or rename the "
-            "file, then restart Zyzzyva.";
-        message = Auxil::dialogWordWrap(message);
-        QMessageBox::warning(this, caption, message);
-        return false;
-    }
-
-    ok = (!dbFile.exists() || dbFile.rename(tmpDbFilename));
-    if (!ok) {
-        QString caption = "Cannot remove database file";
-        QString message = "Cannot remove original database file: " +
-            dbFilename + ".\nPlease close Zyzzyva, remove or rename the "
-            "file, then restart Zyzzyva.";
-        message = Auxil::dialogWordWrap(message);
-        QMessageBox::warning(this, caption, message);
-        tmpDbFile.rename(dbFilename);
-        return false;
-    }
 
     QProgressDialog* dialog = new QProgressDialog(this);
 
-    QLabel* dialogLabel = new QLabel("Creating " + lexicon + " database...");
-    dialog->setWindowTitle("Creating " + lexicon + " Database");
+    QString action = incremental ? "Updating" : "Creating";
+    QLabel* dialogLabel = new QLabel(action + " " + lexicon +
+                                     " database...");
+    dialog->setWindowTitle(action + " " + lexicon + " Database");
     dialog->setLabel(dialogLabel);
 
     CreateDatabaseThread* thread = new CreateDatabaseThread(wordEngine,
         lexicon, dbFilename, definitionFilename, this);
+    thread->setIncremental(incremental);
     connect(thread, SIGNAL(steps(int)),
             dialog, SLOT(setMaximum(int)));
     connect(thread, SIGNAL(progress(int)),
@@ -1372,13 +1497,6 @@ MainWindow::rebuildDatabase(const QString& lexicon)
         success = false;
     }
 
-    if (!success) {
-        if (dbFile.exists())
-            dbFile.remove();
-        if (tmpDbFile.exists())
-            tmpDbFile.rename(dbFilename);
-    }
-
     delete thread;
     delete dialog;
     return success;
@@ -1561,6 +1679,9 @@ MainWindow::readSettings(bool useGeometry)
         //qWarning("Cannot set font: " + fontStr);
     }
 
+    // Word information cache size
+    wordEngine->setCacheSize(MainSettings::getSearchWordCacheSize());
+
     // Set tile theme and background color for all quiz forms
     // FIXME: instead, this should simply call a settingsChanged slot on all
     // forms, and each form should handle it as they see fit
@@ -1708,6 +1829,7 @@ MainWindow::importDawg(const QString& lexicon, const QString& file, bool
                        reverse, QString* errString, quint16*
                        expectedChecksum)
 {
+    searchService->stopAll();
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
     bool ok = wordEngine->importDawgFile(lexicon, file, reverse,
                                          errString, expectedChecksum);
@@ -1999,6 +2121,10 @@ MainWindow::renameLexicon(const QString& oldName, const QString& newName)
 bool
 MainWindow::importLexicon(const QString& lexicon)
 {
+    // The word graphs being replaced may still be having their checksums
+    // verified
+    checksumPool.waitForDone();
+
     QString importFile;
     QString reverseImportFile;
     QString checksumFile;
@@ -2049,6 +2175,18 @@ MainWindow::importLexicon(const QString& lexicon)
     QString splashMessage = "Loading " + lexicon + " lexicon...";
     setSplashMessage(splashMessage);
 
+    QStringList sources;
+    sources << importFile;
+    if (dawg)
+        sources << reverseImportFile;
+    sources << Auxil::getDatabaseFilename(lexicon);
+    bundleSources.insert(lexicon, sources);
+
+    if (importBundle(lexicon)) {
+        importStems(lexicon);
+        return true;
+    }
+
     if (dawg) {
         quint16 expectedForwardChecksum = 0;
         quint16 expectedReverseChecksum = 0;
@@ -2076,6 +2214,9 @@ MainWindow::importLexicon(const QString& lexicon)
 
         ok = ok && importDawg(lexicon, reverseImportFile, true, &lexiconError,
                               &expectedReverseChecksum);
+
+        if (ok)
+            checksumLexicons.append(lexicon);
     }
     else
         ok = importText(lexicon, importFile);
@@ -2097,12 +2238,73 @@ MainWindow::importLexicon(const QString& lexicon)
 int
 MainWindow::importText(const QString& lexicon, const QString& file)
 {
+    searchService->stopAll();
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
     int imported = wordEngine->importTextFile(lexicon, file, true);
     QApplication::restoreOverrideCursor();
     return imported;
 }
 
+//---------------------------------------------------------------------------
+//  importBundle
+//
+//! Import a lexicon from its lexicon bundle, if it has one that is current.
+//
+//! @param lexicon the name of the lexicon
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+MainWindow::importBundle(const QString& lexicon)
+{
+    QString bundleFilename = Auxil::getBundleFilename(lexicon);
+    if (bundleFilename.isEmpty() || !QFile::exists(bundleFilename))
+        return false;
+
+    QString bundleError;
+    searchService->stopAll();
+    bool ok = wordEngine->importBundle(lexicon, bundleFilename,
+                                       bundleSources.value(lexicon),
+                                       &bundleError);
+    if (!ok) {
+        qWarning("Not using lexicon bundle for %s: %s",
+                 lexicon.toUtf8().constData(),
+                 bundleError.toUtf8().constData());
+    }
+    return ok;
+}
+
+//---------------------------------------------------------------------------
+//  writeBundle
+//
+//! Write the lexicon bundle of a lexicon, so that the lexicon is imported
+//! from the bundle the next time it is loaded.  Nothing is written if the
+//! lexicon was imported from a bundle that is still current.
+//
+//! @param lexicon the name of the lexicon
+//---------------------------------------------------------------------------
+void
+MainWindow::writeBundle(const QString& lexicon)
+{
+    QStringList sources = bundleSources.value(lexicon);
+    if (sources.isEmpty() || wordEngine->bundleIsCurrent(lexicon, sources))
+        return;
+
+    QString bundleFilename = Auxil::getBundleFilename(lexicon);
+    if (bundleFilename.isEmpty())
+        return;
+
+    QString bundleError;
+    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+    bool ok = wordEngine->writeBundle(lexicon, bundleFilename, sources,
+                                      &bundleError);
+    QApplication::restoreOverrideCursor();
+    if (!ok) {
+        qWarning("Unable to write lexicon bundle for %s: %s",
+                 lexicon.toUtf8().constData(),
+                 bundleError.toUtf8().constData());
+    }
+}
+
 //---------------------------------------------------------------------------
 //  importStems
 //
@@ -2120,6 +2322,7 @@ MainWindow::importStems(const QString& lexicon)
     stemFiles << (Auxil::getWordsDir() + "/North-American/7-letter-stems.txt");
 
     QString err;
+    searchService->stopAll();
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
     QStringList::iterator it;
     int totalImported = 0;
@@ -30,9 +30,11 @@
 #include <QIcon>
 #include <QLabel>
 #include <QMainWindow>
+#include <QSet>
 #include <QSettings>
 #include <QSplashScreen>
 #include <QTabWidget>
+#include <QThreadPool>
 #include <QToolButton>
 
 class AboutDialog;
@@ -40,6 +42,7 @@ class ActionForm;
 class HelpDialog;
 class QuizSpec;
 class QuizEngine;
+class SearchService;
 class WordEngine;
 class SettingsDialog;
 
@@ -52,6 +55,7 @@ class MainWindow : public QMainWindow
     ~MainWindow() { }
 
     static MainWindow* getInstance() { return instance; }
+    SearchService* getSearchService() const { return searchService; }
 
     public slots:
     void fileOpenRequested(const QString& filename);
@@ -76,9 +80,11 @@ class MainWindow : public QMainWindow
     void viewVariation(int variation);
     void rebuildDatabaseRequested();
     void rescheduleCardboxRequested();
+    void rescheduleSearchFinished(int requestId);
     void displayAbout();
     void displayHelp();
     void displayLexiconError();
+    void displayChecksumError(const QString& error);
     void helpDialogError(const QString& message);
     void closeCurrentTab();
     void currentTabChanged(int index);
@@ -97,8 +103,9 @@ class MainWindow : public QMainWindow
     // FIXME: these probably belong with WordTableView::addToCardbox in a
     // separate class for manipulating quiz databases.  Hm, how about the
     // QuizStatsDatabase class?
-    void rebuildDatabases(const QStringList& lexicons);
-    bool rebuildDatabase(const QString& lexicon);
+    void rebuildDatabases(const QStringList& lexicons, const QSet<QString>&
+                          updateLexicons = QSet<QString>());
+    bool rebuildDatabase(const QString& lexicon, bool incremental = false);
     int rescheduleCardbox(const QStringList& words, const QString& lexicon,
         const QString& quizType, CardboxRescheduleType rescheduleType,
         int rescheduleValue = 0) const;
@@ -114,6 +121,8 @@ class MainWindow : public QMainWindow
     void renameLexicon(const QString& oldName, const QString& newName);
     bool importLexicon(const QString& lexicon);
     int importText(const QString& lexicon, const QString& file);
+    bool importBundle(const QString& lexicon);
+    void writeBundle(const QString& lexicon);
     bool importDawg(const QString& lexicon, const QString& file,
                     bool reverse = false, QString* errString = 0,
                     quint16* expectedChecksum = 0);
@@ -124,6 +133,9 @@ class MainWindow : public QMainWindow
     void newTab(ActionForm* form);
     void newQuizFromQuizFile(const QString& filename);
     void newQuizFromWordFile(const QString& filename);
+    void rescheduleWords(const QStringList& words);
+    void verifyChecksums(const QStringList& lexicons);
+    void warnLexiconError(const QString& error);
 
     private:
     enum LexiconDatabaseError {
@@ -132,12 +144,16 @@ class MainWindow : public QMainWindow
         DbOpenError,
         DbConnectionError,
         DbDoesNotExist,
-        DbSymbolsOutOfDate
+        DbSymbolsOutOfDate,
+        DbLexiconChanged
     };
 
+    class ChecksumVerifier;
+
     private:
     QSplashScreen* splashScreen;
     WordEngine*  wordEngine;
+    SearchService* searchService;
     QTabWidget*  tabStack;
     QToolButton* closeButton;
     QLabel*      messageLabel;
@@ -151,8 +167,23 @@ class MainWindow : public QMainWindow
     HelpDialog*     helpDialog;
 
     QString lexiconError;
+    QStringList checksumLexicons;
+
+    // Verifies lexicon checksums in the background, one batch at a time
+    QThreadPool checksumPool;
+
+    // The files each lexicon is loaded from, and its database.  The lexicon
+    // bundle of a lexicon is only used while none of them has changed.
+    QMap<QString, QStringList> bundleSources;
     QMap<QString, int> dbErrors;
 
+    // The cardbox rescheduling waiting for its search to finish
+    int rescheduleRequestId;
+    QString rescheduleQuizType;
+    QString rescheduleLexicon;
+    CardboxRescheduleType rescheduleType;
+    int rescheduleValue;
+
     static MainWindow*  instance;
 };
 
@@ -25,6 +25,8 @@
 #include "SearchForm.h"
 #include "LexiconSelectWidget.h"
 #include "MainSettings.h"
+#include "MainWindow.h"
+#include "SearchService.h"
 #include "SearchSpecForm.h"
 #include "WordEngine.h"
 #include "WordTableModel.h"
@@ -44,6 +46,163 @@ using namespace Defs;
 
 const QString TITLE_PREFIX = "Search";
 
+// The number of words in the first batch of results delivered
+const int RESULT_BATCH_SIZE = 100;
+
+// Adds the words found by a search to the result model in batches while
+// the search continues, displaying them as the search requires
+class SearchForm::ResultFormat
+{
+    public:
+    ResultFormat(SearchForm* f, const QString& lex, const SearchSpec& spec);
+    void addWords(const QStringList& words);
+
+    private:
+    SearchForm* form;
+    QString lexicon;
+    bool hasAnagramCondition;
+    bool hasSubanagramCondition;
+    bool hasProbabilityCondition;
+    bool hasPlayabilityCondition;
+    int probNumBlanks;
+};
+
+//---------------------------------------------------------------------------
+//  ResultFormat
+//
+//! Constructor.  Determine how the results are to be displayed.
+//
+//! @param f the search form
+//! @param lex the lexicon being searched
+//! @param spec the search specification
+//---------------------------------------------------------------------------
+SearchForm::ResultFormat::ResultFormat(SearchForm* f, const QString& lex,
+                                       const SearchSpec& spec)
+    : form(f), lexicon(lex), hasAnagramCondition(false),
+      hasSubanagramCondition(false), hasProbabilityCondition(false),
+      hasPlayabilityCondition(false),
+      probNumBlanks(MainSettings::getProbabilityNumBlanks())
+{
+    // Check for Anagram or Subanagram conditions, and only group by
+    // alphagrams if one of them is present
+    QListIterator<SearchCondition> it (spec.conditions);
+    while (it.hasNext()) {
+        const SearchCondition& condition = it.next();
+        SearchCondition::SearchType type = condition.type;
+        if (!condition.negated &&
+            ((type == SearchCondition::AnagramMatch) ||
+            (type == SearchCondition::SubanagramMatch) ||
+            (type == SearchCondition::NumAnagrams)))
+        {
+            hasAnagramCondition = true;
+            if (type == SearchCondition::SubanagramMatch)
+                hasSubanagramCondition = true;
+        }
+
+        else if ((type == SearchCondition::ProbabilityOrder) ||
+            (type == SearchCondition::LimitByProbabilityOrder))
+        {
+            // Set number of blanks based on the first probability search
+            // condition
+            if (!hasProbabilityCondition)
+                probNumBlanks = condition.intValue;
+            hasProbabilityCondition = true;
+        }
+
+        else if ((type == SearchCondition::PlayabilityOrder) ||
+            (type == SearchCondition::LimitByPlayabilityOrder))
+        {
+            hasPlayabilityCondition = true;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+//  addWords
+//
+//! Add a batch of words to the result model.
+//
+//! @param words the words
+//---------------------------------------------------------------------------
+void
+SearchForm::ResultFormat::addWords(const QStringList& words)
+{
+    WordEngine* wordEngine = form->wordEngine;
+    WordTableModel* resultModel = form->resultModel;
+
+    // Create a list of WordItem objects from the words
+    QList<WordTableModel::WordItem> wordItems;
+    foreach (const QString& word, words) {
+        QString wildcard;
+        if (hasAnagramCondition) {
+            // Get wildcard characters
+            QList<QChar> wildcardChars;
+            for (int i = 0; i < word.length(); ++i) {
+                QChar c = word[i];
+                if (c.isLower())
+                    wildcardChars.append(c);
+            }
+            if (!wildcardChars.isEmpty()) {
+                qSort(wildcardChars.begin(), wildcardChars.end(),
+                      Auxil::localeAwareLessThanQChar);
+                foreach (const QChar& c, wildcardChars)
+                    wildcard.append(c.toUpper());
+            }
+        }
+
+        QString displayWord = word;
+        QString wordUpper = word.toUpper();
+
+        // Convert to all caps if necessary
+        if (!MainSettings::getWordListLowerCaseWildcards())
+            displayWord = wordUpper;
+
+        WordTableModel::WordItem wordItem
+            (displayWord, WordTableModel::WordNormal, wildcard);
+
+        // Set probability/playability order for correct sorting
+        if (hasProbabilityCondition) {
+            int probOrder = wordEngine->getProbabilityOrder(
+                lexicon, wordUpper, probNumBlanks);
+            wordItem.setProbabilityOrder(probOrder);
+        }
+        else if (hasPlayabilityCondition) {
+            qint64 playValue = wordEngine->getPlayabilityValue(
+                lexicon, wordUpper);
+            int playOrder = wordEngine->getPlayabilityOrder(
+                lexicon, wordUpper);
+            wordItem.setPlayabilityValue(playValue);
+            wordItem.setPlayabilityOrder(playOrder);
+        }
+
+        wordItems.append(wordItem);
+    }
+
+    // FIXME: Probably not the right way to get alphabetical sorting instead
+    // of alphagram sorting
+    bool origGroupByAnagrams = MainSettings::getWordListGroupByAnagrams();
+    if (!hasAnagramCondition)
+        MainSettings::setWordListGroupByAnagrams(false);
+    if (hasSubanagramCondition)
+        MainSettings::setWordListSortByReverseLength(true);
+    if (hasProbabilityCondition)
+        MainSettings::setWordListSortByProbabilityOrder(true);
+    else if (hasPlayabilityCondition)
+        MainSettings::setWordListSortByPlayabilityOrder(true);
+    resultModel->setProbabilityNumBlanks(probNumBlanks);
+    resultModel->addWords(wordItems);
+    MainSettings::setWordListSortByPlayabilityOrder(false);
+    MainSettings::setWordListSortByProbabilityOrder(false);
+    if (hasSubanagramCondition)
+        MainSettings::setWordListSortByReverseLength(false);
+    if (!hasAnagramCondition)
+        MainSettings::setWordListGroupByAnagrams(origGroupByAnagrams);
+
+    form->statusString = "Searching... " +
+        QString::number(resultModel->rowCount()) + " found";
+    emit form->statusChanged(form->statusString);
+}
+
 //---------------------------------------------------------------------------
 //  SearchForm
 //
@@ -54,7 +213,9 @@ const QString TITLE_PREFIX = "Search";
 //! @param f widget flags
 //---------------------------------------------------------------------------
 SearchForm::SearchForm(WordEngine* e, QWidget* parent, Qt::WFlags f)
-    : ActionForm(SearchFormType, parent, f), wordEngine(e)
+    : ActionForm(SearchFormType, parent, f), wordEngine(e),
+      searchService(MainWindow::getInstance()->getSearchService()),
+      searchRequestId(0), resultFormat(0)
 {
     QHBoxLayout* mainHlay = new QHBoxLayout(this);
     mainHlay->setMargin(MARGIN);
@@ -88,7 +249,7 @@ SearchForm::SearchForm(WordEngine* e, QWidget* parent, Qt::WFlags f)
 
     searchButton = new ZPushButton("&Search");
     searchButton->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Fixed);
-    connect(searchButton, SIGNAL(clicked()), SLOT(search()));
+    connect(searchButton, SIGNAL(clicked()), SLOT(searchButtonClicked()));
     buttonHlay->addWidget(searchButton);
 
     resultView = new WordTableView(wordEngine);
@@ -99,12 +260,27 @@ SearchForm::SearchForm(WordEngine* e, QWidget* parent, Qt::WFlags f)
             resultView, SLOT(resizeItemsToContents()));
     resultView->setModel(resultModel);
 
+    connect(searchService, SIGNAL(wordsFound(int, const QStringList&)),
+            SLOT(wordsFound(int, const QStringList&)));
+    connect(searchService, SIGNAL(searchFinished(int)),
+            SLOT(searchFinished(int)));
+
     lexiconActivated(lexiconWidget->getCurrentLexicon());
 
     specChanged();
     QTimer::singleShot(0, this, SLOT(selectInputArea()));
 }
 
+//---------------------------------------------------------------------------
+//  ~SearchForm
+//
+//! Destructor.
+//---------------------------------------------------------------------------
+SearchForm::~SearchForm()
+{
+    delete resultFormat;
+}
+
 //---------------------------------------------------------------------------
 //  getIcon
 //
@@ -198,7 +374,9 @@ SearchForm::selectInputArea()
 //  search
 //
 //! Search for the word or pattern in the edit area, and display the results
-//! in the list box.
+//! in the list box.  The search runs in the background and results are
+//! added as they are found, and the Search button becomes a Stop button
+//! until the search is done.  A search still running is replaced.
 //---------------------------------------------------------------------------
 void
 SearchForm::search()
@@ -209,130 +387,63 @@ SearchForm::search()
 
     QString lexicon = lexiconWidget->getCurrentLexicon();
 
-    searchButton->setEnabled(false);
+    searchButton->setText("&Stop");
+    searchButton->setEnabled(true);
     resultModel->removeRows(0, resultModel->rowCount());
     resultModel->setLexicon(lexicon);
 
     statusString = "Searching...";
     emit statusChanged(statusString);
-    qApp->processEvents();
-
-    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-
-    QStringList wordList =
-        wordEngine->search(lexicon, specForm->getSearchSpec(), false);
-
-    if (!wordList.empty()) {
-
-        // Check for Anagram or Subanagram conditions, and only group by
-        // alphagrams if one of them is present
-        bool hasAnagramCondition = false;
-        bool hasSubanagramCondition = false;
-        bool hasProbabilityCondition = false;
-        bool hasPlayabilityCondition = false;
-        int probNumBlanks = MainSettings::getProbabilityNumBlanks();
-        QListIterator<SearchCondition> it (spec.conditions);
-        while (it.hasNext()) {
-            const SearchCondition& condition = it.next();
-            SearchCondition::SearchType type = condition.type;
-            if (!condition.negated &&
-                ((type == SearchCondition::AnagramMatch) ||
-                (type == SearchCondition::SubanagramMatch) ||
-                (type == SearchCondition::NumAnagrams)))
-            {
-                hasAnagramCondition = true;
-                if (type == SearchCondition::SubanagramMatch)
-                    hasSubanagramCondition = true;
-            }
-
-            else if ((type == SearchCondition::ProbabilityOrder) ||
-                (type == SearchCondition::LimitByProbabilityOrder))
-            {
-                // Set number of blanks based on the first probability search
-                // condition
-                if (!hasProbabilityCondition)
-                    probNumBlanks = condition.intValue;
-                hasProbabilityCondition = true;
-            }
-
-            else if ((type == SearchCondition::PlayabilityOrder) ||
-                (type == SearchCondition::LimitByPlayabilityOrder))
-            {
-                hasPlayabilityCondition = true;
-            }
-        }
-
-        // Create a list of WordItem objects from the words
-        QList<WordTableModel::WordItem> wordItems;
-        foreach (const QString& word, wordList) {
-            QString wildcard;
-            if (hasAnagramCondition) {
-                // Get wildcard characters
-                QList<QChar> wildcardChars;
-                for (int i = 0; i < word.length(); ++i) {
-                    QChar c = word[i];
-                    if (c.isLower())
-                        wildcardChars.append(c);
-                }
-                if (!wildcardChars.isEmpty()) {
-                    qSort(wildcardChars.begin(), wildcardChars.end(),
-                          Auxil::localeAwareLessThanQChar);
-                    foreach (const QChar& c, wildcardChars)
-                        wildcard.append(c.toUpper());
-                }
-            }
-
-            QString displayWord = word;
-            QString wordUpper = word.toUpper();
 
-            // Convert to all caps if necessary
-            if (!MainSettings::getWordListLowerCaseWildcards())
-                displayWord = wordUpper;
+    delete resultFormat;
+    resultFormat = new ResultFormat(this, lexicon, spec);
+    searchRequestId = searchService->search(this, lexicon, spec, false,
+                                            SearchService::NormalPriority,
+                                            RESULT_BATCH_SIZE);
+}
 
-            WordTableModel::WordItem wordItem
-                (displayWord, WordTableModel::WordNormal, wildcard);
+//---------------------------------------------------------------------------
+//  wordsFound
+//
+//! Called when a search delivers a batch of words.  Add the words to the
+//! results if they were found by the current search.
+//
+//! @param requestId the search request ID
+//! @param words the words
+//---------------------------------------------------------------------------
+void
+SearchForm::wordsFound(int requestId, const QStringList& words)
+{
+    if (!searchRequestId || (requestId != searchRequestId))
+        return;
+    resultFormat->addWords(words);
+}
 
-            // Set probability/playability order for correct sorting
-            if (hasProbabilityCondition) {
-                int probOrder = wordEngine->getProbabilityOrder(
-                    lexicon, wordUpper, probNumBlanks);
-                wordItem.setProbabilityOrder(probOrder);
-            }
-            else if (hasPlayabilityCondition) {
-                qint64 playValue = wordEngine->getPlayabilityValue(
-                    lexicon, wordUpper);
-                int playOrder = wordEngine->getPlayabilityOrder(
-                    lexicon, wordUpper);
-                wordItem.setPlayabilityValue(playValue);
-                wordItem.setPlayabilityOrder(playOrder);
-            }
+//---------------------------------------------------------------------------
+//  searchFinished
+//
+//! Called when a search is finished.  If it is the current search, display
+//! the number of results and get ready for the next search.
+//
+//! @param requestId the search request ID
+//---------------------------------------------------------------------------
+void
+SearchForm::searchFinished(int requestId)
+{
+    if (!searchRequestId || (requestId != searchRequestId))
+        return;
 
-            wordItems.append(wordItem);
-        }
+    searchRequestId = 0;
+    delete resultFormat;
+    resultFormat = 0;
 
-        // FIXME: Probably not the right way to get alphabetical sorting instead
-        // of alphagram sorting
-        bool origGroupByAnagrams = MainSettings::getWordListGroupByAnagrams();
-        if (!hasAnagramCondition)
-            MainSettings::setWordListGroupByAnagrams(false);
-        if (hasSubanagramCondition)
-            MainSettings::setWordListSortByReverseLength(true);
-        if (hasProbabilityCondition)
-            MainSettings::setWordListSortByProbabilityOrder(true);
-        else if (hasPlayabilityCondition)
-            MainSettings::setWordListSortByPlayabilityOrder(true);
-        resultModel->setProbabilityNumBlanks(probNumBlanks);
-        resultModel->addWords(wordItems);
-        MainSettings::setWordListSortByPlayabilityOrder(false);
-        MainSettings::setWordListSortByProbabilityOrder(false);
-        if (hasSubanagramCondition)
-            MainSettings::setWordListSortByReverseLength(false);
-        if (!hasAnagramCondition)
-            MainSettings::setWordListGroupByAnagrams(origGroupByAnagrams);
+    int numWords = resultModel->rowCount();
+    updateResultTotal(numWords);
+    if (searchService->isCanceled(requestId)) {
+        statusString += " (stopped)";
+        emit statusChanged(statusString);
     }
-
-    updateResultTotal(wordList.size());
-    emit saveEnabledChanged(!wordList.empty());
+    emit saveEnabledChanged(numWords > 0);
 
     QWidget* focusWidget = QApplication::focusWidget();
     QLineEdit* lineEdit = dynamic_cast<QLineEdit*>(focusWidget);
@@ -343,8 +454,23 @@ SearchForm::search()
         selectInputArea();
     }
 
-    searchButton->setEnabled(true);
-    QApplication::restoreOverrideCursor();
+    searchButton->setText("&Search");
+    specChanged();
+}
+
+//---------------------------------------------------------------------------
+//  searchButtonClicked
+//
+//! Called when the Search button is clicked.  Start a search, or stop the
+//! search in progress.
+//---------------------------------------------------------------------------
+void
+SearchForm::searchButtonClicked()
+{
+    if (searchRequestId)
+        searchService->cancel(searchRequestId);
+    else
+        search();
 }
 
 //---------------------------------------------------------------------------
@@ -356,6 +482,9 @@ SearchForm::search()
 void
 SearchForm::specChanged()
 {
+    // Leave the Stop button enabled while a search is running
+    if (searchRequestId)
+        return;
     searchButton->setEnabled(specForm->isValid());
 }
 
@@ -31,6 +31,7 @@
 #include <QLabel>
 
 class LexiconSelectWidget;
+class SearchService;
 class SearchSpecForm;
 class WordEngine;
 class WordTableModel;
@@ -42,6 +43,7 @@ class SearchForm : public ActionForm
     Q_OBJECT
     public:
     SearchForm(WordEngine* e, QWidget* parent = 0, Qt::WFlags f = 0);
+    ~SearchForm();
     QIcon getIcon() const;
     QString getTitle() const;
     QString getStatusString() const;
@@ -56,12 +58,19 @@ class SearchForm : public ActionForm
 
     public slots:
     void search();
+    void searchButtonClicked();
+    void wordsFound(int requestId, const QStringList& words);
+    void searchFinished(int requestId);
     void updateResultTotal(int num);
     void lexiconActivated(const QString& lexicon);
     void specChanged();
 
+    private:
+    class ResultFormat;
+
     private:
     WordEngine*     wordEngine;
+    SearchService*  searchService;
     LexiconSelectWidget* lexiconWidget;
     SearchSpecForm* specForm;
     WordTableView*  resultView;
@@ -69,6 +78,8 @@ class SearchForm : public ActionForm
     ZPushButton*    searchButton;
     QString         statusString;
     QString         detailsString;
+    int             searchRequestId;
+    ResultFormat*   resultFormat;
 };
 
 #endif // ZYZZYVA_SEARCH_FORM_H
@@ -0,0 +1,424 @@
+//---------------------------------------------------------------------------
+// SearchService.cpp
+//
+// A class for running searches on worker threads.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#include "SearchService.h"
+#include "SearchStream.h"
+#include "WordEngine.h"
+#include <QMutexLocker>
+#include <QRunnable>
+
+// Added to the priority of the requests of the active requester, so they
+// are run before the requests of any other requester
+const int ACTIVE_REQUESTER_BONUS = SearchService::HighPriority + 1;
+
+// A queued or running search request
+class SearchService::Request
+{
+    public:
+    Request() : id(0), requester(0), allCaps(false), priority(0),
+        batchSize(0), canceled(false), stream(0) { }
+
+    int id;
+    QObject* requester;
+    QString lexicon;
+    QList<SearchSpec> specs;
+    bool allCaps;
+    int priority;
+    int batchSize;
+    bool canceled;
+
+    // The stream of the search being run, if any
+    SearchStream* stream;
+
+    // The results of each search, in the order of the specs
+    QList<QStringList> results;
+};
+
+// Passes batches of words found on a worker thread to the receivers of the
+// wordsFound signal
+class SearchService::RequestStream : public SearchStream
+{
+    public:
+    RequestStream(SearchService* s, int r, bool d)
+        : service(s), requestId(r), deliver(d) { }
+
+    protected:
+    void wordsFound(const QStringList& words) {
+        if (deliver)
+            emit service->wordsFound(requestId, words); }
+
+    private:
+    SearchService* service;
+    int requestId;
+    bool deliver;
+};
+
+// Runs the next queued request on a pool thread.  One worker is started
+// for each request, but a worker need not run the request it was started
+// for.
+class SearchService::Worker : public QRunnable
+{
+    public:
+    Worker(SearchService* s) : service(s) { }
+    void run() { service->runNextRequest(); }
+
+    private:
+    SearchService* service;
+};
+
+//---------------------------------------------------------------------------
+//  SearchService
+//
+//! Constructor.
+//
+//! @param e the word engine
+//! @param parent the parent object
+//---------------------------------------------------------------------------
+SearchService::SearchService(const WordEngine* e, QObject* parent)
+    : QObject(parent), engine(e), activeRequester(0), lastRequestId(0),
+      finishedRequest(0)
+{
+    // Keep idle threads rather than replacing them, so searches reuse the
+    // database connections the threads have already opened
+    pool.setExpiryTimeout(-1);
+}
+
+//---------------------------------------------------------------------------
+//  ~SearchService
+//
+//! Destructor.  Cancel all searches and wait for them to stop.
+//---------------------------------------------------------------------------
+SearchService::~SearchService()
+{
+    stopAll();
+    qDeleteAll(requests);
+}
+
+//---------------------------------------------------------------------------
+//  search
+//
+//! Queue a search.  The unfinished requests of the requester are canceled.
+//
+//! @param requester the object making the request, or null
+//! @param lexicon the name of the lexicon
+//! @param spec the search specification
+//! @param allCaps whether to return words in all capitals
+//! @param priority the priority of the request
+//! @param batchSize the size of the first batch of words delivered by the
+//! wordsFound signal, or zero if words are only to be delivered when the
+//! search is finished
+//! @return the request ID
+//---------------------------------------------------------------------------
+int
+SearchService::search(QObject* requester, const QString& lexicon, const
+                      SearchSpec& spec, bool allCaps, Priority priority,
+                      int batchSize)
+{
+    return search(requester, lexicon, QList<SearchSpec>() << spec, allCaps,
+                  priority, batchSize);
+}
+
+//---------------------------------------------------------------------------
+//  search
+//
+//! Queue a list of searches to be run one after another as a single
+//! request.  The unfinished requests of the requester are canceled.
+//
+//! @param requester the object making the request, or null
+//! @param lexicon the name of the lexicon
+//! @param specs the search specifications
+//! @param allCaps whether to return words in all capitals
+//! @param priority the priority of the request
+//! @param batchSize the size of the first batch of words delivered by the
+//! wordsFound signal, or zero if words are only to be delivered when the
+//! searches are finished
+//! @return the request ID
+//---------------------------------------------------------------------------
+int
+SearchService::search(QObject* requester, const QString& lexicon, const
+                      QList<SearchSpec>& specs, bool allCaps, Priority
+                      priority, int batchSize)
+{
+    if (requester) {
+        connect(requester, SIGNAL(destroyed(QObject*)),
+                SLOT(requesterDestroyed(QObject*)), Qt::UniqueConnection);
+    }
+
+    Request* request = new Request;
+    request->requester = requester;
+    request->lexicon = lexicon;
+    request->specs = specs;
+    request->allCaps = allCaps;
+    request->priority = priority;
+    request->batchSize = batchSize;
+
+    QMutexLocker locker (&mutex);
+    if (requester)
+        cancelRequests(requester);
+    int requestId = ++lastRequestId;
+    request->id = requestId;
+    requests.insert(requestId, request);
+    queue.append(request);
+    locker.unlock();
+
+    pool.start(new Worker(this));
+    return requestId;
+}
+
+//---------------------------------------------------------------------------
+//  cancel
+//
+//! Cancel a search request.  The searchFinished signal is still emitted for
+//! the request.
+//
+//! @param requestId the request ID
+//---------------------------------------------------------------------------
+void
+SearchService::cancel(int requestId)
+{
+    QMutexLocker locker (&mutex);
+    Request* request = requests.value(requestId);
+    if (request)
+        cancelRequest(request);
+}
+
+//---------------------------------------------------------------------------
+//  cancelAll
+//
+//! Cancel all unfinished requests of a requester.
+//
+//! @param requester the requester, or null to cancel every request
+//---------------------------------------------------------------------------
+void
+SearchService::cancelAll(QObject* requester)
+{
+    QMutexLocker locker (&mutex);
+    cancelRequests(requester);
+}
+
+//---------------------------------------------------------------------------
+//  stopAll
+//
+//! Cancel every request and wait for the worker threads to stop.  Must be
+//! called before a lexicon is changed.
+//---------------------------------------------------------------------------
+void
+SearchService::stopAll()
+{
+    cancelAll();
+    pool.waitForDone();
+}
+
+//---------------------------------------------------------------------------
+//  setActiveRequester
+//
+//! Set the requester whose requests are run first, such as the form in the
+//! current tab.
+//
+//! @param requester the requester
+//---------------------------------------------------------------------------
+void
+SearchService::setActiveRequester(QObject* requester)
+{
+    QMutexLocker locker (&mutex);
+    activeRequester = requester;
+}
+
+//---------------------------------------------------------------------------
+//  getResults
+//
+//! Get the results of a finished request.  Only available to the receivers
+//! of the searchFinished signal for the request.
+//
+//! @param requestId the request ID
+//! @return the words found by each search of the request, in the order of
+//! the search specifications
+//---------------------------------------------------------------------------
+QList<QStringList>
+SearchService::getResults(int requestId) const
+{
+    if (!finishedRequest || (finishedRequest->id != requestId))
+        return QList<QStringList>();
+    return finishedRequest->results;
+}
+
+//---------------------------------------------------------------------------
+//  isCanceled
+//
+//! Determine whether a finished request was canceled.  Only available to
+//! the receivers of the searchFinished signal for the request.
+//
+//! @param requestId the request ID
+//! @return true if the request was canceled, false otherwise
+//---------------------------------------------------------------------------
+bool
+SearchService::isCanceled(int requestId) const
+{
+    return (finishedRequest && (finishedRequest->id == requestId) &&
+            finishedRequest->canceled);
+}
+
+//---------------------------------------------------------------------------
+//  finishRequest
+//
+//! Called on the thread of the service when a request is finished.  Emit
+//! the searchFinished signal and discard the request.
+//
+//! @param requestId the request ID
+//---------------------------------------------------------------------------
+void
+SearchService::finishRequest(int requestId)
+{
+    mutex.lock();
+    Request* request = requests.take(requestId);
+    mutex.unlock();
+    if (!request)
+        return;
+
+    finishedRequest = request;
+    emit searchFinished(requestId);
+    finishedRequest = 0;
+    delete request;
+}
+
+//---------------------------------------------------------------------------
+//  requesterDestroyed
+//
+//! Called when a requester is destroyed.  Cancel its requests.
+//
+//! @param requester the requester
+//---------------------------------------------------------------------------
+void
+SearchService::requesterDestroyed(QObject* requester)
+{
+    QMutexLocker locker (&mutex);
+    cancelRequests(requester);
+    foreach (Request* request, requests) {
+        if (request->requester == requester)
+            request->requester = 0;
+    }
+    if (activeRequester == requester)
+        activeRequester = 0;
+}
+
+//---------------------------------------------------------------------------
+//  runNextRequest
+//
+//! Run the queued request that should be run next.  Called on a worker
+//! thread.
+//---------------------------------------------------------------------------
+void
+SearchService::runNextRequest()
+{
+    QMutexLocker locker (&mutex);
+    Request* request = takeNextRequest();
+    if (!request)
+        return;
+
+    for (int i = 0; i < request->specs.size(); ++i) {
+        if (request->canceled)
+            break;
+
+        // The stream is canceled if the request is, even if the search has
+        // not yet begun
+        RequestStream stream (this, request->id, request->batchSize > 0);
+        if (request->batchSize > 0)
+            stream.setBatchSize(request->batchSize);
+        request->stream = &stream;
+        locker.unlock();
+
+        QStringList words = engine->search(request->lexicon,
+                                           request->specs.at(i),
+                                           request->allCaps, &stream);
+
+        locker.relock();
+        request->stream = 0;
+        request->results.append(words);
+    }
+    int requestId = request->id;
+    locker.unlock();
+
+    QMetaObject::invokeMethod(this, "finishRequest", Qt::QueuedConnection,
+                              Q_ARG(int, requestId));
+}
+
+//---------------------------------------------------------------------------
+//  takeNextRequest
+//
+//! Remove the request that should be run next from the queue.  The requests
+//! of the active requester come first, then requests of higher priority,
+//! then earlier requests.  The mutex must be held by the caller.
+//
+//! @return the request, or null if the queue is empty
+//---------------------------------------------------------------------------
+SearchService::Request*
+SearchService::takeNextRequest()
+{
+    int best = -1;
+    int bestRank = 0;
+    for (int i = 0; i < queue.size(); ++i) {
+        const Request* request = queue.at(i);
+        int rank = request->priority;
+        if (request->requester && (request->requester == activeRequester))
+            rank += ACTIVE_REQUESTER_BONUS;
+        if ((best < 0) || (rank > bestRank)) {
+            best = i;
+            bestRank = rank;
+        }
+    }
+    return (best < 0) ? 0 : queue.takeAt(best);
+}
+
+//---------------------------------------------------------------------------
+//  cancelRequest
+//
+//! Cancel a request, stopping its search if it is running.  The mutex must
+//! be held by the caller.
+//
+//! @param request the request
+//---------------------------------------------------------------------------
+void
+SearchService::cancelRequest(Request* request)
+{
+    request->canceled = true;
+    if (request->stream)
+        request->stream->cancel();
+}
+
+//---------------------------------------------------------------------------
+//  cancelRequests
+//
+//! Cancel all unfinished requests of a requester.  The mutex must be held
+//! by the caller.
+//
+//! @param requester the requester, or null to cancel every request
+//---------------------------------------------------------------------------
+void
+SearchService::cancelRequests(QObject* requester)
+{
+    foreach (Request* request, requests) {
+        if (!requester || (request->requester == requester))
+            cancelRequest(request);
+    }
+}
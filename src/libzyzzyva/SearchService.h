@@ -0,0 +1,107 @@
+//---------------------------------------------------------------------------
+// SearchService.h
+//
+// A class for running searches on worker threads.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#ifndef ZYZZYVA_SEARCH_SERVICE_H
+#define ZYZZYVA_SEARCH_SERVICE_H
+
+#include "SearchSpec.h"
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+class WordEngine;
+
+// Searches are queued and run on a pool of worker threads, and their
+// results are delivered by signals on the thread the service belongs to.
+// Each request is made on behalf of a requester, usually a form or dialog.
+// A new request cancels the unfinished requests of the same requester, and
+// the requests of the active requester are run before any others.  The
+// lexicons must not be changed while searches are running.
+class SearchService : public QObject
+{
+    Q_OBJECT
+    public:
+    enum Priority {
+        LowPriority = 0,
+        NormalPriority,
+        HighPriority
+    };
+
+    public:
+    SearchService(const WordEngine* e, QObject* parent = 0);
+    ~SearchService();
+
+    int search(QObject* requester, const QString& lexicon, const SearchSpec&
+               spec, bool allCaps, Priority priority = NormalPriority,
+               int batchSize = 0);
+    int search(QObject* requester, const QString& lexicon, const
+               QList<SearchSpec>& specs, bool allCaps, Priority priority =
+               NormalPriority, int batchSize = 0);
+    void cancel(int requestId);
+    void cancelAll(QObject* requester = 0);
+    void stopAll();
+    void setActiveRequester(QObject* requester);
+    QList<QStringList> getResults(int requestId) const;
+    bool isCanceled(int requestId) const;
+
+    signals:
+    void wordsFound(int requestId, const QStringList& words);
+    void searchFinished(int requestId);
+
+    private slots:
+    void finishRequest(int requestId);
+    void requesterDestroyed(QObject* requester);
+
+    private:
+    class Request;
+    class RequestStream;
+    class Worker;
+
+    private:
+    void runNextRequest();
+    Request* takeNextRequest();
+    void cancelRequest(Request* request);
+    void cancelRequests(QObject* requester);
+
+    private:
+    const WordEngine* engine;
+    QThreadPool pool;
+
+    // Requests not yet finished, and those not yet started, guarded by the
+    // mutex
+    QMutex mutex;
+    QMap<int, Request*> requests;
+    QList<Request*> queue;
+    QObject* activeRequester;
+    int lastRequestId;
+
+    // The request whose searchFinished signal is being emitted
+    Request* finishedRequest;
+};
+
+#endif // ZYZZYVA_SEARCH_SERVICE_H
@@ -0,0 +1,201 @@
+//---------------------------------------------------------------------------
+// SearchStream.cpp
+//
+// A class for receiving search results in batches as they are found.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#include "SearchStream.h"
+#include <QMutexLocker>
+#include <QThread>
+
+//---------------------------------------------------------------------------
+//  SearchStream
+//
+//! Constructor.  By default the first batch holds 100 words, and there is
+//! no limit on the number of results or the search time.
+//---------------------------------------------------------------------------
+SearchStream::SearchStream()
+    : batchSize(100), maxResults(0), timeLimit(0), upperCase(false),
+      thread(0), currentBatchSize(0), numResults(0), stopped(0),
+      canceled(false), truncated(false)
+{
+}
+
+//---------------------------------------------------------------------------
+//  begin
+//
+//! Prepare to receive the results of a search.  Called by the search on the
+//! thread that batches are to be delivered on.  A stream that was canceled
+//! before the search began stays canceled, so a search can be canceled from
+//! another thread at any time.
+//
+//! @param upper whether to convert words to upper case
+//---------------------------------------------------------------------------
+void
+SearchStream::begin(bool upper)
+{
+    QMutexLocker locker (&mutex);
+    upperCase = upper;
+    thread = QThread::currentThread();
+    timer.start();
+    pending.clear();
+    currentBatchSize = qMax(batchSize, 1);
+    numResults = 0;
+    truncated = false;
+    if (!canceled)
+        stopped = 0;
+}
+
+//---------------------------------------------------------------------------
+//  addWord
+//
+//! Add a word found by the search.  May be called from any thread.  If
+//! called on the thread that began the search and a full batch of words is
+//! waiting, the batch is delivered.
+//
+//! @param word the word
+//! @return true if the word was accepted, false if the search has been
+//! stopped
+//---------------------------------------------------------------------------
+bool
+SearchStream::addWord(const QString& word)
+{
+    bool deliver = false;
+    {
+        QMutexLocker locker (&mutex);
+        if (stopped)
+            return false;
+
+        pending.append(upperCase ? word.toUpper() : word);
+        ++numResults;
+        if (maxResults && (numResults >= maxResults))
+            stop(false);
+
+        deliver = (pending.size() >= currentBatchSize);
+    }
+
+    if (deliver)
+        flush();
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  addWords
+//
+//! Add a list of words found by the search, for searches that cannot
+//! produce their results incrementally.
+//
+//! @param words the words
+//---------------------------------------------------------------------------
+void
+SearchStream::addWords(const QStringList& words)
+{
+    foreach (const QString& word, words) {
+        if (!addWord(word))
+            break;
+    }
+}
+
+//---------------------------------------------------------------------------
+//  flush
+//
+//! Deliver any words that have been added but not yet delivered.  Does
+//! nothing unless called on the thread that began the search.
+//---------------------------------------------------------------------------
+void
+SearchStream::flush()
+{
+    if (QThread::currentThread() != thread)
+        return;
+
+    QStringList words;
+    {
+        QMutexLocker locker (&mutex);
+        if (pending.isEmpty() || canceled)
+            return;
+        words = pending;
+        pending.clear();
+        if (words.size() >= currentBatchSize)
+            currentBatchSize = qMin(currentBatchSize * 2, MAX_BATCH_SIZE);
+    }
+
+    // Deliver without holding the lock, since the receiver may process
+    // events and cancel the search
+    wordsFound(words);
+}
+
+//---------------------------------------------------------------------------
+//  cancel
+//
+//! Cancel the search.  Words not yet delivered are discarded, and the
+//! search stops as soon as it next checks the stream.  May be called from
+//! any thread, including from within wordsFound.
+//---------------------------------------------------------------------------
+void
+SearchStream::cancel()
+{
+    QMutexLocker locker (&mutex);
+    stop(true);
+    pending.clear();
+}
+
+//---------------------------------------------------------------------------
+//  poll
+//
+//! Determine whether the search should stop, checking the time limit.
+//! Called periodically by long-running searches.
+//
+//! @return true if the search should stop, false otherwise
+//---------------------------------------------------------------------------
+bool
+SearchStream::poll()
+{
+    if (stopped)
+        return true;
+
+    if (timeLimit && (timer.elapsed() >= timeLimit)) {
+        QMutexLocker locker (&mutex);
+        stop(false);
+        return true;
+    }
+
+    return false;
+}
+
+//---------------------------------------------------------------------------
+//  stop
+//
+//! Stop the search.  The mutex must be held by the caller.
+//
+//! @param cancel true if the search was canceled, false if it ran out of
+//! its result or time budget
+//---------------------------------------------------------------------------
+void
+SearchStream::stop(bool cancel)
+{
+    if (stopped)
+        return;
+    if (cancel)
+        canceled = true;
+    else
+        truncated = true;
+    stopped = 1;
+}
@@ -0,0 +1,96 @@
+//---------------------------------------------------------------------------
+// SearchStream.h
+//
+// A class for receiving search results in batches as they are found.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#ifndef ZYZZYVA_SEARCH_STREAM_H
+#define ZYZZYVA_SEARCH_STREAM_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QTime>
+
+class QThread;
+
+// Words may be added from any thread, but batches are only delivered on the
+// thread that began the search, so a subclass may safely update widgets.
+// Each batch is twice the size of the one before, up to a limit, so the
+// first words arrive quickly without making large searches deliver an
+// excessive number of batches.
+class SearchStream
+{
+    public:
+    SearchStream();
+    virtual ~SearchStream() { }
+
+    void setBatchSize(int size) { batchSize = size; }
+    void setMaxResults(int max) { maxResults = max; }
+    void setTimeLimit(int msecs) { timeLimit = msecs; }
+
+    void begin(bool upperCase);
+    bool addWord(const QString& word);
+    void addWords(const QStringList& words);
+    void flush();
+    void cancel();
+    bool poll();
+
+    bool isStopped() const { return stopped; }
+    bool isCanceled() const { return canceled; }
+    bool isTruncated() const { return truncated; }
+    int getNumResults() const { return numResults; }
+    int getElapsed() const { return timer.elapsed(); }
+
+    protected:
+    //-----------------------------------------------------------------------
+    //  wordsFound
+    //
+    //! Called with each batch of words found by the search, on the thread
+    //! that began the search.
+    //
+    //! @param words the words
+    //-----------------------------------------------------------------------
+    virtual void wordsFound(const QStringList& words) = 0;
+
+    private:
+    void stop(bool cancel);
+
+    static const int MAX_BATCH_SIZE = 8192;
+
+    int batchSize;
+    int maxResults;
+    int timeLimit;
+    bool upperCase;
+
+    QThread* thread;
+    QTime timer;
+    QMutex mutex;
+    QStringList pending;
+    int currentBatchSize;
+    int numResults;
+    QAtomicInt stopped;
+    bool canceled;
+    bool truncated;
+};
+
+#endif // ZYZZYVA_SEARCH_STREAM_H
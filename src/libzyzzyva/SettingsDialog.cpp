@@ -213,6 +213,20 @@ SettingsDialog::SettingsDialog(QWidget* parent, Qt::WFlags f)
     searchSelectInputCbox = new QCheckBox("Highlight input after search");
     searchPrefVlay->addWidget(searchSelectInputCbox);
 
+    QHBoxLayout* searchWordCacheSizeHlay = new QHBoxLayout;
+    searchWordCacheSizeHlay->setMargin(0);
+    searchPrefVlay->addLayout(searchWordCacheSizeHlay);
+
+    QLabel* searchWordCacheSizeLabel = new QLabel;
+    searchWordCacheSizeLabel->setText("Memory for word information "
+                                      "cache (MB):");
+    searchWordCacheSizeHlay->addWidget(searchWordCacheSizeLabel);
+
+    searchWordCacheSizeSbox = new QSpinBox;
+    searchWordCacheSizeSbox->setMinimum(0);
+    searchWordCacheSizeSbox->setMaximum(1024);
+    searchWordCacheSizeHlay->addWidget(searchWordCacheSizeSbox);
+
     searchPrefVlay->addStretch(2);
 
     // Quiz Prefs
@@ -768,6 +782,8 @@ SettingsDialog::refreshSettings()
 
     // Search
     searchSelectInputCbox->setChecked(MainSettings::getSearchSelectInput());
+    searchWordCacheSizeSbox->setValue(
+        MainSettings::getSearchWordCacheSize());
 
     // Quiz letter order
     int letterOrderIndex =
@@ -902,6 +918,7 @@ SettingsDialog::writeSettings()
     MainSettings::setUseTileTheme(themeCbox->isChecked());
     MainSettings::setTileTheme(themeCombo->currentText());
     MainSettings::setSearchSelectInput(searchSelectInputCbox->isChecked());
+    MainSettings::setSearchWordCacheSize(searchWordCacheSizeSbox->value());
     MainSettings::setQuizLetterOrder(letterOrderCombo->currentText());
     MainSettings::setQuizBackgroundColor(quizBackgroundColor);
     MainSettings::setQuizUseFlashcardMode(
@@ -104,6 +104,7 @@ class SettingsDialog : public QDialog
     QComboBox*   themeCombo;
     QComboBox*   letterOrderCombo;
     QCheckBox*   searchSelectInputCbox;
+    QSpinBox*    searchWordCacheSizeSbox;
     QLineEdit*   quizBackgroundColorLine;
     QCheckBox*   quizUseFlashcardModeCbox;
     QCheckBox*   quizShowNumResponsesCbox;
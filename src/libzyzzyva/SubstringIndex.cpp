@@ -0,0 +1,206 @@
+//---------------------------------------------------------------------------
+// SubstringIndex.cpp
+//
+// A class for finding the words that contain a string of letters.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#include "SubstringIndex.h"
+#include <QTime>
+#include <QtAlgorithms>
+#include <cstring>
+
+//---------------------------------------------------------------------------
+//  SubstringIndex
+//
+//! Constructor.
+//---------------------------------------------------------------------------
+SubstringIndex::SubstringIndex()
+    : buildTime(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  clear
+//
+//! Remove all words from the index.
+//---------------------------------------------------------------------------
+void
+SubstringIndex::clear()
+{
+    text.clear();
+    wordStarts.clear();
+    suffixes.clear();
+    buildTime = 0;
+}
+
+//---------------------------------------------------------------------------
+//  build
+//
+//! Build the index from a list of words.  Any words already in the index
+//! are removed.
+//
+//! @param words the words, in upper case
+//---------------------------------------------------------------------------
+void
+SubstringIndex::build(const QList<QByteArray>& words)
+{
+    QTime timer;
+    timer.start();
+
+    clear();
+
+    int totalLength = 0;
+    foreach (const QByteArray& word, words)
+        totalLength += word.length();
+
+    text.reserve(totalLength + words.size());
+    wordStarts.reserve(words.size());
+    suffixes.reserve(totalLength);
+    foreach (const QByteArray& word, words) {
+        wordStarts.append(text.size());
+        for (int i = 0; i < word.length(); ++i)
+            suffixes.append(text.size() + i);
+        text.append(word);
+        text.append('\0');
+    }
+
+    qSort(suffixes.begin(), suffixes.end(),
+          SuffixLessThan(text.constData()));
+
+    buildTime = timer.elapsed();
+}
+
+//---------------------------------------------------------------------------
+//  getWords
+//
+//! Get the words that contain a string of letters.
+//
+//! @param substring the letters, in upper case
+//! @return a list of words, each appearing once, in the order they were
+//! given when the index was built
+//---------------------------------------------------------------------------
+QList<QByteArray>
+SubstringIndex::getWords(const QByteArray& substring) const
+{
+    QList<QByteArray> words;
+    int len = substring.length();
+    if (!len)
+        return words;
+
+    // Find the range of suffixes beginning with the substring.  A suffix
+    // shorter than the substring ends with a null byte, which sorts before
+    // any letter.
+    const char* str = substring.constData();
+    const char* data = text.constData();
+    int low = 0;
+    int high = suffixes.size();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (strncmp(data + suffixes.at(mid), str, len) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    int first = low;
+    high = suffixes.size();
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (strncmp(data + suffixes.at(mid), str, len) > 0)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    // A word containing the substring more than once appears more than once
+    // in the range
+    QVector<int> wordIndexes;
+    wordIndexes.reserve(low - first);
+    for (int i = first; i < low; ++i)
+        wordIndexes.append(findWord(suffixes.at(i)));
+    qSort(wordIndexes);
+
+    int numWords = wordStarts.size();
+    for (int i = 0; i < wordIndexes.size(); ++i) {
+        int index = wordIndexes.at(i);
+        if (i && (index == wordIndexes.at(i - 1)))
+            continue;
+        int start = wordStarts.at(index);
+        int end = (index + 1 < numWords) ? wordStarts.at(index + 1) - 1
+                                         : text.size() - 1;
+        words.append(QByteArray(data + start, end - start));
+    }
+
+    return words;
+}
+
+//---------------------------------------------------------------------------
+//  getMemoryUsage
+//
+//! Get the number of bytes allocated by the index.
+//
+//! @return the memory usage in bytes
+//---------------------------------------------------------------------------
+qint64
+SubstringIndex::getMemoryUsage() const
+{
+    return qint64(text.capacity()) +
+        qint64(wordStarts.capacity()) * sizeof(quint32) +
+        qint64(suffixes.capacity()) * sizeof(quint32);
+}
+
+//---------------------------------------------------------------------------
+//  findWord
+//
+//! Find the word containing a position in the text.
+//
+//! @param position the position
+//! @return the index of the word
+//---------------------------------------------------------------------------
+int
+SubstringIndex::findWord(quint32 position) const
+{
+    int low = 0;
+    int high = wordStarts.size() - 1;
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (wordStarts.at(mid) <= position)
+            low = mid;
+        else
+            high = mid - 1;
+    }
+    return low;
+}
+
+//---------------------------------------------------------------------------
+//  operator()
+//
+//! Compare the suffixes of the text beginning at two positions.  Each
+//! suffix ends at the null byte following its word.
+//
+//! @param a the position of the first suffix
+//! @param b the position of the second suffix
+//! @return true if the first suffix sorts before the second
+//---------------------------------------------------------------------------
+bool
+SubstringIndex::SuffixLessThan::operator()(quint32 a, quint32 b) const
+{
+    return strcmp(text + a, text + b) < 0;
+}
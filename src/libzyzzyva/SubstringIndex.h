@@ -0,0 +1,67 @@
+//---------------------------------------------------------------------------
+// SubstringIndex.h
+//
+// A class for finding the words that contain a string of letters.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#ifndef ZYZZYVA_SUBSTRING_INDEX_H
+#define ZYZZYVA_SUBSTRING_INDEX_H
+
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+// A suffix array over the words: the words are stored in a flat array,
+// each followed by a null byte, and every position within a word is sorted
+// by the letters from that position to the end of the word.  The words
+// containing a string are then found by binary search.
+class SubstringIndex
+{
+    public:
+    SubstringIndex();
+    ~SubstringIndex() { }
+
+    void clear();
+    void build(const QList<QByteArray>& words);
+    bool isEmpty() const { return wordStarts.isEmpty(); }
+    QList<QByteArray> getWords(const QByteArray& substring) const;
+    int getNumWords() const { return wordStarts.size(); }
+    qint64 getMemoryUsage() const;
+    int getBuildTime() const { return buildTime; }
+
+    private:
+    class SuffixLessThan {
+      public:
+        SuffixLessThan(const char* t) : text(t) { }
+        bool operator()(quint32 a, quint32 b) const;
+      private:
+        const char* text;
+    };
+
+    int findWord(quint32 position) const;
+
+    QByteArray text;
+    QVector<quint32> wordStarts;
+    QVector<quint32> suffixes;
+    int buildTime;
+};
+
+#endif // ZYZZYVA_SUBSTRING_INDEX_H
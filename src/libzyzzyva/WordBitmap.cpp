@@ -0,0 +1,205 @@
+//---------------------------------------------------------------------------
+// WordBitmap.cpp
+//
+// A class for representing a set of words as a bitmap.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#include "WordBitmap.h"
+
+//---------------------------------------------------------------------------
+//  WordBitmap
+//
+//! Constructor.
+//
+//! @param numWords the number of words that may be in the set
+//! @param value true to start with every word in the set, false to start
+//! with none
+//---------------------------------------------------------------------------
+WordBitmap::WordBitmap(int numWords, bool value)
+    : size(numWords), blocks((numWords + 63) >> 6, value ? ~quint64(0) : 0)
+{
+    clearPadding();
+}
+
+//---------------------------------------------------------------------------
+//  setBits
+//
+//! Add a list of words to the set.
+//
+//! @param ids the numbers of the words
+//---------------------------------------------------------------------------
+void
+WordBitmap::setBits(const QVector<int>& ids)
+{
+    quint64* data = blocks.data();
+    foreach (int id, ids)
+        data[id >> 6] |= quint64(1) << (id & 63);
+}
+
+//---------------------------------------------------------------------------
+//  count
+//
+//! Count the words in the set.
+//
+//! @return the number of words
+//---------------------------------------------------------------------------
+int
+WordBitmap::count() const
+{
+    int total = 0;
+    const quint64* data = blocks.constData();
+    int numBlocks = blocks.size();
+    for (int i = 0; i < numBlocks; ++i) {
+        quint64 b = data[i];
+        b = b - ((b >> 1) & Q_UINT64_C(0x5555555555555555));
+        b = (b & Q_UINT64_C(0x3333333333333333)) +
+            ((b >> 2) & Q_UINT64_C(0x3333333333333333));
+        b = (b + (b >> 4)) & Q_UINT64_C(0x0F0F0F0F0F0F0F0F);
+        total += int((b * Q_UINT64_C(0x0101010101010101)) >> 56);
+    }
+    return total;
+}
+
+//---------------------------------------------------------------------------
+//  getIds
+//
+//! Get the numbers of the words in the set.
+//
+//! @return the numbers of the words, in increasing order
+//---------------------------------------------------------------------------
+QVector<int>
+WordBitmap::getIds() const
+{
+    QVector<int> ids;
+    ids.reserve(count());
+    const quint64* data = blocks.constData();
+    int numBlocks = blocks.size();
+    for (int i = 0; i < numBlocks; ++i) {
+        quint64 b = data[i];
+        for (int id = i << 6; b; ++id, b >>= 1) {
+            if (b & 1)
+                ids.append(id);
+        }
+    }
+    return ids;
+}
+
+//---------------------------------------------------------------------------
+//  getMemoryUsage
+//
+//! Get the number of bytes allocated by the bitmap.
+//
+//! @return the memory usage in bytes
+//---------------------------------------------------------------------------
+qint64
+WordBitmap::getMemoryUsage() const
+{
+    return qint64(blocks.capacity()) * sizeof(quint64);
+}
+
+//---------------------------------------------------------------------------
+//  operator&=
+//
+//! Remove the words not in another set.
+//
+//! @param other the other set, of the same size
+//! @return this set
+//---------------------------------------------------------------------------
+WordBitmap&
+WordBitmap::operator&=(const WordBitmap& other)
+{
+    quint64* data = blocks.data();
+    const quint64* otherData = other.blocks.constData();
+    int numBlocks = qMin(blocks.size(), other.blocks.size());
+    for (int i = 0; i < numBlocks; ++i)
+        data[i] &= otherData[i];
+    for (int i = numBlocks; i < blocks.size(); ++i)
+        data[i] = 0;
+    return *this;
+}
+
+//---------------------------------------------------------------------------
+//  operator|=
+//
+//! Add the words in another set.
+//
+//! @param other the other set, of the same size
+//! @return this set
+//---------------------------------------------------------------------------
+WordBitmap&
+WordBitmap::operator|=(const WordBitmap& other)
+{
+    quint64* data = blocks.data();
+    const quint64* otherData = other.blocks.constData();
+    int numBlocks = qMin(blocks.size(), other.blocks.size());
+    for (int i = 0; i < numBlocks; ++i)
+        data[i] |= otherData[i];
+    return *this;
+}
+
+//---------------------------------------------------------------------------
+//  subtract
+//
+//! Remove the words in another set.
+//
+//! @param other the other set, of the same size
+//! @return this set
+//---------------------------------------------------------------------------
+WordBitmap&
+WordBitmap::subtract(const WordBitmap& other)
+{
+    quint64* data = blocks.data();
+    const quint64* otherData = other.blocks.constData();
+    int numBlocks = qMin(blocks.size(), other.blocks.size());
+    for (int i = 0; i < numBlocks; ++i)
+        data[i] &= ~otherData[i];
+    return *this;
+}
+
+//---------------------------------------------------------------------------
+//  invert
+//
+//! Replace the set with the words not in it.
+//
+//! @return this set
+//---------------------------------------------------------------------------
+WordBitmap&
+WordBitmap::invert()
+{
+    quint64* data = blocks.data();
+    int numBlocks = blocks.size();
+    for (int i = 0; i < numBlocks; ++i)
+        data[i] = ~data[i];
+    clearPadding();
+    return *this;
+}
+
+//---------------------------------------------------------------------------
+//  clearPadding
+//
+//! Clear the bits past the last word, so they are never counted.
+//---------------------------------------------------------------------------
+void
+WordBitmap::clearPadding()
+{
+    if (size & 63)
+        blocks.last() &= (quint64(1) << (size & 63)) - 1;
+}
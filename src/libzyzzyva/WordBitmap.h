@@ -0,0 +1,60 @@
+//---------------------------------------------------------------------------
+// WordBitmap.h
+//
+// A class for representing a set of words as a bitmap.
+//
+// Copyright 2012 Boshvark Software, LLC.
+//
+// This file is part of Zyzzyva.
+//
+// Zyzzyva is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Zyzzyva is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//---------------------------------------------------------------------------
+
+#ifndef ZYZZYVA_WORD_BITMAP_H
+#define ZYZZYVA_WORD_BITMAP_H
+
+#include <QVector>
+
+// A set of words, with one bit for each word numbered by the word graph.
+// Sets are combined 64 words at a time.
+class WordBitmap
+{
+    public:
+    WordBitmap() : size(0) { }
+    explicit WordBitmap(int numWords, bool value = false);
+    ~WordBitmap() { }
+
+    int getSize() const { return size; }
+    bool testBit(int id) const {
+        return (blocks.at(id >> 6) >> (id & 63)) & 1; }
+    void setBit(int id) { blocks[id >> 6] |= quint64(1) << (id & 63); }
+    void setBits(const QVector<int>& ids);
+    int count() const;
+    QVector<int> getIds() const;
+    qint64 getMemoryUsage() const;
+
+    WordBitmap& operator&=(const WordBitmap& other);
+    WordBitmap& operator|=(const WordBitmap& other);
+    WordBitmap& subtract(const WordBitmap& other);
+    WordBitmap& invert();
+
+    private:
+    void clearPadding();
+
+    int size;
+    QVector<quint64> blocks;
+};
+
+#endif // ZYZZYVA_WORD_BITMAP_H
@@ -23,16 +23,20 @@
 //---------------------------------------------------------------------------
 
 #include "WordEngine.h"
+#include "SearchStream.h"
 #include "LetterBag.h"
 #include "Auxil.h"
 #include "Defs.h"
 #include <QApplication>
 #include <QFile>
+#include <QMutexLocker>
 #include <QRegExp>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QTime>
 #include <QVariant>
 #include <QVector>
+#include <algorithm>
 
 using namespace Defs;
 
@@ -44,10 +48,40 @@ const QString WordEngine::DEF_DISPLAY_SEP = " / ";
 
 const int LIMIT_RANGE_MAX = 999999;
 
+// Rough costs of the steps of a search, used to plan the order of its
+// phases, relative to visiting one word while walking the word graph
+const double GRAPH_VISIT_COST = 1.0;
+const double GRAPH_CHECK_COST = 2.0;
+const double ATTRIBUTE_SCAN_COST = 0.02;
+const double ATTRIBUTE_WORD_COST = 1.0;
+const double DATABASE_QUERY_COST = 5000.0;
+const double DATABASE_SCAN_COST = 0.5;
+const double DATABASE_WORD_COST = 10.0;
+
+// Guesses at the fraction of words kept by conditions without statistics,
+// and at how far the word graph walk is cut down by match conditions
+const double GRAPH_MATCH_FRACTION = 0.5;
+const double LITERAL_FRACTION = 0.1;
+const double RACK_VISITS = 200.0;
+const double INCLUDE_LETTER_FRACTION = 0.5;
+const double PART_OF_SPEECH_FRACTION = 0.3;
+const double DEFINITION_FRACTION = 0.01;
+const double HOOK_FRACTION = 0.3;
+const double DATABASE_FRACTION = 0.5;
+
+// An order other than the default is only used if it is estimated to cost
+// less than this fraction of the default, since the estimates are rough
+const double PLAN_MARGIN = 0.5;
+
+// Approximate number of bytes used by each node of the word information
+// cache index
+const int CACHE_INDEX_NODE_SIZE = 32;
+
 //---------------------------------------------------------------------------
 //  clearCache
 //
-//! Clear the word information cache for a lexicon.
+//! Remove the words of a lexicon from the word information cache.  This
+//! must be done whenever the lexicon or its database is reloaded.
 //
 //! @param lexicon the name of the lexicon
 //---------------------------------------------------------------------------
@@ -57,7 +91,254 @@ WordEngine::clearCache(const QString& lexicon) const
     if (!lexiconData.contains(lexicon))
         return;
 
-    lexiconData[lexicon]->wordCache.clear();
+    LexiconData* data = lexiconData[lexicon];
+    for (int i = 0; i < NUM_CACHE_SHARDS; ++i) {
+        QMutexLocker locker (&cacheShards[i].mutex);
+        cacheShards[i].cache.remove(data->id);
+    }
+
+    QMutexLocker locker (&data->symbolMutex);
+    data->symbolStrings.clear();
+}
+
+//---------------------------------------------------------------------------
+//  setCacheSize
+//
+//! Set the amount of memory the word information cache may use.  The limit
+//! is divided evenly among the cache shards, and the least recently used
+//! words of each shard are evicted to bring it within its share.
+//
+//! @param megabytes the size limit in megabytes
+//---------------------------------------------------------------------------
+void
+WordEngine::setCacheSize(int megabytes)
+{
+    qint64 bytes = qint64(qBound(0, megabytes, 1024)) << 20;
+    for (int i = 0; i < NUM_CACHE_SHARDS; ++i) {
+        QMutexLocker locker (&cacheShards[i].mutex);
+        cacheShards[i].cache.setMaxBytes(bytes / NUM_CACHE_SHARDS);
+    }
+}
+
+//---------------------------------------------------------------------------
+//  getCacheSize
+//
+//! Get the amount of memory the word information cache may use.
+//
+//! @return the size limit in megabytes
+//---------------------------------------------------------------------------
+int
+WordEngine::getCacheSize() const
+{
+    qint64 bytes = 0;
+    for (int i = 0; i < NUM_CACHE_SHARDS; ++i) {
+        QMutexLocker locker (&cacheShards[i].mutex);
+        bytes += cacheShards[i].cache.getMaxBytes();
+    }
+    return int(bytes >> 20);
+}
+
+//---------------------------------------------------------------------------
+//  getCacheHits
+//
+//! Get the number of word lookups answered from the word information cache.
+//
+//! @return the number of cache hits
+//---------------------------------------------------------------------------
+qint64
+WordEngine::getCacheHits() const
+{
+    qint64 hits = 0;
+    for (int i = 0; i < NUM_CACHE_SHARDS; ++i) {
+        QMutexLocker locker (&cacheShards[i].mutex);
+        hits += cacheShards[i].hits;
+    }
+    return hits;
+}
+
+//---------------------------------------------------------------------------
+//  getCacheMisses
+//
+//! Get the number of word lookups that had to read the database.
+//
+//! @return the number of cache misses
+//---------------------------------------------------------------------------
+qint64
+WordEngine::getCacheMisses() const
+{
+    qint64 misses = 0;
+    for (int i = 0; i < NUM_CACHE_SHARDS; ++i) {
+        QMutexLocker locker (&cacheShards[i].mutex);
+        misses += cacheShards[i].misses;
+    }
+    return misses;
+}
+
+//---------------------------------------------------------------------------
+//  getCacheMemoryUsage
+//
+//! Get the amount of memory used by the word information cache.
+//
+//! @return the number of bytes used
+//---------------------------------------------------------------------------
+qint64
+WordEngine::getCacheMemoryUsage() const
+{
+    qint64 bytes = 0;
+    for (int i = 0; i < NUM_CACHE_SHARDS; ++i) {
+        QMutexLocker locker (&cacheShards[i].mutex);
+        bytes += cacheShards[i].cache.getMemoryUsage();
+    }
+    return bytes;
+}
+
+//---------------------------------------------------------------------------
+//  getDatabaseQueries
+//
+//! Get the number of calls that have queried a lexicon database.
+//
+//! @return the number of queries
+//---------------------------------------------------------------------------
+qint64
+WordEngine::getDatabaseQueries() const
+{
+    QMutexLocker locker (&databaseStats.mutex);
+    return databaseStats.numQueries;
+}
+
+//---------------------------------------------------------------------------
+//  getDatabaseLoadTime
+//
+//! Get the total time spent loading candidate words into the temporary
+//! tables of lexicon databases.
+//
+//! @return the time in milliseconds
+//---------------------------------------------------------------------------
+qint64
+WordEngine::getDatabaseLoadTime() const
+{
+    QMutexLocker locker (&databaseStats.mutex);
+    return databaseStats.loadTime;
+}
+
+//---------------------------------------------------------------------------
+//  getDatabaseQueryTime
+//
+//! Get the total time spent running queries against lexicon databases and
+//! reading their results.
+//
+//! @return the time in milliseconds
+//---------------------------------------------------------------------------
+qint64
+WordEngine::getDatabaseQueryTime() const
+{
+    QMutexLocker locker (&databaseStats.mutex);
+    return databaseStats.queryTime;
+}
+
+//---------------------------------------------------------------------------
+//  recordDatabaseQuery
+//
+//! Add the times taken by one call that queried a lexicon database to the
+//! totals.
+//
+//! @param numWords the number of candidate words loaded
+//! @param loadTime the time taken to load the candidate words
+//! @param queryTime the time taken to run the query and read its results
+//---------------------------------------------------------------------------
+void
+WordEngine::recordDatabaseQuery(int numWords, int loadTime, int queryTime)
+    const
+{
+    QMutexLocker locker (&databaseStats.mutex);
+    ++databaseStats.numQueries;
+    databaseStats.numWords += numWords;
+    databaseStats.loadTime += loadTime;
+    databaseStats.queryTime += queryTime;
+}
+
+//---------------------------------------------------------------------------
+//  getPerformanceReport
+//
+//! Describe the time spent querying lexicon databases, and the memory used
+//! by the indexes of each lexicon and the time taken to build them.
+//
+//! @return the report, one item per line
+//---------------------------------------------------------------------------
+QString
+WordEngine::getPerformanceReport() const
+{
+    QStringList lines;
+    databaseStats.mutex.lock();
+    lines.append(QString("Database: %1 queries, %2 candidate words loaded "
+                         "in %3 ms, queries run in %4 ms")
+                 .arg(databaseStats.numQueries)
+                 .arg(databaseStats.numWords)
+                 .arg(databaseStats.loadTime)
+                 .arg(databaseStats.queryTime));
+    databaseStats.mutex.unlock();
+
+    QMapIterator<QString, LexiconData*> it (lexiconData);
+    while (it.hasNext()) {
+        it.next();
+        const LexiconData* data = it.value();
+        lines.append(it.key() + ":");
+
+        const AlphagramIndex& alphagrams = data->alphagramIndex;
+        lines.append(QString("  Alphagram index: %1 words, %2 alphagrams, "
+                             "%3 KB, built in %4 ms")
+                     .arg(alphagrams.getNumWords())
+                     .arg(alphagrams.getNumAlphagrams())
+                     .arg(alphagrams.getMemoryUsage() >> 10)
+                     .arg(alphagrams.getBuildTime()));
+
+        // The attribute store and statistics are loaded with the database
+        const AttributeStore& attributes = data->attributes;
+        if (attributes.isEmpty())
+            lines.append("  Attribute store: not loaded");
+        else {
+            lines.append(QString("  Attribute store: %1 words, %2 KB, "
+                                 "loaded in %3 ms")
+                         .arg(attributes.getNumWords())
+                         .arg(attributes.getMemoryUsage() >> 10)
+                         .arg(attributes.getLoadTime()));
+        }
+        if (!data->stats.isEmpty()) {
+            lines.append(QString("  Lexicon statistics: built in %1 ms")
+                         .arg(data->stats.getBuildTime()));
+        }
+
+        // The bitmap index is built by the first search that needs it
+        QMutexLocker locker (&data->bitmapMutex);
+        const BitmapIndex& bitmaps = data->bitmapIndex;
+        if (bitmaps.isEmpty())
+            lines.append("  Bitmap index: not built");
+        else {
+            lines.append(QString("  Bitmap index: %1 words, %2 KB, built in "
+                                 "%3 ms")
+                         .arg(bitmaps.getNumWords())
+                         .arg(bitmaps.getMemoryUsage() >> 10)
+                         .arg(bitmaps.getBuildTime()));
+        }
+        locker.unlock();
+
+        // So is the substring index of the word graph
+        int numWords = 0;
+        qint64 bytes = 0;
+        int buildTime = 0;
+        if (!data->graph ||
+            !data->graph->getSubstringIndexUsage(&numWords, &bytes,
+                                                 &buildTime))
+        {
+            lines.append("  Substring index: not built");
+        }
+        else {
+            lines.append(QString("  Substring index: %1 words, %2 KB, "
+                                 "built in %3 ms")
+                         .arg(numWords).arg(bytes >> 10).arg(buildTime));
+        }
+    }
+    return lines.join("\n");
 }
 
 //---------------------------------------------------------------------------
@@ -99,6 +380,18 @@ WordEngine::connectToDatabase(const QString& lexicon, const QString& filename,
     LexiconData* data = lexiconData[lexicon];
     data->db = db;
     data->dbConnectionName = dbConnectionName;
+
+    // The connection is used by the thread that opened it, and other
+    // threads open connections of their own as they need them
+    DatabaseConnection* connection = new DatabaseConnection;
+    connection->db = db;
+    connection->name = dbConnectionName;
+    ThreadConnections* threadData = getThreadConnections();
+    threadData->lexicons.insert(data);
+    data->connections.insert(threadData, connection);
+
+    clearCache(lexicon);
+    loadAttributes(lexicon);
     return true;
 }
 
@@ -121,13 +414,142 @@ WordEngine::disconnectFromDatabase(const QString& lexicon)
     if (!db || !db->isOpen() || dbConnectionName.isEmpty())
         return true;
 
-    delete db;
+    closeConnections(lexicon);
     lexiconData[lexicon]->db = 0;
-    QSqlDatabase::removeDatabase(dbConnectionName);
+    lexiconData[lexicon]->attributes.clear();
+    lexiconData[lexicon]->stats.clear();
+    clearCache(lexicon);
     lexiconData[lexicon]->dbConnectionName.clear();
     return true;
 }
 
+//---------------------------------------------------------------------------
+//  getConnection
+//
+//! Get the connection to the database of a lexicon for the calling thread,
+//! opening a new connection if the thread does not have one yet.
+//! Connections stay open until the database is disconnected or the thread
+//! finishes.
+//
+//! @param lexicon the name of the lexicon
+//! @return the connection, or null if the database is not connected
+//---------------------------------------------------------------------------
+WordEngine::DatabaseConnection*
+WordEngine::getConnection(const QString& lexicon) const
+{
+    if (!lexiconData.contains(lexicon))
+        return 0;
+
+    LexiconData* data = lexiconData[lexicon];
+    if (!data->db)
+        return 0;
+
+    ThreadConnections* threadData = getThreadConnections();
+    QMutexLocker locker (&data->connectionMutex);
+    DatabaseConnection* connection = data->connections.value(threadData);
+    if (connection)
+        return connection;
+
+    // Name the connection after the connections of the thread rather than
+    // the thread ID, since a finished thread's ID may be reused
+    QString name = data->dbConnectionName + "_" +
+        QString::number(quintptr(threadData));
+    QSqlDatabase* db = new QSqlDatabase(
+        QSqlDatabase::cloneDatabase(*data->db, name));
+    if (!db->open()) {
+        qWarning("Unable to open database connection: %s",
+                 db->lastError().text().toUtf8().constData());
+        delete db;
+        QSqlDatabase::removeDatabase(name);
+        return 0;
+    }
+
+    connection = new DatabaseConnection;
+    connection->db = db;
+    connection->name = name;
+    threadData->lexicons.insert(data);
+    data->connections.insert(threadData, connection);
+    return connection;
+}
+
+//---------------------------------------------------------------------------
+//  getThreadConnections
+//
+//! Get the database connections of the calling thread, creating them if the
+//! thread does not have any yet.
+//
+//! @return the connections of the thread
+//---------------------------------------------------------------------------
+WordEngine::ThreadConnections*
+WordEngine::getThreadConnections() const
+{
+    ThreadConnections* threadData = threadConnections.localData();
+    if (!threadData) {
+        threadData = new ThreadConnections;
+        threadConnections.setLocalData(threadData);
+    }
+    return threadData;
+}
+
+//---------------------------------------------------------------------------
+//  getDatabase
+//
+//! Get the database of a lexicon, as seen through the connection of the
+//! calling thread.
+//
+//! @param lexicon the name of the lexicon
+//! @return the database, or null if the database is not connected
+//---------------------------------------------------------------------------
+QSqlDatabase*
+WordEngine::getDatabase(const QString& lexicon) const
+{
+    DatabaseConnection* connection = getConnection(lexicon);
+    return connection ? connection->db : 0;
+}
+
+//---------------------------------------------------------------------------
+//  closeConnections
+//
+//! Close every connection to the database of a lexicon.  No other thread
+//! may be using the lexicon while this is done.
+//
+//! @param lexicon the name of the lexicon
+//---------------------------------------------------------------------------
+void
+WordEngine::closeConnections(const QString& lexicon)
+{
+    LexiconData* data = lexiconData[lexicon];
+    QMutexLocker locker (&data->connectionMutex);
+    qDeleteAll(data->connections);
+    data->connections.clear();
+}
+
+//---------------------------------------------------------------------------
+//  ~DatabaseConnection
+//
+//! Destructor.  Close the connection.
+//---------------------------------------------------------------------------
+WordEngine::DatabaseConnection::~DatabaseConnection()
+{
+    delete wordTableInsert;
+    delete db;
+    QSqlDatabase::removeDatabase(name);
+}
+
+//---------------------------------------------------------------------------
+//  ~ThreadConnections
+//
+//! Destructor.  Called in a thread as it finishes, to close the connections
+//! it opened that are still open.
+//---------------------------------------------------------------------------
+WordEngine::ThreadConnections::~ThreadConnections()
+{
+    foreach (LexiconData* data, lexicons) {
+        QMutexLocker locker (&data->connectionMutex);
+        delete data->connections.take(this);
+    }
+}
+
 //---------------------------------------------------------------------------
 //  databaseIsConnected
 //
@@ -159,14 +581,19 @@ WordEngine::importTextFile(const QString& lexicon, const QString& filename,
                            bool loadDefinitions, QString* errString)
 {
     // Delete old word graph if it exists
-    if (lexiconData.contains(lexicon))
+    if (lexiconData.contains(lexicon)) {
+        releaseBundle(lexicon);
         delete lexiconData[lexicon]->graph;
-    else
+    }
+    else {
         lexiconData[lexicon] = new LexiconData;
+        lexiconData[lexicon]->id = lexiconData.size();
+    }
 
     WordGraph* graph = new WordGraph;
     lexiconData[lexicon]->graph = graph;
     lexiconData[lexicon]->lexiconFile = filename;
+    clearCache(lexicon);
 
     QFile file (filename);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -178,6 +605,7 @@ WordEngine::importTextFile(const QString& lexicon, const QString& filename,
     }
 
     int imported = 0;
+    QSet<QString> words;
     char* buffer = new char[MAX_INPUT_LINE_LEN];
     while (file.readLine(buffer, MAX_INPUT_LINE_LEN) > 0) {
         QString line (buffer);
@@ -186,12 +614,8 @@ WordEngine::importTextFile(const QString& lexicon, const QString& filename,
             continue;
         QString word = line.section(' ', 0, 0).toUpper();
 
-        if (!graph->containsWord(word)) {
-            QString alpha = Auxil::getAlphagram(word);
-            ++lexiconData[lexicon]->numAnagramsMap[alpha];
-        }
+        words.insert(word);
 
-        graph->addWord(word);
         if (loadDefinitions) {
             QString definition = line.section(' ', 1);
             addDefinition(lexicon, word, definition);
@@ -200,6 +624,20 @@ WordEngine::importTextFile(const QString& lexicon, const QString& filename,
     }
 
     delete[] buffer;
+
+    // Build a minimal DAWG from the words so the lexicon is searched the
+    // same way as lexicons loaded from DAWG files
+    if (!graph->importWords(words.toList())) {
+        if (errString) {
+            *errString = "Can't build a word graph from file '" + filename +
+                "'.";
+        }
+        return 0;
+    }
+
+    buildAlphagramIndex(lexicon);
+    QMutexLocker locker (&lexiconData[lexicon]->bitmapMutex);
+    lexiconData[lexicon]->bitmapIndex.clear();
     return imported;
 }
 
@@ -222,104 +660,515 @@ WordEngine::importDawgFile(const QString& lexicon, const QString& filename,
 {
     if (!lexiconData.contains(lexicon)) {
         lexiconData[lexicon] = new LexiconData;
+        lexiconData[lexicon]->id = lexiconData.size();
         lexiconData[lexicon]->graph = new WordGraph;
     }
+    else
+        releaseBundle(lexicon);
 
     WordGraph* graph = lexiconData[lexicon]->graph;
     bool ok = graph->importDawgFile(filename, reverse, errString,
                                     expectedChecksum);
+    if (ok && !reverse) {
+        buildAlphagramIndex(lexicon);
+        clearCache(lexicon);
+        QMutexLocker locker (&lexiconData[lexicon]->bitmapMutex);
+        lexiconData[lexicon]->bitmapIndex.clear();
+    }
     return ok;
 }
 
 //---------------------------------------------------------------------------
-//  importStems
+//  importBundle
 //
-//! Import stems for a lexicon from a file.  The file is assumed to be in
-//! plain text format, containing one stem per line.  The file is also assumed
-//! to contain stems of equal length.  All stems of different length than the
-//! first stem will be discarded.
+//! Import a lexicon from a lexicon bundle written by writeBundle.  The word
+//! graphs and the alphagram index are used in place from the mapped bundle,
+//! so nothing is read or built until it is needed.  The attributes in the
+//! bundle are used once the database is connected.
 //
 //! @param lexicon the name of the lexicon
-//! @param filename the name of the file to import
+//! @param filename the name of the bundle file
+//! @param sources the files the lexicon is loaded from, and its database
 //! @param errString returns the error string in case of error
-//! @return the number of stems imported
+//! @return true if successful, false otherwise
 //---------------------------------------------------------------------------
-int
-WordEngine::importStems(const QString& lexicon, const QString& filename,
-                        QString* errString)
+bool
+WordEngine::importBundle(const QString& lexicon, const QString& filename,
+                         const QStringList& sources, QString* errString)
 {
-    if (!lexiconData.contains(lexicon))
-        return 0;
+    LexiconBundle* bundle = new LexiconBundle;
+    if (!bundle->open(filename, errString)) {
+        delete bundle;
+        return false;
+    }
 
-    QFile file (filename);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!bundle->isCurrent(sources)) {
         if (errString) {
-            *errString = "Can't open file '" + filename + "': " +
-                file.errorString();
+            *errString = "The lexicon bundle '" + filename + "' is out of "
+                "date.";
         }
-        return -1;
+        delete bundle;
+        return false;
     }
 
-    // XXX: At some point, may want to consider allowing words of varying
-    // lengths to be in the same file?
-    QStringList words;
-    QSet<QString> alphagrams;
-    int imported = 0;
-    int length = 0;
-    char* buffer = new char[MAX_INPUT_LINE_LEN];
-    while (file.readLine(buffer, MAX_INPUT_LINE_LEN) > 0) {
-        QString line (buffer);
-        line = line.simplified();
-        if (!line.length() || (line.at(0) == '#'))
-            continue;
-        QString word = line.section(' ', 0, 0);
-
-        if (!length)
-            length = word.length();
-
-        if (length != int(word.length()))
-            continue;
+    WordGraph* graph = new WordGraph;
+    if (!graph->attachBundle(*bundle, errString)) {
+        delete graph;
+        delete bundle;
+        return false;
+    }
 
-        words << word;
-        alphagrams.insert(Auxil::getAlphagram(word));
-        ++imported;
+    if (lexiconData.contains(lexicon)) {
+        releaseBundle(lexicon);
+        delete lexiconData[lexicon]->graph;
+    }
+    else {
+        lexiconData[lexicon] = new LexiconData;
+        lexiconData[lexicon]->id = lexiconData.size();
     }
-    delete[] buffer;
 
-    // Insert the stem list into the map, or append to an existing stem list
     LexiconData* data = lexiconData[lexicon];
-    data->stems[length] += words;
-    data->stemAlphagrams[length].unite(alphagrams);
-    return imported;
+    data->graph = graph;
+    data->bundle = bundle;
+    data->bundleSources = sources;
+    data->lexiconFile =
+        QString::fromUtf8(bundle->getSection(LexiconBundle::LexiconFile));
+    data->definitions.clear();
+    QMutexLocker locker (&data->bitmapMutex);
+    data->bitmapIndex.clear();
+    locker.unlock();
+    clearCache(lexicon);
+
+    if (!data->alphagramIndex.attachBundle(*bundle, graph->getNumWords()))
+        buildAlphagramIndex(lexicon);
+    if (data->db)
+        loadAttributes(lexicon);
+
+    return true;
 }
 
 //---------------------------------------------------------------------------
-//  databaseSearch
+//  writeBundle
 //
-//! Search the database for words matching the conditions in a search spec.
-//! If a word list is provided, also ensure that result words are in that
-//! list.
+//! Write a lexicon to a lexicon bundle, to be imported by importBundle.  The
+//! bundle holds the word graphs, the alphagram index, the hooks and the
+//! definitions of every word, and the attributes if they are loaded.
 //
 //! @param lexicon the name of the lexicon
-//! @param optimizedSpec the search spec
-//! @param wordList optional list of words that results must be in
-//! @return a list of words matching the search spec
+//! @param filename the name of the bundle file
+//! @param sources the files the lexicon is loaded from, and its database
+//! @param errString returns the error string in case of error
+//! @return true if successful, false otherwise
 //---------------------------------------------------------------------------
-QStringList
-WordEngine::databaseSearch(const QString& lexicon, const SearchSpec&
-                           optimizedSpec, const QStringList* wordList) const
+bool
+WordEngine::writeBundle(const QString& lexicon, const QString& filename,
+                        const QStringList& sources, QString* errString) const
 {
-    if (!lexiconData.contains(lexicon) || !lexiconData[lexicon]->db)
-        return QStringList();
+    if (!lexiconData.contains(lexicon))
+        return false;
 
-    // Build SQL query string
-    QSet<QString> tables;
-    QString whereStr;
-    bool foundCondition = false;
+    const LexiconData* data = lexiconData[lexicon];
+    QList<QByteArray> words = data->graph->getWords();
+    if (words.isEmpty()) {
+        if (errString)
+            *errString = "The lexicon is empty.";
+        return false;
+    }
+
+    // Hooks and definitions are held by word number
+    int numWords = words.size();
+    QVector<quint32> frontHooks (numWords);
+    QVector<quint32> backHooks (numWords);
+    QVector<quint32> definitionOffsets (numWords + 1);
+    QByteArray definitionData;
+    for (int id = 0; id < numWords; ++id) {
+        QString word = QString::fromLatin1(words.at(id));
+        frontHooks[id] = data->graph->getFrontHooks(word);
+        backHooks[id] = data->graph->getBackHooks(word);
+        definitionOffsets[id] = definitionData.size();
+        if (data->definitions.contains(word)) {
+            QStringList defs (data->definitions.value(word).values());
+            definitionData += defs.join(DEF_ORIG_SEP).toUtf8();
+        }
+        else if (data->bundle) {
+            definitionData += getBundleDefinition(lexicon, word).toUtf8();
+        }
+    }
+    definitionOffsets[numWords] = definitionData.size();
+
+    LexiconBundle bundle;
+    bundle.setSection(LexiconBundle::SourceStamp,
+                      LexiconBundle::getSourceStamp(sources));
+    bundle.setSection(LexiconBundle::LexiconFile,
+                      data->lexiconFile.toUtf8());
+    data->graph->writeBundle(bundle);
+    data->alphagramIndex.writeBundle(bundle);
+    data->attributes.writeBundle(bundle);
+    bundle.setSection(LexiconBundle::FrontHooks,
+        QByteArray::fromRawData((const char*) frontHooks.constData(),
+                                numWords * sizeof(quint32)));
+    bundle.setSection(LexiconBundle::BackHooks,
+        QByteArray::fromRawData((const char*) backHooks.constData(),
+                                numWords * sizeof(quint32)));
+    if (!definitionData.isEmpty()) {
+        bundle.setSection(LexiconBundle::DefinitionOffsets,
+            QByteArray::fromRawData(
+                (const char*) definitionOffsets.constData(),
+                (numWords + 1) * sizeof(quint32)));
+        bundle.setSection(LexiconBundle::DefinitionData, definitionData);
+    }
+
+    return bundle.save(filename, errString);
+}
+
+//---------------------------------------------------------------------------
+//  bundleIsCurrent
+//
+//! Determine whether a lexicon was imported from a lexicon bundle that is
+//! current, and that holds the attributes if they are loaded.
+//
+//! @param lexicon the name of the lexicon
+//! @param sources the files the lexicon is loaded from, and its database
+//! @return true if the bundle is current, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordEngine::bundleIsCurrent(const QString& lexicon, const QStringList&
+                            sources) const
+{
+    if (!lexiconData.contains(lexicon))
+        return false;
+
+    const LexiconData* data = lexiconData[lexicon];
+    if (!data->bundle || !data->bundle->isCurrent(sources))
+        return false;
+
+    return data->attributes.isEmpty() ||
+        data->bundle->hasSection(LexiconBundle::AttributeColumns);
+}
+
+//---------------------------------------------------------------------------
+//  verifyChecksums
+//
+//! Verify the checksums of the DAWG files imported for a lexicon.  This is
+//! kept off the import path so that startup does not have to touch every
+//! page of the lexicon.
+//
+//! @param lexicon the name of the lexicon
+//! @param errString returns the error string in case of error
+//! @return true if the checksums match or were not provided, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordEngine::verifyChecksums(const QString& lexicon, QString* errString)
+{
+    if (!lexiconData.contains(lexicon))
+        return true;
+
+    return lexiconData[lexicon]->graph->verifyChecksums(errString);
+}
+
+//---------------------------------------------------------------------------
+//  importStems
+//
+//! Import stems for a lexicon from a file.  The file is assumed to be in
+//! plain text format, containing one stem per line.  The file is also assumed
+//! to contain stems of equal length.  All stems of different length than the
+//! first stem will be discarded.
+//
+//! @param lexicon the name of the lexicon
+//! @param filename the name of the file to import
+//! @param errString returns the error string in case of error
+//! @return the number of stems imported
+//---------------------------------------------------------------------------
+int
+WordEngine::importStems(const QString& lexicon, const QString& filename,
+                        QString* errString)
+{
+    if (!lexiconData.contains(lexicon))
+        return 0;
+
+    QFile file (filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errString) {
+            *errString = "Can't open file '" + filename + "': " +
+                file.errorString();
+        }
+        return -1;
+    }
+
+    // XXX: At some point, may want to consider allowing words of varying
+    // lengths to be in the same file?
+    QStringList words;
+    QSet<QString> alphagrams;
+    int imported = 0;
+    int length = 0;
+    char* buffer = new char[MAX_INPUT_LINE_LEN];
+    while (file.readLine(buffer, MAX_INPUT_LINE_LEN) > 0) {
+        QString line (buffer);
+        line = line.simplified();
+        if (!line.length() || (line.at(0) == '#'))
+            continue;
+        QString word = line.section(' ', 0, 0);
+
+        if (!length)
+            length = word.length();
+
+        if (length != int(word.length()))
+            continue;
+
+        words << word;
+        alphagrams.insert(Auxil::getAlphagram(word));
+        ++imported;
+    }
+    delete[] buffer;
+
+    // Insert the stem list into the map, or append to an existing stem list
+    LexiconData* data = lexiconData[lexicon];
+    data->stems[length] += words;
+    data->stemAlphagrams[length].unite(alphagrams);
+    return imported;
+}
+
+//---------------------------------------------------------------------------
+//  attributeSearch
+//
+//! Find the words matching the numeric conditions in a search spec by
+//! scanning the attribute store.  If a word list is provided, only the
+//! words in that list are checked.
+//
+//! @param lexicon the name of the lexicon
+//! @param optimizedSpec the search spec
+//! @param wordList optional list of words that results must be in
+//! @return a list of words matching the search spec
+//---------------------------------------------------------------------------
+QStringList
+WordEngine::attributeSearch(const QString& lexicon, const SearchSpec&
+                            optimizedSpec, const QStringList* wordList) const
+{
+    if (!lexiconData.contains(lexicon))
+        return QStringList();
+
+    const LexiconData* data = lexiconData[lexicon];
+    const AttributeStore& store = data->attributes;
+    if (store.isEmpty())
+        return QStringList();
+
+    // Number the words in the list, keeping the case of each word
+    QStringList listWords;
+    QVector<int> listIds;
+    if (wordList) {
+        foreach (const QString& word, *wordList) {
+            int id = data->graph->getWordId(word.toUpper());
+            if (id < 0)
+                continue;
+            listWords.append(word);
+            listIds.append(id);
+        }
+    }
+
+    // Narrow the words with one pass over a column for each condition.  The
+    // first condition selects from every word unless a list was given.
+    QVector<int> ids = listIds;
+    bool selectAll = !wordList;
+    QListIterator<SearchCondition> cit (optimizedSpec.conditions);
+    while (cit.hasNext()) {
+        const SearchCondition& condition = cit.next();
+        if (getConditionPhase(lexicon, condition) != AttributePhase)
+            continue;
+
+        QList<AttributeStore::Attribute> attributes;
+        QList<quint32> minValues;
+        QList<quint32> maxValues;
+        getAttributeRanges(condition, &attributes, &minValues, &maxValues);
+        for (int i = 0; i < attributes.size(); ++i) {
+            if (selectAll) {
+                ids = store.select(attributes.at(i), minValues.at(i),
+                                   maxValues.at(i));
+                selectAll = false;
+            }
+            else {
+                store.filter(attributes.at(i), minValues.at(i),
+                             maxValues.at(i), ids);
+            }
+        }
+    }
+
+    QStringList resultList;
+    if (!wordList) {
+        foreach (int id, ids)
+            resultList.append(data->graph->getWordAt(id));
+        return resultList;
+    }
+
+    // Filtering keeps the order of the list, so the words remaining can be
+    // picked out in one pass
+    int j = 0;
+    for (int i = 0; (i < listIds.size()) && (j < ids.size()); ++i) {
+        if (listIds.at(i) == ids.at(j)) {
+            resultList.append(listWords.at(i));
+            ++j;
+        }
+    }
+    return resultList;
+}
+
+//---------------------------------------------------------------------------
+//  loadWordTable
+//
+//! Load a list of words into the temporary search_words table of a lexicon
+//! database, replacing the words already there, so a query can join with
+//! the list instead of naming every word in its text.  The table lasts as
+//! long as the connection, and the words are inserted with a single
+//! prepared statement that is kept for later lists.
+//
+//! @param lexicon the name of the lexicon
+//! @param words the words
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordEngine::loadWordTable(const QString& lexicon, const QStringList& words)
+    const
+{
+    DatabaseConnection* connection = getConnection(lexicon);
+    if (!connection || !connection->db->isOpen())
+        return false;
+
+    // Each connection has its own temporary table
+    QSqlDatabase* db = connection->db;
+    QSqlQuery query (*db);
+    if (!query.exec("CREATE TEMP TABLE IF NOT EXISTS search_words "
+                    "(word text PRIMARY KEY)") ||
+        !query.exec("DELETE FROM search_words"))
+    {
+        qWarning("Unable to create word table: %s",
+                 query.lastError().text().toUtf8().constData());
+        return false;
+    }
+
+    if (!connection->wordTableInsert) {
+        connection->wordTableInsert = new QSqlQuery(*db);
+        connection->wordTableInsert->prepare("INSERT OR IGNORE INTO "
+                                             "search_words (word) VALUES "
+                                             "(?)");
+    }
+
+    QVariantList values;
+    foreach (const QString& word, words)
+        values.append(word.toUpper());
+
+    db->transaction();
+    connection->wordTableInsert->addBindValue(values);
+    bool ok = connection->wordTableInsert->execBatch();
+    db->commit();
+
+    if (!ok) {
+        qWarning("Unable to load word table: %s",
+                 connection->wordTableInsert->lastError().text().toUtf8()
+                 .constData());
+    }
+    return ok;
+}
+
+//---------------------------------------------------------------------------
+//  getAttributeRanges
+//
+//! Determine the ranges of attribute values that satisfy a numeric search
+//! condition.  A word satisfies the condition if every attribute listed is
+//! within its range.
+//
+//! @param condition the search condition
+//! @param attributes return the attributes
+//! @param minValues return the minimum value of each attribute
+//! @param maxValues return the maximum value of each attribute
+//---------------------------------------------------------------------------
+void
+WordEngine::getAttributeRanges(const SearchCondition& condition,
+                               QList<AttributeStore::Attribute>* attributes,
+                               QList<quint32>* minValues, QList<quint32>*
+                               maxValues) const
+{
+    quint32 minValue = qMax(condition.minValue, 0);
+    quint32 maxValue = qMax(condition.maxValue, 0);
+
+    switch (condition.type) {
+        case SearchCondition::ProbabilityOrder:
+        case SearchCondition::PlayabilityOrder: {
+            AttributeStore::Attribute attribute =
+                AttributeStore::PlayabilityOrder;
+            if (condition.type == SearchCondition::ProbabilityOrder) {
+                attribute = AttributeStore::getProbabilityOrder(
+                    condition.intValue);
+            }
+
+            // Lax boundaries, using the minimum and maximum orders that
+            // follow each order attribute
+            if (condition.boolValue) {
+                *attributes << AttributeStore::Attribute(attribute + 2)
+                            << AttributeStore::Attribute(attribute + 1);
+                *minValues << minValue << 0;
+                *maxValues << 0xFFFFFFFF << maxValue;
+            }
+            // Strict boundaries
+            else {
+                *attributes << attribute;
+                *minValues << minValue;
+                *maxValues << maxValue;
+            }
+        }
+        break;
+
+        case SearchCondition::Length:
+        case SearchCondition::NumVowels:
+        case SearchCondition::NumUniqueLetters:
+        case SearchCondition::PointValue:
+        case SearchCondition::NumAnagrams: {
+            AttributeStore::Attribute attribute = AttributeStore::Length;
+            if (condition.type == SearchCondition::NumVowels)
+                attribute = AttributeStore::NumVowels;
+            if (condition.type == SearchCondition::NumUniqueLetters)
+                attribute = AttributeStore::NumUniqueLetters;
+            if (condition.type == SearchCondition::PointValue)
+                attribute = AttributeStore::PointValue;
+            if (condition.type == SearchCondition::NumAnagrams)
+                attribute = AttributeStore::NumAnagrams;
+
+            *attributes << attribute;
+            *minValues << minValue;
+            *maxValues << maxValue;
+        }
+        break;
+
+        default:
+        break;
+    }
+}
+
+//---------------------------------------------------------------------------
+//  databaseSearch
+//
+//! Search the database for words matching the conditions in a search spec.
+//! If a word list is provided, also ensure that result words are in that
+//! list.
+//
+//! @param lexicon the name of the lexicon
+//! @param optimizedSpec the search spec
+//! @param wordList optional list of words that results must be in
+//! @return a list of words matching the search spec
+//---------------------------------------------------------------------------
+QStringList
+WordEngine::databaseSearch(const QString& lexicon, const SearchSpec&
+                           optimizedSpec, const QStringList* wordList) const
+{
+    if (!lexiconData.contains(lexicon) || !lexiconData[lexicon]->db)
+        return QStringList();
+
+    // Build SQL query string
+    QSet<QString> tables;
+    QString whereStr;
+    bool foundCondition = false;
     QListIterator<SearchCondition> cit (optimizedSpec.conditions);
     while (cit.hasNext()) {
         SearchCondition condition = cit.next();
-        if (getConditionPhase(condition) != DatabasePhase)
+        if (getConditionPhase(lexicon, condition) != DatabasePhase)
             continue;
 
         if (foundCondition)
@@ -328,17 +1177,6 @@ WordEngine::databaseSearch(const QString& lexicon, const SearchSpec&
         whereStr += " (";
 
         switch (condition.type) {
-            case SearchCondition::PatternMatch: {
-                tables.insert("words");
-                QString str =
-                    condition.stringValue.replace("?", "_").replace("*", "%");
-                whereStr += " words.word";
-                if (condition.negated)
-                    whereStr += " NOT";
-                whereStr += " LIKE '" + str + "'";
-            }
-            break;
-
             case SearchCondition::PartOfSpeech:
             case SearchCondition::Definition: {
                 tables.insert("words");
@@ -527,23 +1365,22 @@ WordEngine::databaseSearch(const QString& lexicon, const SearchSpec&
         whereStr += ")";
     }
 
-    // Make sure results are in the provided word list
+    // Make sure results are in the provided word list, by joining with a
+    // temporary table holding the list
+    QTime timer;
+    timer.start();
+    int loadTime = 0;
     QMap<QString, QString> upperToLower;
     if (wordList) {
+        if (!loadWordTable(lexicon, *wordList))
+            return QStringList();
+        loadTime = timer.restart();
+
         tables.insert("words");
-        whereStr += " AND words.word IN (";
-        QStringListIterator it (*wordList);
-        bool firstWord = true;
-        while (it.hasNext()) {
-            QString word = it.next();
-            QString wordUpper = word.toUpper();
-            upperToLower[wordUpper] = word;
-            if (!firstWord)
-                whereStr += ",";
-            firstWord = false;
-            whereStr += "'" + wordUpper + "'";
-        }
-        whereStr += ")";
+        tables.insert("search_words");
+        whereStr += " AND words.word=search_words.word";
+        foreach (const QString& word, *wordList)
+            upperToLower[word.toUpper()] = word;
     }
 
     QStringList tablesList = tables.toList();
@@ -560,7 +1397,9 @@ WordEngine::databaseSearch(const QString& lexicon, const SearchSpec&
 
     // Query the database
     QStringList resultList;
-    QSqlDatabase* db = lexiconData[lexicon]->db;
+    QSqlDatabase* db = getDatabase(lexicon);
+    if (!db)
+        return QStringList();
     QSqlQuery query (queryStr, *db);
     while (query.next()) {
         QString word = query.value(0).toString();
@@ -570,6 +1409,8 @@ WordEngine::databaseSearch(const QString& lexicon, const SearchSpec&
         resultList.append(word);
     }
 
+    recordDatabaseQuery(wordList ? wordList->size() : 0, loadTime,
+                        timer.elapsed());
     return resultList;
 }
 
@@ -713,30 +1554,23 @@ WordEngine::applyPostConditions(const QString& lexicon,
 
             // Sort the words according to playability order
             else if (playValueMap.isEmpty()) {
-                LexiconData* lexData = lexiconData.value(lexicon);
-                if (!lexData)
+                QSqlDatabase* db = getDatabase(lexicon);
+                if (!db || !db->isOpen())
                     return returnList;
 
-                QSqlDatabase* db = lexData->db;
-                if (!db || !db->isOpen())
+                QTime timer;
+                timer.start();
+                if (!loadWordTable(lexicon, returnList))
                     return returnList;
+                int loadTime = timer.restart();
 
                 QMap<QString, QString> origCase;
-                QString qstr = "SELECT word, playability FROM words "
-                    "WHERE word IN (";
-                QStringListIterator it (returnList);
-                for (int i = 0; it.hasNext(); ++i) {
-                    const QString& word = it.next();
+                foreach (const QString& word, returnList)
                     origCase[word.toUpper()] = word;
-                    if (i)
-                        qstr += ", ";
-                    qstr += "'" + word.toUpper() + "'";
-                }
-                qstr += ")";
 
-                QSqlQuery query (*db);
-                query.prepare(qstr);
-                query.exec();
+                QSqlQuery query ("SELECT words.word, words.playability FROM "
+                                 "words, search_words WHERE "
+                                 "words.word=search_words.word", *db);
 
                 while (query.next()) {
                     QString word = origCase[query.value(0).toString()];
@@ -748,6 +1582,9 @@ WordEngine::applyPostConditions(const QString& lexicon,
                     radix += wordUpper;
                     playValueMap.insert(radix, word);
                 }
+
+                recordDatabaseQuery(returnList.size(), loadTime,
+                                    timer.elapsed());
             }
 
             QMap<QString, QString>& valueMap = probCondition ?
@@ -800,86 +1637,273 @@ WordEngine::lexiconIsLoaded(const QString& lexicon) const
 }
 
 //---------------------------------------------------------------------------
-//  isAcceptable
+//  buildAlphagramIndex
 //
-//! Determine whether a word is acceptable in a lexicon.
+//! Build the alphagram index for a lexicon from its word graph.
 //
 //! @param lexicon the name of the lexicon
-//! @param word the word to look up
-//! @return true if acceptable, false otherwise
 //---------------------------------------------------------------------------
-bool
-WordEngine::isAcceptable(const QString& lexicon, const QString& word) const
+void
+WordEngine::buildAlphagramIndex(const QString& lexicon)
 {
     if (!lexiconData.contains(lexicon))
-        return false;
+        return;
 
-    return lexiconData[lexicon]->graph->containsWord(word);
+    LexiconData* data = lexiconData[lexicon];
+    data->alphagramIndex.build(data->graph->getWords());
 }
 
 //---------------------------------------------------------------------------
-//  search
+//  releaseBundle
 //
-//! Search for acceptable words matching a search specification.
+//! Release the lexicon bundle a lexicon was imported from, if any.  The
+//! word graph, alphagram index and attributes attached to the bundle are
+//! cleared, and must be loaded again by the caller.
 //
 //! @param lexicon the name of the lexicon
-//! @param spec the search specification
-//! @param allCaps whether to ensure the words in the list are all caps
-//! @return a list of acceptable words
 //---------------------------------------------------------------------------
-QStringList
-WordEngine::search(const QString& lexicon, const SearchSpec& spec, bool
-                   allCaps) const
+void
+WordEngine::releaseBundle(const QString& lexicon)
 {
     if (!lexiconData.contains(lexicon))
-        return QStringList();
+        return;
 
-    SearchSpec optimizedSpec = spec;
-    optimizedSpec.optimize(lexicon);
+    LexiconData* data = lexiconData[lexicon];
+    if (!data->bundle)
+        return;
 
-    // Discover which kinds of search conditions are present
-    QMap<ConditionPhase, int> phaseCounts;
-    int lengthConditions = 0;
-    QListIterator<SearchCondition> cit (optimizedSpec.conditions);
-    while (cit.hasNext()) {
-        SearchCondition condition = cit.next();
-        ConditionPhase phase = getConditionPhase(condition);
-        ++phaseCounts[phase];
-        if (condition.type == SearchCondition::Length)
-            ++lengthConditions;
-    }
+    data->graph->clear();
+    data->alphagramIndex.clear();
+    data->attributes.clear();
+    data->stats.clear();
+    QMutexLocker locker (&data->bitmapMutex);
+    data->bitmapIndex.clear();
+    locker.unlock();
+    clearCache(lexicon);
+
+    delete data->bundle;
+    data->bundle = 0;
+    data->bundleSources.clear();
+}
+
+//---------------------------------------------------------------------------
+//  loadAttributes
+//
+//! Load the numeric attributes of every word in a lexicon from its
+//! database.  If they cannot be loaded, conditions on them are left to the
+//! database.
+//
+//! @param lexicon the name of the lexicon
+//---------------------------------------------------------------------------
+void
+WordEngine::loadAttributes(const QString& lexicon)
+{
+    if (!lexiconData.contains(lexicon))
+        return;
+
+    LexiconData* data = lexiconData[lexicon];
+    if (!data->db || !data->graph)
+        return;
+
+    // The attributes of a bundle are only used while the database is the
+    // one the bundle was written from
+    bool attached = data->bundle &&
+        data->bundle->isCurrent(data->bundleSources) &&
+        data->attributes.attachBundle(*data->bundle,
+                                      data->graph->getNumWords());
 
-    // Do not search the database based on Length conditions that were only
-    // added by SearchSpec::optimize to optimize word graph searches
-    if ((phaseCounts.contains(WordGraphPhase)) && lengthConditions &&
-        (lengthConditions == phaseCounts.value(DatabasePhase)))
+    QString errString;
+    if (!attached &&
+        !data->attributes.load(*data->db, data->graph, &errString))
     {
-        --phaseCounts[DatabasePhase];
+        qWarning("Unable to load attributes for %s: %s",
+                 lexicon.toUtf8().constData(),
+                 errString.toUtf8().constData());
+        return;
     }
 
-    // Search the word graph if necessary
+    data->stats.build(data->attributes);
+}
+
+//---------------------------------------------------------------------------
+//  isAcceptable
+//
+//! Determine whether a word is acceptable in a lexicon.
+//
+//! @param lexicon the name of the lexicon
+//! @param word the word to look up
+//! @return true if acceptable, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordEngine::isAcceptable(const QString& lexicon, const QString& word) const
+{
+    if (!lexiconData.contains(lexicon))
+        return false;
+
+    return lexiconData[lexicon]->graph->containsWord(word);
+}
+
+//---------------------------------------------------------------------------
+//  getWordId
+//
+//! Get the number of a word in a lexicon.  Words are numbered from zero in
+//! alphabetical order with no gaps, so the number can index an array or a
+//! bitmap with one entry per word in the lexicon.
+//
+//! @param lexicon the name of the lexicon
+//! @param word the word, in upper case
+//! @return the number of the word, or -1 if the word is not acceptable
+//---------------------------------------------------------------------------
+int
+WordEngine::getWordId(const QString& lexicon, const QString& word) const
+{
+    if (!lexiconData.contains(lexicon))
+        return -1;
+
+    return lexiconData[lexicon]->graph->getWordId(word);
+}
+
+//---------------------------------------------------------------------------
+//  getWordAt
+//
+//! Get the word in a lexicon with a particular number, as returned by
+//! getWordId.
+//
+//! @param lexicon the name of the lexicon
+//! @param id the number of the word
+//! @return the word, or an empty string if there is no such word
+//---------------------------------------------------------------------------
+QString
+WordEngine::getWordAt(const QString& lexicon, int id) const
+{
+    if (!lexiconData.contains(lexicon))
+        return QString();
+
+    return lexiconData[lexicon]->graph->getWordAt(id);
+}
+
+//---------------------------------------------------------------------------
+//  search
+//
+//! Search for acceptable words matching a search specification.
+//!
+//! If a stream is given, the words are also delivered to it in batches.
+//! When only the word graph needs to be searched, words are delivered as
+//! the graph is walked; otherwise they are delivered once every phase of
+//! the search is complete.  If the search runs out of its result or time
+//! budget, only the words delivered are returned.
+//
+//! @param lexicon the name of the lexicon
+//! @param spec the search specification
+//! @param allCaps whether to ensure the words in the list are all caps
+//! @param stream the stream to receive words, or null
+//! @return a list of acceptable words, or an empty list if the search was
+//! canceled
+//---------------------------------------------------------------------------
+QStringList
+WordEngine::search(const QString& lexicon, const SearchSpec& spec, bool
+                   allCaps, SearchStream* stream) const
+{
+    if (!lexiconData.contains(lexicon))
+        return QStringList();
+
+    if (stream)
+        stream->begin(allCaps);
+
+    SearchSpec optimizedSpec = spec;
+    optimizedSpec.optimize(lexicon);
+
+    // Look up exact anagrams in the alphagram index, and answer searches
+    // made only of conditions with bitmaps from the bitmap index, instead of
+    // searching
+    QString anagramLetters;
+    bool indexed = true;
     QStringList resultList;
-    if (phaseCounts.value(WordGraphPhase) ||
-        !phaseCounts.value(DatabasePhase))
-    {
-        resultList = wordGraphSearch(lexicon, optimizedSpec);
-        if (resultList.isEmpty())
-            return resultList;
+    if (isExactAnagramSearch(optimizedSpec, &anagramLetters)) {
+        resultList =
+            lexiconData[lexicon]->alphagramIndex.getAnagrams(anagramLetters);
+    }
+    else if (isBitmapSearch(lexicon, optimizedSpec))
+        resultList = bitmapSearch(lexicon, optimizedSpec);
+    else
+        indexed = false;
+
+    if (indexed) {
+        if (stream) {
+            stream->addWords(resultList);
+            stream->flush();
+            if (stream->isCanceled())
+                return QStringList();
+            resultList = resultList.mid(0, stream->getNumResults());
+        }
+        if (!resultList.isEmpty())
+            addToCache(lexicon, resultList);
+        return resultList;
     }
 
-    // Search the database if necessary, passing word graph results
-    if (phaseCounts.value(DatabasePhase)) {
-        resultList = databaseSearch(lexicon, optimizedSpec,
-            phaseCounts.contains(WordGraphPhase) ? &resultList : 0);
+    // Choose the order in which to run the phases of the search
+    QMap<ConditionPhase, int> phaseCounts =
+        getSearchPhases(lexicon, optimizedSpec);
+    SearchPlan plan = planSearch(lexicon, optimizedSpec, phaseCounts);
+
+    // Words can only be streamed from the word graph if no later phase
+    // will remove any of them
+    bool streamGraph = stream && (plan.phases.size() == 1) &&
+        (plan.phases.first() == WordGraphPhase) && !plan.postConditions;
+
+    // Run each phase, passing it the results of the phases before it.  The
+    // word graph checks the words it is passed instead of being searched.
+    bool haveResults = false;
+    foreach (ConditionPhase phase, plan.phases) {
+        if (stream && stream->poll())
+            return QStringList();
+
+        switch (phase) {
+            case WordGraphPhase:
+            if (haveResults) {
+                resultList = lexiconData[lexicon]->graph->filterWords(
+                    resultList, optimizedSpec);
+            }
+            else {
+                resultList = wordGraphSearch(lexicon, optimizedSpec,
+                                             streamGraph ? stream : 0);
+            }
+            break;
+
+            case AttributePhase:
+            resultList = attributeSearch(lexicon, optimizedSpec,
+                                         haveResults ? &resultList : 0);
+            break;
+
+            case DatabasePhase:
+            resultList = databaseSearch(lexicon, optimizedSpec,
+                                        haveResults ? &resultList : 0);
+            break;
+
+            default:
+            break;
+        }
+
         if (resultList.isEmpty())
             return resultList;
+        haveResults = true;
     }
 
     // Check post conditions if necessary
-    if (phaseCounts.value(PostConditionPhase)) {
+    if (plan.postConditions) {
+        if (stream && stream->poll())
+            return QStringList();
         resultList = applyPostConditions(lexicon, optimizedSpec, resultList);
     }
 
+    if (stream && !streamGraph) {
+        stream->addWords(resultList);
+        stream->flush();
+        if (stream->isCanceled())
+            return QStringList();
+        resultList = resultList.mid(0, stream->getNumResults());
+    }
+
     // Convert to all caps if necessary
     if (allCaps) {
         QStringList::iterator it;
@@ -887,14 +1911,295 @@ WordEngine::search(const QString& lexicon, const SearchSpec& spec, bool
             *it = (*it).toUpper();
     }
 
-    if (!resultList.isEmpty()) {
-        clearCache(lexicon);
+    if (!resultList.isEmpty())
         addToCache(lexicon, resultList);
-    }
 
     return resultList;
 }
 
+//---------------------------------------------------------------------------
+//  isExactAnagramSearch
+//
+//! Determine whether an optimized search spec does nothing but find the
+//! exact anagrams of a set of letters.  Length conditions are allowed, since
+//! SearchSpec::optimize makes them consistent with the anagram length.
+//
+//! @param optimizedSpec the optimized search spec
+//! @param letters return the letters to find anagrams of
+//! @return true if the spec is an exact anagram search, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordEngine::isExactAnagramSearch(const SearchSpec& optimizedSpec, QString*
+                                 letters) const
+{
+    if (!optimizedSpec.conjunction)
+        return false;
+
+    bool found = false;
+    foreach (const SearchCondition& condition, optimizedSpec.conditions) {
+        if (condition.type == SearchCondition::Length)
+            continue;
+
+        QString str = condition.stringValue;
+        if ((condition.type != SearchCondition::AnagramMatch) ||
+            condition.negated || found || str.contains("[") ||
+            str.contains("?") || str.contains("*"))
+        {
+            return false;
+        }
+
+        *letters = str;
+        found = true;
+    }
+
+    return found;
+}
+
+//---------------------------------------------------------------------------
+//  isBitmapSearch
+//
+//! Determine whether every condition of an optimized search spec can be
+//! answered from the bitmap index and the attribute store.
+//
+//! @param lexicon the name of the lexicon
+//! @param optimizedSpec the optimized search spec
+//! @return true if the spec is a bitmap search, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordEngine::isBitmapSearch(const QString& lexicon, const SearchSpec&
+                           optimizedSpec) const
+{
+    if (optimizedSpec.conditions.isEmpty())
+        return false;
+
+    foreach (const SearchCondition& condition, optimizedSpec.conditions) {
+        switch (condition.type) {
+            case SearchCondition::Length:
+            case SearchCondition::NumVowels:
+            case SearchCondition::NumUniqueLetters:
+            case SearchCondition::NumAnagrams:
+            case SearchCondition::IncludeLetters:
+            case SearchCondition::InWordList:
+            break;
+
+            case SearchCondition::PointValue:
+            case SearchCondition::ProbabilityOrder:
+            case SearchCondition::PlayabilityOrder:
+            if (getConditionPhase(lexicon, condition) != AttributePhase)
+                return false;
+            break;
+
+            case SearchCondition::BelongToGroup: {
+                SearchSet searchSet =
+                    Auxil::stringToSearchSet(condition.stringValue);
+                if ((searchSet != SetHookWords) &&
+                    (searchSet != SetFrontHooks) &&
+                    (searchSet != SetBackHooks))
+                {
+                    return false;
+                }
+            }
+            break;
+
+            default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  getBitmapIndex
+//
+//! Get the bitmap index for a lexicon, building it if it has not been built
+//! since the lexicon was loaded.
+//
+//! @param lexicon the name of the lexicon
+//! @return the bitmap index, or null if the lexicon is not loaded
+//---------------------------------------------------------------------------
+const BitmapIndex*
+WordEngine::getBitmapIndex(const QString& lexicon) const
+{
+    if (!lexiconData.contains(lexicon))
+        return 0;
+
+    const LexiconData* data = lexiconData[lexicon];
+    QMutexLocker locker (&data->bitmapMutex);
+    if (data->bitmapIndex.isEmpty())
+        data->bitmapIndex.build(data->graph, data->alphagramIndex);
+    return &data->bitmapIndex;
+}
+
+//---------------------------------------------------------------------------
+//  bitmapSearch
+//
+//! Find the words matching a search spec by combining the bitmap for each
+//! condition.  Words are only looked up once the final set is known.
+//
+//! @param lexicon the name of the lexicon
+//! @param optimizedSpec the search spec, a bitmap search
+//! @return a list of words, in alphabetical order
+//---------------------------------------------------------------------------
+QStringList
+WordEngine::bitmapSearch(const QString& lexicon, const SearchSpec&
+                         optimizedSpec) const
+{
+    const BitmapIndex* index = getBitmapIndex(lexicon);
+    if (!index)
+        return QStringList();
+
+    WordBitmap result;
+    bool first = true;
+    foreach (const SearchCondition& condition, optimizedSpec.conditions) {
+        WordBitmap bitmap = getConditionBitmap(lexicon, index, condition);
+        if (first)
+            result = bitmap;
+        else if (optimizedSpec.conjunction)
+            result &= bitmap;
+        else
+            result |= bitmap;
+        first = false;
+    }
+
+    return index->getWords(result);
+}
+
+//---------------------------------------------------------------------------
+//  getConditionBitmap
+//
+//! Get the set of words matching a search condition from the bitmap index,
+//! or from the attribute store for attributes the index does not hold.
+//! Negated numeric conditions are treated like their positive forms, as
+//! they are by the database.
+//
+//! @param lexicon the name of the lexicon
+//! @param index the bitmap index
+//! @param condition the search condition
+//! @return the set of words
+//---------------------------------------------------------------------------
+WordBitmap
+WordEngine::getConditionBitmap(const QString& lexicon, const BitmapIndex*
+                               index, const SearchCondition& condition) const
+{
+    int numWords = index->getNumWords();
+    switch (condition.type) {
+        case SearchCondition::Length:
+        return index->getRange(BitmapIndex::Length, condition.minValue,
+                               condition.maxValue);
+
+        case SearchCondition::NumVowels:
+        return index->getRange(BitmapIndex::NumVowels, condition.minValue,
+                               condition.maxValue);
+
+        case SearchCondition::NumUniqueLetters:
+        return index->getRange(BitmapIndex::NumUniqueLetters,
+                               condition.minValue, condition.maxValue);
+
+        case SearchCondition::NumAnagrams:
+        return index->getRange(BitmapIndex::NumAnagrams, condition.minValue,
+                               condition.maxValue);
+
+        // Words with each letter at least as many times as it is given, or
+        // if negated, words with none of the letters
+        case SearchCondition::IncludeLetters: {
+            QByteArray letters = condition.stringValue.toUpper().toLatin1();
+            QMap<uchar, int> counts;
+            for (int i = 0; i < letters.length(); ++i)
+                ++counts[uchar(letters.at(i))];
+
+            WordBitmap bitmap (numWords, true);
+            QMapIterator<uchar, int> it (counts);
+            while (it.hasNext()) {
+                it.next();
+                if (condition.negated)
+                    bitmap.subtract(index->getLetters(it.key(), 1));
+                else
+                    bitmap &= index->getLetters(it.key(), it.value());
+            }
+            return bitmap;
+        }
+
+        case SearchCondition::InWordList: {
+            WordBitmap bitmap = index->getWords(
+                condition.stringValue.split(QChar(' ')));
+            if (condition.negated)
+                bitmap.invert();
+            return bitmap;
+        }
+
+        case SearchCondition::BelongToGroup: {
+            SearchSet searchSet =
+                Auxil::stringToSearchSet(condition.stringValue);
+            WordBitmap bitmap (numWords);
+            if ((searchSet == SetFrontHooks) || (searchSet == SetHookWords))
+                bitmap |= index->getFrontHooks();
+            if ((searchSet == SetBackHooks) || (searchSet == SetHookWords))
+                bitmap |= index->getBackHooks();
+            if (condition.negated)
+                bitmap.invert();
+            return bitmap;
+        }
+
+        default: {
+            const AttributeStore& store = lexiconData[lexicon]->attributes;
+            QList<AttributeStore::Attribute> attributes;
+            QList<quint32> minValues;
+            QList<quint32> maxValues;
+            getAttributeRanges(condition, &attributes, &minValues,
+                               &maxValues);
+
+            QVector<int> ids;
+            for (int i = 0; i < attributes.size(); ++i) {
+                if (!i) {
+                    ids = store.select(attributes.at(i), minValues.at(i),
+                                       maxValues.at(i));
+                }
+                else {
+                    store.filter(attributes.at(i), minValues.at(i),
+                                 maxValues.at(i), ids);
+                }
+            }
+
+            WordBitmap bitmap (numWords);
+            bitmap.setBits(ids);
+            return bitmap;
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+//  explainSearch
+//
+//! Describe how a search would be carried out: which index would answer
+//! it, or the order in which its phases would be run, with the estimated
+//! number of words left after each phase.
+//
+//! @param lexicon the name of the lexicon
+//! @param spec the search specification
+//! @return a description of the search plan, one step per line
+//---------------------------------------------------------------------------
+QString
+WordEngine::explainSearch(const QString& lexicon, const SearchSpec& spec)
+    const
+{
+    if (!lexiconData.contains(lexicon))
+        return QString();
+
+    SearchSpec optimizedSpec = spec;
+    optimizedSpec.optimize(lexicon);
+
+    QString anagramLetters;
+    if (isExactAnagramSearch(optimizedSpec, &anagramLetters))
+        return "1. Look up anagrams in alphagram index";
+    if (isBitmapSearch(lexicon, optimizedSpec))
+        return "1. Combine bitmaps from bitmap index";
+
+    QMap<ConditionPhase, int> phaseCounts =
+        getSearchPhases(lexicon, optimizedSpec);
+    return describePlan(planSearch(lexicon, optimizedSpec, phaseCounts));
+}
+
 //---------------------------------------------------------------------------
 //  wordGraphSearch
 //
@@ -902,16 +2207,17 @@ WordEngine::search(const QString& lexicon, const SearchSpec& spec, bool
 //
 //! @param lexicon the name of the lexicon
 //! @param optimizedSpec the search spec
+//! @param stream the stream to receive words, or null
 //! @return a list of words
 //---------------------------------------------------------------------------
 QStringList
 WordEngine::wordGraphSearch(const QString& lexicon, const SearchSpec&
-                            optimizedSpec) const
+                            optimizedSpec, SearchStream* stream) const
 {
     if (!lexiconData.contains(lexicon))
         return QStringList();
 
-    return lexiconData[lexicon]->graph->search(optimizedSpec);
+    return lexiconData[lexicon]->graph->search(optimizedSpec, stream);
 }
 
 //---------------------------------------------------------------------------
@@ -952,20 +2258,33 @@ WordEngine::alphagrams(const QStringList& strList) const
 WordEngine::WordInfo
 WordEngine::getWordInfo(const QString& lexicon, const QString& word) const
 {
-    if (word.isEmpty())
+    if (word.isEmpty() || !lexiconData.contains(lexicon))
         return WordInfo();
 
-    if (!lexiconData.contains(lexicon))
+    const LexiconData* data = lexiconData[lexicon];
+    int wordId = data->graph ? data->graph->getWordId(word) : -1;
+    if (wordId < 0)
         return WordInfo();
 
-    if (lexiconData[lexicon]->wordCache.contains(word)) {
-        //qDebug("Cache HIT: |%s|", word.toUtf8().data());
-        return lexiconData[lexicon]->wordCache[word];
-    }
-    //qDebug("Cache MISS: |%s|", word.toUtf8().data());
-
-    addToCache(lexicon, QStringList(word));
-    return lexiconData[lexicon]->wordCache.value(word);
+    quint64 key = WordInfoCache::getKey(data->id, wordId);
+    CacheShard& shard = getCacheShard(key);
+    WordInfo info;
+    shard.mutex.lock();
+    bool found = shard.cache.find(key, &info);
+    if (found)
+        ++shard.hits;
+    else
+        ++shard.misses;
+    shard.mutex.unlock();
+    if (found)
+        return info;
+
+    // The shard lock is not held while the database is read, so another
+    // thread may evict the word again before it is looked up, and the
+    // information read is returned directly instead
+    QList<WordInfo> infos;
+    readWordInfo(lexicon, QStringList(word), &infos);
+    return infos.isEmpty() ? WordInfo() : infos.first();
 }
 
 //---------------------------------------------------------------------------
@@ -982,7 +2301,7 @@ WordEngine::getNumWords(const QString& lexicon) const
     if (!lexiconData.contains(lexicon))
         return 0;
 
-    QSqlDatabase* db = lexiconData[lexicon]->db;
+    QSqlDatabase* db = getDatabase(lexicon);
     if (db && db->isOpen()) {
         QString qstr = "SELECT count(*) FROM words";
         QSqlQuery query (qstr, *db);
@@ -1058,7 +2377,7 @@ WordEngine::getDefinition(const QString& lexicon, const QString& word,
     QString definition;
     if (info.isValid()) {
         if (replaceLinks) {
-            QStringList defs = info.definition.split(DEF_ORIG_SEP);
+            QStringList defs = info.getDefinition().split(DEF_ORIG_SEP);
             definition = QString();
             foreach (const QString& def, defs) {
                 if (!definition.isEmpty())
@@ -1068,14 +2387,18 @@ WordEngine::getDefinition(const QString& lexicon, const QString& word,
             return definition;
         }
         else {
-            return info.definition;
+            return info.getDefinition();
         }
     }
 
     else {
-        if (!lexiconData[lexicon]->definitions.contains(word))
-            return QString();
-
+        if (!lexiconData[lexicon]->definitions.contains(word)) {
+            definition = getBundleDefinition(lexicon, word);
+            if (replaceLinks)
+                definition.replace(DEF_ORIG_SEP, DEF_DISPLAY_SEP);
+            return definition;
+        }
+
         const QMultiMap<QString, QString>& mmap =
             lexiconData[lexicon]->definitions.value(word);
         QMapIterator<QString, QString> it (mmap);
@@ -1107,11 +2430,16 @@ QString
 WordEngine::getFrontHookLetters(const QString& lexicon, const QString& word)
     const
 {
-    QString ret;
-
     WordInfo info = getWordInfo(lexicon, word);
-    if (info.isValid()) {
-        ret = info.frontHooks;
+    if (info.isValid())
+        return info.getFrontHooks();
+
+    // Look up hooks in the word graph, and only search for them if some are
+    // not letters A-Z
+    QString ret;
+    quint32 hooks = getFrontHooks(lexicon, word);
+    if (!(hooks & WordGraph::OTHER_LETTER_BIT)) {
+        ret = WordGraph::getLetters(hooks);
     }
 
     else {
@@ -1151,11 +2479,16 @@ WordEngine::getFrontHookLetters(const QString& lexicon, const QString& word)
 QString
 WordEngine::getBackHookLetters(const QString& lexicon, const QString& word) const
 {
-    QString ret;
-
     WordInfo info = getWordInfo(lexicon, word);
-    if (info.isValid()) {
-        ret = info.backHooks;
+    if (info.isValid())
+        return info.getBackHooks();
+
+    // Look up hooks in the word graph, and only search for them if some are
+    // not letters A-Z
+    QString ret;
+    quint32 hooks = getBackHooks(lexicon, word);
+    if (!(hooks & WordGraph::OTHER_LETTER_BIT)) {
+        ret = WordGraph::getLetters(hooks);
     }
 
     else {
@@ -1182,10 +2515,58 @@ WordEngine::getBackHookLetters(const QString& lexicon, const QString& word) cons
     return ret;
 }
 
+//---------------------------------------------------------------------------
+//  getFrontHooks
+//
+//! Get the letters that can be added to the front of a word to make other
+//! valid words, looked up in the word graph.
+//
+//! @param lexicon the name of the lexicon
+//! @param word the word, assumed to be upper case
+//! @return a mask with a bit set for each hook letter, as returned by
+//! WordGraph::getLetterBit
+//---------------------------------------------------------------------------
+quint32
+WordEngine::getFrontHooks(const QString& lexicon, const QString& word) const
+{
+    if (!lexiconData.contains(lexicon))
+        return 0;
+
+    quint32 hooks = 0;
+    if (getBundleHooks(lexicon, word, true, &hooks))
+        return hooks;
+    return lexiconData[lexicon]->graph->getFrontHooks(word);
+}
+
+//---------------------------------------------------------------------------
+//  getBackHooks
+//
+//! Get the letters that can be added to the back of a word to make other
+//! valid words, looked up in the word graph.
+//
+//! @param lexicon the name of the lexicon
+//! @param word the word, assumed to be upper case
+//! @return a mask with a bit set for each hook letter, as returned by
+//! WordGraph::getLetterBit
+//---------------------------------------------------------------------------
+quint32
+WordEngine::getBackHooks(const QString& lexicon, const QString& word) const
+{
+    if (!lexiconData.contains(lexicon))
+        return 0;
+
+    quint32 hooks = 0;
+    if (getBundleHooks(lexicon, word, false, &hooks))
+        return hooks;
+    return lexiconData[lexicon]->graph->getBackHooks(word);
+}
+
 //---------------------------------------------------------------------------
 //  addToCache
 //
-//! Add information about a list of words to the cache.
+//! Add information about a list of words to the cache, reading only the
+//! words not already there.  The least recently used words are evicted
+//! if the cache grows past its size limit.
 //
 //! @param lexicon the name of the lexicon
 //! @param words the list of words
@@ -1196,9 +2577,47 @@ WordEngine::addToCache(const QString& lexicon, const QStringList& words) const
     if (words.isEmpty() || !lexiconData.contains(lexicon))
         return;
 
-    LexiconData* lexData = lexiconData[lexicon];
-    QSqlDatabase* db = lexData->db;
-    if (!db || !db->isOpen())
+    const LexiconData* data = lexiconData[lexicon];
+    if (!data->graph)
+        return;
+
+    // Throw out words that are already in the cache
+    QStringList needWords;
+    foreach (const QString& word, words) {
+        int wordId = data->graph->getWordId(word);
+        if (wordId < 0)
+            continue;
+
+        quint64 key = WordInfoCache::getKey(data->id, wordId);
+        CacheShard& shard = getCacheShard(key);
+        QMutexLocker locker (&shard.mutex);
+        if (!shard.cache.contains(key))
+            needWords.append(word);
+    }
+
+    readWordInfo(lexicon, needWords);
+}
+
+//---------------------------------------------------------------------------
+//  readWordInfo
+//
+//! Read information about a list of words from the database into the
+//! cache.
+//
+//! @param lexicon the name of the lexicon
+//! @param words the list of words
+//! @param infos returns the information read, if not null
+//---------------------------------------------------------------------------
+void
+WordEngine::readWordInfo(const QString& lexicon, const QStringList& words,
+                         QList<WordInfo>* infos) const
+{
+    if (words.isEmpty() || !lexiconData.contains(lexicon))
+        return;
+
+    LexiconData* data = lexiconData[lexicon];
+    QSqlDatabase* db = getDatabase(lexicon);
+    if (!db || !db->isOpen() || !data->graph)
         return;
 
     QString qstr = "SELECT word, num_vowels, "
@@ -1209,50 +2628,46 @@ WordEngine::addToCache(const QString& lexicon, const QStringList& words) const
         "probability_order0, min_probability_order0, max_probability_order0, "
         "probability_order1, min_probability_order1, max_probability_order1, "
         "probability_order2, min_probability_order2, max_probability_order2 "
-        "FROM words WHERE words.word";
+        "FROM words";
 
-    // Throw out words that are already in the cache
-    QStringList needWords;
-    foreach (const QString& word, words) {
-        if (lexData->wordCache.contains(word))
-            continue;
-        needWords.append(word);
-    }
-
-    // Construct the where clause from the word list
-    if (needWords.count() == 1) {
-        qstr += "='" + needWords.first() + "'";
+    // Look up a single word directly, and join with a temporary table
+    // holding the words otherwise
+    QTime timer;
+    timer.start();
+    int loadTime = 0;
+    QSqlQuery query (*db);
+    if (words.count() == 1) {
+        query.prepare(qstr + " WHERE word=?");
+        query.addBindValue(words.first().toUpper());
     }
     else {
-        qstr += " IN (";
-        QStringListIterator it (needWords);
-        for (int i = 0; it.hasNext(); ++i) {
-            if (i)
-                qstr += ", ";
-            qstr += "'" + it.next().toUpper() + "'";
-        }
-        qstr += ")";
+        if (!loadWordTable(lexicon, words))
+            return;
+        loadTime = timer.restart();
+        query.prepare(qstr + ", search_words WHERE "
+                      "words.word=search_words.word");
     }
-
-    QSqlQuery query (*db);
-    query.prepare(qstr);
     query.exec();
 
     while (query.next()) {
         int placeNum = 0;
+        QString word = query.value(placeNum++).toString();
+        int wordId = data->graph->getWordId(word);
+        if (wordId < 0)
+            continue;
+
         WordInfo info;
-        info.word                 = query.value(placeNum++).toString();
-        info.numVowels            = query.value(placeNum++).toInt();
-        info.numUniqueLetters     = query.value(placeNum++).toInt();
-        info.numAnagrams          = query.value(placeNum++).toInt();
-        info.pointValue           = query.value(placeNum++).toInt();
-        info.frontHooks           = query.value(placeNum++).toString();
-        info.backHooks            = query.value(placeNum++).toString();
-        info.isFrontHook          = query.value(placeNum++).toBool();
-        info.isBackHook           = query.value(placeNum++).toBool();
-        info.lexiconSymbols       = query.value(placeNum++).toString();
-        info.definition           = query.value(placeNum++).toString();
-        info.playability          = query.value(placeNum++).toLongLong();
+        info.numVowels        = query.value(placeNum++).toInt();
+        info.numUniqueLetters = query.value(placeNum++).toInt();
+        info.numAnagrams      = query.value(placeNum++).toInt();
+        info.pointValue       = query.value(placeNum++).toInt();
+        QByteArray frontHooks = query.value(placeNum++).toString().toUtf8();
+        QByteArray backHooks  = query.value(placeNum++).toString().toUtf8();
+        info.isFrontHook      = query.value(placeNum++).toBool();
+        info.isBackHook       = query.value(placeNum++).toBool();
+        QString symbolStr     = query.value(placeNum++).toString();
+        QByteArray definition = query.value(placeNum++).toString().toUtf8();
+        info.playability      = query.value(placeNum++).toLongLong();
 
         ValueOrder playOrder;
         playOrder.valueOrder    = query.value(placeNum++).toInt();
@@ -1260,16 +2675,46 @@ WordEngine::addToCache(const QString& lexicon, const QStringList& words) const
         playOrder.maxValueOrder = query.value(placeNum++).toInt();
         info.playabilityOrder = playOrder;
 
-        for (int numBlanks = 0; numBlanks <= 2; ++numBlanks) {
+        for (int numBlanks = 0; numBlanks < WordInfo::NUM_PROBABILITY_ORDERS;
+             ++numBlanks)
+        {
             ValueOrder probOrder;
             probOrder.valueOrder    = query.value(placeNum++).toInt();
             probOrder.minValueOrder = query.value(placeNum++).toInt();
             probOrder.maxValueOrder = query.value(placeNum++).toInt();
-            info.blankProbabilityOrder[numBlanks] = probOrder;
+            info.probabilityOrders[numBlanks] = probOrder;
         }
 
-        lexiconData[lexicon]->wordCache[info.word] = info;
+        // Only a few distinct symbol strings occur in a lexicon, so each
+        // is stored once and the words refer to it
+        data->symbolMutex.lock();
+        int symbols = data->symbolStrings.indexOf(symbolStr);
+        if (symbols < 0) {
+            symbols = data->symbolStrings.size();
+            data->symbolStrings.append(symbolStr);
+        }
+        data->symbolMutex.unlock();
+        info.symbols = symbols;
+
+        QByteArray text = word.toUtf8();
+        info.wordLength = text.length();
+        info.frontHooksLength = frontHooks.length();
+        info.backHooksLength = backHooks.length();
+        info.definitionLength = definition.length();
+        info.text = text + frontHooks + backHooks + definition;
+
+        quint64 key = WordInfoCache::getKey(data->id, wordId);
+        CacheShard& shard = getCacheShard(key);
+        shard.mutex.lock();
+        shard.cache.insert(key, info);
+        shard.mutex.unlock();
+
+        if (infos)
+            infos->append(info);
     }
+
+    recordDatabaseQuery((words.count() == 1) ? 0 : words.count(), loadTime,
+                        timer.elapsed());
 }
 
 //---------------------------------------------------------------------------
@@ -1295,7 +2740,7 @@ WordEngine::matchesPostConditions(const QString& lexicon, const QString& word,
     QListIterator<SearchCondition> it (conditions);
     while (it.hasNext()) {
         const SearchCondition& condition = it.next();
-        if (getConditionPhase(condition) != PostConditionPhase)
+        if (getConditionPhase(lexicon, condition) != PostConditionPhase)
             continue;
 
         switch (condition.type) {
@@ -1546,8 +2991,7 @@ WordEngine::getNumAnagrams(const QString& lexicon, const QString& word) const
         return info.numAnagrams;
     }
     else {
-        QString alpha = Auxil::getAlphagram(word);
-        return lexiconData[lexicon]->numAnagramsMap.value(alpha);
+        return lexiconData[lexicon]->alphagramIndex.getNumAnagrams(word);
     }
 }
 
@@ -1650,7 +3094,7 @@ WordEngine::getProbabilityOrder(const QString& lexicon, const QString& word,
 
     WordInfo info = getWordInfo(lexicon, word);
     return info.isValid() ?
-        info.blankProbabilityOrder.value(numBlanks).valueOrder : 0;
+        info.getProbabilityOrder(numBlanks).valueOrder : 0;
 }
 
 //---------------------------------------------------------------------------
@@ -1672,7 +3116,7 @@ WordEngine::getMinProbabilityOrder(const QString& lexicon, const QString&
 
     WordInfo info = getWordInfo(lexicon, word);
     return info.isValid() ?
-        info.blankProbabilityOrder.value(numBlanks).minValueOrder : 0;
+        info.getProbabilityOrder(numBlanks).minValueOrder : 0;
 }
 
 //---------------------------------------------------------------------------
@@ -1694,7 +3138,7 @@ WordEngine::getMaxProbabilityOrder(const QString& lexicon, const QString&
 
     WordInfo info = getWordInfo(lexicon, word);
     return info.isValid() ?
-        info.blankProbabilityOrder.value(numBlanks).maxValueOrder : 0;
+        info.getProbabilityOrder(numBlanks).maxValueOrder : 0;
 }
 
 //---------------------------------------------------------------------------
@@ -1805,7 +3249,12 @@ WordEngine::getLexiconSymbols(const QString& lexicon, const QString& word) const
         return 0;
 
     WordInfo info = getWordInfo(lexicon, word);
-    return info.isValid() ? info.lexiconSymbols : QString();
+    if (!info.isValid())
+        return QString();
+
+    const LexiconData* data = lexiconData[lexicon];
+    QMutexLocker locker (&data->symbolMutex);
+    return data->symbolStrings.value(info.symbols);
 }
 
 //---------------------------------------------------------------------------
@@ -2013,33 +3462,498 @@ WordEngine::addDefinition(const QString& lexicon, const QString& word,
     lexiconData[lexicon]->definitions.insert(word, defMap);
 }
 
+//---------------------------------------------------------------------------
+//  getBundleDefinition
+//
+//! Get the definition of a word from the lexicon bundle a lexicon was
+//! imported from.
+//
+//! @param lexicon the name of the lexicon
+//! @param word the word, assumed to be upper case
+//! @return the definition, with definitions separated by DEF_ORIG_SEP, or
+//! an empty string if there is none
+//---------------------------------------------------------------------------
+QString
+WordEngine::getBundleDefinition(const QString& lexicon, const QString& word)
+    const
+{
+    const LexiconData* data = lexiconData.value(lexicon);
+    if (!data || !data->bundle)
+        return QString();
+
+    QByteArray offsetSection =
+        data->bundle->getSection(LexiconBundle::DefinitionOffsets);
+    QByteArray definitionData =
+        data->bundle->getSection(LexiconBundle::DefinitionData);
+    int id = data->graph->getWordId(word);
+    int numOffsets = offsetSection.size() / int(sizeof(quint32));
+    if ((id < 0) || (id + 1 >= numOffsets))
+        return QString();
+
+    const quint32* offsets = (const quint32*) offsetSection.constData();
+    quint32 start = offsets[id];
+    quint32 end = offsets[id + 1];
+    if ((start > end) || (end > quint32(definitionData.size())))
+        return QString();
+
+    return QString::fromUtf8(definitionData.constData() + start,
+                             end - start);
+}
+
+//---------------------------------------------------------------------------
+//  getBundleHooks
+//
+//! Get the hooks of a word from the lexicon bundle a lexicon was imported
+//! from.  Only the words of the lexicon have their hooks in the bundle.
+//
+//! @param lexicon the name of the lexicon
+//! @param word the word, assumed to be upper case
+//! @param front true for front hooks, false for back hooks
+//! @param hooks returns a mask with a bit set for each hook letter, as
+//! returned by WordGraph::getLetterBit
+//! @return true if the hooks were found, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordEngine::getBundleHooks(const QString& lexicon, const QString& word, bool
+                           front, quint32* hooks) const
+{
+    const LexiconData* data = lexiconData.value(lexicon);
+    if (!data || !data->bundle)
+        return false;
+
+    QByteArray section = data->bundle->getSection(
+        front ? LexiconBundle::FrontHooks : LexiconBundle::BackHooks);
+    int id = data->graph->getWordId(word);
+    if ((id < 0) || (id >= section.size() / int(sizeof(quint32))))
+        return false;
+
+    *hooks = ((const quint32*) section.constData())[id];
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  getSearchPhases
+//
+//! Count the conditions of a search checked by each phase, leaving out the
+//! attribute and database phases when they would only check conditions
+//! the word graph already checks.
+//
+//! @param lexicon the name of the lexicon
+//! @param optimizedSpec the search specification, already optimized
+//! @return the number of conditions checked by each phase
+//---------------------------------------------------------------------------
+QMap<WordEngine::ConditionPhase, int>
+WordEngine::getSearchPhases(const QString& lexicon, const SearchSpec&
+                            optimizedSpec) const
+{
+    QMap<ConditionPhase, int> phaseCounts;
+    QMap<ConditionPhase, int> graphCounts;
+    QListIterator<SearchCondition> cit (optimizedSpec.conditions);
+    while (cit.hasNext()) {
+        SearchCondition condition = cit.next();
+        ConditionPhase phase = getConditionPhase(lexicon, condition);
+        ++phaseCounts[phase];
+        if ((condition.type == SearchCondition::Length) ||
+            (condition.type == SearchCondition::IncludeLetters))
+        {
+            ++graphCounts[phase];
+        }
+    }
+
+    // Length and Include Letters conditions are checked by the word graph,
+    // which also uses them to prune its traversal, so do not check the
+    // attribute store or search the database if they are the only
+    // conditions for that phase.  That is only safe if the word graph is
+    // searched: either it has conditions of its own, or every attribute
+    // and database phase is removed, so the graph is searched by default.
+    QList<ConditionPhase> graphOnlyPhases;
+    bool otherPhases = false;
+    QMapIterator<ConditionPhase, int> pit (phaseCounts);
+    while (pit.hasNext()) {
+        pit.next();
+        if (pit.value() == graphCounts.value(pit.key()))
+            graphOnlyPhases.append(pit.key());
+        else if ((pit.key() == AttributePhase) ||
+                 (pit.key() == DatabasePhase))
+        {
+            otherPhases = true;
+        }
+    }
+
+    if (phaseCounts.contains(WordGraphPhase) || !otherPhases) {
+        foreach (ConditionPhase phase, graphOnlyPhases)
+            phaseCounts.remove(phase);
+    }
+
+    return phaseCounts;
+}
+
+//---------------------------------------------------------------------------
+//  planSearch
+//
+//! Choose the order in which to run the phases of a search.  By default
+//! the word graph is searched first if it is needed, then the attribute
+//! store is checked, then the database is searched.  If statistics have
+//! been gathered for the lexicon, the cost of every order is estimated, so
+//! that a selective attribute or database phase can run first and pass a
+//! short list of words to the others.
+//
+//! @param lexicon the name of the lexicon
+//! @param optimizedSpec the search specification, already optimized
+//! @param phaseCounts the number of conditions checked by each phase
+//! @return the search plan
+//---------------------------------------------------------------------------
+WordEngine::SearchPlan
+WordEngine::planSearch(const QString& lexicon, const SearchSpec&
+                       optimizedSpec, const QMap<ConditionPhase, int>&
+                       phaseCounts) const
+{
+    SearchPlan plan;
+    plan.postConditions = phaseCounts.value(PostConditionPhase);
+
+    bool attributePhase = phaseCounts.value(AttributePhase);
+    bool databasePhase = phaseCounts.value(DatabasePhase);
+    if (phaseCounts.value(WordGraphPhase) || (!attributePhase &&
+                                              !databasePhase))
+    {
+        plan.phases.append(WordGraphPhase);
+    }
+    if (attributePhase)
+        plan.phases.append(AttributePhase);
+    if (databasePhase)
+        plan.phases.append(DatabasePhase);
+
+    const LexiconStats& stats = lexiconData[lexicon]->stats;
+    if (stats.isEmpty())
+        return plan;
+
+    // Gather the length limits, the attribute ranges, and the guessed
+    // fractions of words kept by the other conditions
+    int minLength = 0;
+    int maxLength = MAX_WORD_LEN;
+    QList<AttributeStore::Attribute> attributes;
+    QList<quint32> minValues;
+    QList<quint32> maxValues;
+    double graphFraction = phaseCounts.value(WordGraphPhase)
+        ? GRAPH_MATCH_FRACTION : 1;
+    double databaseFraction = 1;
+    foreach (const SearchCondition& condition, optimizedSpec.conditions) {
+        ConditionPhase phase = getConditionPhase(lexicon, condition);
+        if (condition.type == SearchCondition::Length) {
+            minLength = qMax(minLength, condition.minValue);
+            maxLength = qMin(maxLength, condition.maxValue);
+        }
+        else if (condition.type == SearchCondition::IncludeLetters)
+            graphFraction *= estimateDatabaseFraction(lexicon, condition);
+
+        if (phase == AttributePhase) {
+            getAttributeRanges(condition, &attributes, &minValues,
+                               &maxValues);
+        }
+        else if (phase == DatabasePhase)
+            databaseFraction *= estimateDatabaseFraction(lexicon, condition);
+    }
+
+    double numWords = stats.getNumWords(minLength, maxLength);
+    double totalWords = stats.getNumWords();
+    if (!numWords)
+        return plan;
+
+    QMap<ConditionPhase, PhaseEstimate> estimates;
+    plan.graphVisits = estimateGraphVisits(optimizedSpec, numWords);
+    PhaseEstimate& graph = estimates[WordGraphPhase];
+    graph.fraction = graphFraction * plan.graphVisits / numWords;
+    graph.fullCost = plan.graphVisits * GRAPH_VISIT_COST;
+    graph.wordCost = GRAPH_CHECK_COST;
+
+    PhaseEstimate& attribute = estimates[AttributePhase];
+    attribute.fraction = stats.estimate(minLength, maxLength, attributes,
+                                        minValues, maxValues) / numWords;
+    attribute.wordCost = ATTRIBUTE_WORD_COST +
+        ATTRIBUTE_SCAN_COST * attributes.size();
+    attribute.fullCost = totalWords * ATTRIBUTE_SCAN_COST *
+        attributes.size() + attribute.fraction * numWords *
+        ATTRIBUTE_WORD_COST;
+
+    PhaseEstimate& database = estimates[DatabasePhase];
+    database.fraction = databaseFraction;
+    database.fixedCost = DATABASE_QUERY_COST;
+    database.wordCost = DATABASE_WORD_COST;
+    database.fullCost = DATABASE_QUERY_COST + totalWords *
+        DATABASE_SCAN_COST;
+
+    plan.estimated = true;
+    plan.defaultCost = estimatePlanCost(plan.phases, estimates, numWords,
+                                        &plan.estimates);
+    plan.cost = plan.defaultCost;
+
+    // Phases can only be reordered if each one narrows the results of the
+    // ones before it.  The default order is sorted, so every other order
+    // is a later permutation.
+    if (!optimizedSpec.conjunction)
+        return plan;
+
+    QList<ConditionPhase> phases = plan.phases;
+    while (std::next_permutation(phases.begin(), phases.end())) {
+        QList<double> phaseEstimates;
+        double cost = estimatePlanCost(phases, estimates, numWords,
+                                       &phaseEstimates);
+        if ((cost < plan.cost) && (cost < plan.defaultCost * PLAN_MARGIN)) {
+            plan.phases = phases;
+            plan.estimates = phaseEstimates;
+            plan.cost = cost;
+        }
+    }
+
+    return plan;
+}
+
+//---------------------------------------------------------------------------
+//  estimatePlanCost
+//
+//! Estimate the cost of running the phases of a search in an order.
+//
+//! @param phases the phases, in order
+//! @param phaseEstimates the estimates for each phase
+//! @param numWords the number of words of the lengths searched for
+//! @param estimates returns the estimated number of words left after each
+//! phase
+//! @return the estimated cost
+//---------------------------------------------------------------------------
+double
+WordEngine::estimatePlanCost(const QList<ConditionPhase>& phases, const
+                             QMap<ConditionPhase, PhaseEstimate>&
+                             phaseEstimates, double numWords, QList<double>*
+                             estimates) const
+{
+    double cost = 0;
+    double words = numWords;
+    for (int i = 0; i < phases.size(); ++i) {
+        PhaseEstimate estimate = phaseEstimates.value(phases.at(i));
+        if (i)
+            cost += estimate.fixedCost + words * estimate.wordCost;
+        else
+            cost += estimate.fullCost;
+        words *= estimate.fraction;
+        if (estimates)
+            estimates->append(words);
+    }
+    return cost;
+}
+
+//---------------------------------------------------------------------------
+//  estimateGraphVisits
+//
+//! Estimate the number of words visited while walking the word graph for a
+//! search.  Literal letters in a pattern lead straight to the words
+//! containing them, and the letters of a rack without wildcards allow
+//! only a few paths to be followed.
+//
+//! @param optimizedSpec the search specification, already optimized
+//! @param numWords the number of words of the lengths searched for
+//! @return the estimated number of words visited
+//---------------------------------------------------------------------------
+double
+WordEngine::estimateGraphVisits(const SearchSpec& optimizedSpec, double
+                                numWords) const
+{
+    double visits = numWords;
+    foreach (const SearchCondition& condition, optimizedSpec.conditions) {
+        if (condition.negated)
+            continue;
+
+        const QString& value = condition.stringValue;
+        switch (condition.type) {
+            case SearchCondition::PatternMatch: {
+                int run = 0;
+                int longestRun = 0;
+                bool inClass = false;
+                for (int i = 0; i < value.length(); ++i) {
+                    QChar c = value.at(i);
+                    if (c == '[')
+                        inClass = true;
+                    else if (c == ']')
+                        inClass = false;
+                    if (!inClass && c.isLetter())
+                        longestRun = qMax(longestRun, ++run);
+                    else
+                        run = 0;
+                }
+                double patternVisits = numWords;
+                for (int i = 0; i < longestRun; ++i)
+                    patternVisits *= LITERAL_FRACTION;
+                visits = qMin(visits, patternVisits);
+            }
+            break;
+
+            case SearchCondition::AnagramMatch:
+            case SearchCondition::SubanagramMatch: {
+                if (value.contains("*"))
+                    break;
+                double rackVisits = RACK_VISITS;
+                int numWildcards = value.count("?") + value.count("[");
+                for (int i = 0; i < numWildcards; ++i)
+                    rackVisits *= 26;
+                visits = qMin(visits, rackVisits);
+            }
+            break;
+
+            default:
+            break;
+        }
+    }
+    return visits;
+}
+
+//---------------------------------------------------------------------------
+//  estimateDatabaseFraction
+//
+//! Guess the fraction of words kept by a condition for which no statistics
+//! are gathered.
+//
+//! @param lexicon the name of the lexicon
+//! @param condition the search condition
+//! @return the estimated fraction of words kept
+//---------------------------------------------------------------------------
+double
+WordEngine::estimateDatabaseFraction(const QString& lexicon, const
+                                     SearchCondition& condition) const
+{
+    double fraction = DATABASE_FRACTION;
+    switch (condition.type) {
+        case SearchCondition::InWordList: {
+            int numWords = lexiconData[lexicon]->stats.getNumWords();
+            int numListWords = condition.stringValue.split(QChar(' '),
+                QString::SkipEmptyParts).size();
+            if (numWords)
+                fraction = qMin(1.0, double(numListWords) / numWords);
+        }
+        break;
+
+        case SearchCondition::IncludeLetters:
+        fraction = 1;
+        for (int i = 0; i < condition.stringValue.length(); ++i)
+            fraction *= INCLUDE_LETTER_FRACTION;
+        break;
+
+        case SearchCondition::PartOfSpeech:
+        fraction = PART_OF_SPEECH_FRACTION;
+        break;
+
+        case SearchCondition::Definition:
+        fraction = DEFINITION_FRACTION;
+        break;
+
+        case SearchCondition::BelongToGroup:
+        fraction = HOOK_FRACTION;
+        break;
+
+        default:
+        break;
+    }
+
+    return condition.negated ? (1 - fraction) : fraction;
+}
+
+//---------------------------------------------------------------------------
+//  describePlan
+//
+//! Describe a search plan, one phase per line, followed by its estimated
+//! cost.
+//
+//! @param plan the search plan
+//! @return the description
+//---------------------------------------------------------------------------
+QString
+WordEngine::describePlan(const SearchPlan& plan) const
+{
+    QStringList lines;
+    for (int i = 0; i < plan.phases.size(); ++i) {
+        QString line = QString::number(i + 1) + ". ";
+        switch (plan.phases.at(i)) {
+            case WordGraphPhase:
+            line += i ? "Check words against word graph"
+                      : "Search word graph";
+            break;
+
+            case AttributePhase:
+            line += i ? "Check words against attribute store"
+                      : "Select words from attribute store";
+            break;
+
+            case DatabasePhase:
+            line += i ? "Check words against database" : "Search database";
+            break;
+
+            default:
+            break;
+        }
+
+        if (plan.estimated) {
+            if (!i && (plan.phases.at(i) == WordGraphPhase)) {
+                line += ", visiting ~" +
+                    QString::number(plan.graphVisits, 'f', 0) + " words";
+            }
+            line += ": ~" + QString::number(plan.estimates.at(i), 'f', 0) +
+                " words";
+        }
+        lines.append(line);
+    }
+
+    if (plan.postConditions) {
+        lines.append(QString::number(plan.phases.size() + 1) +
+                     ". Apply post conditions");
+    }
+
+    if (plan.estimated) {
+        lines.append("Estimated cost " + QString::number(plan.cost, 'f', 0) +
+                     ", default order " +
+                     QString::number(plan.defaultCost, 'f', 0));
+    }
+    else
+        lines.append("Default order, no lexicon statistics");
+
+    return lines.join("\n");
+}
+
 //---------------------------------------------------------------------------
 //  getConditionPhase
 //
 //! Determine the search phase during which a search condition should be
-//! considered.
+//! considered.  Numeric conditions are checked against the attribute store
+//! if it is loaded, and otherwise by the database.
 //
+//! @param lexicon the name of the lexicon
 //! @param condition the search condition
 //! @return the appropriate search phase
 //---------------------------------------------------------------------------
 WordEngine::ConditionPhase
-WordEngine::getConditionPhase(const SearchCondition& condition) const
+WordEngine::getConditionPhase(const QString& lexicon, const SearchCondition&
+                              condition) const
 {
     switch (condition.type) {
+        case SearchCondition::PatternMatch:
         case SearchCondition::AnagramMatch:
         case SearchCondition::SubanagramMatch:
         case SearchCondition::ConsistOf:
         return WordGraphPhase;
 
         case SearchCondition::Length:
-        case SearchCondition::InWordList:
         case SearchCondition::NumVowels:
-        case SearchCondition::IncludeLetters:
         case SearchCondition::ProbabilityOrder:
         case SearchCondition::PlayabilityOrder:
         case SearchCondition::NumUniqueLetters:
         case SearchCondition::PointValue:
         case SearchCondition::NumAnagrams:
+        if (lexiconData.contains(lexicon) &&
+            !lexiconData[lexicon]->attributes.isEmpty())
+        {
+            return AttributePhase;
+        }
+        return DatabasePhase;
+
+        case SearchCondition::InWordList:
+        case SearchCondition::IncludeLetters:
         case SearchCondition::PartOfSpeech:
         case SearchCondition::Definition:
         return DatabasePhase;
@@ -2051,16 +3965,6 @@ WordEngine::getConditionPhase(const SearchCondition& condition) const
         case SearchCondition::LimitByPlayabilityOrder:
         return PostConditionPhase;
 
-        case SearchCondition::PatternMatch:
-        if (condition.stringValue.startsWith("*") &&
-            condition.stringValue.endsWith("*") &&
-            !condition.stringValue.contains("["))
-        {
-            return DatabasePhase;
-        }
-        else
-            return WordGraphPhase;
-
         case SearchCondition::BelongToGroup: {
             SearchSet searchSet =
                 Auxil::stringToSearchSet(condition.stringValue);
@@ -2077,3 +3981,259 @@ WordEngine::getConditionPhase(const SearchCondition& condition) const
         return UnknownPhase;
     }
 }
+
+//---------------------------------------------------------------------------
+//  WordInfoCache
+//
+//! Constructor.
+//---------------------------------------------------------------------------
+WordEngine::WordInfoCache::WordInfoCache()
+    : garbage(0), first(-1), last(-1), maxBytes(0)
+{
+}
+
+//---------------------------------------------------------------------------
+//  clear
+//
+//! Remove every word from the cache and release its memory.
+//---------------------------------------------------------------------------
+void
+WordEngine::WordInfoCache::clear()
+{
+    entries = QVector<Entry>();
+    freeEntries = QVector<int>();
+    index = QHash<quint64, int>();
+    arena = QByteArray();
+    garbage = 0;
+    first = -1;
+    last = -1;
+}
+
+//---------------------------------------------------------------------------
+//  remove
+//
+//! Remove the words of a lexicon from the cache.
+//
+//! @param lexiconId the number of the lexicon
+//---------------------------------------------------------------------------
+void
+WordEngine::WordInfoCache::remove(int lexiconId)
+{
+    int entry = first;
+    while (entry >= 0) {
+        int next = entries.at(entry).next;
+        if (int(entries.at(entry).key >> 32) == lexiconId)
+            evict(entry);
+        entry = next;
+    }
+
+    if (index.isEmpty())
+        clear();
+    else if (garbage > arena.size() / 2)
+        compact();
+}
+
+//---------------------------------------------------------------------------
+//  setMaxBytes
+//
+//! Set the amount of memory the cache may use, evicting the least recently
+//! used words if it already uses more.
+//
+//! @param bytes the size limit in bytes
+//---------------------------------------------------------------------------
+void
+WordEngine::WordInfoCache::setMaxBytes(qint64 bytes)
+{
+    maxBytes = bytes;
+    evictToLimit();
+}
+
+//---------------------------------------------------------------------------
+//  getMemoryUsage
+//
+//! Get the amount of memory used by the cache, including space left by
+//! evicted words that has not yet been reused.
+//
+//! @return the number of bytes used
+//---------------------------------------------------------------------------
+qint64
+WordEngine::WordInfoCache::getMemoryUsage() const
+{
+    return qint64(entries.capacity()) * sizeof(Entry) +
+        qint64(freeEntries.capacity()) * sizeof(int) +
+        qint64(index.capacity()) * sizeof(void*) +
+        qint64(index.size()) * CACHE_INDEX_NODE_SIZE + arena.capacity();
+}
+
+//---------------------------------------------------------------------------
+//  find
+//
+//! Find a word in the cache, making it the most recently used word.
+//
+//! @param key the key of the word
+//! @param info returns a copy of the word information, with its own text
+//! @return true if the word is in the cache, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordEngine::WordInfoCache::find(quint64 key, WordInfo* info)
+{
+    QHash<quint64, int>::const_iterator it = index.constFind(key);
+    if (it == index.constEnd())
+        return false;
+
+    int entry = it.value();
+    if (entry != first) {
+        unlink(entry);
+        linkFirst(entry);
+    }
+
+    const WordInfo& cached = entries.at(entry).info;
+    *info = cached;
+    info->text = QByteArray(arena.constData() + cached.textOffset,
+                            getTextLength(cached));
+    info->textOffset = 0;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  insert
+//
+//! Add a word to the cache as the most recently used word, replacing any
+//! information already held for it.
+//
+//! @param key the key of the word
+//! @param info the word information, with its text
+//---------------------------------------------------------------------------
+void
+WordEngine::WordInfoCache::insert(quint64 key, const WordInfo& info)
+{
+    QHash<quint64, int>::const_iterator it = index.constFind(key);
+    if (it != index.constEnd())
+        evict(it.value());
+
+    int entry = entries.size();
+    if (freeEntries.isEmpty())
+        entries.append(Entry());
+    else {
+        entry = freeEntries.last();
+        freeEntries.pop_back();
+    }
+
+    // The text is moved to the arena, so the entry holds no text of its
+    // own
+    Entry& newEntry = entries[entry];
+    newEntry.info = info;
+    newEntry.info.text = QByteArray();
+    newEntry.info.textOffset = arena.size();
+    newEntry.key = key;
+    arena.append(info.text);
+    index.insert(key, entry);
+    linkFirst(entry);
+
+    evictToLimit();
+}
+
+//---------------------------------------------------------------------------
+//  unlink
+//
+//! Remove an entry from the list of entries in order of use.
+//
+//! @param entry the entry
+//---------------------------------------------------------------------------
+void
+WordEngine::WordInfoCache::unlink(int entry)
+{
+    Entry& e = entries[entry];
+    if (e.prev >= 0)
+        entries[e.prev].next = e.next;
+    else
+        first = e.next;
+    if (e.next >= 0)
+        entries[e.next].prev = e.prev;
+    else
+        last = e.prev;
+    e.prev = -1;
+    e.next = -1;
+}
+
+//---------------------------------------------------------------------------
+//  linkFirst
+//
+//! Add an entry to the front of the list of entries in order of use.
+//
+//! @param entry the entry
+//---------------------------------------------------------------------------
+void
+WordEngine::WordInfoCache::linkFirst(int entry)
+{
+    Entry& e = entries[entry];
+    e.prev = -1;
+    e.next = first;
+    if (first >= 0)
+        entries[first].prev = entry;
+    else
+        last = entry;
+    first = entry;
+}
+
+//---------------------------------------------------------------------------
+//  evict
+//
+//! Remove an entry from the cache, leaving its text in the arena until the
+//! arena is next compacted.
+//
+//! @param entry the entry
+//---------------------------------------------------------------------------
+void
+WordEngine::WordInfoCache::evict(int entry)
+{
+    unlink(entry);
+    Entry& e = entries[entry];
+    index.remove(e.key);
+    garbage += getTextLength(e.info);
+    e.info = WordInfo();
+    freeEntries.append(entry);
+}
+
+//---------------------------------------------------------------------------
+//  evictToLimit
+//
+//! Evict the least recently used words until the words left fit within the
+//! size limit, always keeping the most recently used word, and compact the
+//! arena if most of it is no longer used.
+//---------------------------------------------------------------------------
+void
+WordEngine::WordInfoCache::evictToLimit()
+{
+    qint64 entryBytes = sizeof(Entry) + CACHE_INDEX_NODE_SIZE;
+    while ((last != first) && (index.size() * entryBytes + arena.size() -
+                               garbage > maxBytes))
+    {
+        evict(last);
+    }
+
+    if (garbage > arena.size() / 2)
+        compact();
+}
+
+//---------------------------------------------------------------------------
+//  compact
+//
+//! Copy the text of the words in the cache to a new arena, dropping the
+//! text of evicted words.
+//---------------------------------------------------------------------------
+void
+WordEngine::WordInfoCache::compact()
+{
+    QByteArray compacted;
+    compacted.reserve(arena.size() - garbage);
+    for (int entry = first; entry >= 0; entry = entries.at(entry).next) {
+        WordInfo& info = entries[entry].info;
+        int offset = compacted.size();
+        compacted.append(arena.constData() + info.textOffset,
+                         getTextLength(info));
+        info.textOffset = offset;
+    }
+    arena = compacted;
+    garbage = 0;
+}
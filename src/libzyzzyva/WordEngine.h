@@ -25,21 +25,42 @@
 #ifndef ZYZZYVA_WORD_ENGINE_H
 #define ZYZZYVA_WORD_ENGINE_H
 
+#include "AlphagramIndex.h"
+#include "AttributeStore.h"
+#include "BitmapIndex.h"
+#include "LexiconBundle.h"
+#include "LexiconStats.h"
 #include "WordGraph.h"
+#include <QByteArray>
+#include <QHash>
 #include <QMap>
 #include <QMultiMap>
+#include <QMutex>
+#include <QPair>
 #include <QSet>
 #include <QString>
 #include <QStringList>
+#include <QThreadStorage>
+#include <QVector>
 #include <QSqlDatabase>
 #include <stdint.h>
 
+class QSqlQuery;
+class SearchStream;
+
+// Lexicon data is only changed while a lexicon is loaded, imported or
+// connected to its database, and must not be read by other threads while
+// that happens.  Once loaded, the const methods may be called from any
+// number of threads at once: the word information cache is locked shard by
+// shard, and each thread reads the database through a connection of its
+// own.
 class WordEngine : public QObject
 {
     Q_OBJECT
     public:
     static const QString DEF_ORIG_SEP;
     static const QString DEF_DISPLAY_SEP;
+    static const int DEFAULT_CACHE_SIZE = 16;
 
     class ValueOrder {
         public:
@@ -50,52 +71,122 @@ class WordEngine : public QObject
         int maxValueOrder;
     };
 
+    // Information about a word in a fixed layout.  The word, its hooks and
+    // its definition are held as UTF-8 text, and the lexicon symbols as an
+    // index into a table of the distinct symbol strings of the lexicon.  In
+    // the word information cache the text is held in an arena shared by
+    // every cached word; a copy handed out by the cache has its own text.
     class WordInfo {
         public:
-        WordInfo() : numVowels(0), numUniqueLetters(0), numAnagrams(0),
-            pointValue(0) { }
-        ~WordInfo() { }
+        static const int NUM_PROBABILITY_ORDERS = 3;
+
+        WordInfo() : textOffset(0), definitionLength(0),
+            frontHooksLength(0), backHooksLength(0), wordLength(0),
+            numVowels(0), numUniqueLetters(0), numAnagrams(0),
+            pointValue(0), isFrontHook(false), isBackHook(false),
+            symbols(0), playability(0) { }
 
-        bool isValid() const { return !word.isEmpty(); }
+        bool isValid() const { return wordLength; }
+        QString getWord() const { return getText(0, wordLength); }
+        QString getFrontHooks() const {
+            return getText(wordLength, frontHooksLength); }
+        QString getBackHooks() const {
+            return getText(wordLength + frontHooksLength, backHooksLength); }
+        QString getDefinition() const {
+            return getText(wordLength + frontHooksLength + backHooksLength,
+                           definitionLength); }
+        ValueOrder getProbabilityOrder(int numBlanks) const {
+            return ((numBlanks >= 0) && (numBlanks < NUM_PROBABILITY_ORDERS))
+                ? probabilityOrders[numBlanks] : ValueOrder(); }
+
+        private:
+        QString getText(int start, int length) const {
+            return length ? QString::fromUtf8(text.constData() + start,
+                                              length) : QString(); }
 
         public:
-        QString word;
-        int numVowels;
-        int numUniqueLetters;
-        int numAnagrams;
-        int pointValue;
-        QString frontHooks;
-        QString backHooks;
+        QByteArray text;
+        quint32 textOffset;
+        quint32 definitionLength;
+        quint16 frontHooksLength;
+        quint16 backHooksLength;
+        quint8 wordLength;
+        quint8 numVowels;
+        quint8 numUniqueLetters;
+        quint8 numAnagrams;
+        quint8 pointValue;
         bool isFrontHook;
         bool isBackHook;
-        QString lexiconSymbols;
-        QString definition;
+        quint16 symbols;
         qint64 playability;
         ValueOrder playabilityOrder;
-        QMap<int, ValueOrder> blankProbabilityOrder;
+        ValueOrder probabilityOrders[NUM_PROBABILITY_ORDERS];
     };
 
+    // A connection to a lexicon database for the use of one thread, with
+    // the prepared statement for loading its temporary word table
+    class DatabaseConnection {
+        public:
+        DatabaseConnection() : db(0), wordTableInsert(0) { }
+        ~DatabaseConnection();
+
+        public:
+        QSqlDatabase* db;
+        QString name;
+        QSqlQuery* wordTableInsert;
+    };
+
+    class ThreadConnections;
+
     class LexiconData {
         public:
-        LexiconData() : graph(0), db(0) { }
+        LexiconData() : id(0), graph(0), db(0), bundle(0) { }
 
         public:
+        int id;
         QString name;
         QString lexiconFile;
         QMap<QString, QMultiMap<QString, QString> > definitions;
         QMap<int, QStringList> stems;
-        QMap<QString, int> numAnagramsMap;
+        AlphagramIndex alphagramIndex;
+        AttributeStore attributes;
+        LexiconStats stats;
+        mutable BitmapIndex bitmapIndex;
+        mutable QMutex bitmapMutex;
+        mutable QStringList symbolStrings;
+        mutable QMutex symbolMutex;
         QMap<QString, qint64> playabilityMap;
         QMap<int, QSet<QString> > stemAlphagrams;
-        mutable QMap<QString, WordInfo> wordCache;
         WordGraph* graph;
         QSqlDatabase* db;
         QString dbConnectionName;
+
+        // Connections to the database, keyed by the connections of the
+        // thread using them
+        mutable QHash<const ThreadConnections*, DatabaseConnection*>
+            connections;
+        mutable QMutex connectionMutex;
+
+        // The bundle the lexicon was loaded from, if any, and the files it
+        // was built from
+        LexiconBundle* bundle;
+        QStringList bundleSources;
+    };
+
+    // The lexicons a thread has opened database connections to.  A
+    // connection may only be used by the thread that opened it, so the
+    // connections are closed when the thread finishes.
+    class ThreadConnections {
+        public:
+        ~ThreadConnections();
+
+        public:
+        QSet<LexiconData*> lexicons;
     };
 
     public:
-    WordEngine(QObject* parent = 0)
-        : QObject(parent) { }
+    WordEngine(QObject* parent = 0) : QObject(parent) {
+        setCacheSize(DEFAULT_CACHE_SIZE); }
     ~WordEngine() { }
 
     bool connectToDatabase(const QString& lexicon, const QString& filename,
@@ -107,14 +198,26 @@ class WordEngine : public QObject
     bool importDawgFile(const QString& lexicon, const QString& filename, bool
                         reverse = false, QString* errString = 0, quint16*
                         expectedChecksum = 0);
+    bool importBundle(const QString& lexicon, const QString& filename,
+                      const QStringList& sources, QString* errString = 0);
+    bool writeBundle(const QString& lexicon, const QString& filename,
+                     const QStringList& sources, QString* errString = 0)
+        const;
+    bool bundleIsCurrent(const QString& lexicon, const QStringList& sources)
+        const;
+    bool verifyChecksums(const QString& lexicon, QString* errString = 0);
     int importStems(const QString& lexicon, const QString& filename,
                     QString* errString = 0);
     bool lexiconIsLoaded(const QString& lexicon) const;
     bool isAcceptable(const QString& lexicon, const QString& word) const;
+    int getWordId(const QString& lexicon, const QString& word) const;
+    QString getWordAt(const QString& lexicon, int id) const;
     QStringList search(const QString& lexicon, const SearchSpec& spec,
-                       bool allCaps) const;
+                       bool allCaps, SearchStream* stream = 0) const;
+    QString explainSearch(const QString& lexicon, const SearchSpec& spec)
+        const;
     QStringList wordGraphSearch(const QString& lexicon, const SearchSpec&
-                                spec) const;
+                                spec, SearchStream* stream = 0) const;
     QStringList alphagrams(const QStringList& strList) const;
     int getNumWords(const QString& lexicon) const;
     QString getLexiconFile(const QString& lexicon) const;
@@ -125,6 +228,9 @@ class WordEngine : public QObject
         const;
     QString getBackHookLetters(const QString& lexicon, const QString& word)
         const;
+    quint32 getFrontHooks(const QString& lexicon, const QString& word)
+        const;
+    quint32 getBackHooks(const QString& lexicon, const QString& word) const;
     qint64 getPlayabilityValue(const QString& lexicon, const QString& word)
         const;
     int getPlayabilityOrder(const QString& lexicon, const QString& word)
@@ -149,17 +255,176 @@ class WordEngine : public QObject
     QString getLexiconSymbols(const QString& lexicon, const QString& word) const;
 
     void addToCache(const QString& lexicon, const QStringList& words) const;
+    void setCacheSize(int megabytes);
+    int getCacheSize() const;
+    qint64 getCacheHits() const;
+    qint64 getCacheMisses() const;
+    qint64 getCacheMemoryUsage() const;
+    qint64 getDatabaseQueries() const;
+    qint64 getDatabaseLoadTime() const;
+    qint64 getDatabaseQueryTime() const;
+    QString getPerformanceReport() const;
 
     private:
     enum ConditionPhase {
         UnknownPhase = 0,
         WordGraphPhase,
+        AttributePhase,
         DatabasePhase,
         PostConditionPhase
     };
 
+    // The order in which the phases of a search are run, with the estimated
+    // number of words left after each phase.  A phase after the first is
+    // given the words left by the phases before it.
+    class SearchPlan {
+        public:
+        SearchPlan() : estimated(false), postConditions(false),
+            graphVisits(0), cost(0), defaultCost(0) { }
+
+        public:
+        QList<ConditionPhase> phases;
+        QList<double> estimates;
+        bool estimated;
+        bool postConditions;
+        double graphVisits;
+        double cost;
+        double defaultCost;
+    };
+
+    // A least recently used cache of word information.  The records are
+    // held in entries linked in order of use, and their text is appended to
+    // one arena, which is compacted once most of it belongs to evicted
+    // words.  The memory limit covers the entries, the index and the arena,
+    // but the most recently added word is always kept.
+    class WordInfoCache {
+        public:
+        WordInfoCache();
+
+        void clear();
+        void remove(int lexiconId);
+        void setMaxBytes(qint64 bytes);
+        qint64 getMaxBytes() const { return maxBytes; }
+        qint64 getMemoryUsage() const;
+        bool contains(quint64 key) const { return index.contains(key); }
+        bool find(quint64 key, WordInfo* info);
+        void insert(quint64 key, const WordInfo& info);
+
+        static quint64 getKey(int lexiconId, int wordId) {
+            return (quint64(lexiconId) << 32) | quint32(wordId); }
+
+        private:
+        class Entry {
+            public:
+            Entry() : key(0), prev(-1), next(-1) { }
+
+            public:
+            WordInfo info;
+            quint64 key;
+            int prev;
+            int next;
+        };
+
+        int getTextLength(const WordInfo& info) const {
+            return info.wordLength + info.frontHooksLength +
+                info.backHooksLength + info.definitionLength; }
+        void unlink(int entry);
+        void linkFirst(int entry);
+        void evict(int entry);
+        void evictToLimit();
+        void compact();
+
+        QVector<Entry> entries;
+        QVector<int> freeEntries;
+        QHash<quint64, int> index;
+        QByteArray arena;
+        int garbage;
+        int first;
+        int last;
+        qint64 maxBytes;
+    };
+
+    // One of the independently locked parts of the word information cache
+    class CacheShard {
+        public:
+        CacheShard() : hits(0), misses(0) { }
+
+        public:
+        WordInfoCache cache;
+        QMutex mutex;
+        qint64 hits;
+        qint64 misses;
+    };
+
+    // Totals of the time spent querying lexicon databases, added to by
+    // every call that queries one
+    class DatabaseStats {
+        public:
+        DatabaseStats() : numQueries(0), numWords(0), loadTime(0),
+            queryTime(0) { }
+
+        public:
+        QMutex mutex;
+        qint64 numQueries;
+        qint64 numWords;
+        qint64 loadTime;
+        qint64 queryTime;
+    };
+
+    // The fraction of words a search phase keeps, the cost of running it
+    // first, and the cost of running it on a list of words
+    class PhaseEstimate {
+        public:
+        PhaseEstimate() : fraction(1), fullCost(0), fixedCost(0),
+            wordCost(0) { }
+
+        public:
+        double fraction;
+        double fullCost;
+        double fixedCost;
+        double wordCost;
+    };
+
     private:
     void clearCache(const QString& lexicon) const;
+    void readWordInfo(const QString& lexicon, const QStringList& words,
+                      QList<WordInfo>* infos = 0) const;
+    DatabaseConnection* getConnection(const QString& lexicon) const;
+    ThreadConnections* getThreadConnections() const;
+    QSqlDatabase* getDatabase(const QString& lexicon) const;
+    void closeConnections(const QString& lexicon);
+    void recordDatabaseQuery(int numWords, int loadTime, int queryTime)
+        const;
+    CacheShard& getCacheShard(quint64 key) const {
+        return cacheShards[(key ^ (key >> 32)) % NUM_CACHE_SHARDS]; }
+    void buildAlphagramIndex(const QString& lexicon);
+    void releaseBundle(const QString& lexicon);
+    void loadAttributes(const QString& lexicon);
+    QMap<ConditionPhase, int> getSearchPhases(const QString& lexicon, const
+                                              SearchSpec& optimizedSpec)
+                                              const;
+    SearchPlan planSearch(const QString& lexicon, const SearchSpec&
+                          optimizedSpec, const QMap<ConditionPhase, int>&
+                          phaseCounts) const;
+    double estimatePlanCost(const QList<ConditionPhase>& phases, const
+                            QMap<ConditionPhase, PhaseEstimate>&
+                            phaseEstimates, double numWords, QList<double>*
+                            estimates) const;
+    double estimateGraphVisits(const SearchSpec& optimizedSpec, double
+                               numWords) const;
+    double estimateDatabaseFraction(const QString& lexicon, const
+                                    SearchCondition& condition) const;
+    QString describePlan(const SearchPlan& plan) const;
+    bool isExactAnagramSearch(const SearchSpec& optimizedSpec, QString*
+                              letters) const;
+    bool isBitmapSearch(const QString& lexicon, const SearchSpec&
+                        optimizedSpec) const;
+    const BitmapIndex* getBitmapIndex(const QString& lexicon) const;
+    QStringList bitmapSearch(const QString& lexicon, const SearchSpec&
+                             optimizedSpec) const;
+    WordBitmap getConditionBitmap(const QString& lexicon, const BitmapIndex*
+                                  index, const SearchCondition& condition)
+                                  const;
     bool matchesPostConditions(const QString& lexicon, const QString& word,
                                const QList<SearchCondition>& conditions) const;
     bool isSetMember(const QString& lexicon, const QString& word,
@@ -169,16 +434,40 @@ class WordEngine : public QObject
                                const SearchSpec& spec) const;
     void addDefinition(const QString& lexicon, const QString& word,
                        const QString& definition);
+    QString getBundleDefinition(const QString& lexicon, const QString& word)
+        const;
+    bool getBundleHooks(const QString& lexicon, const QString& word, bool
+                        front, quint32* hooks) const;
+    QStringList attributeSearch(const QString& lexicon, const SearchSpec&
+                                optimizedSpec, const QStringList* wordList = 0)
+                                const;
+    bool loadWordTable(const QString& lexicon, const QStringList& words)
+        const;
+    void getAttributeRanges(const SearchCondition& condition,
+                            QList<AttributeStore::Attribute>* attributes,
+                            QList<quint32>* minValues, QList<quint32>*
+                            maxValues) const;
     QStringList databaseSearch(const QString& lexicon, const SearchSpec&
                                optimizedSpec, const QStringList* wordList = 0)
                                const;
     QStringList applyPostConditions(const QString& lexicon, const SearchSpec&
                                     optimizedSpec, const QStringList&
                                     wordList) const;
-    ConditionPhase getConditionPhase(const SearchCondition& condition) const;
+    ConditionPhase getConditionPhase(const QString& lexicon, const
+                                     SearchCondition& condition) const;
 
     private:
     QMap<QString, LexiconData*> lexiconData;
+
+    // Information about recently used words, keyed by lexicon and word ID
+    // and split into shards so that threads seldom wait for each other
+    static const int NUM_CACHE_SHARDS = 16;
+    mutable CacheShard cacheShards[NUM_CACHE_SHARDS];
+
+    mutable DatabaseStats databaseStats;
+
+    // The database connections opened by each thread
+    mutable QThreadStorage<ThreadConnections*> threadConnections;
 };
 
 #endif // ZYZZYVA_WORD_ENGINE_H
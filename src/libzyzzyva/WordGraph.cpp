@@ -23,13 +23,15 @@
 //---------------------------------------------------------------------------
 
 #include "WordGraph.h"
+#include "LexiconBundle.h"
+#include "SearchStream.h"
 #include "Defs.h"
 #include <QFile>
 #include <QList>
-#include <QRegExp>
+#include <QThreadPool>
+#include <cstring>
 #include <iostream>
 #include <map>
-#include <stack>
 
 const qint32 TERMINAL_NODE = 0;
 const qint32 ROOT_NODE = 1;
@@ -43,6 +45,12 @@ const qint32 V_LETTER       = 24;
 const qint32 M_LETTER       = 0xFF;
 const qint32 M_NODE_POINTER = 0x1FFFFFL;
 
+// Parallel searches divide the graph into the subtrees at this depth
+const int SPLIT_DEPTH = 2;
+
+// Streaming searches check for cancellation after this many edges
+const int POLL_INTERVAL = 1024;
+
 using namespace std;
 using namespace Defs;
 
@@ -52,7 +60,11 @@ using namespace Defs;
 //! Constructor.
 //---------------------------------------------------------------------------
 WordGraph::WordGraph()
-    : dawg(0), rdawg(0), top(0), rtop(0), numWords(0)
+    : dawg(0), rdawg(0), dawgFile(0), rdawgFile(0), bundleDawg(false),
+      bundleReverseDawg(false), numEdges(0), numReverseEdges(0),
+      expectedChecksum(0), expectedReverseChecksum(0),
+      computedChecksum(-1), computedReverseChecksum(-1),
+      checksumPending(false), reverseChecksumPending(false)
 {
     // Test for endianness
     char endianTest[2] = { 1, 0 };
@@ -77,12 +89,8 @@ WordGraph::~WordGraph()
 void
 WordGraph::clear()
 {
-    if (dawg)
-        delete[] dawg;
-    if (rdawg)
-        delete[] rdawg;
-    dawg = 0;
-    rdawg = 0;
+    releaseDawg(false);
+    releaseDawg(true);
 }
 
 //---------------------------------------------------------------------------
@@ -91,6 +99,11 @@ WordGraph::clear()
 //! Import words from a DAWG file as generated by Graham Toal's dawgutils
 //! programs: http://www.gtoal.com/wordgames/dawgutils/
 //
+//! The file is mapped into memory read-only and the edges are walked
+//! directly from the mapping, so processes and lexicons share the page cache
+//! instead of each holding a private copy.  The checksum is not computed
+//! here; it is recorded and checked later by verifyChecksums.
+//
 //! @param filename the name of the DAWG file to import
 //! @param reverse whether the DAWG contains reversed words
 //! @param errString returns the error string in case of error
@@ -101,71 +114,250 @@ bool
 WordGraph::importDawgFile(const QString& filename, bool reverse, QString*
                           errString, quint16* expectedChecksum)
 {
-    QFile file (filename);
-    if (!file.open(QIODevice::ReadOnly)) {
+    QFile* file = new QFile(filename);
+    if (!file->open(QIODevice::ReadOnly)) {
         if (errString)
             *errString = "Can't open file '" + filename + "': "
-            + file.errorString();
+            + file->errorString();
+        delete file;
         return false;
     }
 
-    qint32 numEdges;
-    qint32* p = &numEdges;
-    char* cp = (char*) p;
-    file.read(cp, 1 * sizeof(qint32));
+    qint32 edgeCount = 0;
+    file->read((char*) &edgeCount, sizeof(qint32));
     if (bigEndian)
-        convertEndian(p, 1);
+        convertEndian(&edgeCount, 1);
+
+    qint64 fileSize = (qint64(edgeCount) + 1) * sizeof(qint32);
+    if ((edgeCount <= 0) || (file->size() < fileSize)) {
+        if (errString)
+            *errString = "The lexicon file '" + filename + "' is truncated "
+                "or corrupted.";
+        delete file;
+        return false;
+    }
+
+    releaseDawg(reverse);
+
+    // The edge count header lands at index 0 of the mapping, where the edge
+    // array expects the terminal node.  That is harmless because the
+    // terminal node is never dereferenced.  Big-endian hosts must convert
+    // the edges, so they read a private copy instead.
+    qint32* edges = 0;
+    qint32 checksum = -1;
+    uchar* mapping = bigEndian ? 0 : file->map(0, fileSize);
+    if (mapping) {
+        edges = (qint32*) mapping;
+    }
+    else {
+        edges = new qint32[edgeCount + 1];
+        edges[0] = 0;
+        file->read((char*) &edges[1], edgeCount * sizeof(qint32));
+
+        // The checksum covers the file contents, so take it before the
+        // edges are converted in place
+        if (expectedChecksum)
+            checksum = qChecksum((char*) &edges[1], edgeCount);
+
+        if (bigEndian)
+            convertEndian(&edges[1], edgeCount);
+
+        delete file;
+        file = 0;
+    }
 
     if (reverse) {
-        rdawg = new qint32[numEdges + 1];
-        rdawg[0] = 0;
-        p = &rdawg[1];
-        cp = (char*) p;
-        file.read(cp, numEdges * sizeof(qint32));
+        rdawg = edges;
+        rdawgFile = file;
+        numReverseEdges = edgeCount;
+        expectedReverseChecksum = expectedChecksum ? *expectedChecksum : 0;
+        computedReverseChecksum = checksum;
+        reverseChecksumPending = (expectedChecksum != 0);
     }
     else {
-        dawg = new qint32[numEdges + 1];
-        dawg[0] = 0;
-        p = &dawg[1];
-        cp = (char*) p;
-        file.read(cp, numEdges * sizeof(qint32));
-    }
-
-    if (expectedChecksum && errString) {
-        char* cp = (char*) p;
-        //qDebug("file: %s", filename.toUtf8().constData());
-        //qDebug("expected checksum: %d", *expectedChecksum);
-        //qDebug("got checksum:      %d", qChecksum(cp, numEdges));
-        if (*expectedChecksum != qChecksum(cp, numEdges)) {
-            *errString =
-                "The lexicon checksum does not match the expected checksum.  "
-                "It is possible the lexicon has been corrupted.";
+        dawg = edges;
+        dawgFile = file;
+        numEdges = edgeCount;
+        this->expectedChecksum = expectedChecksum ? *expectedChecksum : 0;
+        computedChecksum = checksum;
+        checksumPending = (expectedChecksum != 0);
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  verifyChecksums
+//
+//! Compare the checksums of imported DAWG files with the values expected at
+//! import time.  Each checksum is only computed once, so this is cheap to
+//! call repeatedly.
+//
+//! @param errString returns the error string in case of error
+//! @return true if all pending checksums match, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordGraph::verifyChecksums(QString* errString)
+{
+    bool ok = true;
+
+    if (checksumPending && dawg) {
+        if (computedChecksum < 0)
+            computedChecksum = qChecksum((char*) &dawg[1], numEdges);
+        ok = ok && (computedChecksum == expectedChecksum);
+        checksumPending = false;
+    }
+
+    if (reverseChecksumPending && rdawg) {
+        if (computedReverseChecksum < 0) {
+            computedReverseChecksum =
+                qChecksum((char*) &rdawg[1], numReverseEdges);
         }
+        ok = ok && (computedReverseChecksum == expectedReverseChecksum);
+        reverseChecksumPending = false;
     }
 
-    if (bigEndian)
-        convertEndian(p, numEdges);
+    if (!ok && errString) {
+        *errString =
+            "The lexicon checksum does not match the expected checksum.  "
+            "It is possible the lexicon has been corrupted.";
+    }
+
+    return ok;
+}
+
+//---------------------------------------------------------------------------
+//  importWords
+//
+//! Build forward and reverse DAWGs from a list of words, such as a lexicon
+//! imported from a text file.  The DAWGs are minimal and use the same packed
+//! edge format as DAWG files, so they are searched the same way.
+//
+//! @param words the words to import, in any order
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordGraph::importWords(const QStringList& words)
+{
+    QList<QByteArray> forwardWords;
+    QList<QByteArray> reverseWords;
+    foreach (const QString& word, words) {
+        if (word.isEmpty())
+            continue;
+
+        QByteArray bytes = word.toLatin1();
+        QByteArray reversed (bytes.size(), 0);
+        for (int i = 0; i < bytes.size(); ++i)
+            reversed[bytes.size() - i - 1] = bytes[i];
+
+        forwardWords.append(bytes);
+        reverseWords.append(reversed);
+    }
+
+    qSort(forwardWords);
+    qSort(reverseWords);
+
+    releaseDawg(false);
+    releaseDawg(true);
+    checksumPending = false;
+    reverseChecksumPending = false;
+
+    Builder forwardBuilder;
+    foreach (const QByteArray& word, forwardWords)
+        forwardBuilder.addWord(word);
+    dawg = forwardBuilder.finish(&numEdges);
+
+    Builder reverseBuilder;
+    foreach (const QByteArray& word, reverseWords)
+        reverseBuilder.addWord(word);
+    rdawg = reverseBuilder.finish(&numReverseEdges);
+
+    return (dawg && rdawg);
+}
+
+//---------------------------------------------------------------------------
+//  attachBundle
+//
+//! Use the DAWGs and reachability summaries held by a lexicon bundle in
+//! place.  The bundle must stay open while the graph is in use.
+//
+//! @param bundle the bundle
+//! @param errString returns the error string in case of error
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordGraph::attachBundle(const LexiconBundle& bundle, QString* errString)
+{
+    clear();
+    checksumPending = false;
+    reverseChecksumPending = false;
+
+    for (int i = 0; i < 2; ++i) {
+        bool reverse = (i == 1);
+        QByteArray edgeSection = bundle.getSection(reverse
+            ? LexiconBundle::ReverseDawg : LexiconBundle::ForwardDawg);
+        QByteArray summarySection = bundle.getSection(reverse
+            ? LexiconBundle::ReverseSummaries
+            : LexiconBundle::ForwardSummaries);
+
+        qint32 edgeCount = edgeSection.size() / int(sizeof(qint32)) - 1;
+        SummaryTable& nodeSummaries = reverse ? reverseSummaries : summaries;
+        if ((edgeCount <= 0) ||
+            (edgeSection.size() % int(sizeof(qint32))) ||
+            !nodeSummaries.attach(summarySection, edgeCount))
+        {
+            if (errString) {
+                *errString = "The lexicon bundle does not hold a valid "
+                    "word graph.";
+            }
+            clear();
+            return false;
+        }
+
+        // The bundle is mapped read-only, but edges are never written
+        qint32* edges = (qint32*) edgeSection.constData();
+        if (reverse) {
+            rdawg = edges;
+            numReverseEdges = edgeCount;
+            bundleReverseDawg = true;
+        }
+        else {
+            dawg = edges;
+            numEdges = edgeCount;
+            bundleDawg = true;
+        }
+    }
 
     return true;
 }
 
 //---------------------------------------------------------------------------
-//  addWord
+//  writeBundle
 //
-//! Add a word to the old-style graph.  Represent the word in both forward and
-//! reverse order for quick lookup in either direction.
+//! Add the DAWGs and reachability summaries to a lexicon bundle, building
+//! the summaries if they have not been built yet.  The DAWG sections are
+//! not copied, so the graph must not be changed until the bundle is saved.
 //
-//! @param w the word to add
+//! @param bundle the bundle
 //---------------------------------------------------------------------------
 void
-WordGraph::addWord(const QString& w)
+WordGraph::writeBundle(LexiconBundle& bundle) const
 {
-    if (w.isEmpty())
-        return;
+    if (dawg) {
+        bundle.setSection(LexiconBundle::ForwardDawg,
+            QByteArray::fromRawData((const char*) dawg,
+                                    (numEdges + 1) * sizeof(qint32)));
+        bundle.setSection(LexiconBundle::ForwardSummaries,
+                          getSummaries(false).getData());
+    }
 
-    addWordOld(w, false);
-    addWordOld(w, true);
-    ++numWords;
+    if (rdawg) {
+        bundle.setSection(LexiconBundle::ReverseDawg,
+            QByteArray::fromRawData((const char*) rdawg,
+                                    (numReverseEdges + 1) * sizeof(qint32)));
+        bundle.setSection(LexiconBundle::ReverseSummaries,
+                          getSummaries(true).getData());
+    }
 }
 
 //---------------------------------------------------------------------------
@@ -182,7 +374,7 @@ WordGraph::containsWord(const QString& w) const
         return false;
 
     if (!dawg)
-        return containsWordOld(w);
+        return false;
 
     qint32 node = ROOT_NODE;
     bool eow = false;
@@ -212,28 +404,112 @@ WordGraph::containsWord(const QString& w) const
     return eow;
 }
 
+//---------------------------------------------------------------------------
+//  getFrontHooks
+//
+//! Get the letters that can be added to the front of a word to make other
+//! words in the graph.  The word's path is followed once in the reverse
+//! graph, and the hooks are the letters ending a word below it.
+//
+//! @param word the word, in upper case
+//! @return a mask with a bit set for each hook letter, as returned by
+//! getLetterBit
+//---------------------------------------------------------------------------
+quint32
+WordGraph::getFrontHooks(const QString& word) const
+{
+    if (!dawg || word.isEmpty())
+        return 0;
+
+    QByteArray bytes = word.toLatin1();
+    if (rdawg) {
+        QByteArray reversed (bytes.size(), 0);
+        for (int i = 0; i < bytes.size(); ++i)
+            reversed[bytes.size() - i - 1] = bytes[i];
+        return getEndLetters(rdawg, findNode(rdawg, ROOT_NODE, reversed));
+    }
+
+    // Without a reverse graph, follow the word below each first letter
+    quint32 hooks = 0;
+    for (const qint32* edge = &dawg[ROOT_NODE]; ; ++edge) {
+        qint32 node = findNode(dawg, *edge & M_NODE_POINTER,
+                               bytes.left(bytes.size() - 1));
+        const qint32* last = node ? findEdge(dawg, node, bytes.at(
+                                             bytes.size() - 1)) : 0;
+        if (last && (*last & M_END_OF_WORD))
+            hooks |= getLetterBit((*edge >> V_LETTER) & M_LETTER);
+        if (*edge & M_END_OF_NODE)
+            break;
+    }
+    return hooks;
+}
+
+//---------------------------------------------------------------------------
+//  getBackHooks
+//
+//! Get the letters that can be added to the back of a word to make other
+//! words in the graph.  The word's path is followed once, and the hooks
+//! are the letters ending a word below it.
+//
+//! @param word the word, in upper case
+//! @return a mask with a bit set for each hook letter, as returned by
+//! getLetterBit
+//---------------------------------------------------------------------------
+quint32
+WordGraph::getBackHooks(const QString& word) const
+{
+    if (!dawg || word.isEmpty())
+        return 0;
+
+    return getEndLetters(dawg, findNode(dawg, ROOT_NODE, word.toLatin1()));
+}
+
+//---------------------------------------------------------------------------
+//  getLetters
+//
+//! Get the letters whose bits are set in a letter mask.  The bit shared by
+//! letters other than A-Z is ignored.
+//
+//! @param letterBits the letter mask
+//! @return a string of lower case letters, in alphabetical order
+//---------------------------------------------------------------------------
+QString
+WordGraph::getLetters(quint32 letterBits)
+{
+    QString letters;
+    for (int i = 0; i < 26; ++i) {
+        if (letterBits & (quint32(1) << i))
+            letters += QChar('a' + i);
+    }
+    return letters;
+}
+
 //---------------------------------------------------------------------------
 //  search
 //
-//! Search for acceptable words matching a search specification.
+//! Search for acceptable words matching a search specification.  If a
+//! stream is given, matching words are also added to it.  A conjunction of
+//! match conditions adds words as they are found; a disjunction must
+//! combine its result sets first, and adds the words at the end.
 //
 //! @param spec the search specification
-//! @return a list of acceptable words
+//! @param stream the stream to receive words, or null
+//! @return a list of acceptable words, or an empty list if the search was
+//! canceled
 //---------------------------------------------------------------------------
 QStringList
-WordGraph::search(const SearchSpec& spec) const
+WordGraph::search(const SearchSpec& spec, SearchStream* stream) const
 {
     QStringList wordList;
     if (spec.conditions.empty())
         return wordList;
 
     if (!dawg)
-        return searchOld(spec);
+        return wordList;
 
     QList<SearchCondition> posMatchConditions;
     QList<SearchCondition> negMatchConditions;
-    int maxLength = MAX_WORD_LEN;
-    QString excludeLetters;
+    SearchLimits limits;
     int numWildcardConditions = 0;
 
     QListIterator<SearchCondition> it (spec.conditions);
@@ -254,13 +530,17 @@ WordGraph::search(const SearchSpec& spec) const
             break;
 
             case SearchCondition::Length:
-            if (condition.maxValue < maxLength)
-                maxLength = condition.maxValue;
+            if (condition.minValue > limits.minLength)
+                limits.minLength = condition.minValue;
+            if (condition.maxValue < limits.maxLength)
+                limits.maxLength = condition.maxValue;
             break;
 
             case SearchCondition::IncludeLetters:
             if (condition.negated)
-                excludeLetters += condition.stringValue;
+                limits.exclude(condition.stringValue);
+            else
+                limits.include(condition.stringValue);
             break;
 
             default: break;
@@ -283,336 +563,39 @@ WordGraph::search(const SearchSpec& spec) const
         posMatchConditions.append(condition);
     }
 
+    // Search for positive conditions first, followed by negative conditions
+    QList<SearchCondition> matchConditions =
+        posMatchConditions + negMatchConditions;
     map<QString, QString> finalWordSet;
     map<QString, QString>::iterator sit;
-    int conditionNum = 0;
-
-    // Search for each condition separately, and take the conjunction or
-    // disjunction of the result sets. Search for positive conditions first,
-    // followed by negative conditions.
-    QListIterator<SearchCondition> mit (posMatchConditions +
-                                        negMatchConditions);
-    while (mit.hasNext()) {
-        const SearchCondition& condition = mit.next();
-        QString unmatched = condition.stringValue;
-        bool negated = condition.negated;
-
-        // Use set to eliminate duplicates since patterns with wildcards may
-        // match the same word in more than one way
-        map<QString, QString> wordSet;
-        stack <TraversalState> states;
-        QString word;
-
-        bool wildcard = false;
-        bool reversePattern = false;
-
-        // If Pattern match is unspecified, change it to a single wildcard
-        // character.  Also, remove any redundant wildcards.
-        if (condition.type == SearchCondition::PatternMatch) {
-            if (unmatched.isEmpty())
-                unmatched = "*";
-            else
-                unmatched.replace(QRegExp("\\*+"), "*");
 
-            if ((unmatched.left(1) == "*") && (unmatched.right(1) != "*")) {
-                unmatched = reverseString(unmatched);
-                reversePattern = true;
-            }
-        }
-
-        // If Anagram or Subanagram match contains a wildcard, note it and remove
-        // the wildcard character from the match pattern.  Also move character
-        // classes to the end of the string so they will be seen last if
-        // moving sequentially through the string looking for matches.
-        else if ((condition.type == SearchCondition::AnagramMatch) ||
-                 (condition.type == SearchCondition::SubanagramMatch))
-        {
-            wildcard = unmatched.contains('*');
-            if (wildcard)
-                unmatched = unmatched.replace('*', QString());
-
-            QRegExp re ("\\[[^\\]]*\\][^\\W_\\d]");
-            int pos = 0;
-            while ((pos = re.indexIn(unmatched, pos)) >= 0) {
-                unmatched = unmatched.left(re.pos()) +
-                    unmatched.right(unmatched.length() -
-                                   (re.pos() + re.matchedLength()) + 1) +
-                    unmatched.mid(re.pos(), re.matchedLength() - 1);
-                pos += re.matchedLength();
-            }
-        }
-
-        qint32 node = ROOT_NODE;
-
-        // Traverse the tree looking for matches
-        while (node) {
-
-            // Stop if word is at max length
-            if (int(word.length()) < maxLength) {
-                QString origWord = word;
-                QString origUnmatched = unmatched;
-
-                QString match;
-                int closeIndex = 0;
-
-                // Get the next character in the Pattern match.  Allow a
-                // wildcard to match the empty string.
-                if ((condition.type == SearchCondition::PatternMatch) &&
-                    (!unmatched.isEmpty()))
-                {
-                    match = unmatched.at(0);
-                    if (match == "*") {
-                        states.push(TraversalState(node, word,
-                            unmatched.right(unmatched.length() - 1)));
-                    }
-                    else if (match == "[") {
-                        closeIndex = unmatched.indexOf(']', 0);
-                        match = unmatched.mid(1, closeIndex);
-                    }
-                }
-
-                qint32* edge = reversePattern ? &rdawg[node] : &dawg[node];
-
-                // Traverse next nodes, looking for matches
-                for (; ; ++edge) {
-                    qint32 longLetter = *edge;
-                    longLetter = longLetter >> V_LETTER;
-                    longLetter = longLetter & M_LETTER;
-
-                    QChar letter = (char) longLetter;
-
-                    if (excludeLetters.contains(letter)) {
-                        if (*edge & M_END_OF_NODE)
-                            break;
-                        else
-                            continue;
-                    }
-
-                    unmatched = origUnmatched;
-                    word = origWord;
-
-                    // Special processing for Pattern match
-                    if (condition.type == SearchCondition::PatternMatch) {
-
-                        // A node matches wildcard characters or its own
-                        // letter
-                        bool matchLetter = match.contains(letter);
-                        bool matchNegated = match.contains("^");
-                        QChar c = letter;
-                        if (match.contains ("]") || (match == "?"))
-                            c = c.toLower();
-
-                        if ((match == "*") || (match == "?") ||
-                            (matchLetter ^ matchNegated))
-                            word += c;
-                        else {
-                            if (*edge & M_END_OF_NODE)
-                                break;
-                            else
-                                continue;
-                        }
-
-                        qint32 child = *edge & M_NODE_POINTER;
-
-                        // If this node matches, push its child on the stack
-                        // to be traversed later
-                        if (child) {
-                            if (match == "*") {
-                                states.push(TraversalState(child, word,
-                                                           unmatched));
-                            }
-
-                            if (closeIndex < unmatched.length() - 1) {
-                                states.push(TraversalState(child, word,
-                                    unmatched.right(unmatched.length() -
-                                    closeIndex - 1)));
-                            }
-                        }
-
-                        // If end of word and end of pattern, put the word in
-                        // the list.  If we are searching the reverse list,
-                        // reverse the word first.
-                        QString wordUpper = word.toUpper();
-                        if (reversePattern)
-                            wordUpper = reverseString(wordUpper);
-
-                        if ((*edge & M_END_OF_WORD) &&
-                            ((int(unmatched.length()) == closeIndex + 1) ||
-                            ((int(unmatched.length()) == closeIndex + 2) &&
-                             (QChar(unmatched.at(closeIndex + 1)) == '*'))) &&
-                            matchesSpec(wordUpper, spec) &&
-                            !wordSet.count(wordUpper))
-                        {
-                            wordSet.insert(make_pair(wordUpper,
-                                reversePattern ? reverseString(word)
-                                               : word));
-                        }
-                    }
-
-                    // Special processing for Anagram or Subanagram match
-                    else if
-                        ((condition.type == SearchCondition::AnagramMatch) ||
-                         (condition.type == SearchCondition::SubanagramMatch))
-                    {
-                        // Find the current letter in the pattern.  First,
-                        // prefer to match the letter itself.  Second, prefer
-                        // to match the letter as part of a character class.
-                        // If the letter matches more than one character
-                        // class, match the first one and push traversal
-                        // states for each of the others that is matched.
-                        // Character classes are guaranteed to be at the end
-                        // of the search string, so once you're in a character
-                        // class, you're always in a character class.
-                        int len = unmatched.length();
-                        bool inGroup = false;
-                        bool found = false;
-                        bool negated = false;
-                        int matchStart = -1;
-                        int matchEnd = -1;
-                        int groupStart = -1;
-                        bool wildcardMatch = false;
-                        for (int i = 0; i < len; ++i) {
-                            QChar c = unmatched.at(i);
-
-                            if (c == '[') {
-                                inGroup = true;
-                                negated = false;
-                                groupStart = i;
-                            }
-
-                            else if (inGroup) {
-                                if (c == '^')
-                                    negated = true;
-
-                                else if (c == ']') {
-                                    if (found ^ negated) {
-                                        qint32 child = *edge & M_NODE_POINTER;
-
-                                        if (matchEnd < 0) {
-                                            matchStart = groupStart;
-                                            matchEnd = i;
-                                            wildcardMatch = true;
-                                        }
-
-                                        else if (child) {
-                                            states.push(TraversalState(child,
-                                                word + letter,
-                                                unmatched.left(groupStart) +
-                                                unmatched.right(
-                                                unmatched.length() - i - 1)));
-                                        }
-                                    }
-                                    inGroup = false;
-                                    found = false;
-                                    negated = false;
-                                }
-
-                                else if (c == letter)
-                                    found = true;
-                            }
-
-                            // Matched the character itself
-                            else if (c == letter) {
-                                found = true;
-                                matchStart = i;
-                                matchEnd = i;
-                                break;
-                            }
-                        }
-
-                        // Try to match the current letter against the
-                        // pattern.  If the letter doesn't match exactly,
-                        // match a ? char.
-                        //int index = unmatched.find(node->letter);
-                        found = (matchStart >= 0);
-                        if (!found) {
-                            matchStart = matchEnd = unmatched.indexOf("?");
-                            found = (matchStart >= 0);
-                            wildcardMatch = true;
-                        }
-
-                        // If this letter matched or a wildcard was specified,
-                        // keep traversing after possibly adding the current
-                        // word.
-                        if (found || wildcard) {
-                            word += (found && !wildcardMatch) ? QChar(letter)
-                                : QChar(letter).toLower();
-
-                            if (found)
-                                unmatched.replace(matchStart,
-                                                  matchEnd - matchStart + 1,
-                                                  QString());
-
-                            qint32 child = *edge & M_NODE_POINTER;
-                            if (child &&
-                                (wildcard || !unmatched.isEmpty()))
-                            {
-                                states.push(TraversalState(child, word,
-                                                           unmatched));
-                            }
-
-                            QString wordUpper = word.toUpper();
-                            if ((*edge & M_END_OF_WORD) &&
-                                ((condition.type ==
-                                  SearchCondition::SubanagramMatch) ||
-                                  unmatched.isEmpty()) &&
-                                  matchesSpec(wordUpper, spec) &&
-                                  !wordSet.count(wordUpper))
-                            {
-                                wordSet.insert(make_pair(wordUpper, word));
-                            }
-                        }
-                    }
-
-                    if (*edge & M_END_OF_NODE)
-                        break;
-                }
-            }
-
-            // Done traversing next nodes, pop a child off the stack
-            node = 0;
-            if (states.size()) {
-                TraversalState state = states.top();
-                node = state.node;
-                unmatched = state.unmatched;
-                word = state.word;
-                states.pop();
-            }
-        }
-
-        // Take conjunction or disjunction with final result set
-        if (!conditionNum) {
-            finalWordSet = wordSet;
-        }
+    // Find the conjunction of all match conditions with a single walk of
+    // the graph
+    if (spec.conjunction || (matchConditions.size() == 1)) {
+        searchParallel(matchConditions, spec, limits, finalWordSet, stream);
+        if (stream && stream->isCanceled())
+            return wordList;
 
-        else if (spec.conjunction) {
-            map<QString, QString> conjunctionSet;
-            for (sit = wordSet.begin(); sit != wordSet.end(); ++sit) {
-                map<QString, QString>::iterator found =
-                    finalWordSet.find(sit->first);
-                if (found != finalWordSet.end()) {
-                    if (negated)
-                        finalWordSet.erase(found);
-                    else
-                        conjunctionSet.insert(*found);
-                }
-            }
-            if (!negated) {
-                if (conjunctionSet.empty())
-                    return wordList;
-                finalWordSet = conjunctionSet;
-            }
+        for (sit = finalWordSet.begin(); sit != finalWordSet.end(); ++sit) {
+            wordList << (wildcardLower ? sit->second : sit->first);
         }
 
-        else {
-            // FIXME: disjunction is broken for negated conditions! Fix this
-            // when disjunction is enabled in the UI.
-            for (sit = wordSet.begin(); sit != wordSet.end(); ++sit) {
-                finalWordSet.insert(*sit);
-            }
-        }
+        if (stream)
+            stream->flush();
+        return wordList;
+    }
 
-        ++conditionNum;
+    // Otherwise search for each condition separately, and take the
+    // disjunction of the result sets
+    // FIXME: disjunction is broken for negated conditions! Fix this when
+    // disjunction is enabled in the UI.
+    foreach (const SearchCondition& condition, matchConditions) {
+        map<QString, QString> wordSet;
+        searchParallel(QList<SearchCondition>() << condition, spec, limits,
+                       wordSet, 0);
+        if (stream && stream->poll())
+            return wordList;
+        finalWordSet.insert(wordSet.begin(), wordSet.end());
     }
 
     // Transform word set into word list and return it
@@ -620,654 +603,2164 @@ WordGraph::search(const SearchSpec& spec) const
         wordList << (wildcardLower ? sit->second : sit->first);
     }
 
+    if (stream) {
+        stream->addWords(wordList);
+        stream->flush();
+    }
+
     return wordList;
 }
 
 //---------------------------------------------------------------------------
-//  getNumWords
+//  searchParallel
 //
-//! Return the number of words in the graph.
+//! Find all words matching a conjunction of match conditions, dividing the
+//! graph into subtrees that are searched by the threads of the global
+//! thread pool.  The calling thread searches subtrees as well, and only
+//! waits for pool threads that were actually started, so a busy pool simply
+//! means fewer threads take part.
 //
-//! @return the number of words
+//! @param conditions the match conditions, positive conditions first
+//! @param spec the search specification, checked for each matching word
+//! @param limits limits on every matching word
+//! @param wordSet the set to receive matching words
+//! @param stream the stream to receive matching words as they are found,
+//! or null
 //---------------------------------------------------------------------------
-int
-WordGraph::getNumWords() const
+void
+WordGraph::searchParallel(const QList<SearchCondition>& conditions, const
+                          SearchSpec& spec, const SearchLimits& limits,
+                          map<QString, QString>& wordSet, SearchStream*
+                          stream) const
 {
-    return (dawg ? getNumWords(ROOT_NODE) : numWords);
+    if ((conditions.size() == 1) &&
+        searchSubstring(conditions.first(), spec, wordSet, stream))
+    {
+        return;
+    }
+
+    QThreadPool* pool = QThreadPool::globalInstance();
+    if (pool->maxThreadCount() < 2) {
+        searchSubtree(conditions, spec, limits, wordSet, QByteArray(), 0,
+                      stream);
+        return;
+    }
+
+    // Words shorter than the split depth are found while dividing the graph
+    SearchJob job (this, conditions, spec, limits, stream);
+    searchSubtree(conditions, spec, limits, wordSet, QByteArray(),
+                  &job.prefixes, stream);
+
+    int numThreads = qMin(pool->maxThreadCount(), job.prefixes.size());
+    QVector<map<QString, QString> > threadWordSets (numThreads);
+    int numStarted = 0;
+    for (int i = 1; i < numThreads; ++i) {
+        SearchWorker* worker = new SearchWorker(&job, &threadWordSets[i]);
+        if (!pool->tryStart(worker)) {
+            delete worker;
+            break;
+        }
+        ++numStarted;
+    }
+
+    job.run(wordSet);
+    job.finished.acquire(numStarted);
+
+    // The sets are ordered, so the merged result does not depend on which
+    // thread searched which subtree
+    for (int i = 1; i <= numStarted; ++i)
+        wordSet.insert(threadWordSets[i].begin(), threadWordSets[i].end());
 }
 
 //---------------------------------------------------------------------------
-//  matchesSpec
+//  searchSubstring
 //
-//! Determine whether a word matches a search specification.  Only the
-//! following attributes are checked: Include Letters, Consist Letters/Pct,
-//! Min Length, Min Anagrams, Max Anagrams, Min Probability, Max Probability.
-//! All other attributes are assumed to have been checked in the course of
-//! finding the word to be checked.
+//! Find all words matching a Pattern match condition that begins and ends
+//! with a wildcard, e.g. "*A?C*".  Such a pattern constrains neither end of
+//! a word, so walking the graph would visit every edge.  Instead the words
+//! containing the pattern's longest run of literal letters are looked up in
+//! the substring index, and only those are matched against the pattern.
+//
+//! @param condition the match condition
+//! @param spec the search specification, checked for each matching word
+//! @param wordSet the set to receive matching words
+//! @param stream the stream to receive matching words as they are found,
+//! or null
+//! @return true if the search was done, false if the condition cannot be
+//! searched with the substring index
 //---------------------------------------------------------------------------
 bool
-WordGraph::matchesSpec(QString word, const SearchSpec& spec) const
+WordGraph::searchSubstring(const SearchCondition& condition, const
+                           SearchSpec& spec, map<QString, QString>& wordSet,
+                           SearchStream* stream) const
 {
-    QListIterator<SearchCondition> it (spec.conditions);
-    while (it.hasNext()) {
-        const SearchCondition& condition = it.next();
+    const QString& pattern = condition.stringValue;
+    if ((condition.type != SearchCondition::PatternMatch) ||
+        (pattern.length() < 2) || !pattern.startsWith("*") ||
+        !pattern.endsWith("*"))
+    {
+        return false;
+    }
 
-        switch (condition.type) {
-            case SearchCondition::Length:
-            if ((int(word.length()) < condition.minValue) ||
-                (int(word.length()) > condition.maxValue))
-                return false;
-            break;
+    CompiledPattern compiled;
+    if (!compiled.compile(pattern) || compiled.getLongestLiteral().isEmpty())
+        return false;
 
-            case SearchCondition::IncludeLetters: {
-                QString tmpWord = word;
-                int includeLen = condition.stringValue.length();
-                for (int i = 0; i < includeLen; ++i) {
-                    int index = tmpWord.indexOf(condition.stringValue.at(i));
-                    if ((index < 0) ^ condition.negated)
-                        return false;
-                    tmpWord.replace(index, 1, QString());
-                }
-            }
-            break;
+    QList<QByteArray> candidates;
+    {
+        QMutexLocker locker (&substringMutex);
+        if (substringIndex.isEmpty())
+            substringIndex.build(getWords());
+        candidates = substringIndex.getWords(compiled.getLongestLiteral());
+    }
 
-            case SearchCondition::ConsistOf:
-            if ((condition.minValue > 0) || (condition.maxValue < 100)) {
-                int wordLen = word.length();
-                int consist = 0;
-                for (int i = 0; i < wordLen; ++i) {
-                    if (condition.stringValue.contains(word.at(i)))
-                        ++consist;
-                }
-                int consistPct = (consist * 100) / wordLen;
-                if ((consistPct < condition.minValue) ||
-                    (consistPct > condition.maxValue))
-                    return false;
-            }
+    bool wildcardMatch[MAX_WORD_LEN];
+    foreach (const QByteArray& word, candidates) {
+        if (stream && stream->isStopped())
             break;
 
-            // XXX: Implement these!
-            //case SearchCondition::NumAnagrams:
-            //case SearchCondition::Probability:
-
-            default: break;
+        int length = word.length();
+        quint64 state = compiled.getStartState();
+        for (int i = 0; state && (i < length); ++i)
+            state = compiled.step(state, word.at(i), &wildcardMatch[i]);
+        if (!compiled.accepts(state))
+            continue;
+
+        QString wordUpper = QString::fromLatin1(word.constData(), length);
+        if (!matchesSpec(wordUpper, spec))
+            continue;
+
+        QString wordDisplay = wordUpper;
+        for (int i = 0; i < length; ++i) {
+            if (wildcardMatch[i])
+                wordDisplay[i] = wordDisplay[i].toLower();
         }
+        if (stream && !stream->addWord(wordDisplay))
+            break;
+        wordSet.insert(make_pair(wordUpper, wordDisplay));
     }
 
     return true;
 }
 
 //---------------------------------------------------------------------------
-//  convertEndian
+//  searchSubtree
 //
-//! Convert a buffer between big-endian and little-endian representation.
+//! Find all words matching a conjunction of match conditions in the subtree
+//! below a prefix.
 //
-//! @param data an array to read the data into
-//! @param count the number of 32-bit words to convert
-//! @return the number of words converted
+//! @param conditions the match conditions, positive conditions first
+//! @param spec the search specification, checked for each matching word
+//! @param limits limits on every matching word
+//! @param wordSet the set to receive matching words
+//! @param prefix the prefix leading to the subtree to search
+//! @param splitPrefixes if not null, return the prefixes of subtrees at the
+//! split depth instead of searching them
+//! @param stream the stream to receive matching words as they are found,
+//! or null
 //---------------------------------------------------------------------------
-qint32
-WordGraph::convertEndian(qint32* data, qint32 count)
+void
+WordGraph::searchSubtree(const QList<SearchCondition>& conditions, const
+                         SearchSpec& spec, const SearchLimits& limits,
+                         map<QString, QString>& wordSet, const QByteArray&
+                         prefix, QList<QByteArray>* splitPrefixes,
+                         SearchStream* stream) const
 {
-    for (int i = 0; i < count; ++i) {
-        char* p = (char*) data;
-        char c = p[0];
-        p[0] = p[3];
-        p[3] = c;
-        c = p[1];
-        p[1] = p[2];
-        p[2] = c;
-        ++data;
+    if (conditions.size() > 1) {
+        searchConjunction(conditions, spec, limits, wordSet, prefix,
+                          splitPrefixes, stream);
+        return;
+    }
+
+    const SearchCondition& condition = conditions.first();
+    if (condition.type == SearchCondition::PatternMatch) {
+        searchPattern(condition, spec, limits, wordSet, prefix,
+                      splitPrefixes, stream);
+    }
+    else {
+        searchAnagram(condition, spec, limits, wordSet, prefix,
+                      splitPrefixes, stream);
     }
-    return count;
 }
 
 //---------------------------------------------------------------------------
-//  addWordOld
+//  searchPattern
 //
-//! Add a word at a location in the old-style graph.
+//! Find all words matching a single Pattern match condition.  The pattern
+//! is compiled into a bit-parallel matcher, and the graph is walked with an
+//! explicit stack of edge cursors indexed by depth, so no memory is
+//! allocated until a matching word is found.
 //
-//! @param w the word to add
-//! @param reverse true if the word should be reversed and added to the
-//! reverse list
+//! @param condition the Pattern match condition
+//! @param spec the search specification, checked for each matching word
+//! @param limits limits on every matching word
+//! @param wordSet the set to receive matching words
+//! @param prefix the prefix leading to the subtree to search
+//! @param splitPrefixes if not null, return the prefixes of subtrees at the
+//! split depth instead of searching them
+//! @param stream the stream to receive matching words as they are found,
+//! or null
 //---------------------------------------------------------------------------
 void
-WordGraph::addWordOld(const QString& w, bool reverse)
-{
-    QString word = (reverse ? reverseString(w) : w);
-    Node* node = (reverse ? rtop : top);
-    Node* parentNode = 0;
-    QChar c;
-    int wordLength = word.length();
-    for (int i = 0; i < wordLength; ++i) {
-        c = word.at(i);
-
-        // Empty node, so create a new node and link from its parent
-        if (!node) {
-            node = new Node(c.toAscii());
-            (parentNode ? parentNode->child : (reverse ? rtop : top)) = node;
-        }
+WordGraph::searchPattern(const SearchCondition& condition, const SearchSpec&
+                         spec, const SearchLimits& limits,
+                         map<QString, QString>& wordSet, const QByteArray&
+                         prefix, QList<QByteArray>* splitPrefixes,
+                         SearchStream* stream) const
+{
+    // If the pattern starts with a wildcard and does not end with one,
+    // search the reversed pattern in the reverse graph instead
+    QString pattern = condition.stringValue;
+    if (pattern.isEmpty())
+        pattern = "*";
+
+    bool reversePattern = false;
+    if (pattern.startsWith("*") && !pattern.endsWith("*")) {
+        pattern = reverseString(pattern);
+        reversePattern = true;
+    }
 
-        // Nonempty node, so find the current letter in the chain
-        else {
-            while (node->letter != c) {
-                if (!node->next) {
-                    node->next = new Node(c.toAscii());
-                }
-                node = node->next;
-            }
-        }
+    const qint32* graph = reversePattern ? rdawg : dawg;
+    if (!graph)
+        return;
+    const SummaryTable& summary = getSummaries(reversePattern);
+
+    CompiledPattern compiled;
+    if (!compiled.compile(pattern))
+        return;
+
+    // For each depth, the next edge to visit (null when the node has been
+    // exhausted), the pattern state reached before that edge, and the
+    // included letters not yet seen
+    const qint32* edges[MAX_WORD_LEN];
+    quint64 states[MAX_WORD_LEN];
+    quint32 needed[MAX_WORD_LEN];
+    char word[MAX_WORD_LEN];
+    bool wildcardMatch[MAX_WORD_LEN];
 
-        parentNode = node;
-        node = node->child;
+    // Follow the prefix to the subtree to be searched
+    qint32 node = ROOT_NODE;
+    quint64 state = compiled.getStartState();
+    quint32 stillNeeded = limits.includeMask;
+    int base = prefix.length();
+    for (int i = 0; i < base; ++i) {
+        uchar letter = prefix.at(i);
+        const qint32* edge = findEdge(graph, node, letter);
+        if (!edge)
+            return;
+        state = compiled.step(state, letter, &wildcardMatch[i]);
+        word[i] = letter;
+        stillNeeded = limits.getNeeded(stillNeeded, word, i + 1);
+        node = *edge & M_NODE_POINTER;
     }
 
-    parentNode->eow = true;
-}
+    if (!node || !state || !canDescend(summary[node], limits, base,
+                                       compiled.getMinRemaining(state),
+                                       stillNeeded))
+    {
+        return;
+    }
 
-//---------------------------------------------------------------------------
-//  reverseString
-//
-//! Reverse the characters of a string or pattern.  Character classes, e.g.
-//! "[ABCDE]" are treated as single characters and left intact.
-//
-//! @param s the string to reverse
-//! @return the reversed string
-//---------------------------------------------------------------------------
-QString
-WordGraph::reverseString(const QString& s) const
-{
-    QString reverse;
-    QString tmp;
-    bool inCharClass = false;
-    for (int i = 0; i < s.length(); ++i) {
-        QChar c = s[i];
-
-        if (c == ']') {
-            reverse.prepend(c);
-            reverse.prepend(tmp);
-            tmp.clear();
-            inCharClass = false;
+    int depth = base;
+    edges[depth] = &graph[node];
+    states[depth] = state;
+    needed[depth] = stillNeeded;
+    int numVisited = 0;
+
+    while (depth >= base) {
+        const qint32* edge = edges[depth];
+        if (!edge) {
+            --depth;
+            continue;
         }
 
-        else if (c == '[') {
-            tmp.append(c);
-            inCharClass = true;
-        }
+        if (stream && !(++numVisited % POLL_INTERVAL) && stream->poll())
+            return;
 
-        else if (inCharClass) {
-            tmp.append(c);
-        }
+        qint32 value = *edge;
+        edges[depth] = (value & M_END_OF_NODE) ? 0 : edge + 1;
 
-        else {
-            reverse.prepend(c);
-        }
-    }
+        uchar letter = (value >> V_LETTER) & M_LETTER;
+        if (limits.excluded[letter])
+            continue;
 
-    if (inCharClass)
-        reverse.prepend(tmp);
+        state = compiled.step(states[depth], letter, &wildcardMatch[depth]);
+        if (!state)
+            continue;
 
-    return reverse;
-}
+        word[depth] = letter;
+        int length = depth + 1;
 
-//---------------------------------------------------------------------------
-//  containsWordOld
-//
-//! Determine whether the old-style graph contains a word.
-//
-//! @param w the word to search for
-//---------------------------------------------------------------------------
-bool
-WordGraph::containsWordOld(const QString& w) const
-{
-    Node* node = top;
-    bool eow = false;
-    QChar c;
-    int wordLength = w.length();
-    for (int i = 0; i < wordLength; ++i) {
-        if (!node)
-            return false;
+        if ((value & M_END_OF_WORD) && compiled.accepts(state)) {
+            QString wordUpper = QString::fromLatin1(word, length);
+            QString wordDisplay = wordUpper;
+            for (int i = 0; i < length; ++i) {
+                if (wildcardMatch[i])
+                    wordDisplay[i] = wordDisplay[i].toLower();
+            }
+            if (reversePattern) {
+                wordUpper = reverseString(wordUpper);
+                wordDisplay = reverseString(wordDisplay);
+            }
 
-        c = w.at(i);
-        while (node->letter != c) {
-            if (!node->next)
-                return false;
-            node = node->next;
+            if (matchesSpec(wordUpper, spec)) {
+                if (stream && !stream->addWord(wordDisplay))
+                    return;
+                wordSet.insert(make_pair(wordUpper, wordDisplay));
+            }
         }
 
-        eow = node->eow;
-        node = node->child;
-    }
+        qint32 child = value & M_NODE_POINTER;
+        if (!child)
+            continue;
 
-    return eow;
+        stillNeeded = limits.getNeeded(needed[depth], word, length);
+        if (canDescend(summary[child], limits, length,
+                       compiled.getMinRemaining(state), stillNeeded))
+        {
+            if (splitPrefixes && (length == SPLIT_DEPTH)) {
+                splitPrefixes->append(QByteArray(word, length));
+                continue;
+            }
+            ++depth;
+            edges[depth] = &graph[child];
+            states[depth] = state;
+            needed[depth] = stillNeeded;
+        }
+    }
 }
 
 //---------------------------------------------------------------------------
-//  searchOld
+//  searchAnagram
 //
-//! Search for acceptable words matching a search specification in the
-//! old-style graph.  This code will probably never be updated.  Instead, code
-//! should be added to create a new DAWG structure on the fly when the user
-//! loads a lexicon from a text file.  That will make this method obsolete.
+//! Find all words matching a single Anagram or Subanagram match condition.
+//! The rack is compiled into letter counts and blank and class budgets, and
+//! the graph is walked with the same explicit stack as Pattern matches.
 //
-//! @param spec the search specification
-//! @return a list of acceptable words
+//! @param condition the Anagram or Subanagram match condition
+//! @param spec the search specification, checked for each matching word
+//! @param limits limits on every matching word
+//! @param wordSet the set to receive matching words
+//! @param prefix the prefix leading to the subtree to search
+//! @param splitPrefixes if not null, return the prefixes of subtrees at the
+//! split depth instead of searching them
+//! @param stream the stream to receive matching words as they are found,
+//! or null
 //---------------------------------------------------------------------------
-QStringList
-WordGraph::searchOld(const SearchSpec& spec) const
+void
+WordGraph::searchAnagram(const SearchCondition& condition, const SearchSpec&
+                         spec, const SearchLimits& limits,
+                         map<QString, QString>& wordSet, const QByteArray&
+                         prefix, QList<QByteArray>* splitPrefixes,
+                         SearchStream* stream) const
 {
-    QStringList wordList;
-    if (!top || spec.conditions.empty())
-        return wordList;
+    if (!dawg)
+        return;
+    const SummaryTable& summary = getSummaries(false);
 
-    QList<SearchCondition> matchConditions;
-    int maxLength = MAX_WORD_LEN;
-    QString excludeLetters;
-    int numWildcardConditions = 0;
+    CompiledRack rack;
+    if (!rack.compile(condition.stringValue,
+                      condition.type == SearchCondition::SubanagramMatch))
+    {
+        return;
+    }
 
-    QListIterator<SearchCondition> it (spec.conditions);
-    while (it.hasNext()) {
-        const SearchCondition& condition = it.next();
+    // For each depth, the next edge to visit (null when the node has been
+    // exhausted) and the included letters not yet seen.  The rack holds a
+    // letter for each depth above the current one, and is popped when
+    // leaving a level.
+    const qint32* edges[MAX_WORD_LEN];
+    quint32 needed[MAX_WORD_LEN];
+    char word[MAX_WORD_LEN];
+    bool wildcardMatch[MAX_WORD_LEN];
 
-        switch (condition.type) {
-            case SearchCondition::PatternMatch:
-            case SearchCondition::AnagramMatch:
-            case SearchCondition::SubanagramMatch:
-            matchConditions.append(condition);
-            if (condition.stringValue.contains("?") ||
-                condition.stringValue.contains("["))
-                ++numWildcardConditions;
-            break;
+    // Follow the prefix to the subtree to be searched
+    qint32 node = ROOT_NODE;
+    quint32 stillNeeded = limits.includeMask;
+    int base = prefix.length();
+    for (int i = 0; i < base; ++i) {
+        uchar letter = prefix.at(i);
+        const qint32* edge = findEdge(dawg, node, letter);
+        if (!edge || !rack.push(letter, &wildcardMatch[i]))
+            return;
+        word[i] = letter;
+        stillNeeded = limits.getNeeded(stillNeeded, word, i + 1);
+        node = *edge & M_NODE_POINTER;
+    }
 
-            case SearchCondition::Length:
-            if (condition.maxValue < maxLength)
-                maxLength = condition.maxValue;
-            break;
+    if (!node || (base >= rack.getMaxLength()) ||
+        !canDescend(summary[node], limits, base, rack.getMinRemaining(),
+                    stillNeeded | rack.getRequiredLetters()))
+    {
+        return;
+    }
 
-            case SearchCondition::IncludeLetters:
-            if (condition.negated)
-                excludeLetters += condition.stringValue;
-            break;
+    int depth = base;
+    edges[depth] = &dawg[node];
+    needed[depth] = stillNeeded;
+    int numVisited = 0;
+
+    while (depth >= base) {
+        const qint32* edge = edges[depth];
+        if (!edge) {
+            --depth;
+            if (depth >= base)
+                rack.pop();
+            continue;
+        }
 
-            default: break;
+        if (stream && !(++numVisited % POLL_INTERVAL) && stream->poll())
+            return;
+
+        qint32 value = *edge;
+        edges[depth] = (value & M_END_OF_NODE) ? 0 : edge + 1;
+
+        uchar letter = (value >> V_LETTER) & M_LETTER;
+        if (limits.excluded[letter] ||
+            !rack.push(letter, &wildcardMatch[depth]))
+        {
+            continue;
         }
-    }
 
-    // Only replace wildcard matches with lower case letters if there is
-    // exactly one pattern using wildcards
-    // XXX: Commented out because it may be a reasonable default to use the
-    // lower case lettering as matched by the first such condition
-    //bool wildcardLower =(numWildcardConditions == 1);
-    bool wildcardLower = true;
+        word[depth] = letter;
+        int length = depth + 1;
 
-    // If no match condition was specified, search for all words matching the
-    // other conditions
-    if (matchConditions.empty()) {
-        SearchCondition condition;
-        condition.type = SearchCondition::PatternMatch;
-        condition.stringValue = "*";
-        matchConditions.append(condition);
+        if ((value & M_END_OF_WORD) && rack.accepts()) {
+            QString wordUpper = QString::fromLatin1(word, length);
+            if (matchesSpec(wordUpper, spec)) {
+                QString wordDisplay = wordUpper;
+                for (int i = 0; i < length; ++i) {
+                    if (wildcardMatch[i])
+                        wordDisplay[i] = wordDisplay[i].toLower();
+                }
+                if (stream && !stream->addWord(wordDisplay))
+                    return;
+                wordSet.insert(make_pair(wordUpper, wordDisplay));
+            }
+        }
+
+        qint32 child = value & M_NODE_POINTER;
+        stillNeeded = limits.getNeeded(needed[depth], word, length);
+        bool descend = child && (length < rack.getMaxLength()) &&
+            canDescend(summary[child], limits, length, rack.getMinRemaining(),
+                       stillNeeded | rack.getRequiredLetters());
+
+        if (descend && splitPrefixes && (length == SPLIT_DEPTH)) {
+            splitPrefixes->append(QByteArray(word, length));
+            descend = false;
+        }
+
+        if (descend) {
+            ++depth;
+            edges[depth] = &dawg[child];
+            needed[depth] = stillNeeded;
+        }
+        else {
+            rack.pop();
+        }
     }
+}
 
-    map<QString, QString> finalWordSet;
-    map<QString, QString>::iterator sit;
-    int conditionNum = 0;
+//---------------------------------------------------------------------------
+//  searchConjunction
+//
+//! Find all words matching every one of several match conditions with a
+//! single walk of the graph.  The conditions are compiled together, and an
+//! edge is cut off as soon as any positive condition rejects it.  Lower
+//! case letters in the results are those matched by wildcards in the first
+//! condition.
+//
+//! @param conditions the match conditions, positive conditions first
+//! @param spec the search specification, checked for each matching word
+//! @param limits limits on every matching word
+//! @param wordSet the set to receive matching words
+//! @param prefix the prefix leading to the subtree to search
+//! @param splitPrefixes if not null, return the prefixes of subtrees at the
+//! split depth instead of searching them
+//! @param stream the stream to receive matching words as they are found,
+//! or null
+//---------------------------------------------------------------------------
+void
+WordGraph::searchConjunction(const QList<SearchCondition>& conditions,
+                             const SearchSpec& spec, const SearchLimits&
+                             limits, map<QString, QString>& wordSet, const
+                             QByteArray& prefix, QList<QByteArray>*
+                             splitPrefixes, SearchStream* stream) const
+{
+    if (!dawg)
+        return;
+    const SummaryTable& summary = getSummaries(false);
 
-    // Search for each condition separately, and take the conjunction or
-    // disjunction of the result sets
-    QListIterator<SearchCondition> mit (matchConditions);
-    while (mit.hasNext()) {
-        const SearchCondition& condition = mit.next();
-        QString unmatched = condition.stringValue;
+    CompiledConditions compiled;
+    if (!compiled.compile(conditions))
+        return;
 
-        // Use set to eliminate duplicates since patterns with wildcards may
-        // match the same word in more than one way
-        map<QString, QString> wordSet;
-        stack <TraversalStateOld> states;
-        QString word;
+    // For each depth, the next edge to visit (null when the node has been
+    // exhausted) and the included letters not yet seen.  The conditions
+    // hold a letter for each depth above the current one, and are popped
+    // when leaving a level.
+    const qint32* edges[MAX_WORD_LEN];
+    quint32 needed[MAX_WORD_LEN];
+    char word[MAX_WORD_LEN];
+    bool wildcardMatch[MAX_WORD_LEN];
 
-        bool wildcard = false;
-        bool reversePattern = false;
+    // Follow the prefix to the subtree to be searched
+    qint32 node = ROOT_NODE;
+    quint32 stillNeeded = limits.includeMask;
+    int base = prefix.length();
+    for (int i = 0; i < base; ++i) {
+        uchar letter = prefix.at(i);
+        const qint32* edge = findEdge(dawg, node, letter);
+        if (!edge || !compiled.push(letter, &wildcardMatch[i]))
+            return;
+        word[i] = letter;
+        stillNeeded = limits.getNeeded(stillNeeded, word, i + 1);
+        node = *edge & M_NODE_POINTER;
+    }
 
-        // If Pattern match is unspecified, change it to a single wildcard
-        // character.  Also, remove any redundant wildcards.
-        if (condition.type == SearchCondition::PatternMatch) {
-            if (unmatched.isEmpty())
-                unmatched = "*";
-            else
-                unmatched.replace(QRegExp("\\*+"), "*");
+    if (!node || (base >= compiled.getMaxLength()) ||
+        !canDescend(summary[node], limits, base, compiled.getMinRemaining(),
+                    stillNeeded | compiled.getRequiredLetters()))
+    {
+        return;
+    }
 
-            if ((unmatched.left(1) == "*") && (unmatched.right(1) != "*")) {
-                unmatched = reverseString(unmatched);
-                reversePattern = true;
-            }
+    int depth = base;
+    edges[depth] = &dawg[node];
+    needed[depth] = stillNeeded;
+    int numVisited = 0;
+
+    while (depth >= base) {
+        const qint32* edge = edges[depth];
+        if (!edge) {
+            --depth;
+            if (depth >= base)
+                compiled.pop();
+            continue;
         }
 
-        // If Anagram or Subanagram match contains a wildcard, note it and remove
-        // the wildcard character from the match pattern.  Also move character
-        // classes to the end of the string so they will be seen last if
-        // moving sequentially through the string looking for matches.
-        else if ((condition.type == SearchCondition::AnagramMatch) ||
-                 (condition.type == SearchCondition::SubanagramMatch))
+        if (stream && !(++numVisited % POLL_INTERVAL) && stream->poll())
+            return;
+
+        qint32 value = *edge;
+        edges[depth] = (value & M_END_OF_NODE) ? 0 : edge + 1;
+
+        uchar letter = (value >> V_LETTER) & M_LETTER;
+        if (limits.excluded[letter] ||
+            !compiled.push(letter, &wildcardMatch[depth]))
         {
-            wildcard = unmatched.contains('*');
-            if (wildcard)
-                unmatched = unmatched.replace('*', QString());
-
-            QRegExp re ("\\[[^\\]]*\\][^\\W_\\d]");
-            int pos = 0;
-            while ((pos = re.indexIn(unmatched, pos)) >= 0) {
-                unmatched = unmatched.left(re.pos()) +
-                    unmatched.right(unmatched.length() -
-                                   (re.pos() + re.matchedLength()) + 1) +
-                    unmatched.mid(re.pos(), re.matchedLength() - 1);
-                pos += re.matchedLength();
-            }
+            continue;
         }
 
-        Node* node = (reversePattern ? rtop : top);
-
-        // Traverse the tree looking for matches
-        while (node) {
-
-            // Stop if word is at max length
-            if (int(word.length()) < maxLength) {
-                QString origWord = word;
-                QString origUnmatched = unmatched;
-
-                QString match;
-                int closeIndex = 0;
-
-                // Get the next character in the Pattern match.  Allow a
-                // wildcard to match the empty string.
-                if ((condition.type == SearchCondition::PatternMatch) &&
-                    (!unmatched.isEmpty()))
-                {
-                    match = unmatched.at(0);
-                    if (match == "*")
-                        states.push(TraversalStateOld(node, word,
-                            unmatched.right(unmatched.length() - 1)));
-
-                    else if (match == "[") {
-                        closeIndex = unmatched.indexOf(']', 0);
-                        match = unmatched.mid(1, closeIndex);
-                    }
-                }
+        word[depth] = letter;
+        int length = depth + 1;
 
-                // Traverse next nodes, looking for matches
-                for (; node; node = node->next) {
-                    if (excludeLetters.contains(node->letter))
-                        continue;
-
-                    unmatched = origUnmatched;
-                    word = origWord;
-
-                    // Special processing for Pattern match
-                    if (condition.type == SearchCondition::PatternMatch) {
-
-                        // A node matches wildcard characters or its own
-                        // letter
-                        bool matchLetter = match.contains(node->letter);
-                        bool matchNegated = match.contains("^");
-                        QChar c = (match.contains ("]") || (match == "?"))
-                            ? node->letter.toLower() : node->letter;
-
-                        if ((match == "*") || (match == "?") ||
-                            (matchLetter ^ matchNegated))
-                            word += c;
-                        else
-                            continue;
-
-                        // If this node matches, push its child on the stack
-                        // to be traversed later
-                        if (node->child) {
-                            if (match == "*")
-                                states.push(TraversalStateOld(node->child, word,
-                                                              unmatched));
-
-                            states.push(TraversalStateOld(node->child, word,
-                                unmatched.right(unmatched.length() -
-                                                closeIndex - 1)));
-                        }
-
-                        // If end of word and end of pattern, put the word in
-                        // the list.  If we are searching the reverse list,
-                        // reverse the word first.
-                        QString wordUpper = word.toUpper();
-                        if (reversePattern)
-                            wordUpper = reverseString(wordUpper);
-
-                        if (node->eow &&
-                            ((int(unmatched.length()) == closeIndex + 1) ||
-                            ((int(unmatched.length()) == closeIndex + 2) &&
-                             (QChar(unmatched.at(closeIndex + 1)) == '*'))) &&
-                            matchesSpec(wordUpper, spec) &&
-                            !wordSet.count(wordUpper))
-                        {
-                            wordSet.insert(make_pair(wordUpper,
-                                reversePattern ? reverseString(word)
-                                               : word));
-                        }
-                    }
-
-                    // Special processing for Anagram or Subanagram match
-                    else if
-                        ((condition.type == SearchCondition::AnagramMatch) ||
-                         (condition.type == SearchCondition::SubanagramMatch))
-                    {
-                        // Find the current letter in the pattern.  First,
-                        // prefer to match the letter itself.  Second, prefer
-                        // to match the letter as part of a character class.
-                        // If the letter matches more than one character
-                        // class, match the first one and push traversal
-                        // states for each of the others that is matched.
-                        // Character classes are guaranteed to be at the end
-                        // of the search string, so once you're in a character
-                        // class, you're always in a character class.
-                        int len = unmatched.length();
-                        bool inGroup = false;
-                        bool found = false;
-                        bool negated = false;
-                        int matchStart = -1;
-                        int matchEnd = -1;
-                        int groupStart = -1;
-                        bool wildcardMatch = false;
-                        for (int i = 0; i < len; ++i) {
-                            QChar c = unmatched.at(i);
-
-                            if (c == '[') {
-                                inGroup = true;
-                                negated = false;
-                                groupStart = i;
-                            }
-
-                            else if (inGroup) {
-                                if (c == '^')
-                                    negated = true;
-
-                                else if (c == ']') {
-                                    if (found ^ negated) {
-                                        if (matchEnd < 0) {
-                                            matchStart = groupStart;
-                                            matchEnd = i;
-                                            wildcardMatch = true;
-                                        }
-
-                                        else if (node->child) {
-                                            states.push(TraversalStateOld(
-                                                node->child,
-                                                word + node->letter,
-                                                unmatched.left(groupStart) +
-                                                unmatched.right(
-                                                unmatched.length() - i - 1)));
-                                        }
-                                    }
-                                    inGroup = false;
-                                    found = false;
-                                    negated = false;
-                                }
-
-                                else if (c == node->letter)
-                                    found = true;
-                            }
-
-                            // Matched the character itself
-                            else if (c == node->letter) {
-                                found = true;
-                                matchStart = i;
-                                matchEnd = i;
-                                break;
-                            }
-                        }
-
-                        // Try to match the current letter against the
-                        // pattern.  If the letter doesn't match exactly,
-                        // match a ? char.
-                        //int index = unmatched.find(node->letter);
-                        found = (matchStart >= 0);
-                        if (!found) {
-                            matchStart = matchEnd = unmatched.indexOf("?");
-                            found = (matchStart >= 0);
-                            wildcardMatch = true;
-                        }
-
-                        // If this letter matched or a wildcard was specified,
-                        // keep traversing after possibly adding the current
-                        // word.
-                        if (found || wildcard) {
-                            word += (found && !wildcardMatch) ? node->letter
-                                : node->letter.toLower();
-
-                            if (found)
-                                unmatched.replace(matchStart,
-                                                  matchEnd - matchStart + 1,
-                                                  QString());
-
-                            if (node->child &&
-                                (wildcard || !unmatched.isEmpty()))
-                            {
-                                states.push(TraversalStateOld(node->child, word,
-                                                              unmatched));
-                            }
-
-                            QString wordUpper = word.toUpper();
-                            if (node->eow &&
-                                ((condition.type ==
-                                  SearchCondition::SubanagramMatch) ||
-                                  unmatched.isEmpty()) &&
-                                  matchesSpec(wordUpper, spec) &&
-                                  !wordSet.count(wordUpper))
-                            {
-                                wordSet.insert(make_pair(wordUpper, word));
-                            }
-                        }
-                    }
+        if ((value & M_END_OF_WORD) && compiled.accepts()) {
+            QString wordUpper = QString::fromLatin1(word, length);
+            if (matchesSpec(wordUpper, spec)) {
+                QString wordDisplay = wordUpper;
+                for (int i = 0; i < length; ++i) {
+                    if (wildcardMatch[i])
+                        wordDisplay[i] = wordDisplay[i].toLower();
                 }
-            }
-
-            // Done traversing next nodes, pop a child off the stack
-            node = 0;
-            if (states.size()) {
-                TraversalStateOld state = states.top();
-                node = state.node;
-                unmatched = state.unmatched;
-                word = state.word;
-                states.pop();
+                if (stream && !stream->addWord(wordDisplay))
+                    return;
+                wordSet.insert(make_pair(wordUpper, wordDisplay));
             }
         }
 
-        // Take conjunction or disjunction with final result set
-        if (!conditionNum) {
-            finalWordSet = wordSet;
-        }
+        qint32 child = value & M_NODE_POINTER;
+        stillNeeded = limits.getNeeded(needed[depth], word, length);
+        bool descend = child && (length < compiled.getMaxLength()) &&
+            canDescend(summary[child], limits, length,
+                       compiled.getMinRemaining(),
+                       stillNeeded | compiled.getRequiredLetters());
 
-        else if (spec.conjunction) {
-            map<QString, QString> conjunctionSet;
-            for (sit = wordSet.begin(); sit != wordSet.end(); ++sit) {
-                map<QString, QString>::iterator found =
-                    finalWordSet.find(sit->first);
-                if (found != finalWordSet.end())
-                    conjunctionSet.insert(*found);
-            }
-            if (conjunctionSet.empty())
-                return wordList;
-            finalWordSet = conjunctionSet;
+        if (descend && splitPrefixes && (length == SPLIT_DEPTH)) {
+            splitPrefixes->append(QByteArray(word, length));
+            descend = false;
         }
 
+        if (descend) {
+            ++depth;
+            edges[depth] = &dawg[child];
+            needed[depth] = stillNeeded;
+        }
         else {
-            for (sit = wordSet.begin(); sit != wordSet.end(); ++sit) {
-                finalWordSet.insert(*sit);
-            }
+            compiled.pop();
         }
+    }
+}
 
-        ++conditionNum;
+//---------------------------------------------------------------------------
+//  findEdge
+//
+//! Find the edge leaving a node with a particular letter.
+//
+//! @param edges the DAWG edges
+//! @param node the node
+//! @param letter the letter
+//! @return the edge, or null if there is none
+//---------------------------------------------------------------------------
+const qint32*
+WordGraph::findEdge(const qint32* edges, qint32 node, uchar letter) const
+{
+    for (const qint32* edge = &edges[node]; ; ++edge) {
+        if (uchar((*edge >> V_LETTER) & M_LETTER) == letter)
+            return edge;
+        if (*edge & M_END_OF_NODE)
+            return 0;
     }
+}
 
-    // Transform word set into word list and return it
-    for (sit = finalWordSet.begin(); sit != finalWordSet.end(); ++sit) {
-        wordList << (wildcardLower ? sit->second : sit->first);
+//---------------------------------------------------------------------------
+//  findNode
+//
+//! Follow a path of letters from a node.
+//
+//! @param edges the DAWG edges
+//! @param node the node to start from
+//! @param path the letters to follow
+//! @return the node reached, or zero if the path leaves the graph or ends
+//! at a node with no edges
+//---------------------------------------------------------------------------
+qint32
+WordGraph::findNode(const qint32* edges, qint32 node, const QByteArray& path)
+    const
+{
+    for (int i = 0; i < path.size(); ++i) {
+        if (!node)
+            return 0;
+        const qint32* edge = findEdge(edges, node, path.at(i));
+        if (!edge)
+            return 0;
+        node = *edge & M_NODE_POINTER;
+    }
+    return node;
+}
+
+//---------------------------------------------------------------------------
+//  getEndLetters
+//
+//! Get the letters of the edges leaving a node that end a word.
+//
+//! @param edges the DAWG edges
+//! @param node the node, or zero
+//! @return a mask with a bit set for each letter, as returned by
+//! getLetterBit
+//---------------------------------------------------------------------------
+quint32
+WordGraph::getEndLetters(const qint32* edges, qint32 node) const
+{
+    quint32 letters = 0;
+    if (!node)
+        return letters;
+
+    for (const qint32* edge = &edges[node]; ; ++edge) {
+        if (*edge & M_END_OF_WORD)
+            letters |= getLetterBit((*edge >> V_LETTER) & M_LETTER);
+        if (*edge & M_END_OF_NODE)
+            break;
+    }
+    return letters;
+}
+
+//---------------------------------------------------------------------------
+//  filterWords
+//
+//! Find the words in a list that match the conditions of a search
+//! specification checked by the word graph, as if the graph had been
+//! searched for them.  The words are assumed to be in the graph, and the
+//! match conditions are taken as a conjunction.  This lets a short list of
+//! words found some other way be checked without walking the graph.
+//
+//! @param words the words to check
+//! @param spec the search specification
+//! @return the matching words, in the order and case a search would give
+//---------------------------------------------------------------------------
+QStringList
+WordGraph::filterWords(const QStringList& words, const SearchSpec& spec)
+    const
+{
+    QStringList wordList;
+    QList<SearchCondition> posMatchConditions;
+    QList<SearchCondition> negMatchConditions;
+    foreach (const SearchCondition& condition, spec.conditions) {
+        if ((condition.type != SearchCondition::PatternMatch) &&
+            (condition.type != SearchCondition::AnagramMatch) &&
+            (condition.type != SearchCondition::SubanagramMatch))
+        {
+            continue;
+        }
+        if (condition.negated)
+            negMatchConditions.append(condition);
+        else
+            posMatchConditions.append(condition);
+    }
+
+    if (posMatchConditions.empty()) {
+        SearchCondition condition;
+        condition.type = SearchCondition::PatternMatch;
+        condition.stringValue = "*";
+        posMatchConditions.append(condition);
+    }
+
+    CompiledConditions compiled;
+    if (!compiled.compile(posMatchConditions + negMatchConditions))
+        return wordList;
+
+    map<QString, QString> wordSet;
+    bool wildcardMatch[MAX_WORD_LEN];
+    int maxLength = compiled.getMaxLength();
+    foreach (const QString& word, words) {
+        QString wordUpper = word.toUpper();
+        QByteArray letters = wordUpper.toLatin1();
+        int length = letters.length();
+        if (length > maxLength)
+            continue;
+
+        int depth = 0;
+        while ((depth < length) &&
+               compiled.push(uchar(letters.at(depth)),
+                             &wildcardMatch[depth]))
+        {
+            ++depth;
+        }
+        bool matches = (depth == length) && compiled.accepts();
+        for (int i = 0; i < depth; ++i)
+            compiled.pop();
+
+        if (!matches || !matchesSpec(wordUpper, spec))
+            continue;
+
+        QString wordDisplay = wordUpper;
+        for (int i = 0; i < length; ++i) {
+            if (wildcardMatch[i])
+                wordDisplay[i] = wordDisplay[i].toLower();
+        }
+        wordSet.insert(make_pair(wordUpper, wordDisplay));
     }
 
+    map<QString, QString>::iterator sit;
+    for (sit = wordSet.begin(); sit != wordSet.end(); ++sit)
+        wordList << sit->second;
     return wordList;
 }
 
 //---------------------------------------------------------------------------
 //  getNumWords
 //
-//! Return the number of words under a node in the graph.
+//! Return the number of words in the graph.
 //
 //! @return the number of words
 //---------------------------------------------------------------------------
 int
-WordGraph::getNumWords(qint32 node) const
+WordGraph::getNumWords() const
 {
-    int count = 0;
-    for (qint32* edge = &dawg[node]; ; ++edge) {
-        if ((*edge & M_END_OF_WORD) != 0)
-            ++count;
+    return (dawg ? int(getSummaries(false)[ROOT_NODE].numWords) : 0);
+}
+
+//---------------------------------------------------------------------------
+//  getWordId
+//
+//! Get the position of a word in the alphabetical list of words in the
+//! graph.  Words are numbered densely from zero, so the number can index
+//! an array with one entry per word.  The edges before the word's path at
+//! each node are skipped by adding up their word counts.
+//
+//! @param word the word, in upper case
+//! @return the number of the word, or -1 if the word is not in the graph
+//---------------------------------------------------------------------------
+int
+WordGraph::getWordId(const QString& word) const
+{
+    if (!dawg || word.isEmpty())
+        return -1;
+
+    const SummaryTable& summary = getSummaries(false);
+    QByteArray path = word.toLatin1();
+    int id = 0;
+    qint32 node = ROOT_NODE;
+    for (int i = 0; i < path.size(); ++i) {
+        if (!node)
+            return -1;
+
+        uchar letter = path.at(i);
+        const qint32* edge = &dawg[node];
+        for (; ; ++edge) {
+            if (uchar((*edge >> V_LETTER) & M_LETTER) == letter)
+                break;
+            if (*edge & M_END_OF_NODE)
+                return -1;
+            id += getNumEdgeWords(summary, *edge);
+        }
+
+        // A word ending here comes before the longer words below it
+        bool eow = (*edge & M_END_OF_WORD);
+        if (i == path.size() - 1)
+            return (eow ? id : -1);
+        if (eow)
+            ++id;
         node = *edge & M_NODE_POINTER;
-        if (node)
-            count += getNumWords(node);
-        if (*edge & M_END_OF_NODE)
-            break;
     }
-    return count;
+
+    return -1;
 }
 
 //---------------------------------------------------------------------------
-//  Node
+//  getWordAt
 //
-//! Constructor.
+//! Get the word with a particular number, as returned by getWordId.
+//
+//! @param id the number of the word
+//! @return the word, or an empty string if there is no such word
 //---------------------------------------------------------------------------
-WordGraph::Node::Node(char c, bool e)
-    : letter(c), eow(e), next(0), child(0)
+QString
+WordGraph::getWordAt(int id) const
 {
+    if ((id < 0) || (id >= getNumWords()))
+        return QString();
+
+    const SummaryTable& summary = getSummaries(false);
+    char word[MAX_WORD_LEN];
+    int length = 0;
+    qint32 node = ROOT_NODE;
+    while (node && (length < MAX_WORD_LEN)) {
+        const qint32* edge = &dawg[node];
+        for (; ; ++edge) {
+            int count = getNumEdgeWords(summary, *edge);
+            if (id < count)
+                break;
+            if (*edge & M_END_OF_NODE)
+                return QString();
+            id -= count;
+        }
+
+        word[length++] = (*edge >> V_LETTER) & M_LETTER;
+        if (*edge & M_END_OF_WORD) {
+            if (!id)
+                return QString::fromLatin1(word, length);
+            --id;
+        }
+        node = *edge & M_NODE_POINTER;
+    }
+
+    return QString();
 }
 
 //---------------------------------------------------------------------------
-//  ~Node
+//  getNumEdgeWords
 //
-//! Destructor.  Destroy this node along with its next and child nodes.
+//! Return the number of words whose path through the forward graph
+//! includes an edge.
+//
+//! @param summary the summaries of the forward graph
+//! @param edge the edge
+//! @return the number of words
 //---------------------------------------------------------------------------
-WordGraph::Node::~Node()
+int
+WordGraph::getNumEdgeWords(const SummaryTable& summary, qint32 edge) const
 {
-    delete next;
-    delete child;
+    qint32 child = edge & M_NODE_POINTER;
+    return ((edge & M_END_OF_WORD) ? 1 : 0) +
+        (child ? int(summary[child].numWords) : 0);
 }
 
 //---------------------------------------------------------------------------
-//  operator==
+//  getSubstringIndexUsage
 //
-//! Compare two nodes to see if they are equivalent.  Two nodes are
-//! equivalent if their internal data are equal, and if their CHILD and
-//! NEXT pointers are exactly the same.
+//! Get the size of the substring index and the time taken to build it.
 //
-//! @param rhs the right-hand side of the comparison
-//! @return true if equivalent, false otherwise
+//! @param numWords returns the number of words in the index
+//! @param bytes returns the memory usage in bytes
+//! @param buildTime returns the build time in milliseconds
+//! @return true if the index has been built, false otherwise
 //---------------------------------------------------------------------------
 bool
-WordGraph::Node::operator==(const Node& rhs)
+WordGraph::getSubstringIndexUsage(int* numWords, qint64* bytes, int*
+                                  buildTime) const
+{
+    QMutexLocker locker (&substringMutex);
+    if (substringIndex.isEmpty())
+        return false;
+
+    *numWords = substringIndex.getNumWords();
+    *bytes = substringIndex.getMemoryUsage();
+    *buildTime = substringIndex.getBuildTime();
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  getWords
+//
+//! Return all words in the graph, in alphabetical order.
+//
+//! @return a list of words
+//---------------------------------------------------------------------------
+QList<QByteArray>
+WordGraph::getWords() const
+{
+    QList<QByteArray> words;
+    if (!dawg)
+        return words;
+
+    const qint32* edges[MAX_WORD_LEN];
+    char word[MAX_WORD_LEN];
+    int depth = 0;
+    edges[0] = &dawg[ROOT_NODE];
+
+    while (depth >= 0) {
+        const qint32* edge = edges[depth];
+        if (!edge) {
+            --depth;
+            continue;
+        }
+
+        qint32 value = *edge;
+        edges[depth] = (value & M_END_OF_NODE) ? 0 : edge + 1;
+        word[depth] = (value >> V_LETTER) & M_LETTER;
+
+        if (value & M_END_OF_WORD)
+            words.append(QByteArray(word, depth + 1));
+
+        qint32 child = value & M_NODE_POINTER;
+        if (child && (depth + 1 < MAX_WORD_LEN)) {
+            ++depth;
+            edges[depth] = &dawg[child];
+        }
+    }
+
+    return words;
+}
+
+//---------------------------------------------------------------------------
+//  canDescend
+//
+//! Determine whether a child node can lead to a word within the search
+//! limits.
+//
+//! @param child the summary of the child node
+//! @param limits the search limits
+//! @param length the number of letters before the child node
+//! @param minRemaining the fewest letters still needed by the condition
+//! @param needed letters that must still appear in the word
+//! @return true if the child node should be traversed, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordGraph::canDescend(const NodeSummary& child, const SearchLimits& limits,
+                      int length, int minRemaining, quint32 needed) const
+{
+    int shortest = qMax(minRemaining, int(child.minLength));
+    return (length + shortest <= limits.maxLength) &&
+        (length + child.maxLength >= limits.minLength) &&
+        (minRemaining <= child.maxLength) && !(needed & ~child.letters);
+}
+
+//---------------------------------------------------------------------------
+//  getSummaries
+//
+//! Get the reachability summaries of a DAWG, building them the first time
+//! they are needed.  They are built once, so the DAWG is only walked in
+//! full if a search or word numbering needs it.  This is called for every
+//! word by searches running in parallel, so once the summaries are ready
+//! they are returned without locking.
+//
+//! @param reverse true to get the summaries of the reverse DAWG
+//! @return the summaries, which are empty if the DAWG is not loaded
+//---------------------------------------------------------------------------
+const WordGraph::SummaryTable&
+WordGraph::getSummaries(bool reverse) const
+{
+    QAtomicPointer<const SummaryTable>& ready = reverse
+        ? readyReverseSummaries : readySummaries;
+    const SummaryTable* readyTable = ready;
+    if (readyTable)
+        return *readyTable;
+
+    QMutexLocker locker (&summaryMutex);
+    SummaryTable& nodeSummaries = reverse ? reverseSummaries : summaries;
+    const qint32* edges = reverse ? rdawg : dawg;
+    if (nodeSummaries.isEmpty() && edges)
+        nodeSummaries.build(edges, reverse ? numReverseEdges : numEdges);
+    if (!nodeSummaries.isEmpty())
+        ready.fetchAndStoreRelease(&nodeSummaries);
+    return nodeSummaries;
+}
+
+//---------------------------------------------------------------------------
+//  matchesSpec
+//
+//! Determine whether a word matches a search specification.  Only the
+//! following attributes are checked: Include Letters, Consist Letters/Pct,
+//! Min Length, Min Anagrams, Max Anagrams, Min Probability, Max Probability.
+//! All other attributes are assumed to have been checked in the course of
+//! finding the word to be checked.
+//---------------------------------------------------------------------------
+bool
+WordGraph::matchesSpec(QString word, const SearchSpec& spec) const
+{
+    QListIterator<SearchCondition> it (spec.conditions);
+    while (it.hasNext()) {
+        const SearchCondition& condition = it.next();
+
+        switch (condition.type) {
+            case SearchCondition::Length:
+            if ((int(word.length()) < condition.minValue) ||
+                (int(word.length()) > condition.maxValue))
+                return false;
+            break;
+
+            case SearchCondition::IncludeLetters: {
+                QString tmpWord = word;
+                int includeLen = condition.stringValue.length();
+                for (int i = 0; i < includeLen; ++i) {
+                    int index = tmpWord.indexOf(condition.stringValue.at(i));
+                    if ((index < 0) ^ condition.negated)
+                        return false;
+                    tmpWord.replace(index, 1, QString());
+                }
+            }
+            break;
+
+            case SearchCondition::ConsistOf:
+            if ((condition.minValue > 0) || (condition.maxValue < 100)) {
+                int wordLen = word.length();
+                int consist = 0;
+                for (int i = 0; i < wordLen; ++i) {
+                    if (condition.stringValue.contains(word.at(i)))
+                        ++consist;
+                }
+                int consistPct = (consist * 100) / wordLen;
+                if ((consistPct < condition.minValue) ||
+                    (consistPct > condition.maxValue))
+                    return false;
+            }
+            break;
+
+            // XXX: Implement these!
+            //case SearchCondition::NumAnagrams:
+            //case SearchCondition::Probability:
+
+            default: break;
+        }
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  convertEndian
+//
+//! Convert a buffer between big-endian and little-endian representation.
+//
+//! @param data an array to read the data into
+//! @param count the number of 32-bit words to convert
+//! @return the number of words converted
+//---------------------------------------------------------------------------
+qint32
+WordGraph::convertEndian(qint32* data, qint32 count)
+{
+    for (int i = 0; i < count; ++i) {
+        char* p = (char*) data;
+        char c = p[0];
+        p[0] = p[3];
+        p[3] = c;
+        c = p[1];
+        p[1] = p[2];
+        p[2] = c;
+        ++data;
+    }
+    return count;
+}
+
+//---------------------------------------------------------------------------
+//  releaseDawg
+//
+//! Release a forward or reverse DAWG, unmapping its file if it was mapped.
+//
+//! @param reverse true to release the reverse DAWG
+//---------------------------------------------------------------------------
+void
+WordGraph::releaseDawg(bool reverse)
+{
+    qint32*& edges = reverse ? rdawg : dawg;
+    QFile*& file = reverse ? rdawgFile : dawgFile;
+    bool& bundled = reverse ? bundleReverseDawg : bundleDawg;
+    SummaryTable& nodeSummaries = reverse ? reverseSummaries : summaries;
+    QAtomicPointer<const SummaryTable>& ready = reverse
+        ? readyReverseSummaries : readySummaries;
+
+    if (file) {
+        file->unmap((uchar*) edges);
+        delete file;
+    }
+    else if (!bundled)
+        delete[] edges;
+
+    edges = 0;
+    file = 0;
+    bundled = false;
+    ready.fetchAndStoreRelease(0);
+    nodeSummaries.clear();
+
+    if (!reverse) {
+        QMutexLocker locker (&substringMutex);
+        substringIndex.clear();
+    }
+}
+
+//---------------------------------------------------------------------------
+//  reverseString
+//
+//! Reverse the characters of a string or pattern.  Character classes, e.g.
+//! "[ABCDE]" are treated as single characters and left intact.
+//
+//! @param s the string to reverse
+//! @return the reversed string
+//---------------------------------------------------------------------------
+QString
+WordGraph::reverseString(const QString& s) const
+{
+    QString reverse;
+    QString tmp;
+    bool inCharClass = false;
+    for (int i = 0; i < s.length(); ++i) {
+        QChar c = s[i];
+
+        if (c == ']') {
+            reverse.prepend(c);
+            reverse.prepend(tmp);
+            tmp.clear();
+            inCharClass = false;
+        }
+
+        else if (c == '[') {
+            tmp.append(c);
+            inCharClass = true;
+        }
+
+        else if (inCharClass) {
+            tmp.append(c);
+        }
+
+        else {
+            reverse.prepend(c);
+        }
+    }
+
+    if (inCharClass)
+        reverse.prepend(tmp);
+
+    return reverse;
+}
+
+//---------------------------------------------------------------------------
+//  clear
+//
+//! Remove all summaries.
+//---------------------------------------------------------------------------
+void
+WordGraph::SummaryTable::clear()
+{
+    data.clear();
+    nodeBits = 0;
+    nodeRanks = 0;
+    nodeSummaries = 0;
+}
+
+//---------------------------------------------------------------------------
+//  build
+//
+//! Compute the reachability summary of every node in a DAWG.
+//
+//! @param edges the DAWG edges
+//! @param numEdges the number of edges
+//---------------------------------------------------------------------------
+void
+WordGraph::SummaryTable::build(const qint32* edges, qint32 numEdges)
+{
+    clear();
+
+    int numBitWords = getNumBitWords(numEdges);
+    QVector<quint32> bits (numBitWords, 0);
+    bits[ROOT_NODE >> 5] |= quint32(1) << (ROOT_NODE & 31);
+    for (qint32 i = ROOT_NODE; i <= numEdges; ++i) {
+        qint32 child = edges[i] & M_NODE_POINTER;
+        if (child && (child <= numEdges))
+            bits[child >> 5] |= quint32(1) << (child & 31);
+    }
+
+    int numNodes = 0;
+    for (int i = 0; i < numBitWords; ++i)
+        numNodes += countBits(bits[i]);
+
+    QByteArray tableData (2 * numBitWords * sizeof(quint32) +
+                          numNodes * sizeof(NodeSummary), 0);
+    quint32* tableBits = (quint32*) tableData.data();
+    quint32* tableRanks = tableBits + numBitWords;
+    int rank = 0;
+    for (int i = 0; i < numBitWords; ++i) {
+        tableBits[i] = bits[i];
+        tableRanks[i] = rank;
+        rank += countBits(bits[i]);
+    }
+
+    // The summaries are computed in place, now that nodes can be numbered
+    setData(tableData, numEdges);
+    summarizeNode(edges, ROOT_NODE,
+                  (NodeSummary*) (tableRanks + numBitWords));
+}
+
+//---------------------------------------------------------------------------
+//  attach
+//
+//! Use summaries written by getData, such as a section of a lexicon
+//! bundle, in place.
+//
+//! @param tableData the summary data
+//! @param numEdges the number of edges in the DAWG
+//! @return true if successful, false if the data is not valid
+//---------------------------------------------------------------------------
+bool
+WordGraph::SummaryTable::attach(const QByteArray& tableData, qint32 numEdges)
+{
+    clear();
+    if (!setData(tableData, numEdges)) {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  setData
+//
+//! Point the bits, running totals and summaries into summary data, after
+//! checking that the data fits a DAWG.
+//
+//! @param tableData the summary data
+//! @param numEdges the number of edges in the DAWG
+//! @return true if successful, false if the data is not valid
+//---------------------------------------------------------------------------
+bool
+WordGraph::SummaryTable::setData(const QByteArray& tableData, qint32
+                                 numEdges)
+{
+    int numBitWords = getNumBitWords(numEdges);
+    int bitSize = 2 * numBitWords * int(sizeof(quint32));
+    if (tableData.size() < bitSize)
+        return false;
+
+    const quint32* bits = (const quint32*) tableData.constData();
+    const quint32* ranks = bits + numBitWords;
+    int numNodes = ranks[numBitWords - 1] +
+        countBits(bits[numBitWords - 1]);
+    if (tableData.size() != bitSize + numNodes * int(sizeof(NodeSummary)))
+        return false;
+
+    data = tableData;
+    nodeBits = (const quint32*) data.constData();
+    nodeRanks = nodeBits + numBitWords;
+    nodeSummaries = (const NodeSummary*) (nodeRanks + numBitWords);
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  summarizeNode
+//
+//! Compute the reachability summary of a node and all nodes below it.
+//! Nodes already summarized are skipped, so each node is visited once.
+//
+//! @param edges the DAWG edges
+//! @param node the node
+//! @param summaries the summaries being computed, in node order
+//---------------------------------------------------------------------------
+void
+WordGraph::SummaryTable::summarizeNode(const qint32* edges, qint32 node,
+                                       NodeSummary* summaries)
+{
+    NodeSummary& summary = summaries[getIndex(node)];
+    if (summary.minLength)
+        return;
+
+    // Mark the node as visited, so a corrupt graph cannot recurse forever
+    summary.minLength = 0xFF;
+
+    quint32 letters = 0;
+    quint32 numWords = 0;
+    int minLength = 0xFF;
+    int maxLength = 0;
+    for (const qint32* edge = &edges[node]; ; ++edge) {
+        qint32 value = *edge;
+        letters |= getLetterBit((value >> V_LETTER) & M_LETTER);
+
+        if (value & M_END_OF_WORD) {
+            ++numWords;
+            minLength = 1;
+            maxLength = qMax(maxLength, 1);
+        }
+
+        qint32 child = value & M_NODE_POINTER;
+        if (child) {
+            summarizeNode(edges, child, summaries);
+            const NodeSummary& childSummary = summaries[getIndex(child)];
+            letters |= childSummary.letters;
+            numWords += childSummary.numWords;
+            minLength = qMin(minLength, childSummary.minLength + 1);
+            maxLength = qMax(maxLength, childSummary.maxLength + 1);
+        }
+
+        if (value & M_END_OF_NODE)
+            break;
+    }
+
+    summary.letters = letters;
+    summary.numWords = numWords;
+    summary.minLength = qMin(minLength, 0xFF);
+    summary.maxLength = qMin(maxLength, 0xFF);
+}
+
+//---------------------------------------------------------------------------
+//  Builder
+//
+//! Constructor.
+//---------------------------------------------------------------------------
+WordGraph::Builder::Builder()
+{
+    nodes.append(QVector<Edge>());
+    path.append(0);
+}
+
+//---------------------------------------------------------------------------
+//  addWord
+//
+//! Add a word to the graph being built.  Words must be added in sorted
+//! order.  Nodes along the previous word that are no longer shared with the
+//! new word are minimized before the new suffix is appended.
+//
+//! @param word the word to add
+//---------------------------------------------------------------------------
+void
+WordGraph::Builder::addWord(const QByteArray& word)
+{
+    if (word.isEmpty() || (word == previous))
+        return;
+
+    int common = 0;
+    while ((common < word.size()) && (common < previous.size()) &&
+           (word[common] == previous[common]))
+    {
+        ++common;
+    }
+
+    minimize(common);
+
+    for (int i = common; i < word.size(); ++i) {
+        int node = nodes.size();
+        nodes.append(QVector<Edge>());
+        nodes[path.last()].append(Edge(word[i], node));
+        path.append(node);
+    }
+
+    nodes[path[word.size() - 1]].last().eow = true;
+    previous = word;
+}
+
+//---------------------------------------------------------------------------
+//  finish
+//
+//! Minimize the remaining nodes and pack the graph into an edge array.  The
+//! root node is placed at ROOT_NODE and index 0 is left as the terminal node.
+//
+//! @param numEdges returns the number of edges in the array
+//! @return the edge array, to be freed with delete[], or 0 if empty
+//---------------------------------------------------------------------------
+qint32*
+WordGraph::Builder::finish(qint32* numEdges)
+{
+    minimize(0);
+    *numEdges = 0;
+    if (nodes[0].isEmpty())
+        return 0;
+
+    // Assign each reachable node the offset of its first edge
+    QVector<qint32> offsets (nodes.size(), 0);
+    QVector<int> order;
+    qint32 nextOffset = ROOT_NODE + nodes[0].size();
+    offsets[0] = ROOT_NODE;
+    order.append(0);
+    for (int i = 0; i < order.size(); ++i) {
+        const QVector<Edge>& edges = nodes[order[i]];
+        for (int j = 0; j < edges.size(); ++j) {
+            int child = edges[j].child;
+            if ((child < 0) || offsets[child])
+                continue;
+            offsets[child] = nextOffset;
+            nextOffset += nodes[child].size();
+            order.append(child);
+        }
+    }
+
+    if (nextOffset > M_NODE_POINTER)
+        return 0;
+
+    qint32* packed = new qint32[nextOffset];
+    packed[0] = 0;
+    foreach (int node, order) {
+        const QVector<Edge>& edges = nodes[node];
+        qint32* edge = &packed[offsets[node]];
+        for (int j = 0; j < edges.size(); ++j, ++edge) {
+            quint32 value = quint32(uchar(edges[j].letter)) << V_LETTER;
+            if (edges[j].eow)
+                value |= M_END_OF_WORD;
+            if (j == edges.size() - 1)
+                value |= M_END_OF_NODE;
+            if (edges[j].child >= 0)
+                value |= offsets[edges[j].child];
+            *edge = qint32(value);
+        }
+    }
+
+    *numEdges = nextOffset - 1;
+    return packed;
+}
+
+//---------------------------------------------------------------------------
+//  minimize
+//
+//! Replace each node on the current path below a certain depth with an
+//! equivalent registered node, or register it if it is new.  Nodes without
+//! edges are replaced by the terminal node.
+//
+//! @param depth the depth of the deepest node to keep on the path
+//---------------------------------------------------------------------------
+void
+WordGraph::Builder::minimize(int depth)
+{
+    while (path.size() - 1 > depth) {
+        int child = path.last();
+        path.pop_back();
+        Edge& edge = nodes[path.last()].last();
+
+        if (nodes[child].isEmpty()) {
+            edge.child = -1;
+            continue;
+        }
+
+        QByteArray key = signature(child);
+        QHash<QByteArray, int>::const_iterator it = registry.constFind(key);
+        if (it == registry.constEnd())
+            registry.insert(key, child);
+        else
+            edge.child = it.value();
+    }
+}
+
+//---------------------------------------------------------------------------
+//  signature
+//
+//! Return a key identifying a node by its outgoing edges.  Two nodes with
+//! the same signature accept the same set of suffixes.
+//
+//! @param node the node
+//! @return the signature
+//---------------------------------------------------------------------------
+QByteArray
+WordGraph::Builder::signature(int node) const
+{
+    QByteArray key;
+    foreach (const Edge& edge, nodes[node]) {
+        key.append(edge.letter);
+        key.append(edge.eow ? '1' : '0');
+        key.append((const char*) &edge.child, sizeof(edge.child));
+    }
+    return key;
+}
+
+//---------------------------------------------------------------------------
+//  compile
+//
+//! Compile a Pattern match string.  Wildcards become self-looping positions
+//! and every other token becomes a set of letters it can match.
+//
+//! @param pattern the pattern string
+//! @return true if successful, false if the pattern can match no word
+//---------------------------------------------------------------------------
+bool
+WordGraph::CompiledPattern::compile(const QString& pattern)
+{
+    memset(matchMask, 0, sizeof(matchMask));
+    memset(literalMask, 0, sizeof(literalMask));
+    numTokens = 0;
+    starMask = 0;
+    longestLiteral.clear();
+
+    int numLetters = 0;
+    int len = pattern.length();
+    QByteArray literal;
+    for (int i = 0; i < len; ++i) {
+        char c = pattern.at(i).toLatin1();
+
+        if (c != '*' && c != '?' && c != '[') {
+            literal += c;
+            if (literal.length() > longestLiteral.length())
+                longestLiteral = literal;
+        }
+        else
+            literal.clear();
+
+        if (c == '*') {
+            if (numTokens && (starMask & (quint64(1) << (numTokens - 1))))
+                continue;
+            if (numTokens == MAX_TOKENS)
+                return false;
+            starMask |= quint64(1) << numTokens;
+            ++numTokens;
+            continue;
+        }
+
+        if (numTokens == MAX_TOKENS)
+            return false;
+        quint64 bit = quint64(1) << numTokens;
+
+        if (c == '?') {
+            for (int letter = 0; letter < 256; ++letter)
+                matchMask[letter] |= bit;
+        }
+
+        else if (c == '[') {
+            bool negated = false;
+            bool inClass[256];
+            memset(inClass, 0, sizeof(inClass));
+            ++i;
+            if ((i < len) && (pattern.at(i) == '^')) {
+                negated = true;
+                ++i;
+            }
+            for (; (i < len) && (pattern.at(i) != ']'); ++i)
+                inClass[uchar(pattern.at(i).toLatin1())] = true;
+
+            for (int letter = 0; letter < 256; ++letter) {
+                if (inClass[letter] ^ negated)
+                    matchMask[letter] |= bit;
+            }
+        }
+
+        else {
+            matchMask[uchar(c)] |= bit;
+            literalMask[uchar(c)] |= bit;
+        }
+
+        ++numTokens;
+        ++numLetters;
+    }
+
+    if (numLetters > MAX_WORD_LEN)
+        return false;
+
+    acceptMask = quint64(1) << numTokens;
+
+    int remaining = 0;
+    minRemaining[numTokens] = 0;
+    for (int i = numTokens - 1; i >= 0; --i) {
+        if (!(starMask & (quint64(1) << i)))
+            ++remaining;
+        minRemaining[i] = remaining;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  step
+//
+//! Advance a pattern state by one letter.
+//
+//! @param state the current state
+//! @param letter the letter
+//! @param wildcardMatch return whether the letter could only be matched by
+//! a ? or a character class
+//! @return the new state, or zero if the letter cannot be matched
+//---------------------------------------------------------------------------
+quint64
+WordGraph::CompiledPattern::step(quint64 state, uchar letter, bool*
+                                 wildcardMatch) const
+{
+    *wildcardMatch = !(state & (starMask | literalMask[letter]));
+    return closure((state & starMask) | ((state & matchMask[letter]) << 1));
+}
+
+//---------------------------------------------------------------------------
+//  getMinRemaining
+//
+//! Return the fewest letters needed to complete the pattern from a state.
+//! Positions further along never need more letters, so only the furthest
+//! reachable position is considered.
+//
+//! @param state the state, which must not be zero
+//! @return the minimum number of letters remaining
+//---------------------------------------------------------------------------
+int
+WordGraph::CompiledPattern::getMinRemaining(quint64 state) const
+{
+    int pos = 0;
+    for (int shift = 32; shift; shift >>= 1) {
+        if (state >> (pos + shift))
+            pos += shift;
+    }
+    return minRemaining[pos];
+}
+
+//---------------------------------------------------------------------------
+//  compile
+//
+//! Compile an Anagram or Subanagram match string.  Letters are counted,
+//! while each ? and character class becomes a slot that one other letter
+//! may fill.
+//
+//! @param rack the match string
+//! @param subanagram whether words need not use every letter of the rack
+//! @return true if successful, false if the rack can match no word
+//---------------------------------------------------------------------------
+bool
+WordGraph::CompiledRack::compile(const QString& rack, bool subanagram)
+{
+    memset(counts, 0, sizeof(counts));
+    memset(classMask, 0, sizeof(classMask));
+    memset(owner, -1, sizeof(owner));
+    partial = subanagram;
+    wildcard = false;
+    numTiles = 0;
+    numBlanks = 0;
+    numClasses = 0;
+    depth = 0;
+    numExactRemaining = 0;
+    requiredLetters = 0;
+    numOverflow = 0;
+    numMatched = 0;
+
+    int len = rack.length();
+    for (int i = 0; i < len; ++i) {
+        char c = rack.at(i).toLatin1();
+
+        if (c == '*') {
+            wildcard = true;
+            continue;
+        }
+
+        if (numTiles == MAX_WORD_LEN)
+            return false;
+        ++numTiles;
+
+        if (c == '?') {
+            ++numBlanks;
+        }
+
+        else if (c == '[') {
+            bool negated = false;
+            bool inClass[256];
+            memset(inClass, 0, sizeof(inClass));
+            ++i;
+            if ((i < len) && (rack.at(i) == '^')) {
+                negated = true;
+                ++i;
+            }
+            for (; (i < len) && (rack.at(i) != ']'); ++i)
+                inClass[uchar(rack.at(i).toLatin1())] = true;
+
+            for (int letter = 0; letter < 256; ++letter) {
+                if (inClass[letter] ^ negated)
+                    classMask[letter] |= quint32(1) << numClasses;
+            }
+            ++numClasses;
+        }
+
+        else {
+            ++counts[uchar(c)];
+            ++numExactRemaining;
+            requiredLetters |= getLetterBit(c) & LETTER_MASK;
+        }
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  push
+//
+//! Use a letter from the rack.  An exact letter is always preferred, since
+//! leaving it for a later occurrence of the same letter can never allow
+//! more words.  Other letters are matched to a class, a ? or the wildcard.
+//
+//! @param letter the letter
+//! @param wildcardMatch return whether the letter was not matched exactly
+//! @return true if the letter was used, false if it cannot be matched
+//---------------------------------------------------------------------------
+bool
+WordGraph::CompiledRack::push(uchar letter, bool* wildcardMatch)
+{
+    int d = depth;
+    letters[d] = letter;
+
+    if (counts[letter]) {
+        if (!--counts[letter])
+            requiredLetters &= ~getLetterBit(letter);
+        --numExactRemaining;
+        exact[d] = true;
+        *wildcardMatch = false;
+        ++depth;
+        return true;
+    }
+
+    bool blankLeft = wildcard || (numOverflow - numMatched < numBlanks);
+    if (!blankLeft && !classMask[letter])
+        return false;
+
+    memcpy(savedOwner[d], owner, numClasses);
+    overflowLetters[numOverflow] = letter;
+    quint32 visited = 0;
+    bool matched = classMask[letter] && augment(numOverflow, &visited);
+    if (!matched && !blankLeft) {
+        memcpy(owner, savedOwner[d], numClasses);
+        return false;
+    }
+
+    if (matched)
+        ++numMatched;
+    ++numOverflow;
+    exact[d] = false;
+    augmented[d] = matched;
+    *wildcardMatch = true;
+    ++depth;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  pop
+//
+//! Return the most recently used letter to the rack.
+//---------------------------------------------------------------------------
+void
+WordGraph::CompiledRack::pop()
+{
+    --depth;
+    if (exact[depth]) {
+        ++counts[letters[depth]];
+        requiredLetters |= getLetterBit(letters[depth]) & LETTER_MASK;
+        ++numExactRemaining;
+    }
+    else {
+        --numOverflow;
+        if (augmented[depth]) {
+            --numMatched;
+            memcpy(owner, savedOwner[depth], numClasses);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+//  accepts
+//
+//! Determine whether the letters used so far form a match.
+//
+//! @return true if the letters match, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordGraph::CompiledRack::accepts() const
+{
+    return partial || (!numExactRemaining && (numMatched == numClasses) &&
+                       (numOverflow - numMatched >= numBlanks));
+}
+
+//---------------------------------------------------------------------------
+//  getMinRemaining
+//
+//! Return the fewest letters needed to use up the rack.  Each further
+//! letter can use an exact letter, fill a class or fill a ?, but not more
+//! than one of these.
+//
+//! @return the minimum number of letters remaining
+//---------------------------------------------------------------------------
+int
+WordGraph::CompiledRack::getMinRemaining() const
+{
+    if (partial)
+        return 0;
+    int blanksLeft = numBlanks - (numOverflow - numMatched);
+    return numExactRemaining + (numClasses - numMatched) +
+        (blanksLeft > 0 ? blanksLeft : 0);
+}
+
+//---------------------------------------------------------------------------
+//  augment
+//
+//! Try to find a class for an unmatched letter, moving letters already
+//! matched to other classes if necessary.
+//
+//! @param index the index of the letter among letters not matched exactly
+//! @param visited classes already visited in this search
+//! @return true if a class was found, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordGraph::CompiledRack::augment(int index, quint32* visited)
+{
+    quint32 slots = classMask[overflowLetters[index]];
+    for (int i = 0; i < numClasses; ++i) {
+        quint32 bit = quint32(1) << i;
+        if (!(slots & bit) || (*visited & bit))
+            continue;
+        *visited |= bit;
+        if ((owner[i] < 0) || augment(owner[i], visited)) {
+            owner[i] = index;
+            return true;
+        }
+    }
+    return false;
+}
+
+//---------------------------------------------------------------------------
+//  compile
+//
+//! Compile a conjunction of match conditions.  Lower case letters are
+//! reported for wildcards in the first condition, which must be positive.
+//
+//! @param conditions the match conditions
+//! @return true if successful, false if the conditions can match no word
+//---------------------------------------------------------------------------
+bool
+WordGraph::CompiledConditions::compile(const QList<SearchCondition>&
+                                       conditions)
+{
+    patterns.clear();
+    patternNegated.clear();
+    racks.clear();
+    rackNegated.clear();
+    wildcardPattern = false;
+    depth = 0;
+
+    for (int i = 0; i < conditions.size(); ++i) {
+        const SearchCondition& condition = conditions.at(i);
+        bool negated = condition.negated;
+
+        // A condition that cannot be compiled matches no words, so it only
+        // matters if it is positive
+        if (condition.type == SearchCondition::PatternMatch) {
+            CompiledPattern pattern;
+            if (!pattern.compile(condition.stringValue)) {
+                if (negated)
+                    continue;
+                return false;
+            }
+            if (!i)
+                wildcardPattern = true;
+            patterns.append(pattern);
+            patternNegated.append(negated);
+        }
+
+        else {
+            CompiledRack rack;
+            if (!rack.compile(condition.stringValue, condition.type ==
+                              SearchCondition::SubanagramMatch))
+            {
+                if (negated)
+                    continue;
+                return false;
+            }
+            racks.append(rack);
+            rackNegated.append(negated);
+        }
+    }
+
+    numPatterns = patterns.size();
+    numRacks = racks.size();
+    rackFailDepth.fill(-1, numRacks);
+    states.fill(0, (MAX_WORD_LEN + 1) * numPatterns);
+    for (int i = 0; i < numPatterns; ++i)
+        states[i] = patterns.at(i).getStartState();
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  push
+//
+//! Add a letter to every condition.
+//
+//! @param letter the letter
+//! @param wildcardMatch return whether the first condition matched the
+//! letter with a wildcard
+//! @return true if every positive condition accepts the letter, false
+//! otherwise, in which case nothing is changed
+//---------------------------------------------------------------------------
+bool
+WordGraph::CompiledConditions::push(uchar letter, bool* wildcardMatch)
+{
+    if (depth == MAX_WORD_LEN)
+        return false;
+
+    bool ignored;
+    const quint64* current = states.constData() + depth * numPatterns;
+    quint64* next = states.data() + (depth + 1) * numPatterns;
+    for (int i = 0; i < numPatterns; ++i) {
+        bool* match = (!i && wildcardPattern) ? wildcardMatch : &ignored;
+        next[i] = current[i] ? patterns.at(i).step(current[i], letter, match)
+                             : 0;
+        if (!next[i] && !patternNegated.at(i))
+            return false;
+    }
+
+    for (int i = 0; i < numRacks; ++i) {
+        if (rackNegated.at(i)) {
+            if ((rackFailDepth.at(i) < 0) && !racks[i].push(letter, &ignored))
+                rackFailDepth[i] = depth;
+            continue;
+        }
+
+        bool* match = (!i && !wildcardPattern) ? wildcardMatch : &ignored;
+        if (!racks[i].push(letter, match)) {
+            while (i--)
+                popRack(i);
+            return false;
+        }
+    }
+
+    ++depth;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  pop
+//
+//! Remove the last letter pushed from every condition.
+//---------------------------------------------------------------------------
+void
+WordGraph::CompiledConditions::pop()
+{
+    --depth;
+    for (int i = 0; i < numRacks; ++i)
+        popRack(i);
+}
+
+//---------------------------------------------------------------------------
+//  accepts
+//
+//! Determine whether the letters pushed make a word matching every
+//! condition.
+//
+//! @return true if every condition is satisfied, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordGraph::CompiledConditions::accepts() const
+{
+    const quint64* current = states.constData() + depth * numPatterns;
+    for (int i = 0; i < numPatterns; ++i) {
+        if (patterns.at(i).accepts(current[i]) == patternNegated.at(i))
+            return false;
+    }
+
+    for (int i = 0; i < numRacks; ++i) {
+        bool accepted = (rackFailDepth.at(i) < 0) && racks.at(i).accepts();
+        if (accepted == rackNegated.at(i))
+            return false;
+    }
+
+    return true;
+}
+
+//---------------------------------------------------------------------------
+//  getMinRemaining
+//
+//! Return the fewest letters needed to satisfy every positive condition.
+//
+//! @return the minimum number of letters remaining
+//---------------------------------------------------------------------------
+int
+WordGraph::CompiledConditions::getMinRemaining() const
+{
+    int minRemaining = 0;
+    const quint64* current = states.constData() + depth * numPatterns;
+    for (int i = 0; i < numPatterns; ++i) {
+        if (!patternNegated.at(i)) {
+            minRemaining = qMax(minRemaining,
+                                patterns.at(i).getMinRemaining(current[i]));
+        }
+    }
+
+    for (int i = 0; i < numRacks; ++i) {
+        if (!rackNegated.at(i))
+            minRemaining = qMax(minRemaining, racks.at(i).getMinRemaining());
+    }
+
+    return minRemaining;
+}
+
+//---------------------------------------------------------------------------
+//  getMaxLength
+//
+//! Return the length of the longest word the positive conditions allow.
+//
+//! @return the maximum length
+//---------------------------------------------------------------------------
+int
+WordGraph::CompiledConditions::getMaxLength() const
+{
+    int maxLength = MAX_WORD_LEN;
+    for (int i = 0; i < numRacks; ++i) {
+        if (!rackNegated.at(i))
+            maxLength = qMin(maxLength, racks.at(i).getMaxLength());
+    }
+    return maxLength;
+}
+
+//---------------------------------------------------------------------------
+//  getRequiredLetters
+//
+//! Return the letters the positive conditions still require.
+//
+//! @return a mask of required letters, as returned by getLetterBit
+//---------------------------------------------------------------------------
+quint32
+WordGraph::CompiledConditions::getRequiredLetters() const
+{
+    quint32 required = 0;
+    for (int i = 0; i < numRacks; ++i) {
+        if (!rackNegated.at(i))
+            required |= racks.at(i).getRequiredLetters();
+    }
+    return required;
+}
+
+//---------------------------------------------------------------------------
+//  popRack
+//
+//! Remove the last letter pushed from a rack.  A negated rack that could
+//! not take the letter was left unchanged, and becomes unsatisfied again.
+//
+//! @param index the index of the rack
+//---------------------------------------------------------------------------
+void
+WordGraph::CompiledConditions::popRack(int index)
+{
+    int failDepth = rackFailDepth.at(index);
+    if (failDepth == depth)
+        rackFailDepth[index] = -1;
+    else if (failDepth < 0)
+        racks[index].pop();
+}
+
+//---------------------------------------------------------------------------
+//  SearchLimits
+//
+//! Constructor.  No limits are set initially.
+//---------------------------------------------------------------------------
+WordGraph::SearchLimits::SearchLimits()
+    : minLength(0), maxLength(MAX_WORD_LEN), includeMask(0)
+{
+    memset(excluded, 0, sizeof(excluded));
+    memset(includeCounts, 0, sizeof(includeCounts));
+}
+
+//---------------------------------------------------------------------------
+//  include
+//
+//! Require letters to appear in every word.  A letter listed more than
+//! once must appear at least that many times.
+//
+//! @param letters the letters
+//---------------------------------------------------------------------------
+void
+WordGraph::SearchLimits::include(const QString& letters)
+{
+    int counts[26];
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < letters.length(); ++i) {
+        uchar letter = letters.at(i).toLatin1();
+        quint32 bit = getLetterBit(letter) & LETTER_MASK;
+        if (!bit)
+            continue;
+        includeMask |= bit;
+        int& count = counts[letter - 'A'];
+        ++count;
+        if (count > includeCounts[letter - 'A'])
+            includeCounts[letter - 'A'] = count;
+    }
+}
+
+//---------------------------------------------------------------------------
+//  exclude
+//
+//! Forbid letters from appearing in any word.
+//
+//! @param letters the letters
+//---------------------------------------------------------------------------
+void
+WordGraph::SearchLimits::exclude(const QString& letters)
+{
+    for (int i = 0; i < letters.length(); ++i)
+        excluded[uchar(letters.at(i).toLatin1())] = true;
+}
+
+//---------------------------------------------------------------------------
+//  getNeeded
+//
+//! Update the set of included letters still needed after a letter has been
+//! added to a word.
+//
+//! @param needed the letters needed before the last letter was added
+//! @param word the word, including the last letter
+//! @param length the length of the word
+//! @return the letters still needed
+//---------------------------------------------------------------------------
+quint32
+WordGraph::SearchLimits::getNeeded(quint32 needed, const char* word, int
+                                   length) const
+{
+    uchar letter = word[length - 1];
+    quint32 bit = getLetterBit(letter) & needed;
+    if (!bit)
+        return needed;
+
+    int count = 0;
+    for (int i = 0; i < length; ++i) {
+        if (word[i] == char(letter))
+            ++count;
+    }
+    return (count >= includeCounts[letter - 'A']) ? (needed & ~bit) : needed;
+}
+
+//---------------------------------------------------------------------------
+//  run
+//
+//! Search subtrees of a parallel search until none are left.
+//
+//! @param wordSet the set to receive matching words
+//---------------------------------------------------------------------------
+void
+WordGraph::SearchJob::run(map<QString, QString>& wordSet)
+{
+    int numPrefixes = prefixes.size();
+    for (;;) {
+        int index = nextPrefix.fetchAndAddRelaxed(1);
+        if ((index >= numPrefixes) || (stream && stream->isStopped()))
+            break;
+        graph->searchSubtree(conditions, spec, limits, wordSet,
+                             prefixes.at(index), 0, stream);
+
+        // Deliver words found by any thread, if this is the thread that
+        // began the search
+        if (stream)
+            stream->flush();
+    }
+}
+
+//---------------------------------------------------------------------------
+//  run
+//
+//! Take part in a parallel search, then signal that this thread is done.
+//---------------------------------------------------------------------------
+void
+WordGraph::SearchWorker::run()
 {
-    return ((letter == rhs.letter) && (eow == rhs.eow)
-            && (next == rhs.next) && (child == rhs.child));
+    job->run(*wordSet);
+    job->finished.release();
 }
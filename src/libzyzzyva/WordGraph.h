@@ -25,13 +25,38 @@
 #ifndef ZYZZYVA_WORD_GRAPH_H
 #define ZYZZYVA_WORD_GRAPH_H
 
+#include "Defs.h"
 #include "SearchSpec.h"
+#include "SubstringIndex.h"
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QByteArray>
 #include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QString>
 #include <QStringList>
+#include <QVector>
+#include <map>
+
+class LexiconBundle;
+class SearchStream;
 
 class WordGraph
 {
+    public:
+    // Bits for the letters A-Z, plus one bit shared by all other letters
+    static const quint32 LETTER_MASK = 0x3FFFFFF;
+    static const quint32 OTHER_LETTER_BIT = 0x4000000;
+
+    static quint32 getLetterBit(uchar letter) {
+        return ((letter >= 'A') && (letter <= 'Z'))
+            ? (quint32(1) << (letter - 'A')) : OTHER_LETTER_BIT; }
+    static QString getLetters(quint32 letterBits);
+
     public:
     WordGraph();
     ~WordGraph();
@@ -39,60 +64,337 @@ class WordGraph
     void clear();
     bool importDawgFile(const QString& filename, bool reverse, QString*
                         errString, quint16* expectedChecksum);
-    void addWord(const QString& w);
+    bool importWords(const QStringList& words);
+    bool attachBundle(const LexiconBundle& bundle, QString* errString = 0);
+    void writeBundle(LexiconBundle& bundle) const;
+    bool verifyChecksums(QString* errString);
     bool containsWord(const QString& w) const;
-    QStringList search(const SearchSpec& spec) const;
+    quint32 getFrontHooks(const QString& word) const;
+    quint32 getBackHooks(const QString& word) const;
+    QStringList search(const SearchSpec& spec, SearchStream* stream = 0)
+        const;
+    QStringList filterWords(const QStringList& words, const SearchSpec& spec)
+        const;
     int getNumWords() const;
+    int getWordId(const QString& word) const;
+    QString getWordAt(int id) const;
+    QList<QByteArray> getWords() const;
+    bool getSubstringIndexUsage(int* numWords, qint64* bytes, int*
+                                buildTime) const;
 
     private:
-    class Node {
+    // The letters appearing below a node, the number of words below it, and
+    // the shortest and longest paths from the node to the end of a word
+    class NodeSummary {
+      public:
+        NodeSummary() : letters(0), numWords(0), minLength(0), maxLength(0)
+            { }
+        quint32 letters;
+        quint32 numWords;
+        quint8 minLength;
+        quint8 maxLength;
+    };
+
+    // The reachability summaries of the nodes of a DAWG.  A node is any
+    // edge pointed to by another edge, so nodes sharing the tail of an edge
+    // list are told apart.  Nodes are numbered by a bit for each edge,
+    // counted with the help of a running total for each word of bits, and
+    // only the nodes have summaries.  The data is held in a single array
+    // so it can be written to and used in place from a lexicon bundle.
+    class SummaryTable {
       public:
-        Node(char c = 0, bool e = false);
-        ~Node();
-        bool operator==(const Node& rhs);
-        QChar letter;
-        bool eow;
-        Node* next;
-        Node* child;
+        SummaryTable() : nodeBits(0), nodeRanks(0), nodeSummaries(0) { }
+        void clear();
+        bool isEmpty() const { return !nodeSummaries; }
+        void build(const qint32* edges, qint32 numEdges);
+        bool attach(const QByteArray& tableData, qint32 numEdges);
+        QByteArray getData() const { return data; }
+        const NodeSummary& operator[](qint32 node) const {
+            return nodeSummaries[getIndex(node)]; }
+
+      private:
+        int getIndex(qint32 node) const {
+            int word = node >> 5;
+            quint32 below = nodeBits[word] & ((quint32(1) << (node & 31)) - 1);
+            return nodeRanks[word] + countBits(below); }
+        static int countBits(quint32 bits) {
+            bits = bits - ((bits >> 1) & 0x55555555);
+            bits = (bits & 0x33333333) + ((bits >> 2) & 0x33333333);
+            return (((bits + (bits >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24; }
+        static int getNumBitWords(qint32 numEdges) {
+            return (numEdges + 32) / 32; }
+        bool setData(const QByteArray& tableData, qint32 numEdges);
+        void summarizeNode(const qint32* edges, qint32 node, NodeSummary*
+                           summaries);
+
+        QByteArray data;
+        const quint32* nodeBits;
+        const quint32* nodeRanks;
+        const NodeSummary* nodeSummaries;
     };
 
-    class TraversalState {
+    // Limits on every word a search can find, used to cut off subtrees
+    // that cannot contain such a word
+    class SearchLimits {
       public:
-        TraversalState(qint32 n, const QString& w, const QString& u)
-            : node(n), word(w), unmatched(u) { }
-        qint32 node;
-        QString word;
-        QString unmatched;
+        SearchLimits();
+        void include(const QString& letters);
+        void exclude(const QString& letters);
+        quint32 getNeeded(quint32 needed, const char* word, int length)
+            const;
+
+        int minLength;
+        int maxLength;
+        bool excluded[256];
+        quint32 includeMask;
+        int includeCounts[26];
     };
 
-    class TraversalStateOld {
+    // A Pattern match compiled into a bit-parallel matcher.  Each bit of a
+    // state is a position in the pattern that the letters seen so far can
+    // reach, so all ways of matching a word are followed at once.
+    class CompiledPattern {
       public:
-        TraversalStateOld(Node* n, const QString& w, const QString& u)
-            : node(n), word(w), unmatched(u) { }
-        Node* node;
-        QString word;
-        QString unmatched;
+        CompiledPattern() : numTokens(0), starMask(0), acceptMask(0) { }
+        bool compile(const QString& pattern);
+        quint64 getStartState() const { return closure(1); }
+        quint64 step(quint64 state, uchar letter, bool* wildcardMatch)
+            const;
+        bool accepts(quint64 state) const { return (state & acceptMask); }
+        int getMinRemaining(quint64 state) const;
+        QByteArray getLongestLiteral() const { return longestLiteral; }
+
+      private:
+        // A wildcard position may also be skipped without consuming a
+        // letter.  Adjacent wildcards are merged, so one shift suffices.
+        quint64 closure(quint64 state) const {
+            return state | ((state & starMask) << 1); }
+
+        static const int MAX_TOKENS = 63;
+        int numTokens;
+        quint64 starMask;
+        quint64 acceptMask;
+        quint64 matchMask[256];
+        quint64 literalMask[256];
+        int minRemaining[MAX_TOKENS + 1];
+        QByteArray longestLiteral;
+    };
+
+    // An Anagram or Subanagram match compiled into letter counts plus a
+    // slot for each ? and character class.  Letters are pushed and popped
+    // as the graph is walked; letters not matched exactly are assigned to
+    // slots by bipartite matching, so no choice ever needs to be retried.
+    class CompiledRack {
+      public:
+        CompiledRack() : partial(false), wildcard(false), numTiles(0),
+            requiredLetters(0), depth(0) { }
+        bool compile(const QString& rack, bool subanagram);
+        int getMaxLength() const {
+            return wildcard ? Defs::MAX_WORD_LEN : numTiles; }
+        bool push(uchar letter, bool* wildcardMatch);
+        void pop();
+        bool accepts() const;
+        int getMinRemaining() const;
+        quint32 getRequiredLetters() const {
+            return partial ? 0 : requiredLetters; }
+
+      private:
+        bool augment(int index, quint32* visited);
+
+        bool partial;
+        bool wildcard;
+        int numTiles;
+        int numBlanks;
+        int numClasses;
+        int counts[256];
+        quint32 classMask[256];
+        quint32 requiredLetters;
+
+        int depth;
+        int numExactRemaining;
+        int numOverflow;
+        int numMatched;
+        qint8 owner[Defs::MAX_WORD_LEN];
+        uchar overflowLetters[Defs::MAX_WORD_LEN];
+        uchar letters[Defs::MAX_WORD_LEN];
+        bool exact[Defs::MAX_WORD_LEN];
+        bool augmented[Defs::MAX_WORD_LEN];
+        qint8 savedOwner[Defs::MAX_WORD_LEN][Defs::MAX_WORD_LEN];
+    };
+
+    // A conjunction of match conditions, matched together so a letter is
+    // rejected as soon as any positive condition rejects it.  A negated
+    // condition rejects a word only if it matches the whole word, so it
+    // never stops the walk, and a rack that cannot take a letter is simply
+    // marked as satisfied until the letter is popped.
+    class CompiledConditions {
+      public:
+        CompiledConditions() : numPatterns(0), numRacks(0),
+            wildcardPattern(false), depth(0) { }
+        bool compile(const QList<SearchCondition>& conditions);
+        bool push(uchar letter, bool* wildcardMatch);
+        void pop();
+        bool accepts() const;
+        int getMinRemaining() const;
+        int getMaxLength() const;
+        quint32 getRequiredLetters() const;
+
+      private:
+        void popRack(int index);
+
+        int numPatterns;
+        int numRacks;
+        QVector<CompiledPattern> patterns;
+        QVector<bool> patternNegated;
+        QVector<CompiledRack> racks;
+        QVector<bool> rackNegated;
+        QVector<int> rackFailDepth;
+        bool wildcardPattern;
+
+        // The state of each pattern before each depth
+        int depth;
+        QVector<quint64> states;
+    };
+
+    // State shared by the threads of a parallel search.  Subtrees are
+    // identified by the prefixes leading to them, and each thread takes the
+    // next unsearched prefix until none are left.
+    class SearchJob {
+      public:
+        SearchJob(const WordGraph* g, const QList<SearchCondition>& c,
+                  const SearchSpec& s, const SearchLimits& l,
+                  SearchStream* st)
+            : graph(g), conditions(c), spec(s), limits(l), stream(st),
+              nextPrefix(0) { }
+        void run(std::map<QString, QString>& wordSet);
+
+        const WordGraph* graph;
+        const QList<SearchCondition>& conditions;
+        const SearchSpec& spec;
+        const SearchLimits& limits;
+        SearchStream* stream;
+        QList<QByteArray> prefixes;
+        QAtomicInt nextPrefix;
+        QSemaphore finished;
+    };
+
+    // Runs part of a parallel search on a pool thread
+    class SearchWorker : public QRunnable {
+      public:
+        SearchWorker(SearchJob* j, std::map<QString, QString>* w)
+            : job(j), wordSet(w) { }
+        void run();
+
+      private:
+        SearchJob* job;
+        std::map<QString, QString>* wordSet;
+    };
+
+    // Incremental builder for a minimal DAWG in the packed edge format
+    // used by the DAWG files.  Words must be added in sorted order.
+    class Builder {
+      public:
+        Builder();
+        void addWord(const QByteArray& word);
+        qint32* finish(qint32* numEdges);
+
+      private:
+        class Edge {
+          public:
+            Edge(char c = 0, int n = -1) : letter(c), eow(false), child(n) { }
+            char letter;
+            bool eow;
+            int child;
+        };
+
+        void minimize(int depth);
+        QByteArray signature(int node) const;
+
+        QVector<QVector<Edge> > nodes;
+        QVector<int> path;
+        QByteArray previous;
+        QHash<QByteArray, int> registry;
     };
 
     private:
+    void searchParallel(const QList<SearchCondition>& conditions, const
+                        SearchSpec& spec, const SearchLimits& limits,
+                        std::map<QString, QString>& wordSet, SearchStream*
+                        stream) const;
+    bool searchSubstring(const SearchCondition& condition, const SearchSpec&
+                         spec, std::map<QString, QString>& wordSet,
+                         SearchStream* stream) const;
+    void searchSubtree(const QList<SearchCondition>& conditions, const
+                       SearchSpec& spec, const SearchLimits& limits,
+                       std::map<QString, QString>& wordSet, const QByteArray&
+                       prefix, QList<QByteArray>* splitPrefixes,
+                       SearchStream* stream) const;
+    void searchConjunction(const QList<SearchCondition>& conditions, const
+                           SearchSpec& spec, const SearchLimits& limits,
+                           std::map<QString, QString>& wordSet, const
+                           QByteArray& prefix, QList<QByteArray>*
+                           splitPrefixes, SearchStream* stream) const;
+    void searchPattern(const SearchCondition& condition, const SearchSpec&
+                       spec, const SearchLimits& limits,
+                       std::map<QString, QString>& wordSet, const QByteArray&
+                       prefix, QList<QByteArray>* splitPrefixes,
+                       SearchStream* stream) const;
+    void searchAnagram(const SearchCondition& condition, const SearchSpec&
+                       spec, const SearchLimits& limits,
+                       std::map<QString, QString>& wordSet, const QByteArray&
+                       prefix, QList<QByteArray>* splitPrefixes,
+                       SearchStream* stream) const;
+    const qint32* findEdge(const qint32* edges, qint32 node, uchar letter)
+        const;
+    qint32 findNode(const qint32* edges, qint32 node, const QByteArray&
+                    path) const;
+    quint32 getEndLetters(const qint32* edges, qint32 node) const;
+    bool canDescend(const NodeSummary& child, const SearchLimits& limits,
+                    int length, int minRemaining, quint32 needed) const;
+    const SummaryTable& getSummaries(bool reverse) const;
     bool matchesSpec(QString word, const SearchSpec& spec) const;
     QString reverseString(const QString& s) const;
     qint32 convertEndian(qint32* data, qint32 count);
-
-    void addWordOld(const QString& w, bool reverse);
-    bool containsWordOld(const QString& w) const;
-    QStringList searchOld(const SearchSpec& spec) const;
-    int getNumWords(qint32 node) const;
+    void releaseDawg(bool reverse);
+    int getNumEdgeWords(const SummaryTable& summary, qint32 edge) const;
 
     qint32* dawg;
     qint32* rdawg;
 
-    bool bigEndian;
+    // Reachability summaries, built when first needed unless they are held
+    // by a lexicon bundle the graph is attached to.  Each table is
+    // published once it is ready, and is only read after that, so the
+    // mutex is only taken until then.
+    mutable SummaryTable summaries;
+    mutable SummaryTable reverseSummaries;
+    mutable QAtomicPointer<const SummaryTable> readySummaries;
+    mutable QAtomicPointer<const SummaryTable> readyReverseSummaries;
+    mutable QMutex summaryMutex;
 
-    // OLD dawg structures - only used where new DAWG is unavailable
-    Node* top;
-    Node* rtop;
-    int numWords;
+    // Index of the words containing each string of letters, built when
+    // first needed
+    mutable SubstringIndex substringIndex;
+    mutable QMutex substringMutex;
+
+    // Files backing memory-mapped DAWGs - null if the DAWG is on the heap
+    QFile* dawgFile;
+    QFile* rdawgFile;
+
+    // Whether the DAWGs are held by a lexicon bundle, and must not be freed
+    bool bundleDawg;
+    bool bundleReverseDawg;
+
+    // Checksums to be verified lazily, after the lexicon has been loaded
+    qint32 numEdges;
+    qint32 numReverseEdges;
+    quint16 expectedChecksum;
+    quint16 expectedReverseChecksum;
+    qint32 computedChecksum;
+    qint32 computedReverseChecksum;
+    bool checksumPending;
+    bool reverseChecksumPending;
+
+    bool bigEndian;
 };
 
 #endif // ZYZZYVA_WORD_GRAPH_H
@@ -26,6 +26,8 @@
 #include "Defs.h"
 #include "DefinitionLabel.h"
 #include "MainSettings.h"
+#include "MainWindow.h"
+#include "SearchService.h"
 #include "WordEngine.h"
 #include "WordTableView.h"
 #include "ZPushButton.h"
@@ -53,8 +55,10 @@ using namespace Defs;
 WordVariationDialog::WordVariationDialog(WordEngine* we, const QString& lex,
     const QString& word, WordVariationType variation, QWidget* parent,
     Qt::WFlags f)
-    : QDialog(parent, f), wordEngine(we), lexicon(lex), topView(0), topModel(0),
-    middleView(0), middleModel(0), bottomView(0), bottomModel(0)
+    : QDialog(parent, f), wordEngine(we), lexicon(lex), middleLabel(0),
+    bottomLabel(0), topView(0), topModel(0), middleView(0), middleModel(0),
+    bottomView(0), bottomModel(0), searchRequestId(0),
+    sortAlphabetically(false)
 {
     int numLists = getNumLists(variation);
 
@@ -155,7 +159,6 @@ WordVariationDialog::setWordVariation(const QString& word, WordVariationType
                                       variation)
 {
     bool forceAlphabetSort = false;
-    bool origGroupByAnagrams = MainSettings::getWordListGroupByAnagrams();
     QString title, topTitle, middleTitle, bottomTitle;
     SearchSpec spec;
     SearchCondition condition;
@@ -275,64 +278,79 @@ WordVariationDialog::setWordVariation(const QString& word, WordVariationType
     setWindowTitle(title);
     wordLabel->setText(title);
 
-    QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
-
-    // Populate the top list
-    QList<WordTableModel::WordItem> wordItems = getWordItems(topSpecs);
-
-    // FIXME: Probably not the right way to get alphabetical sorting instead
-    // of alphagram sorting
-    if (forceAlphabetSort)
-        MainSettings::setWordListGroupByAnagrams(false);
-    topModel->addWords(wordItems);
-    if (forceAlphabetSort)
-        MainSettings::setWordListGroupByAnagrams(origGroupByAnagrams);
+    // Search for the words in the background, and fill in the lists when
+    // the searches are finished
+    sortAlphabetically = forceAlphabetSort;
+    listTitles.clear();
+    listSizes.clear();
+    listTitles << topTitle << middleTitle << bottomTitle;
+    listSizes << topSpecs.size() << middleSpecs.size() << bottomSpecs.size();
+
+    topLabel->setText(topTitle + " : searching...");
+    if (!middleSpecs.empty())
+        middleLabel->setText(middleTitle + " : searching...");
+    if (!bottomSpecs.empty())
+        bottomLabel->setText(bottomTitle + " : searching...");
+
+    SearchService* searchService =
+        MainWindow::getInstance()->getSearchService();
+    connect(searchService, SIGNAL(searchFinished(int)),
+            SLOT(searchFinished(int)), Qt::UniqueConnection);
+    searchRequestId = searchService->search(
+        this, lexicon, topSpecs + middleSpecs + bottomSpecs, false,
+        SearchService::HighPriority);
+}
 
-    int topWords = topModel->rowCount();
-    topTitle += " : " + QString::number(topWords) + " word";
-    if (topWords != 1)
-        topTitle += "s";
-    topLabel->setText(topTitle);
+//---------------------------------------------------------------------------
+//  searchFinished
+//
+//! Called when a search is finished.  If it is the search for the words of
+//! this dialog, fill in the word lists.
+//
+//! @param requestId the search request ID
+//---------------------------------------------------------------------------
+void
+WordVariationDialog::searchFinished(int requestId)
+{
+    if (!searchRequestId || (requestId != searchRequestId))
+        return;
 
-    // Populate the middle list
-    if (!middleSpecs.empty()) {
-        wordItems = getWordItems(middleSpecs);
+    searchRequestId = 0;
+    SearchService* searchService =
+        MainWindow::getInstance()->getSearchService();
+    QList<QStringList> results = searchService->getResults(requestId);
 
-        // FIXME: Probably not the right way to get alphabetical sorting
-        // instead of alphagram sorting
-        if (forceAlphabetSort)
-            MainSettings::setWordListGroupByAnagrams(false);
-        middleModel->addWords(wordItems);
-        if (forceAlphabetSort)
-            MainSettings::setWordListGroupByAnagrams(origGroupByAnagrams);
+    QList<WordTableModel*> models;
+    QList<QLabel*> labels;
+    models << topModel << middleModel << bottomModel;
+    labels << topLabel << middleLabel << bottomLabel;
 
-        int middleWords = middleModel->rowCount();
-        middleTitle += " : " + QString::number(middleWords) + " word";
-        if (middleWords != 1)
-            middleTitle += "s";
-        middleLabel->setText(middleTitle);
-    }
+    int start = 0;
+    for (int i = 0; i < models.size(); ++i) {
+        int numSpecs = listSizes.value(i);
+        if (!models[i] || !numSpecs)
+            continue;
 
-    // Populate the bottom list
-    if (!bottomSpecs.empty()) {
-        wordItems = getWordItems(bottomSpecs);
+        QList<WordTableModel::WordItem> wordItems =
+            getWordItems(results.mid(start, numSpecs));
+        start += numSpecs;
 
         // FIXME: Probably not the right way to get alphabetical sorting
         // instead of alphagram sorting
-        if (forceAlphabetSort)
+        bool origGroupByAnagrams = MainSettings::getWordListGroupByAnagrams();
+        if (sortAlphabetically)
             MainSettings::setWordListGroupByAnagrams(false);
-        bottomModel->addWords(wordItems);
-        if (forceAlphabetSort)
+        models[i]->addWords(wordItems);
+        if (sortAlphabetically)
             MainSettings::setWordListGroupByAnagrams(origGroupByAnagrams);
 
-        int bottomWords = bottomModel->rowCount();
-        bottomTitle += " : " + QString::number(bottomWords) + " word";
-        if (bottomWords != 1)
-            bottomTitle += "s";
-        bottomLabel->setText(bottomTitle);
+        int numWords = models[i]->rowCount();
+        QString title = listTitles[i] + " : " + QString::number(numWords) +
+            " word";
+        if (numWords != 1)
+            title += "s";
+        labels[i]->setText(title);
     }
-
-    QApplication::restoreOverrideCursor();
 }
 
 //---------------------------------------------------------------------------
@@ -341,17 +359,17 @@ WordVariationDialog::setWordVariation(const QString& word, WordVariationType
 //! Construct a list of word items to be inserted into a word list, based on
 //! the results of a list of searches.
 //
-//! @param searchSpecs the list of search specifications
+//! @param wordLists the words found by each search
 //! @return a list of word items
 //---------------------------------------------------------------------------
 QList<WordTableModel::WordItem>
-WordVariationDialog::getWordItems(const QList<SearchSpec>& searchSpecs) const
+WordVariationDialog::getWordItems(const QList<QStringList>& wordLists) const
 {
     QList<WordTableModel::WordItem> wordItems;
     QMap<QString, QString> wordMap;
-    QListIterator<SearchSpec> lit (searchSpecs);
+    QListIterator<QStringList> lit (wordLists);
     while (lit.hasNext()) {
-        QStringList wordList = wordEngine->search(lexicon, lit.next(), false);
+        const QStringList& wordList = lit.next();
         QStringListIterator wit (wordList);
         while (wit.hasNext()) {
             QString str = wit.next();
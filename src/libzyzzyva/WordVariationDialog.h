@@ -31,6 +31,7 @@
 #include <QDialog>
 #include <QList>
 #include <QLabel>
+#include <QStringList>
 
 class DefinitionLabel;
 class WordEngine;
@@ -46,10 +47,13 @@ class WordVariationDialog : public QDialog
                         0, Qt::WFlags f = 0);
     ~WordVariationDialog();
 
+    private slots:
+    void searchFinished(int requestId);
+
     private:
     void setWordVariation(const QString& word, WordVariationType variation);
-    QList<WordTableModel::WordItem> getWordItems(const QList<SearchSpec>&
-                                                 searchSpecs) const;
+    QList<WordTableModel::WordItem> getWordItems(const QList<QStringList>&
+                                                 wordLists) const;
     int getNumLists(WordVariationType variation);
 
     private:
@@ -66,6 +70,12 @@ class WordVariationDialog : public QDialog
     WordTableView*   bottomView;
     WordTableModel*  bottomModel;
     ZPushButton*     closeButton;
+
+    // The search for the words of the lists, and how to display them
+    int              searchRequestId;
+    bool             sortAlphabetically;
+    QStringList      listTitles;
+    QList<int>       listSizes;
 };
 
 #endif // ZYZZYVA_WORD_VARIATION_DIALOG_H
@@ -42,8 +42,11 @@ win32 {
 # Source files
 SOURCES = \
     AboutDialog.cpp \
+    AlphagramIndex.cpp \
     AnalyzeQuizDialog.cpp \
+    AttributeStore.cpp \
     Auxil.cpp \
+    BitmapIndex.cpp \
     CardboxAddDialog.cpp \
     CardboxForm.cpp \
     CardboxRemoveDialog.cpp \
@@ -60,8 +63,10 @@ SOURCES = \
     JudgeDialog.cpp \
     JudgeSelectDialog.cpp \
     LetterBag.cpp \
+    LexiconBundle.cpp \
     LexiconSelectDialog.cpp \
     LexiconSelectWidget.cpp \
+    LexiconStats.cpp \
     LexiconStyleDialog.cpp \
     LexiconStyleWidget.cpp \
     MainSettings.cpp \
@@ -79,9 +84,13 @@ SOURCES = \
     SearchForm.cpp \
     SearchCondition.cpp \
     SearchConditionForm.cpp \
+    SearchService.cpp \
     SearchSpec.cpp \
     SearchSpecForm.cpp \
+    SearchStream.cpp \
     SettingsDialog.cpp \
+    SubstringIndex.cpp \
+    WordBitmap.cpp \
     WordEngine.cpp \
     WordEntryDialog.cpp \
     WordGraph.cpp \
@@ -128,6 +137,7 @@ HEADERS = \
     QuizQuestion.h \
     SearchForm.h \
     SearchConditionForm.h \
+    SearchService.h \
     SearchSpecForm.h \
     SettingsDialog.h \
     WordEngine.h \
@@ -23,12 +23,73 @@
 //---------------------------------------------------------------------------
 
 #include <QtTest/QtTest>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include "WordEngine.h"
+#include "CreateDatabaseThread.h"
+#include "SearchService.h"
+#include "SearchStream.h"
 #include "MainSettings.h"
 #include "Auxil.h"
 #include "Defs.h"
 
+// Collects the words delivered by a search, optionally canceling the
+// search after the first batch
+class TestSearchStream : public SearchStream
+{
+    public:
+    TestSearchStream(bool c = false) : cancelAfterBatch(c), numBatches(0) { }
+    QStringList words;
+    bool cancelAfterBatch;
+    int numBatches;
+
+    protected:
+    void wordsFound(const QStringList& w) {
+        words += w;
+        ++numBatches;
+        if (cancelAfterBatch)
+            cancel();
+    }
+};
+
+// Runs a search on a pool thread and keeps its results
+class SearchRunner : public QRunnable
+{
+    public:
+    SearchRunner(const WordEngine* e, const QString& l, const SearchSpec& s)
+        : engine(e), lexicon(l), spec(s) { setAutoDelete(false); }
+    QStringList results;
+
+    void run() { results = engine->search(lexicon, spec, true); }
+
+    private:
+    const WordEngine* engine;
+    QString lexicon;
+    SearchSpec spec;
+};
+
+// Collects the results of the requests made to a search service
+class SearchCollector : public QObject
+{
+    Q_OBJECT
+    public:
+    SearchCollector(SearchService* s) : service(s) {
+        connect(s, SIGNAL(searchFinished(int)), SLOT(searchFinished(int))); }
+    QMap<int, QStringList> results;
+    QList<int> canceled;
+
+    public slots:
+    void searchFinished(int requestId) {
+        results[requestId] = service->getResults(requestId).value(0);
+        if (service->isCanceled(requestId))
+            canceled.append(requestId);
+    }
+
+    private:
+    SearchService* service;
+};
+
 class WordEngineTest : public QObject
 {
     Q_OBJECT
@@ -38,9 +99,26 @@ class WordEngineTest : public QObject
     private slots:
     void testSearch_data();
     void testSearch();
+    void testSearchStream_data();
+    void testSearchStream();
+    void testSearchStreamBudget();
+    void testConcurrentSearch_data();
+    void testConcurrentSearch();
+    void testSearchService();
+    void testHooks_data();
+    void testHooks();
+    void testWordIds();
+    void testTextImport();
+    void testAttributePhases_data();
+    void testAttributePhases();
+    void testBundle();
+    void benchmarkSearch_data();
+    void benchmarkSearch();
 
     private:
     void tryImport();
+    bool readSearchSpec(const QString& testName, SearchSpec& spec);
+    bool readSearchResults(const QString& testName, QStringList& results);
 
     private:
     WordEngine engine;
@@ -98,15 +176,21 @@ WordEngineTest::testSearch_data()
 
     QTest::newRow("3s") << "3s";
     QTest::newRow("7s-type1") << "7s-type1";
+    QTest::newRow("anagram-aeinst") << "anagram-aeinst";
     QTest::newRow("anagram-_aeinst") << "anagram-_aeinst";
     QTest::newRow("anagram-__aerstw") << "anagram-__aerstw";
     QTest::newRow("pattern-p_r_s") << "pattern-p_r_s";
+    QTest::newRow("pattern-infix-z_z") << "pattern-infix-z_z";
+    QTest::newRow("pattern-infix-q-no-u") << "pattern-infix-q-no-u";
     QTest::newRow("subanagram-aeiprs") << "subanagram-aeiprs";
+    QTest::newRow("conjunction-q-subanagram") << "conjunction-q-subanagram";
     QTest::newRow("4s-take-A-prefix") << "4s-take-A-prefix";
     QTest::newRow("3s-8s-take-X-suffix") << "3s-8s-take-X-suffix";
     QTest::newRow("Q-no-U-new-in-owl2") << "Q-no-U-new-in-owl2";
     QTest::newRow("8s-with-5-vowels") << "8s-with-5-vowels";
     QTest::newRow("8s-with-7-anagrams") << "8s-with-7-anagrams";
+    QTest::newRow("5s-front-hooks-with-z") << "5s-front-hooks-with-z";
+    QTest::newRow("4s-no-vowel-no-back-hook") << "4s-no-vowel-no-back-hook";
     QTest::newRow("8s-prob-1001-2000") << "8s-prob-1001-2000";
     QTest::newRow("anagram-Z-vowel-vowel") << "anagram-Z-vowel-vowel";
     QTest::newRow("pattern-vowel-D-vowel") << "pattern-vowel-D-vowel";
@@ -124,48 +208,588 @@ WordEngineTest::testSearch()
     tryImport();
 
     QFETCH(QString, testName);
-    QString testFilename = testName + ".zzs";
-    QString resultFilename = testName + ".txt";
 
-    // Create a SearchSpec from a test file
-    QFile testFile (Auxil::getRootDir() + "/src/tests/data/" + testFilename);
-    if (!testFile.open(QIODevice::ReadOnly | QIODevice::Text))
-        QFAIL("Cannot open test file");
+    SearchSpec spec;
+    if (!readSearchSpec(testName, spec))
+        QFAIL("Error in test file");
 
-    QString errorMsg;
-    int errorLine = 0;
-    int errorColumn = 0;
+    // Get a list of expected results
+    QStringList expectedResults;
+    if (!readSearchResults(testName, expectedResults))
+        QFAIL("Cannot open result file");
 
-    QDomDocument document;
-    bool success = document.setContent(&testFile, false, &errorMsg,
-                                       &errorLine, &errorColumn);
+    // Do the search and test the results
+    QStringList foundResults = engine.search(TEST_LEXICON, spec, true);
+    qSort(foundResults);
 
-    if (!success)
-        QFAIL("Error in test file XML");
+    QCOMPARE(foundResults, expectedResults);
+}
+
+//---------------------------------------------------------------------------
+//  testSearchStream_data
+//
+//! Set up data files for streaming search tests.  The same specs are used
+//! as for the search tests.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testSearchStream_data()
+{
+    testSearch_data();
+}
+
+//---------------------------------------------------------------------------
+//  testSearchStream
+//
+//! Test that a streaming search delivers the same words it returns, and
+//! that they are the expected search results.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testSearchStream()
+{
+    tryImport();
+
+    QFETCH(QString, testName);
 
     SearchSpec spec;
-    if (!spec.fromDomElement(document.documentElement()))
+    if (!readSearchSpec(testName, spec))
         QFAIL("Error in test file");
 
-    // Get a list of expected results
-    QFile resultFile (Auxil::getRootDir() + "/src/tests/data/" +
-                      resultFilename);
-    if (!resultFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    QStringList expectedResults;
+    if (!readSearchResults(testName, expectedResults))
         QFAIL("Cannot open result file");
 
+    TestSearchStream stream;
+    stream.setBatchSize(1);
+    QStringList foundResults = engine.search(TEST_LEXICON, spec, true,
+                                             &stream);
+    qSort(foundResults);
+    qSort(stream.words);
+
+    QCOMPARE(stream.words, foundResults);
+    QCOMPARE(foundResults, expectedResults);
+    QVERIFY(!stream.isStopped());
+}
+
+//---------------------------------------------------------------------------
+//  testSearchStreamBudget
+//
+//! Test that a streaming search stops when it reaches its result limit or
+//! is canceled.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testSearchStreamBudget()
+{
+    tryImport();
+
+    SearchSpec spec;
+    if (!readSearchSpec("3s", spec))
+        QFAIL("Error in test file");
+
+    TestSearchStream limitStream;
+    limitStream.setMaxResults(10);
+    QStringList foundResults = engine.search(TEST_LEXICON, spec, true,
+                                             &limitStream);
+    QCOMPARE(foundResults.size(), 10);
+    QCOMPARE(limitStream.words.size(), 10);
+    QVERIFY(limitStream.isTruncated());
+    QVERIFY(!limitStream.isCanceled());
+
+    TestSearchStream cancelStream (true);
+    cancelStream.setBatchSize(5);
+    foundResults = engine.search(TEST_LEXICON, spec, true, &cancelStream);
+    QVERIFY(foundResults.isEmpty());
+    QCOMPARE(cancelStream.numBatches, 1);
+    QVERIFY(cancelStream.isCanceled());
+}
+
+//---------------------------------------------------------------------------
+//  testConcurrentSearch_data
+//
+//! Set up data files for concurrent search tests.  The same specs are used
+//! as for the search tests.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testConcurrentSearch_data()
+{
+    testSearch_data();
+}
+
+//---------------------------------------------------------------------------
+//  testConcurrentSearch
+//
+//! Test that a search run on several threads at once gives the expected
+//! results on every thread.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testConcurrentSearch()
+{
+    tryImport();
+
+    QFETCH(QString, testName);
+
+    SearchSpec spec;
+    if (!readSearchSpec(testName, spec))
+        QFAIL("Error in test file");
+
     QStringList expectedResults;
-    while (!resultFile.atEnd()) {
-        expectedResults.append(resultFile.readLine().trimmed());
+    if (!readSearchResults(testName, expectedResults))
+        QFAIL("Cannot open result file");
+
+    const int numThreads = 4;
+    QThreadPool pool;
+    pool.setMaxThreadCount(numThreads);
+    QList<SearchRunner*> runners;
+    for (int i = 0; i < numThreads; ++i) {
+        SearchRunner* runner = new SearchRunner(&engine, TEST_LEXICON, spec);
+        runners.append(runner);
+        pool.start(runner);
     }
-    qSort(expectedResults);
+    pool.waitForDone();
 
-    // Do the search and test the results
-    QStringList foundResults = engine.search(TEST_LEXICON, spec, true);
-    qSort(foundResults);
+    QList<QStringList> foundResults;
+    foreach (SearchRunner* runner, runners) {
+        qSort(runner->results);
+        foundResults.append(runner->results);
+    }
+    qDeleteAll(runners);
+
+    foreach (const QStringList& results, foundResults)
+        QCOMPARE(results, expectedResults);
+}
+
+//---------------------------------------------------------------------------
+//  testSearchService
+//
+//! Test that the search service delivers the results of a request, and
+//! that a request is canceled when its requester makes another one.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testSearchService()
+{
+    tryImport();
+
+    SearchSpec spec;
+    if (!readSearchSpec("anagram-aeinst", spec))
+        QFAIL("Error in test file");
+
+    QStringList expectedResults;
+    if (!readSearchResults("anagram-aeinst", expectedResults))
+        QFAIL("Cannot open result file");
 
+    SearchService service (&engine);
+    SearchCollector collector (&service);
+    QObject requester;
+    int firstId = service.search(&requester, TEST_LEXICON, spec, true);
+    int secondId = service.search(&requester, TEST_LEXICON, spec, true);
+
+    QTime timer;
+    timer.start();
+    while ((collector.results.size() < 2) && (timer.elapsed() < 10000))
+        QTest::qWait(10);
+
+    QCOMPARE(collector.results.size(), 2);
+    QCOMPARE(collector.canceled, QList<int>() << firstId);
+
+    QStringList foundResults = collector.results[secondId];
+    qSort(foundResults);
     QCOMPARE(foundResults, expectedResults);
 }
 
+//---------------------------------------------------------------------------
+//  testHooks_data
+//
+//! Set up words for hook tests.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testHooks_data()
+{
+    QTest::addColumn<QString>("word");
+
+    QTest::newRow("A") << "A";
+    QTest::newRow("AT") << "AT";
+    QTest::newRow("QI") << "QI";
+    QTest::newRow("ARE") << "ARE";
+    QTest::newRow("RATINE") << "RATINE";
+    QTest::newRow("XYST") << "XYST";
+    QTest::newRow("ZZZ") << "ZZZ";
+}
+
+//---------------------------------------------------------------------------
+//  testHooks
+//
+//! Test that hooks found by walking the word graphs match the hooks found
+//! by pattern searches.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testHooks()
+{
+    tryImport();
+
+    QFETCH(QString, word);
+
+    SearchSpec spec;
+    SearchCondition condition;
+    condition.type = SearchCondition::PatternMatch;
+    spec.conditions.append(condition);
+
+    QString expectedFront;
+    spec.conditions[0].stringValue = "?" + word;
+    QStringList frontWords = engine.search(TEST_LEXICON, spec, true);
+    qSort(frontWords);
+    foreach (const QString& str, frontWords)
+        expectedFront += str.at(0).toLower();
+
+    QString expectedBack;
+    spec.conditions[0].stringValue = word + "?";
+    QStringList backWords = engine.search(TEST_LEXICON, spec, true);
+    qSort(backWords);
+    foreach (const QString& str, backWords)
+        expectedBack += str.at(str.length() - 1).toLower();
+
+    QCOMPARE(WordGraph::getLetters(engine.getFrontHooks(TEST_LEXICON, word)),
+             expectedFront);
+    QCOMPARE(WordGraph::getLetters(engine.getBackHooks(TEST_LEXICON, word)),
+             expectedBack);
+}
+
+//---------------------------------------------------------------------------
+//  testWordIds
+//
+//! Test that every word is numbered by its position in alphabetical order,
+//! and that each number leads back to its word.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testWordIds()
+{
+    tryImport();
+
+    SearchSpec spec;
+    SearchCondition condition;
+    condition.type = SearchCondition::PatternMatch;
+    condition.stringValue = "*";
+    spec.conditions.append(condition);
+
+    QStringList words = engine.search(TEST_LEXICON, spec, true);
+    qSort(words);
+    QCOMPARE(engine.getNumWords(TEST_LEXICON), words.size());
+
+    for (int i = 0; i < words.size(); ++i) {
+        QCOMPARE(engine.getWordId(TEST_LEXICON, words[i]), i);
+        QCOMPARE(engine.getWordAt(TEST_LEXICON, i), words[i]);
+    }
+
+    QCOMPARE(engine.getWordId(TEST_LEXICON, "QX"), -1);
+    QCOMPARE(engine.getWordId(TEST_LEXICON, "AAHINGS"), -1);
+    QCOMPARE(engine.getWordAt(TEST_LEXICON, -1), QString());
+    QCOMPARE(engine.getWordAt(TEST_LEXICON, words.size()), QString());
+}
+
+//---------------------------------------------------------------------------
+//  testTextImport
+//
+//! Test that a lexicon imported from a text file accepts the same words and
+//! has the same hooks and pattern matches as the same words loaded from a
+//! DAWG, and that a text file without words is not imported.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testTextImport()
+{
+    tryImport();
+
+    // The two-letter words and their three-letter hooks, so every hook of a
+    // two-letter word is in the text lexicon
+    SearchSpec spec;
+    SearchCondition condition;
+    condition.type = SearchCondition::PatternMatch;
+    condition.stringValue = "??";
+    spec.conditions.append(condition);
+    QStringList twos = engine.search(TEST_LEXICON, spec, true);
+    spec.conditions[0].stringValue = "???";
+    QStringList threes = engine.search(TEST_LEXICON, spec, true);
+    QVERIFY(!twos.isEmpty());
+
+    QString filename = QDir::tempPath() + "/zyzzyva-test.txt";
+    QFile file (filename);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    foreach (const QString& word, twos + threes)
+        file.write(word.toLower().toLatin1() + "\n");
+    file.close();
+
+    WordEngine textEngine;
+    QString errString;
+    int imported = textEngine.importTextFile(TEST_LEXICON, filename, false,
+                                             &errString);
+    QVERIFY2(imported, errString.toUtf8().constData());
+    QCOMPARE(imported, twos.size() + threes.size());
+
+    foreach (const QString& word, twos + threes)
+        QVERIFY(textEngine.isAcceptable(TEST_LEXICON, word));
+    QVERIFY(!textEngine.isAcceptable(TEST_LEXICON, "QX"));
+    QVERIFY(!textEngine.isAcceptable(TEST_LEXICON, "ABLE"));
+
+    foreach (const QString& word, twos) {
+        QCOMPARE(textEngine.getFrontHooks(TEST_LEXICON, word),
+                 engine.getFrontHooks(TEST_LEXICON, word));
+        QCOMPARE(textEngine.getBackHooks(TEST_LEXICON, word),
+                 engine.getBackHooks(TEST_LEXICON, word));
+    }
+
+    spec.conditions[0].stringValue = "?A*";
+    QStringList textWords = textEngine.search(TEST_LEXICON, spec, true);
+    QStringList dawgWords = engine.search(TEST_LEXICON, spec, true);
+    QStringList expectedWords;
+    foreach (const QString& word, dawgWords) {
+        if (word.length() <= 3)
+            expectedWords.append(word);
+    }
+    qSort(textWords);
+    qSort(expectedWords);
+    QCOMPARE(textWords, expectedWords);
+
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate |
+                      QIODevice::Text));
+    file.write("# No words\n");
+    file.close();
+    errString.clear();
+    QCOMPARE(textEngine.importTextFile(TEST_LEXICON, filename, false,
+                                       &errString), 0);
+    QVERIFY(!errString.isEmpty());
+
+    QFile::remove(filename);
+}
+
+//---------------------------------------------------------------------------
+//  testAttributePhases_data
+//
+//! Set up searches combining a Length condition, checked by the attribute
+//! store, with a condition only the database can check.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testAttributePhases_data()
+{
+    QTest::addColumn<int>("type");
+    QTest::addColumn<QString>("value");
+    QTest::addColumn<int>("minLength");
+    QTest::addColumn<int>("maxLength");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("length-definition")
+        << int(SearchCondition::Definition) << "feline" << 4 << 4
+        << (QStringList() << "LION" << "LYNX" << "PURR");
+    QTest::newRow("length-part-of-speech")
+        << int(SearchCondition::PartOfSpeech) << "v" << 4 << 4
+        << (QStringList() << "BARK" << "PURR");
+    QTest::newRow("length-range-definition")
+        << int(SearchCondition::Definition) << "canine" << 3 << 4
+        << (QStringList() << "BARK" << "DOG");
+}
+
+//---------------------------------------------------------------------------
+//  testAttributePhases
+//
+//! Test that Length conditions are still checked when the attribute store
+//! is loaded and the only other phase is a database search.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testAttributePhases()
+{
+    QFETCH(int, type);
+    QFETCH(QString, value);
+    QFETCH(int, minLength);
+    QFETCH(int, maxLength);
+    QFETCH(QStringList, expected);
+
+    QString filename = QDir::tempPath() + "/zyzzyva-test-defs.txt";
+    QString dbFilename = QDir::tempPath() + "/zyzzyva-test.db";
+    QFile file (filename);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write("CAT a small feline [n]\n"
+               "LION a large feline [n]\n"
+               "LYNX a wild feline [n]\n"
+               "KITTEN a young feline [n]\n"
+               "PURR to make the sound of a contented feline [v]\n"
+               "DOG a canine [n]\n"
+               "BARK to make the sound of a canine [v]\n");
+    file.close();
+
+    WordEngine dbEngine;
+    QString lexicon = Defs::LEXICON_CUSTOM;
+    QString errString;
+    QVERIFY2(dbEngine.importTextFile(lexicon, filename, true, &errString),
+             errString.toUtf8().constData());
+
+    CreateDatabaseThread thread (&dbEngine, lexicon, dbFilename, filename);
+    thread.start();
+    thread.wait();
+    QVERIFY2(thread.getError().isEmpty(),
+             thread.getError().toUtf8().constData());
+    QVERIFY2(dbEngine.connectToDatabase(lexicon, dbFilename, &errString),
+             errString.toUtf8().constData());
+
+    SearchSpec spec;
+    SearchCondition condition;
+    condition.type = SearchCondition::Length;
+    condition.minValue = minLength;
+    condition.maxValue = maxLength;
+    spec.conditions.append(condition);
+    condition = SearchCondition();
+    condition.type = SearchCondition::SearchType(type);
+    condition.stringValue = value;
+    spec.conditions.append(condition);
+
+    QVERIFY(dbEngine.explainSearch(lexicon, spec).contains(
+        "attribute store"));
+
+    QStringList words = dbEngine.search(lexicon, spec, true);
+    qSort(words);
+    QCOMPARE(words, expected);
+
+    dbEngine.disconnectFromDatabase(lexicon);
+    QFile::remove(dbFilename);
+    QFile::remove(filename);
+}
+
+//---------------------------------------------------------------------------
+//  testBundle
+//
+//! Test that a lexicon imported from a lexicon bundle has the same words,
+//! word numbers, hooks and anagrams as the lexicon the bundle was written
+//! from, and that a bundle is not imported once its sources change.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::testBundle()
+{
+    tryImport();
+
+    QString filename = QDir::tempPath() + "/zyzzyva-test.zlb";
+    QStringList sources;
+    sources << (Auxil::getWordsDir() + "/north-american/owl2.dwg");
+    sources << (Auxil::getWordsDir() + "/north-american/owl2-r.dwg");
+
+    QString errString;
+    QVERIFY2(engine.writeBundle(TEST_LEXICON, filename, sources, &errString),
+             errString.toUtf8().constData());
+
+    WordEngine bundleEngine;
+    QVERIFY2(bundleEngine.importBundle(TEST_LEXICON, filename, sources,
+                                       &errString),
+             errString.toUtf8().constData());
+
+    SearchSpec spec;
+    SearchCondition condition;
+    condition.type = SearchCondition::PatternMatch;
+    condition.stringValue = "*";
+    spec.conditions.append(condition);
+
+    QStringList words = engine.search(TEST_LEXICON, spec, true);
+    QCOMPARE(bundleEngine.search(TEST_LEXICON, spec, true), words);
+    QCOMPARE(bundleEngine.getNumWords(TEST_LEXICON),
+             engine.getNumWords(TEST_LEXICON));
+
+    foreach (const QString& word, words) {
+        QCOMPARE(bundleEngine.getWordId(TEST_LEXICON, word),
+                 engine.getWordId(TEST_LEXICON, word));
+        QCOMPARE(bundleEngine.getFrontHooks(TEST_LEXICON, word),
+                 engine.getFrontHooks(TEST_LEXICON, word));
+        QCOMPARE(bundleEngine.getBackHooks(TEST_LEXICON, word),
+                 engine.getBackHooks(TEST_LEXICON, word));
+    }
+
+    spec.conditions[0].type = SearchCondition::AnagramMatch;
+    spec.conditions[0].stringValue = "AEINST";
+    QCOMPARE(bundleEngine.search(TEST_LEXICON, spec, true),
+             engine.search(TEST_LEXICON, spec, true));
+
+    QStringList changedSources = sources;
+    changedSources << filename;
+    QVERIFY(!bundleEngine.importBundle(TEST_LEXICON, filename,
+                                       changedSources));
+
+    QFile::remove(filename);
+}
+
+//---------------------------------------------------------------------------
+//  benchmarkSearch_data
+//
+//! Set up data files for search benchmarks.  The same specs are used as
+//! for the search tests.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::benchmarkSearch_data()
+{
+    testSearch_data();
+}
+
+//---------------------------------------------------------------------------
+//  benchmarkSearch
+//
+//! Measure search time.
+//---------------------------------------------------------------------------
+void
+WordEngineTest::benchmarkSearch()
+{
+    tryImport();
+
+    QFETCH(QString, testName);
+
+    SearchSpec spec;
+    if (!readSearchSpec(testName, spec))
+        QFAIL("Error in test file");
+
+    QBENCHMARK {
+        engine.search(TEST_LEXICON, spec, true);
+    }
+}
+
+//---------------------------------------------------------------------------
+//  readSearchSpec
+//
+//! Create a search spec from a test file.
+//
+//! @param testName the name of the test
+//! @param spec return the search spec
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordEngineTest::readSearchSpec(const QString& testName, SearchSpec& spec)
+{
+    QFile testFile (Auxil::getRootDir() + "/src/tests/data/" + testName +
+                    ".zzs");
+    if (!testFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QDomDocument document;
+    if (!document.setContent(&testFile, false))
+        return false;
+
+    return spec.fromDomElement(document.documentElement());
+}
+
+//---------------------------------------------------------------------------
+//  readSearchResults
+//
+//! Read the expected results of a search from a test file.
+//
+//! @param testName the name of the test
+//! @param results return the expected results, in sorted order
+//! @return true if successful, false otherwise
+//---------------------------------------------------------------------------
+bool
+WordEngineTest::readSearchResults(const QString& testName, QStringList&
+                                  results)
+{
+    QFile resultFile (Auxil::getRootDir() + "/src/tests/data/" + testName +
+                      ".txt");
+    if (!resultFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    while (!resultFile.atEnd()) {
+        results.append(resultFile.readLine().trimmed());
+    }
+    qSort(results);
+    return true;
+}
+
 // Create a main function for a standalone executable
 QTEST_MAIN(WordEngineTest);
 #include "WordEngineTest.moc"